@@ -0,0 +1,365 @@
+/**
+ * @file e2e_bench.cpp
+ * @brief End-to-end ingest and matching benchmark on a synthetic corpus
+ *
+ * Writes a deterministic corpus of WAV files (melodies, chord sequences and
+ * shaped noise), ingests it with PipelineScheduler and queries the index
+ * with altered copies of every track:
+ *
+ * - transcoded: band-limited to 8 kHz and requantized to 12 bits
+ * - pitched: played back 1% fast
+ * - noisy: white noise added at 10 dB SNR
+ * - truncated: the middle third only
+ *
+ * Tracks that were never indexed are queried as well, so false matches
+ * show up in the precision. The last two lines of the report are the
+ * headline numbers: throughput as a real-time factor of the ingest, and
+ * accuracy as the F1 score of the matches. Every other line is
+ * "key value", so runs can be diffed or parsed.
+ *
+ * Usage: sortify_e2e [--tracks N] [--distractors N] [--seconds S] [--seed N]
+ */
+
+#include <vector>
+#include <string>
+#include <random>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "pipeline_scheduler.hpp"
+#include "duplicate_detector.hpp"
+#include "resampler.hpp"
+#include "logger.hpp"
+#include "synthetic_signals.hpp"
+
+namespace {
+
+using namespace sortify::audio;
+
+constexpr unsigned int corpusSampleRate = 44100;
+
+/**
+ * @struct CorpusOptions
+ * @brief Command line settings
+ */
+struct CorpusOptions {
+    unsigned int tracks = 24;       ///< Indexed tracks
+    unsigned int distractors = 8;   ///< Tracks that are queried but never indexed
+    float seconds = 20.0f;          ///< Length of every track
+    unsigned int seed = 1;          ///< Varies the whole corpus
+};
+
+enum class Variant {
+    TRANSCODED,
+    PITCHED,
+    NOISY,
+    TRUNCATED,
+    COUNT
+};
+
+constexpr size_t variantCount = static_cast<size_t>(Variant::COUNT);
+
+const char* variantName(Variant variant) {
+    switch (variant) {
+        case Variant::TRANSCODED: return "transcoded";
+        case Variant::PITCHED:    return "pitched";
+        case Variant::NOISY:      return "noisy";
+        case Variant::TRUNCATED:  return "truncated";
+        default:                  return "unknown";
+    }
+}
+
+/// Notes of random pitch and length with a harmonic and a noise floor.
+/// sortify::testing::generateMelody has too few distinct melodies for a
+/// corpus, and notes on a scale would share most of their hashes.
+std::vector<AudioSample> generateMelodyLine(float duration, unsigned int sampleRate, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> octaves(0.0, 4.0);
+    std::uniform_int_distribution<size_t> noteLength(sampleRate / 8, sampleRate / 2);
+    std::normal_distribution<float> noise(0.0f, 0.03f);
+
+    std::vector<AudioSample> samples(static_cast<size_t>(duration * sampleRate));
+    double frequency = 220.0;
+    double phase = 0.0;
+    size_t noteEnd = 0;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        if (i == noteEnd) {
+            frequency = 200.0 * std::pow(2.0, octaves(rng));
+            noteEnd = i + noteLength(rng);
+        }
+        // Accumulating the phase avoids clicks at the note changes
+        phase += 2.0 * M_PI * frequency / sampleRate;
+        samples[i] = static_cast<AudioSample>(0.5 * std::sin(phase) + 0.2 * std::sin(2.0 * phase)) + noise(rng);
+    }
+    return samples;
+}
+
+/// Chords of three sine tones that change every half second
+std::vector<AudioSample> generateTones(float duration, unsigned int sampleRate, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> frequency(200.0, 4000.0);
+    const size_t chordLength = sampleRate / 2;
+    const size_t fade = sampleRate / 100;
+
+    std::vector<AudioSample> samples(static_cast<size_t>(duration * sampleRate));
+    double tones[3] = {};
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const size_t position = i % chordLength;
+        if (position == 0) {
+            for (double& tone : tones) {
+                tone = frequency(rng);
+            }
+        }
+        // Short fades keep the chord changes from splattering over every bin
+        const double envelope = std::min(1.0, static_cast<double>(std::min(position, chordLength - position)) / fade);
+        const double t = static_cast<double>(i) / sampleRate;
+        double value = 0.0;
+        for (double tone : tones) {
+            value += std::sin(2.0 * M_PI * tone * t);
+        }
+        samples[i] = static_cast<AudioSample>(0.25 * envelope * value);
+    }
+    return samples;
+}
+
+/// Noise bursts on a beat, each through a one-pole low-pass with its own cutoff
+std::vector<AudioSample> generateShapedNoise(float duration, unsigned int sampleRate, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    std::uniform_real_distribution<float> smoothing(0.05f, 0.9f);
+    const size_t beatLength = sampleRate / 4;
+
+    std::vector<AudioSample> samples(static_cast<size_t>(duration * sampleRate));
+    float alpha = 0.5f;
+    float state = 0.0f;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const size_t position = i % beatLength;
+        if (position == 0) {
+            alpha = smoothing(rng);
+        }
+        state += alpha * (noise(rng) - state);
+        const float decay = std::exp(-8.0f * static_cast<float>(position) / beatLength);
+        samples[i] = 0.4f * decay * state;
+    }
+    return samples;
+}
+
+/// Reference track number `index`; every third track of each kind
+std::vector<AudioSample> generateTrack(unsigned int index, const CorpusOptions& options) {
+    const unsigned int seed = options.seed * 100003u + index;
+    switch (index % 3) {
+        case 0:  return generateMelodyLine(options.seconds, corpusSampleRate, seed);
+        case 1:  return generateTones(options.seconds, corpusSampleRate, seed);
+        default: return generateShapedNoise(options.seconds, corpusSampleRate, seed);
+    }
+}
+
+/// Altered copy of a track, as a query would see it
+std::vector<AudioSample> makeVariant(const std::vector<AudioSample>& track, Variant variant, unsigned int seed) {
+    switch (variant) {
+        case Variant::TRANSCODED: {
+            auto down = resampleAudio(track, corpusSampleRate, 16000);
+            if (!down.isSuccess()) {
+                return {};
+            }
+            auto up = resampleAudio(down.getValue(), 16000, corpusSampleRate);
+            if (!up.isSuccess()) {
+                return {};
+            }
+            std::vector<AudioSample> samples = std::move(up).take();
+            for (auto& sample : samples) {
+                sample = std::round(sample * 2048.0f) / 2048.0f;
+            }
+            return samples;
+        }
+        case Variant::PITCHED: {
+            // Resampled to 1% fewer samples, then played at the original rate
+            auto faster = resampleAudio(track, corpusSampleRate, corpusSampleRate * 99 / 100);
+            return faster.isSuccess() ? std::move(faster).take() : std::vector<AudioSample>();
+        }
+        case Variant::NOISY: {
+            double power = 0.0;
+            for (AudioSample sample : track) {
+                power += static_cast<double>(sample) * sample;
+            }
+            const double rms = std::sqrt(power / std::max<size_t>(track.size(), 1));
+            std::mt19937 rng(seed);
+            std::normal_distribution<float> noise(0.0f, static_cast<float>(rms * std::pow(10.0, -10.0 / 20.0)));
+            std::vector<AudioSample> samples = track;
+            for (auto& sample : samples) {
+                sample += noise(rng);
+            }
+            return samples;
+        }
+        case Variant::TRUNCATED:
+            return std::vector<AudioSample>(track.begin() + track.size() / 3, track.begin() + 2 * track.size() / 3);
+        default:
+            return track;
+    }
+}
+
+/// Peak resident set size of the process in bytes
+uint64_t peakResidentBytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024u;
+#endif
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool parseArguments(int argc, char** argv, CorpusOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* value = argv[++i];
+        char* end = nullptr;
+        if (std::strcmp(argv[i - 1], "--tracks") == 0) {
+            options.tracks = static_cast<unsigned int>(std::strtoul(value, &end, 10));
+        } else if (std::strcmp(argv[i - 1], "--distractors") == 0) {
+            options.distractors = static_cast<unsigned int>(std::strtoul(value, &end, 10));
+        } else if (std::strcmp(argv[i - 1], "--seconds") == 0) {
+            options.seconds = std::strtof(value, &end);
+        } else if (std::strcmp(argv[i - 1], "--seed") == 0) {
+            options.seed = static_cast<unsigned int>(std::strtoul(value, &end, 10));
+        } else {
+            return false;
+        }
+        if (end == value || *end != '\0') {
+            return false;
+        }
+    }
+    return options.tracks > 0 && options.seconds >= 3.0f;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CorpusOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        std::fprintf(stderr, "Usage: %s [--tracks N] [--distractors N] [--seconds S (>= 3)] [--seed N]\n", argv[0]);
+        return 1;
+    }
+    Logger::setLogLevel(LogLevel::ERROR);
+
+    char directory[] = "/tmp/sortify_e2e_XXXXXX";
+    if (::mkdtemp(directory) == nullptr) {
+        std::fprintf(stderr, "Failed to create a corpus directory\n");
+        return 1;
+    }
+
+    // Tracks are regenerated from their seeds for the queries, so the
+    // corpus is never held in memory and the peak RSS is the pipeline's
+    std::vector<std::string> paths;
+    for (unsigned int i = 0; i < options.tracks; ++i) {
+        paths.push_back(std::string(directory) + "/track_" + std::to_string(i) + ".wav");
+        if (!sortify::testing::writeWav16(paths.back(), generateTrack(i, options), corpusSampleRate)) {
+            std::fprintf(stderr, "Failed to write %s\n", paths.back().c_str());
+            return 1;
+        }
+    }
+
+    // Ingest: read, decode, fingerprint and index every file
+    PipelineScheduler pipeline;
+    FingerprintIndex index;
+    auto ingestStart = std::chrono::steady_clock::now();
+    const auto results = pipeline.buildIndex(paths, index);
+    const double ingestSeconds = secondsSince(ingestStart);
+    const uint64_t peakRss = peakResidentBytes();
+
+    for (const auto& path : paths) {
+        std::remove(path.c_str());
+    }
+    ::rmdir(directory);
+
+    size_t failedFiles = 0;
+    for (const auto& result : results) {
+        if (result.status != FileStatus::OK) {
+            std::fprintf(stderr, "%s: %s\n", result.path.c_str(), result.error.c_str());
+            ++failedFiles;
+        }
+    }
+    const double audioSeconds = options.tracks * options.seconds;
+
+    // Queries: a match is reported with the thresholds duplicate detection uses
+    const DuplicateOptions thresholds;
+    const FingerprintConfig config;
+    size_t truePositives[variantCount] = {};
+    size_t reported = 0;
+    size_t correct = 0;
+    size_t falseDistractorMatches = 0;
+    size_t queries = 0;
+    auto queryStart = std::chrono::steady_clock::now();
+
+    auto bestMatch = [&](const std::vector<AudioSample>& samples) {
+        ++queries;
+        auto fingerprint = fingerprintSamples(samples, config);
+        if (!fingerprint.isSuccess()) {
+            return -1;
+        }
+        auto candidates = index.query(fingerprint.getValue(), 1, thresholds.minScore);
+        if (!candidates.isSuccess() || candidates.getValue().empty() ||
+            candidates.getValue()[0].confidence < thresholds.minConfidence) {
+            return -1;
+        }
+        return candidates.getValue()[0].songId;
+    };
+
+    for (unsigned int i = 0; i < options.tracks; ++i) {
+        const auto track = generateTrack(i, options);
+        for (size_t v = 0; v < variantCount; ++v) {
+            const int match = bestMatch(makeVariant(track, Variant(v), options.seed + i));
+            if (match >= 0) {
+                ++reported;
+            }
+            if (match == static_cast<int>(i)) {
+                ++truePositives[v];
+                ++correct;
+            }
+        }
+    }
+    for (unsigned int i = 0; i < options.distractors; ++i) {
+        if (bestMatch(generateTrack(options.tracks + i, options)) >= 0) {
+            ++reported;
+            ++falseDistractorMatches;
+        }
+    }
+    const double querySeconds = secondsSince(queryStart);
+
+    const size_t positives = static_cast<size_t>(options.tracks) * variantCount;
+    const double recall = static_cast<double>(correct) / positives;
+    const double precision = reported > 0 ? static_cast<double>(correct) / reported : 1.0;
+    const double f1 = precision + recall > 0.0 ? 2.0 * precision * recall / (precision + recall) : 0.0;
+
+    std::printf("files %u\n", options.tracks);
+    std::printf("failed_files %zu\n", failedFiles);
+    std::printf("audio_hours %.4f\n", audioSeconds / 3600.0);
+    std::printf("ingest_seconds %.3f\n", ingestSeconds);
+    std::printf("files_per_second %.2f\n", options.tracks / ingestSeconds);
+    std::printf("peak_rss_mib %.1f\n", static_cast<double>(peakRss) / (1024.0 * 1024.0));
+    std::printf("index_bytes_per_audio_hour %.0f\n", index.memoryBytes() / (audioSeconds / 3600.0));
+    std::printf("queries_per_second %.2f\n", queries / querySeconds);
+    for (size_t v = 0; v < variantCount; ++v) {
+        std::printf("recall_%s %.4f\n", variantName(Variant(v)), static_cast<double>(truePositives[v]) / options.tracks);
+    }
+    std::printf("distractor_false_matches %zu/%u\n", falseDistractorMatches, options.distractors);
+    std::printf("recall %.4f\n", recall);
+    std::printf("precision %.4f\n", precision);
+    std::printf("throughput_realtime_factor %.2f\n", audioSeconds / ingestSeconds);
+    std::printf("accuracy_f1 %.4f\n", f1);
+    return failedFiles == 0 ? 0 : 1;
+}
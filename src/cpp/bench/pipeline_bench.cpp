@@ -0,0 +1,426 @@
+/**
+ * @file pipeline_bench.cpp
+ * @brief Microbenchmarks of every fingerprinting stage
+ *
+ * All inputs are generated from fixed seeds, so runs on the same machine
+ * are comparable. Stages report throughput as samples/s, frames/s,
+ * hashes/s or queries/s; compare runs with Google Benchmark's compare.py.
+ */
+
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+#include <thread>
+#include <chrono>
+#include "audio_fingerprint.hpp"
+#include "compact_fingerprint.hpp"
+#include "fingerprint_stages.hpp"
+#include "fingerprint_index.hpp"
+#include "fingerprint_compare.hpp"
+#include "wav_reader.hpp"
+#include "resampler.hpp"
+#include "audio_quality.hpp"
+#include "batch_fingerprinter.hpp"
+#include "pipeline_scheduler.hpp"
+#include "logger.hpp"
+#include "synthetic_signals.hpp"
+
+namespace {
+
+using namespace sortify::audio;
+
+constexpr unsigned int benchSampleRate = 44100;
+constexpr float benchTrackSeconds = 30.0f;
+
+/// One deterministic track shared by every stage benchmark
+const std::vector<AudioSample>& benchTrack() {
+    static const std::vector<AudioSample> samples =
+        sortify::testing::generateMelody(benchTrackSeconds, benchSampleRate, 7);
+    return samples;
+}
+
+void setRate(benchmark::State& state, const char* name, double itemsPerIteration) {
+    state.counters[name] = benchmark::Counter(itemsPerIteration * static_cast<double>(state.iterations()),
+                                              benchmark::Counter::kIsRate);
+}
+
+// Arguments: window size, overlap in percent
+void BM_GenerateSpectrogram(benchmark::State& state) {
+    const auto& samples = benchTrack();
+    const unsigned int windowSize = static_cast<unsigned int>(state.range(0));
+    const float overlap = static_cast<float>(state.range(1)) / 100.0f;
+
+    for (auto _ : state) {
+        auto spectrogram = generateSpectrogram(samples, benchSampleRate, windowSize, overlap);
+        if (!spectrogram.isSuccess()) {
+            state.SkipWithError(spectrogram.getError().c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(spectrogram.getValue().data());
+    }
+    setRate(state, "samples/s", static_cast<double>(samples.size()));
+}
+BENCHMARK(BM_GenerateSpectrogram)
+    ->ArgNames({"window", "overlap"})
+    ->ArgsProduct({{1024, 2048, 4096}, {0, 50, 75}})
+    ->Unit(benchmark::kMillisecond);
+
+// Argument: FFT batch size (0 = one generateSpectrogram call per clip)
+void BM_GenerateSpectrogramBatch(benchmark::State& state) {
+    static const std::vector<std::vector<AudioSample>> clips = [] {
+        std::vector<std::vector<AudioSample>> generated;
+        for (unsigned int seed = 0; seed < 32; ++seed) {
+            generated.push_back(sortify::testing::generateMelody(2.0f, benchSampleRate, 100 + seed));
+        }
+        return generated;
+    }();
+    const unsigned int batchSize = static_cast<unsigned int>(state.range(0));
+
+    size_t totalSamples = 0;
+    for (const auto& clip : clips) {
+        totalSamples += clip.size();
+    }
+
+    for (auto _ : state) {
+        if (batchSize == 0) {
+            for (const auto& clip : clips) {
+                auto spectrogram = generateSpectrogram(clip, benchSampleRate);
+                benchmark::DoNotOptimize(spectrogram.isSuccess());
+            }
+        } else {
+            auto spectrograms = generateSpectrogramBatch(clips, benchSampleRate, 2048, 0.5f, 20.0f, 5000.0f,
+                                                         batchSize);
+            benchmark::DoNotOptimize(spectrograms.data());
+        }
+    }
+    setRate(state, "samples/s", static_cast<double>(totalSamples));
+}
+BENCHMARK(BM_GenerateSpectrogramBatch)->ArgName("batch")->Arg(0)->Arg(8)->Arg(32)->Arg(128)
+    ->Unit(benchmark::kMillisecond);
+
+// Argument: 0 = spectrogram only / 1 = quality frames from the same FFTs /
+// 2 = a second, full-band spectrogram pass for the quality analysis
+void BM_QualityAnalysis(benchmark::State& state) {
+    const int mode = static_cast<int>(state.range(0));
+    QualityTrace quality;
+    Spectrogram spectrogram;
+    Spectrogram fullBand;
+    for (auto _ : state) {
+        generateSpectrogramInto(benchTrack(), spectrogram, benchSampleRate, 2048, 0.5f, 20.0f, 5000.0f, 1,
+                                mode == 1 ? &quality : nullptr);
+        if (mode == 2) {
+            generateSpectrogramInto(benchTrack(), fullBand, benchSampleRate, 2048, 0.5f, 0.0f,
+                                    benchSampleRate / 2.0f);
+        }
+        if (mode != 0) {
+            benchmark::DoNotOptimize(summarizeQuality(quality).isSuccess());
+        }
+        benchmark::DoNotOptimize(spectrogram.data());
+    }
+    setRate(state, "samples/s", static_cast<double>(benchTrack().size()));
+}
+BENCHMARK(BM_QualityAnalysis)->ArgName("mode")->Arg(0)->Arg(1)->Arg(2)->Unit(benchmark::kMillisecond);
+
+void BM_ExtractPeaks(benchmark::State& state) {
+    auto spectrogram = generateSpectrogram(benchTrack(), benchSampleRate);
+    if (!spectrogram.isSuccess()) {
+        state.SkipWithError(spectrogram.getError().c_str());
+        return;
+    }
+
+    size_t numPeaks = 0;
+    for (auto _ : state) {
+        auto peaks = extractPeaks(spectrogram.getValue());
+        numPeaks = peaks.isSuccess() ? peaks.getValue().size() : 0;
+        benchmark::DoNotOptimize(numPeaks);
+    }
+    setRate(state, "frames/s", static_cast<double>(spectrogram.getValue().numFrames()));
+    setRate(state, "samples/s", static_cast<double>(benchTrack().size()));
+    state.counters["peaks"] = static_cast<double>(numPeaks);
+}
+BENCHMARK(BM_ExtractPeaks)->Unit(benchmark::kMillisecond);
+
+/// Peaks of the shared track, as the fingerprint stage sees them
+const std::vector<Peak>& benchPeaks() {
+    static const std::vector<Peak> peaks = [] {
+        auto spectrogram = generateSpectrogram(benchTrack(), benchSampleRate);
+        if (!spectrogram.isSuccess()) {
+            return std::vector<Peak>();
+        }
+        auto extracted = extractPeaks(spectrogram.getValue());
+        return extracted.isSuccess() ? std::move(extracted).take() : std::vector<Peak>();
+    }();
+    return peaks;
+}
+
+void BM_CreateFingerprint(benchmark::State& state) {
+    const auto& peaks = benchPeaks();
+    size_t numHashes = 0;
+    for (auto _ : state) {
+        auto fingerprint = createFingerprint(peaks, 1);
+        numHashes = 0;
+        if (fingerprint.isSuccess()) {
+            for (const auto& entry : fingerprint.getValue()) {
+                numHashes += entry.second.size();
+            }
+        }
+        benchmark::DoNotOptimize(numHashes);
+    }
+    setRate(state, "hashes/s", static_cast<double>(numHashes));
+}
+BENCHMARK(BM_CreateFingerprint)->Unit(benchmark::kMillisecond);
+
+void BM_CreateCompactFingerprint(benchmark::State& state) {
+    const auto& peaks = benchPeaks();
+    size_t numHashes = 0;
+    for (auto _ : state) {
+        auto fingerprint = createCompactFingerprint(peaks);
+        numHashes = fingerprint.isSuccess() ? fingerprint.getValue().size() : 0;
+        benchmark::DoNotOptimize(numHashes);
+    }
+    setRate(state, "hashes/s", static_cast<double>(numHashes));
+}
+BENCHMARK(BM_CreateCompactFingerprint)->Unit(benchmark::kMillisecond);
+
+// Arguments: peaks per frame, 0 = linear scan per anchor / 1 = frame-indexed pairing
+void BM_PairTargetZone(benchmark::State& state) {
+    const unsigned int peaksPerFrame = static_cast<unsigned int>(state.range(0));
+    const bool indexed = state.range(1) != 0;
+
+    // Dense constellations spread over 1024 bins; only a few peaks per frame lie within maxFreqDelta
+    std::vector<Peak> peaks;
+    uint32_t seed = 12345;
+    for (unsigned int t = 0; t < 1000; ++t) {
+        std::vector<float> bins(peaksPerFrame);
+        for (float& bin : bins) {
+            seed = seed * 1664525u + 1013904223u;
+            bin = static_cast<float>(seed >> 22);
+        }
+        std::sort(bins.begin(), bins.end());
+        for (float bin : bins) {
+            peaks.push_back({bin, static_cast<float>(t), 1.0f});
+        }
+    }
+
+    PeakFrames frames;
+    size_t numHashes = 0;
+    for (auto _ : state) {
+        numHashes = 0;
+        if (indexed) {
+            bucketPeakFrames(peaks, frames);
+            numHashes = pairPeaksIndexed(TargetZone(), peaks, frames, [](size_t, uint32_t hash) {
+                benchmark::DoNotOptimize(hash);
+            });
+        } else {
+            for (size_t i = 0; i < peaks.size(); ++i) {
+                numHashes += pairAnchor(peaks[i], peaks.begin() + i + 1, peaks.end(), [](uint32_t hash) {
+                    benchmark::DoNotOptimize(hash);
+                });
+            }
+        }
+        benchmark::DoNotOptimize(numHashes);
+    }
+    setRate(state, "hashes/s", static_cast<double>(numHashes));
+    setRate(state, "peaks/s", static_cast<double>(peaks.size()));
+}
+BENCHMARK(BM_PairTargetZone)->ArgNames({"peaks", "indexed"})
+    ->ArgsProduct({{6, 64, 256}, {0, 1}})->Unit(benchmark::kMicrosecond);
+
+void BM_ReadWav(benchmark::State& state) {
+    const std::string path = "/tmp/sortify_bench_" + std::to_string(::getpid()) + ".wav";
+    if (!sortify::testing::writeWav16(path, benchTrack(), benchSampleRate)) {
+        state.SkipWithError("Failed to write the benchmark WAV file");
+        return;
+    }
+
+    std::vector<AudioSample> samples;
+    for (auto _ : state) {
+        WavFile file(path);
+        file.readAll(samples);
+        benchmark::DoNotOptimize(samples.data());
+    }
+    std::remove(path.c_str());
+    setRate(state, "samples/s", static_cast<double>(benchTrack().size()));
+}
+BENCHMARK(BM_ReadWav)->Unit(benchmark::kMillisecond);
+
+// Argument: input sample rate, converted to the 11025 Hz analysis rate
+void BM_Resample(benchmark::State& state) {
+    const unsigned int inputRate = static_cast<unsigned int>(state.range(0));
+    const auto samples = sortify::testing::generateMelody(10.0f, inputRate, 7);
+    Resampler resampler(inputRate, DecimatedFingerprintPolicy::sampleRate);
+    if (!resampler.isValid()) {
+        state.SkipWithError(resampler.getError().c_str());
+        return;
+    }
+
+    std::vector<AudioSample> output;
+    for (auto _ : state) {
+        output.clear();
+        resampler.reset();
+        resampler.process(samples.data(), samples.size(), output);
+        resampler.finish(output);
+        benchmark::DoNotOptimize(output.data());
+    }
+    setRate(state, "samples/s", static_cast<double>(samples.size()));
+    state.counters["taps"] = static_cast<double>(resampler.tapsPerPhase());
+}
+BENCHMARK(BM_Resample)->ArgName("rate")->Arg(44100)->Arg(48000)->Arg(96000)->Arg(192000)
+    ->Unit(benchmark::kMillisecond);
+
+// Argument: 0 = analyse the track at 44.1 kHz / 1 = decimate to 11025 Hz first
+void BM_FingerprintDecimated(benchmark::State& state) {
+    const bool decimate = state.range(0) != 0;
+    const FingerprintConfig config = decimate ? makeFingerprintConfig<DecimatedFingerprintPolicy>()
+                                              : FingerprintConfig();
+    Resampler resampler(benchSampleRate, config.sampleRate);
+
+    std::vector<AudioSample> decimated;
+    size_t numHashes = 0;
+    for (auto _ : state) {
+        const std::vector<AudioSample>* input = &benchTrack();
+        if (decimate) {
+            decimated.clear();
+            resampler.reset();
+            resampler.process(benchTrack().data(), benchTrack().size(), decimated);
+            resampler.finish(decimated);
+            input = &decimated;
+        }
+        auto fingerprint = fingerprintSamples(*input, config);
+        numHashes = fingerprint.isSuccess() ? fingerprint.getValue().size() : 0;
+        benchmark::DoNotOptimize(numHashes);
+    }
+    setRate(state, "samples/s", static_cast<double>(benchTrack().size()));
+    state.counters["hashes"] = static_cast<double>(numHashes);
+}
+BENCHMARK(BM_FingerprintDecimated)->ArgName("decimate")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Ingest of files on high-latency storage, simulated by sleeping per file.
+// Argument: 0 = BatchFingerprinter (latency inside its decoder),
+// 1 = PipelineScheduler (latency in its read stage)
+void BM_IngestSlowStorage(benchmark::State& state) {
+    constexpr auto latency = std::chrono::milliseconds(20);
+    const std::vector<AudioSample> track(benchTrack().begin(), benchTrack().begin() + 5 * benchSampleRate);
+    const std::vector<std::string> paths(16, "track");
+
+    for (auto _ : state) {
+        std::vector<FileResult> results;
+        if (state.range(0) == 0) {
+            BatchOptions options;
+            options.decoder = [&](const std::string&) {
+                std::this_thread::sleep_for(latency);
+                return track;
+            };
+            results = BatchFingerprinter(options).run(paths, 0, nullptr);
+        } else {
+            PipelineOptions options;
+            options.readThreads = 8;
+            options.reader = [&](const std::string&) {
+                std::this_thread::sleep_for(latency);
+                return Result<uint64_t>::createSuccess(track.size() * sizeof(AudioSample));
+            };
+            options.decoder = [&](const std::string&) { return track; };
+            results = PipelineScheduler(options).run(paths, 0, nullptr);
+        }
+        benchmark::DoNotOptimize(results.data());
+    }
+    setRate(state, "files/s", static_cast<double>(paths.size()));
+}
+BENCHMARK(BM_IngestSlowStorage)->ArgName("pipeline")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Argument: number of indexed tracks
+void BM_IndexQuery(benchmark::State& state) {
+    constexpr unsigned int framesPerTrack = 2000;
+    const int numTracks = static_cast<int>(state.range(0));
+
+    FingerprintIndex index;
+    std::vector<Peak> queryTrack;
+    for (int song = 0; song < numTracks; ++song) {
+        auto peaks = sortify::testing::makePeaks(framesPerTrack, static_cast<unsigned int>(song) + 1);
+        index.addTrack(song, sortify::testing::compactFingerprintOf(peaks));
+        if (song == numTracks / 2) {
+            queryTrack = peaks;
+        }
+    }
+    index.build();
+
+    // A ten second excerpt of one indexed track
+    const CompactFingerprint sample =
+        sortify::testing::compactFingerprintOf(sortify::testing::excerptPeaks(queryTrack, 500, 715));
+    for (auto _ : state) {
+        auto matches = index.query(sample, 5);
+        benchmark::DoNotOptimize(matches);
+    }
+    setRate(state, "queries/s", 1.0);
+    setRate(state, "hashes/s", static_cast<double>(sample.size()));
+}
+BENCHMARK(BM_IndexQuery)->ArgName("tracks")->RangeMultiplier(10)->Range(10, 1000)->Unit(benchmark::kMicrosecond);
+
+// Argument: Bloom filter bits per key (0 = no filter); no sample hash is in the index
+void BM_IndexQueryUnrelated(benchmark::State& state) {
+    constexpr unsigned int framesPerTrack = 2000;
+    constexpr int numTracks = 200;
+
+    FingerprintIndex index;
+    index.setBloomBitsPerKey(static_cast<unsigned int>(state.range(0)));
+    for (int song = 0; song < numTracks; ++song) {
+        auto peaks = sortify::testing::makePeaks(framesPerTrack, static_cast<unsigned int>(song) + 1);
+        index.addTrack(song, sortify::testing::compactFingerprintOf(peaks));
+    }
+    index.build();
+
+    // Hashes the index has never seen, as noise or an unknown recording produces them
+    std::vector<HashRecord> records;
+    uint32_t state32 = 12345;
+    while (records.size() < 2000) {
+        state32 = state32 * 1664525u + 1013904223u;
+        size_t count = 0;
+        if (!index.findPostings(state32, count)) {
+            records.push_back({state32, static_cast<uint32_t>(records.size())});
+        }
+    }
+    std::sort(records.begin(), records.end());
+    const CompactFingerprint sample = CompactFingerprint::fromSortedRecords(std::move(records));
+    for (auto _ : state) {
+        auto matches = index.query(sample, 5);
+        benchmark::DoNotOptimize(matches);
+    }
+    setRate(state, "queries/s", 1.0);
+}
+BENCHMARK(BM_IndexQueryUnrelated)->ArgName("bloom_bits")->Arg(0)->Arg(10)->Unit(benchmark::kMicrosecond);
+
+// Argument: early-exit confidence target in percent (0 = full comparison)
+void BM_CompareFingerprints(benchmark::State& state) {
+    const auto peaks = sortify::testing::makePeaks(2000, 1);
+    const CompactFingerprint track = sortify::testing::compactFingerprintOf(peaks);
+    const CompactFingerprint excerpt =
+        sortify::testing::compactFingerprintOf(sortify::testing::excerptPeaks(peaks, 100, 2000));
+
+    CompareOptions options;
+    options.minConfidence = static_cast<float>(state.range(0)) / 100.0f;
+    FingerprintComparer comparer(options);
+    for (auto _ : state) {
+        auto comparison = comparer.compare(excerpt, track);
+        benchmark::DoNotOptimize(comparison);
+    }
+    setRate(state, "pairs/s", 1.0);
+}
+BENCHMARK(BM_CompareFingerprints)->ArgName("confidence")->Arg(0)->Arg(10)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // Per-file log lines would dominate the timings
+    sortify::audio::Logger::setLogLevel(sortify::audio::LogLevel::ERROR);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
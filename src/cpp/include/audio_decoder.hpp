@@ -0,0 +1,101 @@
+#ifndef AUDIO_DECODER_HPP
+#define AUDIO_DECODER_HPP
+
+/**
+ * @file audio_decoder.hpp
+ * @brief Streaming audio decoding through an FFmpeg pipe
+ *
+ * FFmpeg is started with popen and writes raw 32-bit float samples to its
+ * standard output, which is read in fixed-size blocks and handed to a
+ * callback. Nothing is written to disk and only one block is held in memory,
+ * so decoded audio can go straight into a FingerprintStream.
+ */
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstddef>
+#include "result.hpp"
+#include "audio_fingerprint.hpp"
+
+namespace sortify {
+namespace audio {
+
+/// Receives each decoded block; return false to stop decoding early
+using SampleBlockCallback = std::function<bool(const AudioSample* samples, size_t count)>;
+
+/**
+ * @struct DecodeOptions
+ * @brief Output format and range of a decode
+ */
+struct DecodeOptions {
+    unsigned int sampleRate = 44100;    ///< Output sample rate (Hz)
+    double startSeconds = 0.0;          ///< Position to start decoding from
+    double durationSeconds = 0.0;       ///< Length to decode (0 = until the end)
+    size_t blockSize = 16384;           ///< Samples per callback invocation
+    std::string ffmpegPath = "ffmpeg";  ///< FFmpeg executable
+    std::string ffprobePath = "ffprobe"; ///< FFprobe executable, used to query durations
+};
+
+/**
+ * @class FFmpegDecoder
+ * @brief Decodes any FFmpeg-supported file into mono float samples
+ */
+class FFmpegDecoder {
+public:
+    /**
+     * Decodes a file block by block
+     *
+     * @param filePath Path to the audio file
+     * @param callback Receives the mono samples block by block
+     * @param options Output format and range
+     * @return Result containing the number of samples delivered
+     */
+    static Result<size_t> decodeStream(
+        const std::string& filePath,
+        const SampleBlockCallback& callback,
+        const DecodeOptions& options = DecodeOptions()
+    );
+
+    /**
+     * Decodes a whole file into memory
+     *
+     * @param filePath Path to the audio file
+     * @param options Output format and range
+     * @return Result containing the mono samples
+     */
+    static Result<std::vector<AudioSample>> decode(
+        const std::string& filePath,
+        const DecodeOptions& options = DecodeOptions()
+    );
+
+    /**
+     * Queries the duration of a file without decoding it
+     *
+     * @param filePath Path to the audio file
+     * @param options Options providing the FFprobe executable
+     * @return Result containing the duration in seconds
+     */
+    static Result<double> probeDuration(
+        const std::string& filePath,
+        const DecodeOptions& options = DecodeOptions()
+    );
+
+    /**
+     * Quotes an argument for /bin/sh so it is passed through verbatim
+     *
+     * @param argument Any string, including quotes, spaces and $
+     * @return The argument wrapped in single quotes
+     */
+    static std::string quoteShellArgument(const std::string& argument);
+
+    /**
+     * Builds the FFmpeg command line used by decodeStream
+     */
+    static std::string buildCommand(const std::string& filePath, const DecodeOptions& options);
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // AUDIO_DECODER_HPP
@@ -14,8 +14,12 @@
 
 #include <vector>
 #include <complex>
+#include <cstdint>
 #include <unordered_map>
+#include <memory_resource>
 #include "result.hpp"
+#include "spectrogram.hpp"
+#include "fingerprint_config.hpp"
 
 namespace sortify {
 namespace audio {
@@ -23,7 +27,8 @@ namespace audio {
 // Type definitions for clarity
 using AudioSample = float;
 using FrequencyBin = std::complex<float>;
-using Spectrogram = std::vector<std::vector<float>>; // 2D matrix: rows=frequencies, cols=time
+
+struct QualityTrace;
 
 /**
  * Generates a spectrogram from raw audio data
@@ -34,7 +39,10 @@ using Spectrogram = std::vector<std::vector<float>>; // 2D matrix: rows=frequenc
  * @param overlap Overlap percentage between windows (0.0-1.0)
  * @param minFreq Minimum frequency to include (Hz)
  * @param maxFreq Maximum frequency to include (Hz)
- * @return Result containing 2D spectrogram where rows are frequencies and columns are time
+ * @param numThreads Number of threads to split the windows across (0 = one per hardware thread)
+ * @param resource Memory resource for the spectrogram buffer (nullptr = heap)
+ * @param quality Receives a full-band QualityFrame per window from the same FFTs (nullptr = skip)
+ * @return Result containing a time-major spectrogram of numFrames() windows by numBins() frequencies
  */
 Result<Spectrogram> generateSpectrogram(
     const std::vector<AudioSample>& samples,
@@ -42,7 +50,68 @@ Result<Spectrogram> generateSpectrogram(
     unsigned int windowSize = 2048,
     float overlap = 0.5,
     float minFreq = 20.0f,
-    float maxFreq = 5000.0f
+    float maxFreq = 5000.0f,
+    unsigned int numThreads = 1,
+    std::pmr::memory_resource* resource = nullptr,
+    QualityTrace* quality = nullptr
+);
+
+/**
+ * Generates a spectrogram into a caller-provided one
+ * 
+ * The output is reshaped and overwritten; its buffer is only reallocated
+ * when it is too small, so a spectrogram reused across tracks stops
+ * allocating once it has seen the longest one.
+ * 
+ * @param samples Raw audio samples
+ * @param spectrogram Output spectrogram; its contents are unspecified on failure
+ * @param sampleRate Sample rate of the audio (Hz)
+ * @param windowSize Size of each window for FFT
+ * @param overlap Overlap percentage between windows (0.0-1.0)
+ * @param minFreq Minimum frequency to include (Hz)
+ * @param maxFreq Maximum frequency to include (Hz)
+ * @param numThreads Number of threads to split the windows across (0 = one per hardware thread)
+ * @param quality Receives a full-band QualityFrame per window from the same FFTs (nullptr = skip)
+ * @return Result containing the number of frames written
+ */
+Result<size_t> generateSpectrogramInto(
+    const std::vector<AudioSample>& samples,
+    Spectrogram& spectrogram,
+    unsigned int sampleRate = 44100,
+    unsigned int windowSize = 2048,
+    float overlap = 0.5,
+    float minFreq = 20.0f,
+    float maxFreq = 5000.0f,
+    unsigned int numThreads = 1,
+    QualityTrace* quality = nullptr
+);
+
+/**
+ * Generates the spectrograms of several tracks with batched FFTs
+ * 
+ * The windows of all tracks are packed into one frame matrix and
+ * transformed batchSize at a time with a single FFTW plan, so short clips
+ * no longer pay per-call setup and per-frame execute overhead. Each
+ * spectrogram matches what generateSpectrogram computes for its track, up
+ * to floating-point rounding.
+ * 
+ * @param tracks Raw audio samples of each track
+ * @param sampleRate Sample rate of the audio (Hz)
+ * @param windowSize Size of each window for FFT
+ * @param overlap Overlap percentage between windows (0.0-1.0)
+ * @param minFreq Minimum frequency to include (Hz)
+ * @param maxFreq Maximum frequency to include (Hz)
+ * @param batchSize Number of windows transformed per FFT execution
+ * @return One result per track, in input order
+ */
+std::vector<Result<Spectrogram>> generateSpectrogramBatch(
+    const std::vector<std::vector<AudioSample>>& tracks,
+    unsigned int sampleRate = 44100,
+    unsigned int windowSize = 2048,
+    float overlap = 0.5,
+    float minFreq = 20.0f,
+    float maxFreq = 5000.0f,
+    unsigned int batchSize = 32
 );
 
 /**
@@ -61,10 +130,50 @@ struct Peak {
 /**
  * Extracts distinctive frequency peaks from a spectrogram
  * 
- * @param spectrogram 2D matrix representing the spectrogram
+ * The default six-band layout runs an unrolled kernel; other band layouts
+ * use the generic one.
+ * 
+ * @param spectrogram Time-major spectrogram, as produced by generateSpectrogram
+ * @param config Configuration giving the peak-picking bands
  * @return Result containing vector of Peak structures representing the most distinctive points
  */
-Result<std::vector<Peak>> extractPeaks(const Spectrogram& spectrogram);
+Result<std::vector<Peak>> extractPeaks(const Spectrogram& spectrogram,
+                                       const FingerprintConfig& config = FingerprintConfig());
+
+/**
+ * Extracts peaks into a caller-provided vector, reusing its capacity
+ * 
+ * @param spectrogram Time-major spectrogram, as produced by generateSpectrogram
+ * @param peaks Output vector; cleared before the peaks are appended
+ * @param config Configuration giving the peak-picking bands
+ * @return Result containing the number of peaks extracted
+ */
+Result<size_t> extractPeaksInto(const Spectrogram& spectrogram, std::vector<Peak>& peaks,
+                                const FingerprintConfig& config = FingerprintConfig());
+
+/**
+ * Extracts peaks into a vector drawing from a memory resource
+ * 
+ * Reserves room for the largest possible number of peaks, so the vector
+ * never grows; meant for per-track arenas.
+ * 
+ * @param spectrogram Time-major spectrogram, as produced by generateSpectrogram
+ * @param resource Memory resource for the peak vector
+ * @param config Configuration giving the peak-picking bands
+ * @return Result containing the same peaks as extractPeaks(spectrogram, config)
+ */
+Result<std::pmr::vector<Peak>> extractPeaks(const Spectrogram& spectrogram, std::pmr::memory_resource* resource,
+                                            const FingerprintConfig& config = FingerprintConfig());
+
+/**
+ * Extracts distinctive frequency peaks from a nested-vector spectrogram
+ * 
+ * Converts to the flat layout first; prefer the Spectrogram overload.
+ * 
+ * @param spectrogram 2D matrix where rows are frequencies and columns are time
+ * @return Result containing vector of Peak structures representing the most distinctive points
+ */
+Result<std::vector<Peak>> extractPeaks(const LegacySpectrogram& spectrogram);
 
 /**
  * @struct FingerprintHash
@@ -95,6 +204,26 @@ Result<std::unordered_map<uint32_t, std::vector<FingerprintHash>>> createFingerp
     int songId
 );
 
+/// Hash map of createFingerprint whose nodes and hash vectors come from one memory resource
+using PmrFingerprintMap = std::pmr::unordered_map<uint32_t, std::pmr::vector<FingerprintHash>>;
+
+/**
+ * Creates a fingerprint whose map and per-hash vectors draw from a memory resource
+ * 
+ * Produces the same hashes as createFingerprint without a heap allocation
+ * per hash when the resource is an arena.
+ * 
+ * @param peaks Vector of spectral peaks extracted from the audio
+ * @param songId Identifier for the song being fingerprinted
+ * @param resource Memory resource for the map
+ * @return Result containing the hashmap
+ */
+Result<PmrFingerprintMap> createFingerprint(
+    const std::pmr::vector<Peak>& peaks,
+    int songId,
+    std::pmr::memory_resource* resource
+);
+
 } // namespace audio
 } // namespace sortify
 
@@ -0,0 +1,141 @@
+#ifndef AUDIO_QUALITY_HPP
+#define AUDIO_QUALITY_HPP
+
+/**
+ * @file audio_quality.hpp
+ * @brief Fidelity measurements for choosing which duplicate to keep
+ *
+ * Quality analysis reuses the STFT that fingerprinting already computes:
+ * generateSpectrogram and FingerprintStream hand every window's samples and
+ * full-band FFT output to summarizeQualityFrame, which reduces them to a
+ * 12-byte QualityFrame. The spectrogram itself keeps only the fingerprint
+ * bins, so nothing above maxFreq is stored and no file is decoded or
+ * transformed a second time. summarizeQuality turns the frames of a track
+ * into an AudioQuality:
+ *
+ * - Cutoff frequency: lossy encoders low-pass the signal (typically at
+ *   16-19 kHz), so the highest frequency that regularly carries energy
+ *   exposes transcodes of MP3 or AAC sources. The search re-windows the
+ *   shared Hamming spectrum with a 3-tap kernel to suppress leakage.
+ * - Dynamic range: peak level minus the RMS level of the loudest frames;
+ *   heavily limited remasters score low.
+ * - Clipping: samples at full scale.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "result.hpp"
+#include "audio_fingerprint.hpp"
+#include "fft_plan_cache.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @struct QualityOptions
+ * @brief Thresholds of the quality analysis
+ */
+struct QualityOptions {
+    float cutoffThresholdDb = 60.0f;   ///< 8-bin blocks this far below a frame's strongest block count as empty
+    float cutoffPercentile = 0.95f;    ///< Frame cutoffs reported for the track (0-1); robust to quiet passages
+    float silenceDb = -60.0f;          ///< Frames with a lower RMS level (dBFS) are ignored
+    float loudFraction = 0.2f;         ///< Share of the loudest frames that set the RMS level
+    float clipLevel = 0.999f;          ///< Absolute sample value counted as clipped
+};
+
+/**
+ * @struct QualityFrame
+ * @brief Compact summary of one STFT window
+ *
+ * The sample statistics cover the samples a window adds to the previous
+ * one (the whole window for frame 0, the last stepSize samples after
+ * that), so every sample is counted exactly once.
+ */
+struct QualityFrame {
+    float peak = 0.0f;            ///< Largest absolute sample value
+    float rms = 0.0f;             ///< RMS of the samples
+    uint16_t cutoffBin = 0;       ///< Last FFT bin of the highest block within cutoffThresholdDb of the strongest
+    uint16_t clippedSamples = 0;  ///< Samples at or above clipLevel (saturating)
+};
+
+/**
+ * @struct QualityTrace
+ * @brief Per-frame quality summaries collected alongside a spectrogram
+ *
+ * Pass one to generateSpectrogram, generateSpectrogramInto or
+ * FingerprintStream::setQualityTrace; the frames are overwritten
+ * (generateSpectrogram) or appended (FingerprintStream) and the layout
+ * fields are set by the producer.
+ */
+struct QualityTrace {
+    QualityOptions options;
+    unsigned int sampleRate = 0;      ///< Sample rate of the analysed audio (Hz)
+    unsigned int windowSize = 0;      ///< FFT size of the frames
+    unsigned int stepSize = 0;        ///< Samples between the starts of consecutive frames
+    std::vector<QualityFrame> frames; ///< One summary per spectrogram window
+};
+
+/**
+ * @struct AudioQuality
+ * @brief Track-level fidelity measurements
+ */
+struct AudioQuality {
+    float cutoffFrequency = 0.0f;   ///< Frequency below which the audible frames carry energy (Hz)
+    float nyquistFrequency = 0.0f;  ///< Half the sample rate; the largest possible cutoff (Hz)
+    float peakDb = -200.0f;         ///< Largest sample level (dBFS)
+    float loudRmsDb = -200.0f;      ///< RMS level of the loudest frames (dBFS)
+    float dynamicRangeDb = 0.0f;    ///< peakDb - loudRmsDb
+    uint64_t clippedSamples = 0;    ///< Samples at or above clipLevel
+    double clippedFraction = 0.0;   ///< clippedSamples over the analysed samples
+    unsigned int audibleFrames = 0; ///< Frames above silenceDb
+};
+
+/**
+ * Summarizes one STFT window
+ *
+ * The new samples may be split in two pieces (a ring buffer wrapping
+ * around); pass count2 = 0 otherwise.
+ *
+ * @param samples1 First piece of the samples the window adds
+ * @param count1 Number of samples in the first piece
+ * @param samples2 Second piece of the samples the window adds
+ * @param count2 Number of samples in the second piece
+ * @param spectrum Full FFT output of the window (windowSize / 2 + 1 bins)
+ * @param windowSize FFT size
+ * @param options Thresholds
+ * @return The frame summary
+ */
+QualityFrame summarizeQualityFrame(
+    const AudioSample* samples1,
+    size_t count1,
+    const AudioSample* samples2,
+    size_t count2,
+    const fftwf_complex* spectrum,
+    unsigned int windowSize,
+    const QualityOptions& options
+);
+
+/**
+ * Reduces the frames of a track to its quality measurements
+ *
+ * @param trace Frames collected while the track was analysed
+ * @return Result containing the measurements, or a failure if no frame is above silenceDb
+ */
+Result<AudioQuality> summarizeQuality(const QualityTrace& trace);
+
+/**
+ * Ranks two versions of the same recording by fidelity
+ *
+ * The cutoff frequency decides first (differences under 500 Hz are
+ * ignored), then clipping (under 0.01% of the samples ignored), then
+ * dynamic range (under 1 dB ignored).
+ *
+ * @return Positive if a is the better version, negative if b is, 0 if they are equivalent
+ */
+int compareAudioQuality(const AudioQuality& a, const AudioQuality& b);
+
+} // namespace audio
+} // namespace sortify
+
+#endif // AUDIO_QUALITY_HPP
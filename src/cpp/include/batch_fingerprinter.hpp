@@ -0,0 +1,202 @@
+#ifndef BATCH_FINGERPRINTER_HPP
+#define BATCH_FINGERPRINTER_HPP
+
+/**
+ * @file batch_fingerprinter.hpp
+ * @brief Parallel fingerprinting of many audio files
+ *
+ * Worker threads each decode and fingerprint one file at a time, so while
+ * one worker waits on the decoder another is running the FFT and the disk
+ * and CPU stay busy together. Finished fingerprints pass through a bounded
+ * queue to the calling thread, which hands them to the sink (typically the
+ * index builder); when the sink falls behind, workers block instead of
+ * accumulating fingerprints in memory. With a FingerprintCache, unchanged
+ * files are answered from the cache without being decoded at all.
+ */
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstddef>
+#include "audio_fingerprint.hpp"
+#include "compact_fingerprint.hpp"
+#include "fingerprint_config.hpp"
+#include "fingerprint_index.hpp"
+#include "audio_decoder.hpp"
+#include "segment_fingerprint.hpp"
+#include "fingerprint_cache.hpp"
+#include "pipeline_arena.hpp"
+#include "audio_quality.hpp"
+
+namespace sortify {
+namespace audio {
+
+/// Decodes one file into mono samples at the configured sample rate (empty on failure)
+using AudioDecoder = std::function<std::vector<AudioSample>(const std::string& filePath)>;
+
+/**
+ * @enum FileStatus
+ * @brief Outcome of fingerprinting one file
+ */
+enum class FileStatus {
+    OK,                 ///< Fingerprint created and passed to the sink
+    DECODE_FAILED,      ///< The decoder returned no samples (in segment mode: any failure)
+    FINGERPRINT_FAILED  ///< Decoding worked but a pipeline stage failed
+};
+
+/**
+ * @struct FileResult
+ * @brief Per-file report of a batch run
+ */
+struct FileResult {
+    std::string path;       ///< Input path
+    int songId = 0;         ///< Song ID assigned to the file
+    FileStatus status = FileStatus::DECODE_FAILED;
+    std::string error;      ///< Reason for a failure status
+    size_t numSamples = 0;  ///< Number of decoded samples
+    size_t numHashes = 0;   ///< Number of records in the fingerprint
+    bool fromCache = false; ///< The fingerprint came from the cache without decoding
+    bool hasQuality = false; ///< quality was measured (BatchOptions::analyzeQuality, whole-file modes, not cached)
+    AudioQuality quality;    ///< Fidelity measurements from the fingerprinting FFTs
+};
+
+/// Receives the fingerprint of every successfully processed file, on the calling thread
+using FingerprintSink = std::function<void(const FileResult& file, CompactFingerprint&& fingerprint)>;
+
+/**
+ * @struct BatchOptions
+ * @brief Settings of a BatchFingerprinter
+ */
+struct BatchOptions {
+    FingerprintConfig config;   ///< Analysis parameters for every file
+    unsigned int numThreads = 0; ///< Worker threads (0 = hardware concurrency)
+    size_t maxPendingResults = 0; ///< Finished fingerprints that may wait for the sink (0 = 2 per thread)
+    AudioDecoder decoder;        ///< Decoder returning whole files (empty = stream from FFmpeg)
+    DecodeOptions decodeOptions; ///< FFmpeg settings when streaming; the sample rate comes from config
+    double segmentSeconds = 0.0; ///< Only fingerprint screening segments of this length (0 = whole file)
+    std::vector<double> segmentPositions = defaultSegmentPositions(); ///< Relative centres of the segments
+    FingerprintCache* cache = nullptr; ///< Consulted before decoding and updated afterwards (not owned)
+    bool analyzeQuality = false; ///< Measure FileResult::quality while fingerprinting whole files
+    QualityOptions qualityOptions; ///< Thresholds of the quality analysis
+};
+
+/**
+ * Runs the spectrogram, peak and hash stages on decoded samples
+ *
+ * The spectrogram, peaks and hash scratch space come from the arena when
+ * one is given; only the returned fingerprint is heap-allocated. The
+ * caller resets the arena once the call has returned.
+ *
+ * @param samples Mono samples at config.sampleRate
+ * @param config Analysis parameters
+ * @param arena Arena for the intermediate buffers (nullptr = heap)
+ * @param quality Receives the quality frames of the spectrogram FFTs (nullptr = skip)
+ * @return Result containing the compact fingerprint
+ */
+Result<CompactFingerprint> fingerprintSamples(
+    const std::vector<AudioSample>& samples,
+    const FingerprintConfig& config,
+    PipelineArena* arena = nullptr,
+    QualityTrace* quality = nullptr
+);
+
+/**
+ * Fingerprints several decoded clips, sharing batched FFTs between them
+ *
+ * Meant for many short inputs (samples, ringtones, screening segments),
+ * where per-call FFT setup would dominate. Peak extraction and hashing
+ * still run per clip; every fingerprint equals fingerprintSamples on
+ * the same clip up to rounding differences between FFTW's batched and
+ * single transforms.
+ *
+ * @param clips Mono samples at config.sampleRate, one vector per clip
+ * @param config Analysis parameters
+ * @param batchSize Number of windows transformed per FFT execution
+ * @return One result per clip, in input order
+ */
+std::vector<Result<CompactFingerprint>> fingerprintSampleBatch(
+    const std::vector<std::vector<AudioSample>>& clips,
+    const FingerprintConfig& config,
+    unsigned int batchSize = 32
+);
+
+/**
+ * Streams a file from FFmpeg through a FingerprintStream
+ *
+ * Only one decoded block and the stream's bounded state are held in memory;
+ * the result equals fingerprintSamples on the fully decoded file.
+ *
+ * @param filePath Path to the audio file
+ * @param config Analysis parameters; overrides decodeOptions.sampleRate
+ * @param decodeOptions FFmpeg settings
+ * @return Result containing the compact fingerprint
+ */
+Result<CompactFingerprint> fingerprintFile(
+    const std::string& filePath,
+    const FingerprintConfig& config,
+    const DecodeOptions& decodeOptions = DecodeOptions()
+);
+
+/**
+ * @class BatchFingerprinter
+ * @brief Bounded thread pool that fingerprints a list of files
+ */
+class BatchFingerprinter {
+public:
+    explicit BatchFingerprinter(BatchOptions options = BatchOptions());
+
+    /**
+     * Fingerprints every file in paths
+     *
+     * File i is assigned song ID firstSongId + i. The sink is called in
+     * completion order, never concurrently.
+     *
+     * An exception thrown by the decoder or a pipeline stage is reported as
+     * that file's failure. If the sink throws, no further files are
+     * started, the workers are joined and the exception is rethrown.
+     *
+     * @param paths Files to process
+     * @param firstSongId Song ID of the first file
+     * @param sink Receives each successful fingerprint
+     * @return One report per input file, in input order
+     */
+    std::vector<FileResult> run(const std::vector<std::string>& paths, int firstSongId, const FingerprintSink& sink) const;
+
+    /**
+     * Fingerprints every file in paths into an index and builds it
+     *
+     * @param paths Files to process
+     * @param index Index the tracks are added to
+     * @param firstSongId Song ID of the first file
+     * @return One report per input file, in input order
+     */
+    std::vector<FileResult> buildIndex(const std::vector<std::string>& paths, FingerprintIndex& index, int firstSongId = 0) const;
+
+    /**
+     * Lists the audio files below a directory
+     *
+     * @param directory Root of the tree to scan
+     * @param extensions Lowercase extensions to accept, including the dot
+     * @return Result containing the sorted file paths
+     */
+    static Result<std::vector<std::string>> collectAudioFiles(
+        const std::string& directory,
+        const std::vector<std::string>& extensions = {".mp3", ".m4a", ".flac", ".wav", ".ogg", ".aac", ".aiff"}
+    );
+
+    /**
+     * Get the number of worker threads used per run
+     */
+    unsigned int threadCount() const {
+        return numThreads;
+    }
+
+private:
+    BatchOptions options;
+    unsigned int numThreads;
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // BATCH_FINGERPRINTER_HPP
@@ -0,0 +1,160 @@
+#ifndef BLOOM_FILTER_HPP
+#define BLOOM_FILTER_HPP
+
+/**
+ * @file bloom_filter.hpp
+ * @brief Cache-line blocked Bloom filter over 32-bit fingerprint hashes
+ *
+ * A classic Bloom filter scatters the k bits of a key over the whole bit
+ * array, so a lookup costs k cache misses. A blocked filter first picks one
+ * 64-byte block from the key and sets one bit in each of its eight 64-bit
+ * words, so a lookup touches exactly one cache line (and, when the filter is
+ * mapped from disk, at most one page). At 10 bits per key the false
+ * positive rate is about 1%.
+ *
+ * The filter answers "definitely absent" for most hashes that are not in the
+ * index, which lets a query skip the directory search and the posting list
+ * page for them.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace sortify {
+namespace audio {
+
+/// Default filter size; about 1% false positives
+constexpr unsigned int defaultBloomBitsPerKey = 10;
+
+/**
+ * @struct BloomBlock
+ * @brief One cache line of filter bits
+ */
+struct alignas(64) BloomBlock {
+    uint64_t words[8];
+};
+
+static_assert(sizeof(BloomBlock) == 64, "BloomBlock must be exactly one cache line");
+
+/**
+ * @class BlockedBloomFilter
+ * @brief Membership sketch with one cache line per lookup
+ *
+ * The block layout is part of the index file format; blocks written by one
+ * process can be probed in place by another through mayContain(blocks, ...).
+ */
+class BlockedBloomFilter {
+public:
+    BlockedBloomFilter() = default;
+
+    /**
+     * Creates an empty filter sized for a number of keys
+     *
+     * @param expectedKeys Number of keys that will be inserted
+     * @param bitsPerKey Filter bits per key; more bits lower the false positive rate
+     */
+    explicit BlockedBloomFilter(size_t expectedKeys, unsigned int bitsPerKey = defaultBloomBitsPerKey);
+
+    /**
+     * Adds a key
+     */
+    void insert(uint32_t key) {
+        if (blocks.empty()) {
+            return;
+        }
+        const uint64_t mixed = mixKey(key);
+        BloomBlock& block = blocks[blockOf(mixed, blocks.size())];
+        for (int i = 0; i < 8; ++i) {
+            block.words[i] |= bitOf(mixed, i);
+        }
+    }
+
+    /**
+     * Check if a key may have been inserted
+     *
+     * @return False if the key was definitely not inserted; true for inserted keys,
+     *         for false positives and for a filter without blocks
+     */
+    bool mayContain(uint32_t key) const {
+        return mayContain(blocks.data(), blocks.size(), key);
+    }
+
+    /**
+     * Probes filter blocks that live outside a BlockedBloomFilter, e.g. in a mapped file
+     *
+     * @param data First block
+     * @param blockCount Number of blocks (0 = no filter; every key may be present)
+     * @param key The key to probe
+     */
+    static bool mayContain(const BloomBlock* data, uint64_t blockCount, uint32_t key) {
+        if (blockCount == 0) {
+            return true;
+        }
+        const uint64_t mixed = mixKey(key);
+        const BloomBlock& block = data[blockOf(mixed, blockCount)];
+        for (int i = 0; i < 8; ++i) {
+            if ((block.words[i] & bitOf(mixed, i)) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Check if the filter has no blocks and therefore rejects nothing
+     */
+    bool empty() const {
+        return blocks.empty();
+    }
+
+    /**
+     * Get the number of cache-line blocks
+     */
+    size_t blockCount() const {
+        return blocks.size();
+    }
+
+    /**
+     * Get the filter size in bytes
+     */
+    size_t sizeBytes() const {
+        return blocks.size() * sizeof(BloomBlock);
+    }
+
+    /**
+     * Get the raw blocks, used by the index file writer
+     */
+    const BloomBlock* data() const {
+        return blocks.data();
+    }
+
+private:
+    /**
+     * Spreads the key over 64 bits; the high half picks the block, the low half the bits
+     */
+    static uint64_t mixKey(uint32_t key) {
+        uint64_t value = key * 0x9e3779b97f4a7c15ull;
+        value ^= value >> 32;
+        return value * 0xbf58476d1ce4e5b9ull;
+    }
+
+    static uint64_t blockOf(uint64_t mixed, uint64_t blockCount) {
+        // Multiply-shift maps the high 32 bits onto [0, blockCount) without a division
+        return ((mixed >> 32) * blockCount) >> 32;
+    }
+
+    static uint64_t bitOf(uint64_t mixed, int word) {
+        // Odd per-word salts derive eight independent 6-bit positions from one hash
+        static constexpr uint32_t salts[8] = {0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+                                              0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+        return uint64_t(1) << ((static_cast<uint32_t>(mixed) * salts[word]) >> 26);
+    }
+
+    std::vector<BloomBlock> blocks;
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // BLOOM_FILTER_HPP
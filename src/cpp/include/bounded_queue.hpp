@@ -0,0 +1,122 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+/**
+ * @file bounded_queue.hpp
+ * @brief Blocking multi-producer, multi-consumer queue with a fixed capacity
+ */
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @class BoundedQueue
+ * @brief FIFO queue whose producers block while it is full
+ *
+ * The blocking push is what provides backpressure: a slow consumer stalls
+ * the producers instead of letting queued items grow without limit.
+ *
+ * @tparam T Type of the queued items
+ */
+template<typename T>
+class BoundedQueue {
+public:
+    /**
+     * Creates a queue
+     *
+     * @param capacity Maximum number of queued items (at least 1)
+     */
+    explicit BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * Adds an item, waiting while the queue is full
+     *
+     * @param item The item to add
+     * @return false if the queue was closed and the item was dropped
+     */
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        highWater = std::max(highWater, items.size());
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * Removes the oldest item, waiting while the queue is empty
+     *
+     * @param item Receives the removed item
+     * @return false once the queue is closed and drained
+     */
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * Wakes all waiters; pushes fail from now on and pops drain what is left
+     */
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    /**
+     * Get the number of queued items
+     */
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+    }
+
+    /**
+     * Get the largest number of items that were queued at once
+     */
+    size_t highWaterMark() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return highWater;
+    }
+
+    /**
+     * Get the maximum number of queued items
+     */
+    size_t maxSize() const {
+        return capacity;
+    }
+
+private:
+    const size_t capacity;
+    mutable std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    std::deque<T> items;
+    size_t highWater = 0;
+    bool closed = false;
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // BOUNDED_QUEUE_HPP
@@ -0,0 +1,212 @@
+#ifndef COMPACT_FINGERPRINT_HPP
+#define COMPACT_FINGERPRINT_HPP
+
+/**
+ * @file compact_fingerprint.hpp
+ * @brief Flat, sorted fingerprint representation with 8 bytes per hash
+ *
+ * createFingerprint stores a heap-allocated vector per unique hash and repeats
+ * the hash and song ID inside every entry. CompactFingerprint instead keeps a
+ * single array of {hash, anchorFrame} records sorted by hash, which is several
+ * times smaller and can be searched with a binary search or merged linearly
+ * with another fingerprint.
+ */
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "audio_fingerprint.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @struct HashRecord
+ * @brief One anchor/target hash and the window index of its anchor
+ */
+struct HashRecord {
+    uint32_t hash;        ///< 32-bit hash combining frequency and time information
+    uint32_t anchorFrame; ///< Time position (window index) of the anchor peak
+};
+
+static_assert(sizeof(HashRecord) == 8, "HashRecord must stay packed into 8 bytes");
+
+/**
+ * Orders records by hash, then by anchor frame
+ */
+inline bool operator<(const HashRecord& a, const HashRecord& b) {
+    return a.hash < b.hash || (a.hash == b.hash && a.anchorFrame < b.anchorFrame);
+}
+
+inline bool operator==(const HashRecord& a, const HashRecord& b) {
+    return a.hash == b.hash && a.anchorFrame == b.anchorFrame;
+}
+
+/**
+ * @class HashRange
+ * @brief Contiguous run of records sharing one hash
+ */
+class HashRange {
+public:
+    HashRange(const HashRecord* first, const HashRecord* last) : first(first), last(last) {}
+
+    const HashRecord* begin() const { return first; }
+    const HashRecord* end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    bool empty() const { return first == last; }
+
+private:
+    const HashRecord* first;
+    const HashRecord* last;
+};
+
+/**
+ * @class CompactFingerprint
+ * @brief Sorted, duplicate-free array of hash records for one track
+ */
+class CompactFingerprint {
+public:
+    CompactFingerprint() = default;
+
+    /**
+     * Builds a fingerprint from unsorted records
+     *
+     * @param records Records in any order; duplicates are removed
+     */
+    explicit CompactFingerprint(std::vector<HashRecord> records);
+
+    /**
+     * Converts the hashmap produced by createFingerprint
+     *
+     * @param fingerprint Hashmap of hash → entries
+     * @return The equivalent compact fingerprint
+     */
+    static CompactFingerprint fromHashMap(
+        const std::unordered_map<uint32_t, std::vector<FingerprintHash>>& fingerprint);
+
+    /**
+     * Converts a flat list of hashes, e.g. the output of FingerprintStream
+     *
+     * @param hashes Hashes in any order
+     * @return The equivalent compact fingerprint
+     */
+    static CompactFingerprint fromHashes(const std::vector<FingerprintHash>& hashes);
+
+    /**
+     * Copies records that are already sorted and duplicate-free
+     *
+     * Skips the sort of the constructor; the storage is sized exactly.
+     *
+     * @param first First record
+     * @param last One past the last record
+     * @return The fingerprint holding a copy of [first, last)
+     */
+    static CompactFingerprint fromSortedRecords(const HashRecord* first, const HashRecord* last);
+
+    /**
+     * Adopts records that are already sorted and duplicate-free
+     *
+     * The storage is kept as is, including any spare capacity.
+     *
+     * @param records Sorted, unique records
+     * @return The fingerprint owning the records
+     */
+    static CompactFingerprint fromSortedRecords(std::vector<HashRecord> records);
+
+    /**
+     * Moves the record storage out, leaving the fingerprint empty
+     *
+     * Lets a caller refill the buffer and hand it back through
+     * fromSortedRecords() without reallocating.
+     *
+     * @return The records, with their capacity
+     */
+    std::vector<HashRecord> releaseRecords();
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    const HashRecord* begin() const { return entries.data(); }
+    const HashRecord* end() const { return entries.data() + entries.size(); }
+    const std::vector<HashRecord>& records() const { return entries; }
+
+    /**
+     * Finds all records with the given hash
+     *
+     * @param hash The hash to look up
+     * @return Range of matching records, ordered by anchor frame (empty if absent)
+     */
+    HashRange find(uint32_t hash) const;
+
+    /**
+     * Check if at least one record has the given hash
+     */
+    bool contains(uint32_t hash) const {
+        return !find(hash).empty();
+    }
+
+    /**
+     * Count the distinct hashes in the fingerprint
+     */
+    size_t uniqueHashCount() const;
+
+    /**
+     * Get the number of bytes used by the records
+     */
+    size_t memoryBytes() const {
+        return entries.capacity() * sizeof(HashRecord);
+    }
+
+private:
+    std::vector<HashRecord> entries;
+};
+
+/**
+ * Creates a compact fingerprint from a collection of spectral peaks
+ *
+ * Produces the hashes createFingerprint would, stored as sorted records;
+ * identical (hash, anchorFrame) pairs, which the hash-map form keeps, are
+ * collapsed into one record.
+ * The default target zone pairs with constant bounds; other zones are read
+ * from the configuration at runtime.
+ *
+ * @param peaks Vector of spectral peaks extracted from the audio, sorted by time
+ * @param config Configuration giving the target zone
+ * @return Result containing the compact fingerprint
+ */
+Result<CompactFingerprint> createCompactFingerprint(const std::vector<Peak>& peaks,
+                                                    const FingerprintConfig& config = FingerprintConfig());
+
+/**
+ * Creates a compact fingerprint using a memory resource for scratch space
+ *
+ * Records are collected, sorted and de-duplicated in memory from the
+ * resource; only the final, exactly sized record array is heap-allocated.
+ *
+ * @param peaks Vector of spectral peaks extracted from the audio, sorted by time
+ * @param scratch Memory resource for temporary buffers (e.g. a PipelineArena)
+ * @param config Configuration giving the target zone
+ * @return Result containing the same fingerprint as createCompactFingerprint(peaks, config)
+ */
+Result<CompactFingerprint> createCompactFingerprint(const std::pmr::vector<Peak>& peaks,
+                                                    std::pmr::memory_resource* scratch,
+                                                    const FingerprintConfig& config = FingerprintConfig());
+
+/**
+ * Creates a compact fingerprint in place, reusing the storage of the output
+ *
+ * The records are built directly in the output's buffer, which keeps its
+ * capacity, so a fingerprint reused across tracks stops allocating.
+ *
+ * @param peaks Vector of spectral peaks extracted from the audio, sorted by time
+ * @param fingerprint Output fingerprint; empty on failure
+ * @param config Configuration giving the target zone
+ * @return Result containing the number of records
+ */
+Result<size_t> createCompactFingerprintInto(const std::vector<Peak>& peaks, CompactFingerprint& fingerprint,
+                                            const FingerprintConfig& config = FingerprintConfig());
+
+} // namespace audio
+} // namespace sortify
+
+#endif // COMPACT_FINGERPRINT_HPP
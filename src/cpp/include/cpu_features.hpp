@@ -0,0 +1,43 @@
+#ifndef CPU_FEATURES_HPP
+#define CPU_FEATURES_HPP
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @enum SimdLevel
+ * @brief Vector instruction sets a kernel can be dispatched to
+ */
+enum class SimdLevel {
+    SCALAR, ///< Plain C++ loops
+    SSE2,   ///< 128-bit x86 vectors (baseline on x86-64)
+    AVX2,   ///< 256-bit x86 vectors
+    NEON    ///< 128-bit ARM vectors (baseline on AArch64, e.g. Apple Silicon)
+};
+
+/**
+ * Detects the best instruction set supported by the running CPU
+ *
+ * The result is computed once and cached.
+ *
+ * @return The widest SimdLevel available
+ */
+SimdLevel detectSimdLevel();
+
+/**
+ * Check whether kernels for a SimdLevel were compiled in and can run on this CPU
+ *
+ * @param level The instruction set to check
+ * @return true if dispatching to level is safe
+ */
+bool isSimdLevelSupported(SimdLevel level);
+
+/**
+ * Get a human-readable name for a SimdLevel
+ */
+const char* simdLevelName(SimdLevel level);
+
+} // namespace audio
+} // namespace sortify
+
+#endif // CPU_FEATURES_HPP
@@ -0,0 +1,169 @@
+#ifndef DUPLICATE_DETECTOR_HPP
+#define DUPLICATE_DETECTOR_HPP
+
+/**
+ * @file duplicate_detector.hpp
+ * @brief Library-wide duplicate grouping with a MinHash/LSH candidate stage
+ *
+ * Comparing every pair of tracks is quadratic, which rules it out for a
+ * library of hundreds of thousands of tracks. Instead each track is reduced
+ * to a fixed-size MinHash sketch of its set of fingerprint hashes. The
+ * sketch is cut into bands; tracks whose rows agree on a whole band land
+ * in the same LSH bucket and become candidate pairs. Only candidates get
+ * the full time-offset histogram verification, and confirmed pairs are
+ * merged into duplicate groups with union-find.
+ *
+ * With b bands of r rows, two tracks whose hash sets have Jaccard
+ * similarity J become candidates with probability 1 - (1 - J^r)^b. The
+ * defaults (40 x 3) catch J = 0.5 with probability 0.99 and J = 0.3 with
+ * 0.66, while unrelated tracks (J below 0.02) almost never collide.
+ */
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include "result.hpp"
+#include "compact_fingerprint.hpp"
+
+namespace sortify {
+namespace audio {
+
+/// Minimum value per sketch position; two sketches agree on a position with probability J
+using MinHashSketch = std::vector<uint32_t>;
+
+/**
+ * Computes a one-permutation MinHash sketch of the distinct hashes of a fingerprint
+ *
+ * Every hash is mixed once and assigned to one of numValues bins, each
+ * keeping its minimum; empty bins borrow from a pseudo-randomly chosen
+ * filled bin. This costs O(records) instead of O(records * numValues).
+ *
+ * @param fingerprint Compact fingerprint of the track (e.g. from createCompactFingerprint)
+ * @param numValues Sketch length
+ * @return The sketch; empty if the fingerprint has no records
+ */
+MinHashSketch computeMinHashSketch(const CompactFingerprint& fingerprint, size_t numValues);
+
+/**
+ * Estimates the Jaccard similarity of the hash sets behind two sketches
+ *
+ * @return Fraction of positions on which the sketches agree (0 if the lengths differ)
+ */
+float estimateJaccard(const MinHashSketch& a, const MinHashSketch& b);
+
+/**
+ * @struct DuplicateOptions
+ * @brief Candidate and verification thresholds of a DuplicateDetector
+ */
+struct DuplicateOptions {
+    unsigned int numBands = 40;     ///< LSH bands
+    unsigned int rowsPerBand = 3;   ///< Sketch values per band; the sketch has numBands * rowsPerBand values
+    size_t maxBucketSize = 2000;    ///< Buckets with more tracks (silence, test tones) yield no candidates
+    unsigned int minScore = 20;     ///< Minimum hashes agreeing on one time offset
+    float minConfidence = 0.1f;     ///< Minimum score divided by the smaller fingerprint's record count
+    unsigned int maxOffsetFrames = 4096; ///< Largest time offset between copies that verification considers
+    unsigned int numThreads = 0;    ///< Verification threads (0 = one per hardware thread)
+};
+
+/**
+ * @struct DuplicatePair
+ * @brief Two tracks confirmed to contain the same recording
+ */
+struct DuplicatePair {
+    int firstSongId;       ///< Smaller song ID of the pair
+    int secondSongId;      ///< Larger song ID of the pair
+    unsigned int score;    ///< Hashes agreeing on the best time offset, counted until both thresholds were met
+    int64_t offsetFrames;  ///< Frame in the second track minus frame in the first
+    float confidence;      ///< score divided by the smaller fingerprint's record count
+};
+
+/**
+ * @struct DuplicateReport
+ * @brief Outcome of DuplicateDetector::findDuplicates
+ */
+struct DuplicateReport {
+    std::vector<std::vector<int>> groups; ///< Song IDs of each group (two or more, ascending), ordered by first ID
+    std::vector<DuplicatePair> pairs;     ///< Every verified pair
+    size_t candidatePairs = 0;            ///< Distinct pairs produced by the LSH stage
+    size_t skippedBuckets = 0;            ///< Buckets ignored for exceeding maxBucketSize
+};
+
+/**
+ * Looks up the fingerprint of a track for verification
+ *
+ * Returns nullptr if the fingerprint is unavailable; the pair is then not
+ * verified. Called from several threads at once.
+ */
+using FingerprintLookup = std::function<const CompactFingerprint*(int songId)>;
+
+/**
+ * @class DuplicateDetector
+ * @brief Groups the tracks of a library that contain the same recording
+ *
+ * Only sketches are kept, a few hundred bytes per track; fingerprints are
+ * requested through a FingerprintLookup during verification, so the caller
+ * decides whether they live in memory, in a FingerprintCache or on disk.
+ */
+class DuplicateDetector {
+public:
+    explicit DuplicateDetector(DuplicateOptions options = DuplicateOptions());
+
+    /**
+     * Computes and stores the sketch of a track
+     *
+     * @param songId Identifier of the track; must be unique
+     * @param fingerprint Compact fingerprint of the track
+     * @return Result containing the number of tracks added so far
+     */
+    Result<size_t> addTrack(int songId, const CompactFingerprint& fingerprint);
+
+    /**
+     * Stores a sketch computed elsewhere, e.g. in parallel with computeMinHashSketch
+     *
+     * @param songId Identifier of the track; must be unique
+     * @param sketch Sketch of sketchSize() values
+     * @return Result containing the number of tracks added so far
+     */
+    Result<size_t> addSketch(int songId, MinHashSketch sketch);
+
+    /**
+     * Runs the LSH stage and returns the distinct candidate pairs
+     *
+     * @param skippedBuckets Set to the number of oversized buckets ignored
+     * @return Pairs of song IDs, smaller ID first, in ascending order
+     */
+    std::vector<std::pair<int, int>> findCandidatePairs(size_t* skippedBuckets = nullptr) const;
+
+    /**
+     * Finds candidates, verifies them and groups the confirmed duplicates
+     *
+     * @param lookup Provides the fingerprint of each candidate track
+     * @return Result containing the groups and verified pairs
+     */
+    Result<DuplicateReport> findDuplicates(const FingerprintLookup& lookup) const;
+
+    /**
+     * Get the sketch length implied by the options
+     */
+    size_t sketchSize() const {
+        return static_cast<size_t>(options.numBands) * options.rowsPerBand;
+    }
+
+    /**
+     * Get the number of tracks added
+     */
+    size_t trackCount() const {
+        return songIds.size();
+    }
+
+private:
+    DuplicateOptions options;
+    std::vector<int> songIds;
+    std::vector<uint32_t> sketches;  ///< sketchSize() values per track, in songIds order
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // DUPLICATE_DETECTOR_HPP
@@ -0,0 +1,255 @@
+#ifndef FFT_PLAN_CACHE_HPP
+#define FFT_PLAN_CACHE_HPP
+
+/**
+ * @file fft_plan_cache.hpp
+ * @brief Process-wide cache of FFTW plans shared by all spectrogram computations
+ *
+ * Creating an FFTW plan is far more expensive than executing it, and the FFTW
+ * planner is not thread-safe. This module creates each plan once per transform
+ * size, serializes all planner access behind a single mutex, and hands out
+ * per-caller workspaces that execute the shared plan on their own buffers.
+ */
+
+#include <fftw3.h>
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @enum FFTPlanRigor
+ * @brief Controls how much effort FFTW spends searching for a fast plan
+ */
+enum class FFTPlanRigor {
+    ESTIMATE, ///< Pick a reasonable plan heuristically (fast to create)
+    MEASURE   ///< Time several candidate plans and keep the fastest (slow to create, fast to run)
+};
+
+/**
+ * @class FFTPlanCache
+ * @brief Thread-safe cache of forward FFT plans keyed by transform kind and size
+ *
+ * Plans are created lazily on first use and kept until clear() is called.
+ * Accumulated FFTW wisdom can be exported to disk and imported on the next
+ * start so that FFTW_MEASURE planning is only paid once per machine.
+ */
+class FFTPlanCache {
+public:
+    /**
+     * Get the forward real-to-complex plan for the given size, creating it if needed
+     *
+     * The plan transforms size real values into size / 2 + 1 complex bins and
+     * must only be executed with fftwf_execute_dft_r2c on buffers allocated
+     * with fftwf_alloc_real / fftwf_alloc_complex.
+     *
+     * @param size Transform size (number of real input samples)
+     * @param errorMessage Set to a description of the problem on failure
+     * @return The cached plan, or nullptr if the plan could not be created
+     */
+    static fftwf_plan getRealPlan(unsigned int size, std::string& errorMessage);
+
+    /**
+     * Get a plan running batchSize real-to-complex transforms in one call
+     *
+     * The input is batchSize contiguous frames of size reals and the output
+     * batchSize contiguous frames of size / 2 + 1 bins. One call amortizes
+     * the per-execute overhead and lets FFTW vectorize across frames.
+     *
+     * @param size Transform size (number of real input samples per frame)
+     * @param batchSize Number of frames transformed per execution
+     * @param errorMessage Set to a description of the problem on failure
+     * @return The cached plan, or nullptr if the plan could not be created
+     */
+    static fftwf_plan getBatchedRealPlan(unsigned int size, unsigned int batchSize, std::string& errorMessage);
+
+    /**
+     * Sets the planning rigor used for plans created from now on
+     *
+     * @param rigor The FFTW planning rigor
+     */
+    static void setPlanRigor(FFTPlanRigor rigor);
+
+    /**
+     * Imports FFTW wisdom previously written by exportWisdom()
+     *
+     * @param filePath Path to the wisdom file
+     * @return true if the wisdom was imported, false otherwise
+     */
+    static bool importWisdom(const std::string& filePath);
+
+    /**
+     * Exports the FFTW wisdom gathered by this process
+     *
+     * @param filePath Path to the wisdom file to write
+     * @return true if the wisdom was written, false otherwise
+     */
+    static bool exportWisdom(const std::string& filePath);
+
+    /**
+     * Destroys all cached plans
+     *
+     * Must not be called while any RealFFTWorkspace or BatchedRealFFTWorkspace is still alive.
+     */
+    static void clear();
+
+private:
+    /**
+     * A plan together with the buffers it was created on
+     */
+    struct CachedPlan {
+        fftwf_plan plan;
+        void* in;
+        void* out;
+    };
+
+    /**
+     * Translate the current rigor into FFTW planner flags
+     */
+    static unsigned int plannerFlags();
+
+    // Static members
+    static std::mutex cacheMutex;
+    static FFTPlanRigor planRigor;
+    static std::unordered_map<unsigned int, CachedPlan> realPlans;
+    static std::unordered_map<uint64_t, CachedPlan> batchedRealPlans;
+};
+
+/**
+ * @class RealFFTWorkspace
+ * @brief Aligned buffers bound to a cached real-to-complex plan
+ *
+ * Each thread that computes FFTs owns its own workspace. Executing a shared
+ * plan on distinct buffers is thread-safe in FFTW, so no locking is needed
+ * once the workspace has been created.
+ *
+ * Audio samples are real, so a real-input transform does half the work of a
+ * complex one and lets callers write windowed samples straight into the
+ * input buffer without building an intermediate complex vector.
+ */
+class RealFFTWorkspace {
+public:
+    /**
+     * Creates a workspace for real transforms of the given size
+     *
+     * @param size Transform size (number of real input samples)
+     */
+    explicit RealFFTWorkspace(unsigned int size);
+    ~RealFFTWorkspace();
+
+    RealFFTWorkspace(const RealFFTWorkspace&) = delete;
+    RealFFTWorkspace& operator=(const RealFFTWorkspace&) = delete;
+
+    /**
+     * Check if the buffers and plan were created successfully
+     */
+    bool isValid() const {
+        return plan != nullptr && in != nullptr && out != nullptr;
+    }
+
+    /**
+     * Get the reason the workspace is not valid
+     */
+    const std::string& getError() const {
+        return errorMessage;
+    }
+
+    unsigned int size() const { return transformSize; }
+    unsigned int numOutputBins() const { return transformSize / 2 + 1; }
+    float* input() { return in; }
+    const fftwf_complex* output() const { return out; }
+
+    /**
+     * Transforms the real input buffer into the complex output buffer
+     */
+    void execute() {
+        fftwf_execute_dft_r2c(plan, in, out);
+    }
+
+private:
+    unsigned int transformSize;
+    fftwf_plan plan = nullptr;
+    float* in = nullptr;
+    fftwf_complex* out = nullptr;
+    std::string errorMessage;
+};
+
+/// Frames per execution of a BatchedRealFFTWorkspace unless the caller chooses otherwise
+constexpr unsigned int defaultFFTBatchSize = 32;
+
+/**
+ * @class BatchedRealFFTWorkspace
+ * @brief Packed frame matrix bound to a cached batched real-to-complex plan
+ *
+ * Callers fill up to batchSize() input frames, run execute() once and read
+ * the matching output frames. Unused input slots start out zeroed.
+ */
+class BatchedRealFFTWorkspace {
+public:
+    /**
+     * Creates a workspace for batches of real transforms
+     *
+     * @param size Transform size (number of real input samples per frame)
+     * @param batchSize Number of frames transformed per execution
+     */
+    BatchedRealFFTWorkspace(unsigned int size, unsigned int batchSize);
+    ~BatchedRealFFTWorkspace();
+
+    BatchedRealFFTWorkspace(const BatchedRealFFTWorkspace&) = delete;
+    BatchedRealFFTWorkspace& operator=(const BatchedRealFFTWorkspace&) = delete;
+
+    /**
+     * Check if the buffers and plan were created successfully
+     */
+    bool isValid() const {
+        return plan != nullptr && in != nullptr && out != nullptr;
+    }
+
+    /**
+     * Get the reason the workspace is not valid
+     */
+    const std::string& getError() const {
+        return errorMessage;
+    }
+
+    unsigned int size() const { return transformSize; }
+    unsigned int batchSize() const { return frames; }
+    unsigned int numOutputBins() const { return transformSize / 2 + 1; }
+
+    /**
+     * Get the input frame of one batch slot
+     */
+    float* input(unsigned int slot) {
+        return in + static_cast<size_t>(slot) * transformSize;
+    }
+
+    /**
+     * Get the output bins of one batch slot
+     */
+    const fftwf_complex* output(unsigned int slot) const {
+        return out + static_cast<size_t>(slot) * numOutputBins();
+    }
+
+    /**
+     * Transforms every input frame into its output frame
+     */
+    void execute() {
+        fftwf_execute_dft_r2c(plan, in, out);
+    }
+
+private:
+    unsigned int transformSize;
+    unsigned int frames;
+    fftwf_plan plan = nullptr;
+    float* in = nullptr;
+    fftwf_complex* out = nullptr;
+    std::string errorMessage;
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // FFT_PLAN_CACHE_HPP
@@ -0,0 +1,152 @@
+#ifndef FINGERPRINT_CACHE_HPP
+#define FINGERPRINT_CACHE_HPP
+
+/**
+ * @file fingerprint_cache.hpp
+ * @brief Persistent cache of fingerprints keyed by file identity
+ *
+ * A file is considered unchanged when its size, modification time and a
+ * hash of its first and last bytes all match the cached entry, and the
+ * entry was created with the same parameter hash. Checking this costs two
+ * small reads instead of a full decode, which makes rescans of a mostly
+ * static library incremental.
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "result.hpp"
+#include "compact_fingerprint.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @struct FileIdentity
+ * @brief Cheap description of a file's content
+ */
+struct FileIdentity {
+    uint64_t size = 0;         ///< File size in bytes
+    int64_t mtimeNs = 0;       ///< Modification time in nanoseconds since the epoch
+    uint64_t contentHash = 0;  ///< FNV-1a hash of the first and last sampled bytes
+
+    bool operator==(const FileIdentity& other) const {
+        return size == other.size && mtimeNs == other.mtimeNs && contentHash == other.contentHash;
+    }
+};
+
+/// Bytes hashed at each end of a file for its identity
+constexpr size_t fileIdentitySampleBytes = 64 * 1024;
+
+/**
+ * Computes the identity of a file
+ *
+ * @param filePath Path to the file
+ * @param sampleBytes Bytes hashed at the start and at the end of the file
+ * @return Result containing the identity
+ */
+Result<FileIdentity> computeFileIdentity(const std::string& filePath, size_t sampleBytes = fileIdentitySampleBytes);
+
+/**
+ * @class FingerprintCache
+ * @brief Thread-safe map from file path to its last fingerprint
+ */
+class FingerprintCache {
+public:
+    /**
+     * Creates an empty cache
+     *
+     * @param cachePath File used by load() and save() (empty = memory only)
+     */
+    explicit FingerprintCache(std::string cachePath = "");
+
+    FingerprintCache(const FingerprintCache&) = delete;
+    FingerprintCache& operator=(const FingerprintCache&) = delete;
+
+    /**
+     * Loads the entries stored at the cache path
+     *
+     * A missing file is not an error; an unreadable one leaves the cache empty.
+     *
+     * @return Result containing the number of entries loaded
+     */
+    Result<size_t> load();
+
+    /**
+     * Writes all entries to the cache path, replacing it atomically
+     *
+     * The new file is flushed to disk before it replaces the old one, and
+     * processes saving the same cache at once each write their own
+     * temporary file; the last rename wins.
+     *
+     * @return Result containing the number of bytes written
+     */
+    Result<size_t> save() const;
+
+    /**
+     * Looks up a still-valid fingerprint
+     *
+     * @param filePath Path of the file
+     * @param identity Current identity of the file
+     * @param paramHash Hash of the parameters the caller fingerprints with
+     * @param fingerprint Receives the cached fingerprint on a hit
+     * @return true on a hit
+     */
+    bool lookup(const std::string& filePath, const FileIdentity& identity, uint64_t paramHash,
+                CompactFingerprint& fingerprint) const;
+
+    /**
+     * Stores or replaces the fingerprint of a file
+     */
+    void store(const std::string& filePath, const FileIdentity& identity, uint64_t paramHash,
+               const CompactFingerprint& fingerprint);
+
+    /**
+     * Drops the entries of files that are not in paths (e.g. deleted files)
+     *
+     * @param paths Files that still exist
+     * @return Number of entries removed
+     */
+    size_t retainOnly(const std::vector<std::string>& paths);
+
+    /**
+     * Get the number of cached files
+     */
+    size_t size() const;
+
+    /**
+     * Get the number of lookups that found a valid entry
+     */
+    size_t hits() const {
+        return hitCount;
+    }
+
+    /**
+     * Get the number of lookups that did not
+     */
+    size_t misses() const {
+        return missCount;
+    }
+
+private:
+    struct Entry {
+        FileIdentity identity;
+        uint64_t paramHash = 0;
+        std::vector<HashRecord> records;
+    };
+
+    std::string cachePath;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    mutable std::atomic<size_t> hitCount{0};
+    mutable std::atomic<size_t> missCount{0};
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // FINGERPRINT_CACHE_HPP
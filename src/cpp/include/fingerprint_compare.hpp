@@ -0,0 +1,114 @@
+#ifndef FINGERPRINT_COMPARE_HPP
+#define FINGERPRINT_COMPARE_HPP
+
+/**
+ * @file fingerprint_compare.hpp
+ * @brief Offset-histogram scoring of two compact fingerprints
+ *
+ * Both fingerprints keep their records sorted by hash, so the common
+ * hashes are found with one linear merge join instead of a lookup per
+ * hash. Every common hash votes for the time offset between its two
+ * anchors; votes go into a dense array covering a bounded offset range,
+ * and the tallest bin is the match score.
+ *
+ * For a fixed offset each remaining record can still add at most one
+ * vote, so once the best bin plus the records left on the shorter side
+ * falls below the target the match is provably impossible, and once the
+ * target is reached the comparison is decided. Either way the merge stops
+ * early. A FingerprintComparer allocates its histogram once and never
+ * allocates while comparing.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "compact_fingerprint.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @struct CompareOptions
+ * @brief Offset range and early-exit thresholds of a comparison
+ */
+struct CompareOptions {
+    unsigned int maxOffsetFrames = 4096; ///< Votes for offsets beyond +-this many frames are ignored
+    unsigned int minScore = 0;           ///< Score that decides a match (0 = no score target)
+    float minConfidence = 0.0f;          ///< Confidence that decides a match (0 = no confidence target)
+    size_t maxVotesPerHash = 64;         ///< Hashes pairing more records than this carry no timing and are skipped
+};
+
+/**
+ * @struct FingerprintComparison
+ * @brief Outcome of comparing two fingerprints
+ */
+struct FingerprintComparison {
+    unsigned int score = 0;    ///< Votes for the best offset
+    int64_t offsetFrames = 0;  ///< Frame in the second fingerprint minus frame in the first at the best offset
+    unsigned int matches = 0;  ///< Votes counted for any offset in range
+    float confidence = 0.0f;   ///< score divided by the smaller fingerprint's record count
+    bool complete = true;      ///< False if the merge stopped early; score is then a lower bound
+
+    /**
+     * Check if both thresholds of the options were met
+     */
+    bool isMatch(const CompareOptions& options) const {
+        return score > 0 && score >= options.minScore && confidence >= options.minConfidence;
+    }
+};
+
+/**
+ * @class FingerprintComparer
+ * @brief Reusable, allocation-free scorer of fingerprint pairs
+ *
+ * Not thread-safe; each thread uses its own comparer.
+ */
+class FingerprintComparer {
+public:
+    explicit FingerprintComparer(CompareOptions options = CompareOptions());
+
+    /**
+     * Scores how well two fingerprints agree on a single time offset
+     *
+     * @param first Compact fingerprint of the first track
+     * @param second Compact fingerprint of the second track
+     * @return The best offset and its score
+     */
+    FingerprintComparison compare(const CompactFingerprint& first, const CompactFingerprint& second);
+
+    /**
+     * Changes the options; the histogram is only reallocated if the offset range grows
+     */
+    void setOptions(const CompareOptions& newOptions);
+
+    const CompareOptions& getOptions() const {
+        return options;
+    }
+
+private:
+    CompareOptions options;
+    std::vector<uint32_t> histogram;  ///< One bin per offset in [-maxOffsetFrames, maxOffsetFrames]
+    std::vector<uint32_t> touched;    ///< Bins written by the current comparison, for clearing
+};
+
+/**
+ * Scores two fingerprints with a per-thread FingerprintComparer
+ *
+ * The comparer is reused across calls on the same thread, so only the
+ * first call with given offset bounds allocates.
+ *
+ * @param first Compact fingerprint of the first track
+ * @param second Compact fingerprint of the second track
+ * @param options Offset range and early-exit thresholds
+ * @return The best offset and its score
+ */
+FingerprintComparison compareFingerprints(
+    const CompactFingerprint& first,
+    const CompactFingerprint& second,
+    const CompareOptions& options = CompareOptions()
+);
+
+} // namespace audio
+} // namespace sortify
+
+#endif // FINGERPRINT_COMPARE_HPP
@@ -0,0 +1,210 @@
+#ifndef FINGERPRINT_CONFIG_HPP
+#define FINGERPRINT_CONFIG_HPP
+
+/**
+ * @file fingerprint_config.hpp
+ * @brief Analysis parameters shared by every fingerprinting entry point
+ *
+ * Parameters exist twice: as a compile-time policy whose values are
+ * constants, and as the runtime FingerprintConfig. The peak picking and
+ * pairing kernels are templates over the policy, so the default
+ * configuration runs with unrolled band loops and constant target-zone
+ * bounds; any other configuration takes the runtime-parameterized
+ * instantiation of the same code.
+ */
+
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+namespace sortify {
+namespace audio {
+
+/// Upper bound on the number of bands a frame is split into
+constexpr unsigned int maxFrequencyBands = 16;
+
+/// Band boundaries as fractions of the kept spectrogram bins; band i is [edge i, edge i+1)
+using BandEdges = std::array<double, maxFrequencyBands + 1>;
+
+/**
+ * @struct DefaultFingerprintPolicy
+ * @brief Compile-time form of the default configuration
+ *
+ * Another policy with the same members instantiates its own specialized
+ * kernels via makeFingerprintConfig and matchesPolicy.
+ */
+struct DefaultFingerprintPolicy {
+    static constexpr unsigned int sampleRate = 44100;
+    static constexpr unsigned int windowSize = 2048;
+    static constexpr float overlap = 0.5f;
+    static constexpr float minFreq = 20.0f;
+    static constexpr float maxFreq = 5000.0f;
+
+    // Logarithmic bands: ~0-500, 500-2000, 2000-3000, 3000-4000, 4000-4500 and 4500-5000 Hz
+    static constexpr unsigned int numBands = 6;
+    static constexpr BandEdges bandEdges = {0.0, 0.1, 0.25, 0.4, 0.6, 0.8, 1.0};
+
+    static constexpr float targetTimeRange = 3.0f;         ///< Look for targets within 3 time units
+    static constexpr float minTargetTimeDelta = 0.5f;      ///< Minimum time between anchor and target
+    static constexpr float maxFreqDelta = 30.0f;           ///< Maximum frequency difference
+    static constexpr unsigned int maxTargetsPerAnchor = 5; ///< Find up to 5 targets per anchor
+};
+
+/**
+ * @struct DecimatedFingerprintPolicy
+ * @brief Default analysis at a quarter of the sample rate
+ *
+ * maxFreq stays below the 5512 Hz Nyquist frequency of 11025 Hz audio, and
+ * a quarter of the window keeps the bin width (21.5 Hz) and the hop
+ * (23.2 ms), so bins, bands and the target zone mean the same as in the
+ * default; the FFTs are four times smaller. Feed it audio resampled to
+ * 11025 Hz (see Resampler).
+ */
+struct DecimatedFingerprintPolicy : DefaultFingerprintPolicy {
+    static constexpr unsigned int sampleRate = 11025;
+    static constexpr unsigned int windowSize = 512;
+};
+
+/**
+ * @struct FingerprintConfig
+ * @brief Parameters used to fingerprint a track
+ *
+ * Fingerprints can only be compared when they were created with the same
+ * configuration. The defaults equal DefaultFingerprintPolicy and match
+ * generateSpectrogram, extractPeaks and createCompactFingerprint.
+ */
+struct FingerprintConfig {
+    unsigned int sampleRate = DefaultFingerprintPolicy::sampleRate; ///< Sample rate of the decoded audio (Hz)
+    unsigned int windowSize = DefaultFingerprintPolicy::windowSize; ///< Size of each window for FFT
+    float overlap = DefaultFingerprintPolicy::overlap;              ///< Overlap percentage between windows (0.0-1.0)
+    float minFreq = DefaultFingerprintPolicy::minFreq;              ///< Minimum frequency to include (Hz)
+    float maxFreq = DefaultFingerprintPolicy::maxFreq;              ///< Maximum frequency to include (Hz)
+
+    unsigned int numBands = DefaultFingerprintPolicy::numBands;     ///< Peak-picking bands (1 to maxFrequencyBands)
+    BandEdges bandEdges = DefaultFingerprintPolicy::bandEdges;      ///< numBands + 1 ascending fractions from 0 to 1
+
+    float targetTimeRange = DefaultFingerprintPolicy::targetTimeRange;       ///< Largest anchor-target time delta (frames)
+    float minTargetTimeDelta = DefaultFingerprintPolicy::minTargetTimeDelta; ///< Smallest anchor-target time delta (frames)
+    float maxFreqDelta = DefaultFingerprintPolicy::maxFreqDelta;             ///< Largest anchor-target bin distance
+    unsigned int maxTargetsPerAnchor = DefaultFingerprintPolicy::maxTargetsPerAnchor; ///< Hashes per anchor
+};
+
+/**
+ * Builds the runtime configuration equal to a policy
+ */
+template <typename Policy>
+constexpr FingerprintConfig makeFingerprintConfig() {
+    FingerprintConfig config;
+    config.sampleRate = Policy::sampleRate;
+    config.windowSize = Policy::windowSize;
+    config.overlap = Policy::overlap;
+    config.minFreq = Policy::minFreq;
+    config.maxFreq = Policy::maxFreq;
+    config.numBands = Policy::numBands;
+    config.bandEdges = Policy::bandEdges;
+    config.targetTimeRange = Policy::targetTimeRange;
+    config.minTargetTimeDelta = Policy::minTargetTimeDelta;
+    config.maxFreqDelta = Policy::maxFreqDelta;
+    config.maxTargetsPerAnchor = Policy::maxTargetsPerAnchor;
+    return config;
+}
+
+/**
+ * Check if a configuration uses the peak bands of a policy
+ */
+template <typename Policy>
+constexpr bool matchesPolicyBands(const FingerprintConfig& config) {
+    if (config.numBands != Policy::numBands) {
+        return false;
+    }
+    for (unsigned int i = 0; i <= Policy::numBands; ++i) {
+        if (config.bandEdges[i] != Policy::bandEdges[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Check if a configuration uses the target zone of a policy
+ */
+template <typename Policy>
+constexpr bool matchesPolicyTargetZone(const FingerprintConfig& config) {
+    return config.targetTimeRange == Policy::targetTimeRange &&
+           config.minTargetTimeDelta == Policy::minTargetTimeDelta &&
+           config.maxFreqDelta == Policy::maxFreqDelta &&
+           config.maxTargetsPerAnchor == Policy::maxTargetsPerAnchor;
+}
+
+/**
+ * Check if a configuration equals a policy in every parameter
+ */
+template <typename Policy>
+constexpr bool matchesPolicy(const FingerprintConfig& config) {
+    return config.sampleRate == Policy::sampleRate && config.windowSize == Policy::windowSize &&
+           config.overlap == Policy::overlap && config.minFreq == Policy::minFreq &&
+           config.maxFreq == Policy::maxFreq && matchesPolicyBands<Policy>(config) &&
+           matchesPolicyTargetZone<Policy>(config);
+}
+
+/// Version of the peak picking and hash layout; bump it whenever fingerprints change
+constexpr uint32_t fingerprintFormatVersion = 1;
+
+/// Initial value of a 64-bit FNV-1a hash
+constexpr uint64_t fnvOffsetBasis = 14695981039346656037ull;
+
+/**
+ * Feeds raw bytes into a 64-bit FNV-1a hash
+ *
+ * @param hash Current hash value (start with fnvOffsetBasis)
+ * @param data Bytes to add
+ * @param size Number of bytes
+ * @return The updated hash
+ */
+inline uint64_t fnv1aHash(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * Hashes every parameter that influences the fingerprint of a file
+ *
+ * Two configurations with the same hash produce identical fingerprints, so
+ * the value can key caches and identify the configuration of a stored
+ * index. The band and target-zone parameters only enter the hash when they
+ * differ from the defaults, which keeps the IDs of configurations that
+ * predate them unchanged.
+ *
+ * @param config Analysis parameters
+ * @return 64-bit hash including fingerprintFormatVersion
+ */
+inline uint64_t hashFingerprintConfig(const FingerprintConfig& config) {
+    uint64_t hash = fnv1aHash(fnvOffsetBasis, &fingerprintFormatVersion, sizeof(fingerprintFormatVersion));
+    hash = fnv1aHash(hash, &config.sampleRate, sizeof(config.sampleRate));
+    hash = fnv1aHash(hash, &config.windowSize, sizeof(config.windowSize));
+    hash = fnv1aHash(hash, &config.overlap, sizeof(config.overlap));
+    hash = fnv1aHash(hash, &config.minFreq, sizeof(config.minFreq));
+    hash = fnv1aHash(hash, &config.maxFreq, sizeof(config.maxFreq));
+
+    if (!matchesPolicyBands<DefaultFingerprintPolicy>(config)) {
+        hash = fnv1aHash(hash, &config.numBands, sizeof(config.numBands));
+        hash = fnv1aHash(hash, config.bandEdges.data(), sizeof(double) * (std::min(config.numBands, maxFrequencyBands) + 1));
+    }
+    if (!matchesPolicyTargetZone<DefaultFingerprintPolicy>(config)) {
+        hash = fnv1aHash(hash, &config.targetTimeRange, sizeof(config.targetTimeRange));
+        hash = fnv1aHash(hash, &config.minTargetTimeDelta, sizeof(config.minTargetTimeDelta));
+        hash = fnv1aHash(hash, &config.maxFreqDelta, sizeof(config.maxFreqDelta));
+        hash = fnv1aHash(hash, &config.maxTargetsPerAnchor, sizeof(config.maxTargetsPerAnchor));
+    }
+    return hash;
+}
+
+} // namespace audio
+} // namespace sortify
+
+#endif // FINGERPRINT_CONFIG_HPP
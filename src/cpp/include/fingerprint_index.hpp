@@ -0,0 +1,261 @@
+#ifndef FINGERPRINT_INDEX_HPP
+#define FINGERPRINT_INDEX_HPP
+
+/**
+ * @file fingerprint_index.hpp
+ * @brief Inverted index from hash to the tracks containing it
+ *
+ * Tracks are added as CompactFingerprints and then built into a compressed
+ * sparse row layout: a sorted array of distinct hashes, an offsets array and
+ * one contiguous array of (songId, anchorFrame) postings. A query looks up
+ * every hash of the sample, votes for (song, time offset) pairs and ranks the
+ * songs by the height of their offset histogram peak, so the cost depends on
+ * the posting lists touched rather than on the number of tracks.
+ *
+ * build() also fills a blocked Bloom filter over the distinct hashes, which
+ * rejects most hashes of unrelated audio with a single cache-line probe
+ * before the hash array is searched.
+ */
+
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+#include <cstddef>
+#include "result.hpp"
+#include "compact_fingerprint.hpp"
+#include "bloom_filter.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @struct Posting
+ * @brief One occurrence of a hash in an indexed track
+ */
+struct Posting {
+    int32_t songId;       ///< Track containing the hash
+    uint32_t anchorFrame; ///< Time position (window index) of the anchor in that track
+};
+
+static_assert(sizeof(Posting) == 8, "Posting must stay packed into 8 bytes");
+
+/**
+ * @struct MatchCandidate
+ * @brief One ranked query result
+ */
+struct MatchCandidate {
+    int songId;             ///< Matching track
+    unsigned int score;     ///< Number of hashes agreeing on the best time offset
+    int64_t offsetFrames;   ///< Track frame minus sample frame at the best offset
+    unsigned int matches;   ///< Number of hash hits for the track at any offset
+    float confidence;       ///< score divided by the number of sample hashes (0.0-1.0)
+};
+
+/**
+ * @class MatchAccumulator
+ * @brief Collects (song, time offset) votes and ranks songs by histogram peak
+ *
+ * Votes are appended to a flat array and counted after a sort, which keeps
+ * memory proportional to the number of hits and avoids a hashmap per song.
+ */
+class MatchAccumulator {
+public:
+    /**
+     * Records that a sample hash at sampleFrame was found in songId at trackFrame
+     */
+    void addVote(int32_t songId, uint32_t trackFrame, uint32_t sampleFrame) {
+        const int64_t offset = static_cast<int64_t>(trackFrame) - static_cast<int64_t>(sampleFrame);
+        votes.push_back(static_cast<uint64_t>(static_cast<uint32_t>(songId)) << 32 |
+                        static_cast<uint32_t>(offset + offsetBias));
+    }
+
+    /**
+     * Get the number of votes recorded so far
+     */
+    size_t size() const {
+        return votes.size();
+    }
+
+    /**
+     * Ranks the songs that received votes
+     *
+     * @param sampleHashes Number of hashes in the query, used for confidence
+     * @param maxResults Maximum number of candidates to return
+     * @param minScore Minimum histogram peak for a song to be reported
+     * @return Candidates ordered by descending score
+     */
+    std::vector<MatchCandidate> rank(size_t sampleHashes, size_t maxResults, unsigned int minScore);
+
+    /**
+     * Removes all votes but keeps the allocated memory
+     */
+    void clear() {
+        votes.clear();
+    }
+
+private:
+    // Offsets are stored biased so that the packed key sorts by song, then offset
+    static constexpr int64_t offsetBias = int64_t(1) << 31;
+
+    std::vector<uint64_t> votes;
+};
+
+/**
+ * @class FingerprintIndex
+ * @brief In-memory inverted index over many tracks
+ *
+ * addTrack stages fingerprints; build() merges everything staged into the
+ * searchable layout. query() only sees tracks added before the last build()
+ * and is safe to call from several threads while no track is being added.
+ */
+class FingerprintIndex {
+public:
+    /**
+     * Stages a track for the next build()
+     *
+     * @param songId Identifier returned by queries; must be unique in the index
+     * @param fingerprint Compact fingerprint of the track
+     * @return Result containing the number of records staged
+     */
+    Result<size_t> addTrack(int songId, const CompactFingerprint& fingerprint);
+
+    /**
+     * Stages the postings of one hash for the next build(), e.g. when merging indexes
+     *
+     * The songs named by the postings are registered without the uniqueness
+     * check of addTrack, so the merged sources must hold disjoint songs.
+     *
+     * @param hash The hash the postings belong to
+     * @param list First posting
+     * @param count Number of postings
+     */
+    void addPostings(uint32_t hash, const Posting* list, size_t count);
+
+    /**
+     * Merges all staged tracks into the searchable layout
+     */
+    void build();
+
+    /**
+     * Sets the Bloom filter size used by the next build()
+     *
+     * @param bitsPerKey Filter bits per distinct hash (0 = no filter)
+     */
+    void setBloomBitsPerKey(unsigned int bitsPerKey) {
+        bloomBitsPerKey = bitsPerKey;
+    }
+
+    /**
+     * Records which fingerprint configuration produced the indexed hashes
+     *
+     * Hashes of different configurations never match, so readers compare
+     * this against hashFingerprintConfig of their own configuration.
+     *
+     * @param id hashFingerprintConfig of the configuration (0 = unknown)
+     */
+    void setConfigId(uint64_t id) {
+        configIdValue = id;
+    }
+
+    /**
+     * Get the configuration ID set with setConfigId (0 = unknown)
+     */
+    uint64_t configId() const {
+        return configIdValue;
+    }
+
+    /**
+     * Finds the indexed tracks that best explain the sample
+     *
+     * @param sample Compact fingerprint of the query audio
+     * @param maxResults Maximum number of candidates to return
+     * @param minScore Minimum number of hashes agreeing on one time offset
+     * @return Result containing candidates ordered by descending score
+     */
+    Result<std::vector<MatchCandidate>> query(
+        const CompactFingerprint& sample,
+        size_t maxResults = 10,
+        unsigned int minScore = 2
+    ) const;
+
+    /**
+     * Get the postings of one hash
+     *
+     * @param hash The hash to look up
+     * @param count Set to the number of postings
+     * @return Pointer to the first posting (nullptr if the hash is not indexed)
+     */
+    const Posting* findPostings(uint32_t hash, size_t& count) const;
+
+    /**
+     * Get the number of tracks added, including staged ones
+     */
+    size_t trackCount() const {
+        return songIds.size();
+    }
+
+    /**
+     * Get the number of tracks merged by build(), excluding staged ones
+     */
+    size_t builtTrackCount() const {
+        return builtTracks;
+    }
+
+    /**
+     * Get the number of distinct hashes in the built index
+     */
+    size_t hashCount() const {
+        return hashes.size();
+    }
+
+    /**
+     * Get the number of postings in the built index
+     */
+    size_t postingCount() const {
+        return postings.size();
+    }
+
+    /**
+     * Check if tracks were added since the last build()
+     */
+    bool hasPendingTracks() const {
+        return !pending.empty();
+    }
+
+    /**
+     * Get the number of bytes used by the built index
+     */
+    size_t memoryBytes() const {
+        return hashes.capacity() * sizeof(uint32_t) +
+               offsets.capacity() * sizeof(uint64_t) +
+               postings.capacity() * sizeof(Posting) +
+               bloom.sizeBytes();
+    }
+
+    // Raw layout, used by the index file writer
+    const std::vector<uint32_t>& hashKeys() const { return hashes; }
+    const std::vector<uint64_t>& postingOffsets() const { return offsets; }
+    const std::vector<Posting>& allPostings() const { return postings; }
+    const BlockedBloomFilter& bloomFilter() const { return bloom; }
+
+private:
+    struct PendingEntry {
+        uint32_t hash;
+        Posting posting;
+    };
+
+    std::vector<uint32_t> hashes;   ///< Distinct hashes, ascending
+    std::vector<uint64_t> offsets;  ///< postings[offsets[i], offsets[i+1]) belong to hashes[i]
+    std::vector<Posting> postings;  ///< Sorted by song, then frame within each hash
+    BlockedBloomFilter bloom;       ///< Over hashes; empty if disabled
+    unsigned int bloomBitsPerKey = defaultBloomBitsPerKey;
+    uint64_t configIdValue = 0;
+    std::vector<PendingEntry> pending;
+    std::unordered_set<int> songIds;
+    size_t builtTracks = 0;         ///< songIds.size() at the last build()
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // FINGERPRINT_INDEX_HPP
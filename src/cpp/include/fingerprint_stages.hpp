@@ -0,0 +1,367 @@
+#ifndef FINGERPRINT_STAGES_HPP
+#define FINGERPRINT_STAGES_HPP
+
+/**
+ * @file fingerprint_stages.hpp
+ * @brief Per-frame building blocks shared by the batch and streaming pipelines
+ *
+ * generateSpectrogram, extractPeaks and createFingerprint process a whole
+ * track at once, while FingerprintStream processes one window at a time.
+ * Both are written in terms of the functions below so that they produce
+ * exactly the same peaks and hashes for the same audio.
+ */
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <cmath>
+#include "audio_fingerprint.hpp"
+#include "fingerprint_config.hpp"
+#include "fft_plan_cache.hpp"
+#include "cpu_features.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @struct SpectrogramLayout
+ * @brief Window stepping and kept FFT bin range derived from spectrogram parameters
+ */
+struct SpectrogramLayout {
+    unsigned int windowSize; ///< Samples per window
+    unsigned int stepSize;   ///< Samples between the starts of consecutive windows
+    unsigned int minBin;     ///< First FFT bin stored (spectrogram bin 0)
+    unsigned int maxBin;     ///< Last FFT bin of the requested range
+    unsigned int lastBin;    ///< Last FFT bin actually computed (the Nyquist bin is never stored)
+    unsigned int numBins;    ///< Number of bins per spectrogram frame
+};
+
+/**
+ * Validates spectrogram parameters and derives the window/bin layout
+ *
+ * @param sampleRate Sample rate of the audio (Hz)
+ * @param windowSize Size of each window for FFT
+ * @param overlap Overlap percentage between windows (0.0-1.0)
+ * @param minFreq Minimum frequency to include (Hz)
+ * @param maxFreq Maximum frequency to include (Hz)
+ * @return Result containing the layout, or the reason the parameters are invalid
+ */
+Result<SpectrogramLayout> computeSpectrogramLayout(
+    unsigned int sampleRate,
+    unsigned int windowSize,
+    float overlap,
+    float minFreq,
+    float maxFreq
+);
+
+/**
+ * Helper function to create a Hamming window
+ *
+ * @param size Window size
+ * @return Vector containing the Hamming window coefficients
+ */
+std::vector<float> createHammingWindow(unsigned int size);
+
+/**
+ * Converts the kept range of an FFT output into magnitudes
+ *
+ * @param spectrum FFT output of one window
+ * @param layout Layout giving the bin range to keep
+ * @param frame Destination for layout.numBins magnitudes
+ */
+inline void extractMagnitudes(const fftwf_complex* spectrum, const SpectrogramLayout& layout, float* frame) {
+    // This converts complex value to a single real value representing amplitude
+    // We ignore phase information as it's less important for fingerprinting
+    for (unsigned int sourceBinIdx = layout.minBin; sourceBinIdx <= layout.lastBin; ++sourceBinIdx) {
+        const float re = spectrum[sourceBinIdx][0];
+        const float im = spectrum[sourceBinIdx][1];
+        frame[sourceBinIdx - layout.minBin] = std::sqrt(re * re + im * im);
+    }
+}
+
+/// Frequency bands as half-open [first, second) ranges of spectrogram bins
+using FrequencyBands = std::vector<std::pair<unsigned int, unsigned int>>;
+
+/**
+ * Splits the spectrogram bins into the logarithmic peak-picking bands
+ *
+ * @param numFreqBins Number of bins per spectrogram frame
+ * @return Result containing the bands, or the reason they are invalid for this size
+ */
+Result<FrequencyBands> computeFrequencyBands(unsigned int numFreqBins);
+
+/**
+ * Splits the spectrogram bins into the bands of a configuration
+ *
+ * @param numFreqBins Number of bins per spectrogram frame
+ * @param config Configuration giving numBands and bandEdges
+ * @return Result containing the bands, or the reason they are invalid for this size
+ */
+Result<FrequencyBands> computeFrequencyBands(unsigned int numFreqBins, const FingerprintConfig& config);
+
+/**
+ * @struct BandMaximum
+ * @brief Strongest bin of one frequency band
+ */
+struct BandMaximum {
+    float magnitude;  ///< Largest magnitude in the band (0 if no bin is above zero)
+    unsigned int bin; ///< First bin holding that magnitude
+};
+
+/**
+ * Finds the strongest bin of bins[first, last)
+ *
+ * All instruction sets return identical results; unsupported levels fall
+ * back to the scalar kernel.
+ *
+ * @param bins Magnitudes of one frame
+ * @param first First bin of the band
+ * @param last One past the last bin of the band
+ * @param level Instruction set to use
+ * @return The band maximum; magnitude is 0 if the band holds no positive value
+ */
+BandMaximum findBandMaximum(const float* bins, unsigned int first, unsigned int last,
+                            SimdLevel level = detectSimdLevel());
+
+/**
+ * Picks the peaks of one spectrogram frame
+ *
+ * Finds the strongest bin in each band and keeps those stronger than the
+ * average of the band maxima (dynamic threshold). Band maxima are found with
+ * the widest SIMD kernel the CPU supports, and the threshold sum is
+ * accumulated in the same pass.
+ *
+ * @param frame Magnitudes of one time window
+ * @param bands Bands from computeFrequencyBands
+ * @param time Time position (window index) of the frame
+ * @param peaks Vector the selected peaks are appended to, in band order
+ */
+void pickFramePeaks(const SpectrogramFrame& frame, const FrequencyBands& bands, float time, std::vector<Peak>& peaks);
+
+/**
+ * @struct FixedTargetZone
+ * @brief Time-frequency area in which targets are paired with an anchor peak
+ *
+ * This constellation approach makes the fingerprint robust to noise and distortion.
+ * The bounds are compile-time constants, so pairing against this zone is
+ * fully constant-folded.
+ */
+template <typename Policy = DefaultFingerprintPolicy>
+struct FixedTargetZone {
+    static constexpr float timeRange = Policy::targetTimeRange;
+    static constexpr float minTimeDelta = Policy::minTargetTimeDelta;
+    static constexpr float maxFreqDelta = Policy::maxFreqDelta;
+    static constexpr unsigned int maxTargetsPerAnchor = Policy::maxTargetsPerAnchor;
+};
+
+/// Target zone of the default configuration
+using TargetZone = FixedTargetZone<>;
+
+/**
+ * @struct RuntimeTargetZone
+ * @brief Target zone read from a FingerprintConfig, for non-default configurations
+ */
+struct RuntimeTargetZone {
+    float timeRange;
+    float minTimeDelta;
+    float maxFreqDelta;
+    unsigned int maxTargetsPerAnchor;
+
+    explicit RuntimeTargetZone(const FingerprintConfig& config)
+        : timeRange(config.targetTimeRange),
+          minTimeDelta(config.minTargetTimeDelta),
+          maxFreqDelta(config.maxFreqDelta),
+          maxTargetsPerAnchor(config.maxTargetsPerAnchor) {}
+};
+
+/**
+ * Generate 32-bit hash from anchor/target pair
+ *
+ * 32-bit hash structure:
+ * - Bits 22-31 (10 bits): Anchor frequency (0-1023)
+ * - Bits 12-21 (10 bits): Target frequency (0-1023)
+ * - Bits 0-11  (12 bits): Time delta * 10 (0-4095)
+ *
+ * The bit shifts and masks ensure each component has its own range in the hash
+ */
+inline uint32_t createPeakPairHash(const Peak& anchor, const Peak& target) {
+    const float timeDelta = target.time - anchor.time;
+    return (static_cast<uint32_t>(anchor.frequency) & 0x3FF) << 22 |
+           (static_cast<uint32_t>(target.frequency) & 0x3FF) << 12 |
+           (static_cast<uint32_t>(timeDelta * 10.0f) & 0xFFF);
+}
+
+/**
+ * Pairs one anchor with the targets that follow it
+ *
+ * Peaks must be sorted by time. Visits the peaks in [first, last) in order
+ * and calls emit(hash) for up to zone.maxTargetsPerAnchor targets inside
+ * the target zone.
+ *
+ * @param zone TargetZone (constant bounds) or RuntimeTargetZone
+ * @param anchor The anchor peak
+ * @param first Iterator to the first peak after the anchor
+ * @param last Iterator past the last available peak
+ * @param emit Callable invoked with each 32-bit hash
+ * @return Number of hashes emitted
+ */
+template<typename Zone, typename PeakIterator, typename EmitFunc>
+unsigned int pairAnchorInZone(const Zone& zone, const Peak& anchor, PeakIterator first, PeakIterator last,
+                              EmitFunc&& emit) {
+    unsigned int numTargets = 0;
+
+    for (PeakIterator it = first; it != last && numTargets < zone.maxTargetsPerAnchor; ++it) {
+        const Peak& target = *it;
+
+        // Check if target is within time range
+        float timeDelta = target.time - anchor.time;
+        if (timeDelta < zone.minTimeDelta) continue;
+        if (timeDelta > zone.timeRange) break; // Assuming peaks are sorted by time
+
+        // Check if target is within frequency range
+        float freqDelta = std::abs(target.frequency - anchor.frequency);
+        if (freqDelta > zone.maxFreqDelta) continue;
+
+        emit(createPeakPairHash(anchor, target));
+        numTargets++;
+    }
+
+    return numTargets;
+}
+
+/**
+ * Pairs one anchor with the targets that follow it in the default TargetZone
+ */
+template<typename PeakIterator, typename EmitFunc>
+unsigned int pairAnchor(const Peak& anchor, PeakIterator first, PeakIterator last, EmitFunc&& emit) {
+    return pairAnchorInZone(TargetZone(), anchor, first, last, std::forward<EmitFunc>(emit));
+}
+
+/**
+ * @struct BasicPeakFrames
+ * @brief Time-sorted peaks bucketed into runs of equal time, for indexed pairing
+ *
+ * @tparam IndexVector Vector of uint32_t; its allocator supplies the bucket memory
+ */
+template <typename IndexVector>
+struct BasicPeakFrames {
+    IndexVector starts;           ///< First peak of each frame, followed by the peak count
+    bool frequencySorted = true;  ///< Every frame lists its peaks by ascending frequency
+
+    explicit BasicPeakFrames(IndexVector starts = IndexVector()) : starts(std::move(starts)) {}
+
+    size_t frameCount() const {
+        return starts.empty() ? 0 : starts.size() - 1;
+    }
+};
+
+using PeakFrames = BasicPeakFrames<std::vector<uint32_t>>;
+
+/**
+ * Buckets peaks into frames; extractPeaks output is already in the required order
+ *
+ * @param peaks Peaks to bucket
+ * @param frames Buckets, replaced on success
+ * @return False if the peaks are not sorted by time, in which case only
+ *         pairAnchorInZone's linear scan gives the defined result
+ */
+template <typename PeakVector, typename IndexVector>
+bool bucketPeakFrames(const PeakVector& peaks, BasicPeakFrames<IndexVector>& frames) {
+    frames.starts.clear();
+    frames.frequencySorted = true;
+    for (size_t i = 0; i < peaks.size(); ++i) {
+        if (i == 0 || peaks[i].time != peaks[i - 1].time) {
+            if (i > 0 && peaks[i].time < peaks[i - 1].time) {
+                return false;
+            }
+            frames.starts.push_back(static_cast<uint32_t>(i));
+        } else if (peaks[i].frequency < peaks[i - 1].frequency) {
+            frames.frequencySorted = false;
+        }
+    }
+    frames.starts.push_back(static_cast<uint32_t>(peaks.size()));
+    return true;
+}
+
+/**
+ * Pairs every peak with its targets, visiting only the frames and bins of its target zone
+ *
+ * Emits exactly the hashes, in exactly the order, of calling
+ * pairAnchorInZone for every anchor over the peaks that follow it, but an
+ * anchor only looks at frames whose time delta lies in [minTimeDelta,
+ * timeRange] and, in dense frequency-sorted frames, only at peaks within
+ * maxFreqDelta bins. The cost is O(peaks x targets) however dense the
+ * spectrum is.
+ *
+ * @param zone TargetZone (constant bounds) or RuntimeTargetZone
+ * @param peaks Time-sorted peaks
+ * @param frames Buckets of peaks from bucketPeakFrames
+ * @param emit Callable invoked as emit(anchorIndex, hash)
+ * @return Number of hashes emitted
+ */
+template <typename Zone, typename PeakVector, typename IndexVector, typename EmitFunc>
+size_t pairPeaksIndexed(const Zone& zone, const PeakVector& peaks, const BasicPeakFrames<IndexVector>& frames,
+                        EmitFunc&& emit) {
+    const size_t frameCount = frames.frameCount();
+    size_t numHashes = 0;
+    // Both bounds only move forward as the anchor time grows
+    size_t firstTargetFrame = 0;
+    size_t endTargetFrame = 0;
+
+    for (size_t f = 0; f < frameCount; ++f) {
+        const float anchorTime = peaks[frames.starts[f]].time;
+        firstTargetFrame = std::max(firstTargetFrame, f);
+        while (firstTargetFrame < frameCount &&
+               peaks[frames.starts[firstTargetFrame]].time - anchorTime < zone.minTimeDelta) {
+            ++firstTargetFrame;
+        }
+        endTargetFrame = std::max(endTargetFrame, firstTargetFrame);
+        while (endTargetFrame < frameCount &&
+               !(peaks[frames.starts[endTargetFrame]].time - anchorTime > zone.timeRange)) {
+            ++endTargetFrame;
+        }
+
+        for (size_t i = frames.starts[f]; i < frames.starts[f + 1]; ++i) {
+            const Peak& anchor = peaks[i];
+            unsigned int numTargets = 0;
+
+            for (size_t g = firstTargetFrame; g < endTargetFrame && numTargets < zone.maxTargetsPerAnchor; ++g) {
+                // Within the anchor's own frame only the peaks after it are candidates
+                const Peak* target = peaks.data() + (g == f ? i + 1 : frames.starts[g]);
+                const Peak* last = peaks.data() + frames.starts[g + 1];
+
+                // Sparse frames are cheaper to scan whole than to search: their data-dependent
+                // exits would mispredict more often than the extra comparisons cost
+                if (frames.frequencySorted && last - target > 16) {
+                    target = std::partition_point(target, last, [&](const Peak& peak) {
+                        return anchor.frequency - peak.frequency > zone.maxFreqDelta;
+                    });
+                    for (; target != last && target->frequency - anchor.frequency <= zone.maxFreqDelta; ++target) {
+                        emit(i, createPeakPairHash(anchor, *target));
+                        if (++numTargets == zone.maxTargetsPerAnchor) {
+                            break;
+                        }
+                    }
+                } else {
+                    for (; target != last; ++target) {
+                        if (std::abs(target->frequency - anchor.frequency) > zone.maxFreqDelta) {
+                            continue;
+                        }
+                        emit(i, createPeakPairHash(anchor, *target));
+                        if (++numTargets == zone.maxTargetsPerAnchor) {
+                            break;
+                        }
+                    }
+                }
+            }
+            numHashes += numTargets;
+        }
+    }
+    return numHashes;
+}
+
+} // namespace audio
+} // namespace sortify
+
+#endif // FINGERPRINT_STAGES_HPP
@@ -0,0 +1,159 @@
+#ifndef FINGERPRINT_STREAM_HPP
+#define FINGERPRINT_STREAM_HPP
+
+/**
+ * @file fingerprint_stream.hpp
+ * @brief Incremental fingerprinting of audio delivered in blocks
+ *
+ * FingerprintStream runs the same three stages as generateSpectrogram,
+ * extractPeaks and createFingerprint, but one window at a time. It only keeps
+ * the last windowSize samples and the peaks of the last few windows that can
+ * still be paired (the target zone's timeRange), so memory stays bounded no matter
+ * how long the input is, and hashes are emitted while decoding is still going.
+ */
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <cstddef>
+#include "audio_fingerprint.hpp"
+#include "fingerprint_stages.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @class FingerprintStream
+ * @brief Push-style fingerprint pipeline with bounded memory
+ *
+ * For the same samples and parameters, the hashes emitted over the lifetime
+ * of a stream are exactly those createFingerprint would store, in anchor order.
+ */
+class FingerprintStream {
+public:
+    /**
+     * Creates a stream for one song
+     *
+     * @param songId Identifier stored in every emitted hash
+     * @param sampleRate Sample rate of the audio (Hz)
+     * @param windowSize Size of each window for FFT
+     * @param overlap Overlap percentage between windows (0.0-1.0)
+     * @param minFreq Minimum frequency to include (Hz)
+     * @param maxFreq Maximum frequency to include (Hz)
+     */
+    explicit FingerprintStream(
+        int songId,
+        unsigned int sampleRate = 44100,
+        unsigned int windowSize = 2048,
+        float overlap = 0.5,
+        float minFreq = 20.0f,
+        float maxFreq = 5000.0f
+    );
+
+    /**
+     * Creates a stream for one song with every parameter taken from a configuration
+     *
+     * @param songId Identifier stored in every emitted hash
+     * @param config Spectrogram, band and target-zone parameters
+     */
+    FingerprintStream(int songId, const FingerprintConfig& config);
+
+    FingerprintStream(const FingerprintStream&) = delete;
+    FingerprintStream& operator=(const FingerprintStream&) = delete;
+
+    /**
+     * Check if the stream was configured successfully
+     */
+    bool isValid() const {
+        return errorMessage.empty();
+    }
+
+    /**
+     * Get the reason the stream is not valid
+     */
+    const std::string& getError() const {
+        return errorMessage;
+    }
+
+    /**
+     * Feeds a block of samples into the stream
+     *
+     * Hashes whose anchors can no longer gain targets are appended to output.
+     *
+     * @param samples Pointer to the sample block
+     * @param count Number of samples in the block
+     * @param output Vector the newly completed hashes are appended to
+     * @return Result containing the number of hashes appended
+     */
+    Result<size_t> pushSamples(const AudioSample* samples, size_t count, std::vector<FingerprintHash>& output);
+
+    /**
+     * Signals the end of the input and emits the remaining hashes
+     *
+     * Samples after the last full window are ignored, as in generateSpectrogram.
+     * The stream accepts no further samples afterwards.
+     *
+     * @param output Vector the remaining hashes are appended to
+     * @return Result containing the number of hashes appended
+     */
+    Result<size_t> finish(std::vector<FingerprintHash>& output);
+
+    /**
+     * Summarizes every later window into a quality trace from the same FFT
+     *
+     * Frames are appended to trace->frames as windows complete; call this
+     * before the first pushSamples() so the trace covers the whole stream.
+     *
+     * @param trace Trace to fill (not owned; nullptr stops collecting)
+     */
+    void setQualityTrace(QualityTrace* trace);
+
+    /**
+     * Get the number of spectrogram windows processed so far
+     */
+    unsigned int framesProcessed() const {
+        return nextFrame;
+    }
+
+private:
+    /**
+     * Transforms the window held in the ring buffer and picks its peaks
+     */
+    void processFrame();
+
+    /**
+     * Emits the hashes of anchors whose target zone lies entirely before nextFrame
+     *
+     * @param flushAll Emit every pending anchor regardless of time (end of stream)
+     */
+    size_t emitCompletedAnchors(std::vector<FingerprintHash>& output, bool flushAll);
+
+    int songId;
+    unsigned int sampleRate;
+    RuntimeTargetZone zone;
+    bool defaultZone;                    ///< zone equals TargetZone, so pairing uses the constant bounds
+    SpectrogramLayout layout = {};
+    FrequencyBands bands;
+    std::vector<float> hammingWindow;
+    std::unique_ptr<RealFFTWorkspace> workspace;
+    QualityTrace* quality = nullptr;     ///< Optional consumer of the full-band FFT output
+
+    std::vector<AudioSample> ring;       ///< Last windowSize samples, oldest at ringPos when full
+    size_t ringPos = 0;                  ///< Next write position in the ring
+    size_t samplesReceived = 0;          ///< Total samples pushed so far
+    size_t nextFrameEnd = 0;             ///< Sample count at which the next window is complete
+    unsigned int nextFrame = 0;          ///< Index of the next window to process
+    size_t totalPeaks = 0;               ///< Peaks picked so far, for metrics
+
+    std::vector<float> frameMagnitudes;  ///< Magnitudes of the window being processed
+    std::vector<Peak> framePeaks;        ///< Peaks of the window being processed
+    std::deque<Peak> pendingPeaks;       ///< Peaks still usable as anchors or targets
+    bool finished = false;
+    std::string errorMessage;
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // FINGERPRINT_STREAM_HPP
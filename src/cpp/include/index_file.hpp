@@ -0,0 +1,228 @@
+#ifndef INDEX_FILE_HPP
+#define INDEX_FILE_HPP
+
+/**
+ * @file index_file.hpp
+ * @brief Versioned on-disk fingerprint index that is queried through mmap
+ *
+ * File layout (all integers in the byte order of the writing machine,
+ * sections 8-byte aligned):
+ *
+ *   IndexFileHeader        fixed 128 bytes
+ *   Bloom filter           bloomBlockCount 64-byte BloomBlocks over all
+ *                          hashes, 64-byte aligned (absent if the count is 0)
+ *   radix table            radixBuckets + 1 uint32 entries; bucket b covers
+ *                          directory rows [radix[b], radix[b+1]) whose hash
+ *                          has b as its top 16 bits
+ *   hash directory         hashCount IndexDirectoryEntry rows sorted by hash
+ *   posting data           one varint-encoded posting list per directory row
+ *
+ * A posting list is a sequence of (songDelta, frame) varint pairs in
+ * (song, frame) order. songDelta is the zigzag-encoded difference to the
+ * previous song of the list (starting from 0); frame is a delta to the
+ * previous frame when songDelta is 0 and absolute otherwise.
+ *
+ * MappedIndex maps the file read-only and shared, so opening is independent
+ * of the index size and page cache pages are shared across processes. The
+ * Bloom filter is a small, hot section probed before the directory, so a
+ * hash that is not indexed usually costs one cache line instead of a radix,
+ * directory and posting page each.
+ *
+ * Headers and directory rows are written and read in place as native
+ * structs, so a file is only portable between machines of the same byte
+ * order. MappedIndex rejects a file whose byteOrderMark does not read back
+ * as 0x01020304.
+ *
+ * Version 1 files have no Bloom filter; they are still read and probed
+ * through the directory only.
+ */
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "result.hpp"
+#include "compact_fingerprint.hpp"
+#include "fingerprint_index.hpp"
+#include "bloom_filter.hpp"
+
+namespace sortify {
+namespace audio {
+
+/// Current version of the index file format
+constexpr uint32_t indexFileVersion = 2;
+
+/// Number of buckets in the radix table (top 16 bits of the hash)
+constexpr uint32_t indexRadixBuckets = 1u << 16;
+
+/**
+ * @struct IndexFileHeader
+ * @brief Fixed-size header at the start of every index file
+ */
+struct IndexFileHeader {
+    char magic[8];            ///< "SRTFIDX" followed by a zero byte
+    uint32_t version;         ///< indexFileVersion when written
+    uint32_t headerSize;      ///< sizeof(IndexFileHeader)
+    uint64_t trackCount;      ///< Number of indexed tracks
+    uint64_t hashCount;       ///< Number of directory rows
+    uint64_t postingCount;    ///< Number of postings over all lists
+    uint64_t radixOffset;     ///< File offset of the radix table
+    uint64_t directoryOffset; ///< File offset of the hash directory
+    uint64_t postingsOffset;  ///< File offset of the posting data
+    uint64_t postingsSize;    ///< Size of the posting data in bytes
+    uint64_t fileSize;        ///< Total file size, used to detect truncation
+    uint32_t byteOrderMark;   ///< 0x01020304 as written by the producing machine
+    uint32_t reserved0;
+    uint64_t bloomOffset;     ///< File offset of the Bloom filter (version 2)
+    uint64_t bloomBlockCount; ///< Number of Bloom filter blocks; 0 = no filter
+    uint64_t configId;        ///< hashFingerprintConfig of the producing configuration; 0 = unknown
+    uint64_t reserved[2];
+};
+
+static_assert(sizeof(IndexFileHeader) == 128, "IndexFileHeader must stay 128 bytes");
+
+/**
+ * @struct IndexDirectoryEntry
+ * @brief Location of one hash's posting list
+ */
+struct IndexDirectoryEntry {
+    uint32_t hash;          ///< The hash
+    uint32_t postingCount;  ///< Number of postings in its list
+    uint64_t dataOffset;    ///< Offset of the list from the start of the posting data
+};
+
+static_assert(sizeof(IndexDirectoryEntry) == 16, "IndexDirectoryEntry must stay 16 bytes");
+
+/**
+ * Writes a built index to disk
+ *
+ * The file is written next to the destination and renamed into place, so
+ * readers never observe a partially written index.
+ *
+ * @param index Built index; tracks still pending are not written
+ * @param path Destination file path
+ * @return Result containing the number of bytes written
+ */
+Result<size_t> writeIndexFile(const FingerprintIndex& index, const std::string& path);
+
+/**
+ * @class MappedIndex
+ * @brief Read-only, zero-copy view of an index file
+ *
+ * Queries decode posting lists straight from the mapping and are safe to run
+ * from several threads.
+ */
+class MappedIndex {
+public:
+    /**
+     * Maps an index file
+     *
+     * @param path Path of a file produced by writeIndexFile
+     */
+    explicit MappedIndex(const std::string& path);
+    ~MappedIndex();
+
+    MappedIndex(const MappedIndex&) = delete;
+    MappedIndex& operator=(const MappedIndex&) = delete;
+
+    /**
+     * Check if the file was mapped and validated successfully
+     */
+    bool isValid() const {
+        return errorMessage.empty();
+    }
+
+    /**
+     * Get the reason the file could not be used
+     */
+    const std::string& getError() const {
+        return errorMessage;
+    }
+
+    /**
+     * Get the number of indexed tracks
+     */
+    size_t trackCount() const {
+        return header ? header->trackCount : 0;
+    }
+
+    /**
+     * Get the number of distinct hashes
+     */
+    size_t hashCount() const {
+        return header ? header->hashCount : 0;
+    }
+
+    /**
+     * Get the number of postings over all lists
+     */
+    size_t postingCount() const {
+        return header ? header->postingCount : 0;
+    }
+
+    /**
+     * Get the hash of one directory row, for walking the whole index in hash order
+     *
+     * @param row Row index below hashCount()
+     */
+    uint32_t hashAt(size_t row) const {
+        return directory[row].hash;
+    }
+
+    /**
+     * Get the ID of the fingerprint configuration that produced the index (0 = unknown)
+     */
+    uint64_t configId() const {
+        return header ? header->configId : 0;
+    }
+
+    /**
+     * Check if the file carries a Bloom filter that is probed before the directory
+     */
+    bool hasBloomFilter() const {
+        return bloomBlocks != nullptr;
+    }
+
+    /**
+     * Decodes the postings of one hash
+     *
+     * @param hash The hash to look up
+     * @param postings Vector the postings are appended to, in (song, frame) order
+     * @return Number of postings appended (0 if the hash is not indexed)
+     */
+    size_t decodePostings(uint32_t hash, std::vector<Posting>& postings) const;
+
+    /**
+     * Finds the indexed tracks that best explain the sample
+     *
+     * Scores exactly like FingerprintIndex::query on the index the file was written from.
+     *
+     * @param sample Compact fingerprint of the query audio
+     * @param maxResults Maximum number of candidates to return
+     * @param minScore Minimum number of hashes agreeing on one time offset
+     * @return Result containing candidates ordered by descending score
+     */
+    Result<std::vector<MatchCandidate>> query(
+        const CompactFingerprint& sample,
+        size_t maxResults = 10,
+        unsigned int minScore = 2
+    ) const;
+
+private:
+    const IndexDirectoryEntry* findEntry(uint32_t hash) const;
+    std::string validate() const;
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    const IndexFileHeader* header = nullptr;
+    const uint32_t* radix = nullptr;
+    const IndexDirectoryEntry* directory = nullptr;
+    const uint8_t* postingData = nullptr;
+    const BloomBlock* bloomBlocks = nullptr;
+    std::string errorMessage;
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // INDEX_FILE_HPP
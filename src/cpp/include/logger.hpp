@@ -3,6 +3,25 @@
 
 #include <string>
 #include <functional>
+#include <sstream>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+/**
+ * Lowest level compiled in: 0 = DEBUG ... 4 = FATAL
+ *
+ * SORTIFY_LOG_* calls below this level are removed entirely, arguments
+ * included. Release builds can pass -DSORTIFY_MIN_LOG_LEVEL=2 to strip
+ * debug and info logging.
+ */
+#ifndef SORTIFY_MIN_LOG_LEVEL
+#define SORTIFY_MIN_LOG_LEVEL 0
+#endif
 
 namespace sortify {
 namespace audio {
@@ -19,6 +38,11 @@ enum class LogLevel {
     FATAL    ///< Very severe error that will likely lead to application termination
 };
 
+/**
+ * Get the upper-case name of a log level
+ */
+const char* logLevelName(LogLevel level);
+
 /**
  * @class Logger
  * @brief Provides logging functionality for the audio fingerprinting system
@@ -26,6 +50,10 @@ enum class LogLevel {
  * This class provides static methods to log messages at various severity levels.
  * The default implementation writes to standard output/error, but a custom log
  * function can be set to redirect logs elsewhere.
+ *
+ * Prefer the SORTIFY_LOG_* macros: they check the level before evaluating
+ * or formatting their arguments, so disabled messages cost one load and a
+ * branch, and levels below SORTIFY_MIN_LOG_LEVEL are compiled out.
  */
 class Logger {
 public:
@@ -39,10 +67,41 @@ public:
     /**
      * Sets a custom log function to handle log messages.
      *
-     * @param logFunc Function that takes a LogLevel and a message string
+     * Safe to call while other threads log: it waits for calls into the
+     * previous function to return, so whatever that function uses may be
+     * destroyed afterwards. A log function must not log or call
+     * setLogFunction itself.
+     *
+     * @param logFunc Function that takes a LogLevel and a message string (nullptr = standard output/error)
      */
     static void setLogFunction(std::function<void(LogLevel, const std::string&)> logFunc);
     
+    /**
+     * Returns whether a message of the given level would be output
+     *
+     * @param level The severity level to check
+     */
+    static bool isEnabled(LogLevel level) {
+        return static_cast<int>(level) >= SORTIFY_MIN_LOG_LEVEL &&
+               level >= currentLogLevel.load(std::memory_order_relaxed);
+    }
+    
+    /**
+     * Formats the arguments with operator<< and logs them, if the level is enabled
+     *
+     * @param level The severity level of the message
+     * @param args Values concatenated into the message
+     */
+    template <typename... Args>
+    static void write(LogLevel level, const Args&... args) {
+        if (!isEnabled(level)) {
+            return;
+        }
+        std::ostringstream message;
+        (message << ... << args);
+        log(level, message.str());
+    }
+    
     /**
      * Log a debug message
      *
@@ -88,11 +147,110 @@ private:
     static void log(LogLevel level, const std::string& message);
 
     // Static members
-    static LogLevel currentLogLevel;
+    static inline std::atomic<LogLevel> currentLogLevel{LogLevel::ERROR};
+    static std::shared_mutex logFunctionMutex; ///< Shared while calling logFunction, exclusive while replacing it
     static std::function<void(LogLevel, const std::string&)> logFunction;
 };
 
+/**
+ * @class AsyncLogSink
+ * @brief Log function that hands messages to a background writer thread
+ *
+ * Messages are moved into a fixed-size ring buffer under a short lock; a
+ * dedicated thread writes them to standard output/error in batches, so a
+ * worker never waits on the terminal. When the ring is full new messages
+ * are dropped and counted rather than blocking the caller.
+ */
+class AsyncLogSink {
+public:
+    /**
+     * Starts the writer thread
+     *
+     * @param capacity Number of messages the ring buffer holds
+     */
+    explicit AsyncLogSink(size_t capacity = 4096);
+
+    /**
+     * Uninstalls the sink if needed, writes pending messages and stops the thread
+     *
+     * Uninstalling waits for threads inside write() to return, so the sink
+     * may be destroyed while other threads are still logging; their later
+     * messages go to standard output/error.
+     */
+    ~AsyncLogSink();
+
+    AsyncLogSink(const AsyncLogSink&) = delete;
+    AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+    /**
+     * Routes all Logger output through this sink
+     *
+     * Replaces any other log function. Call it from the thread that owns
+     * the sink.
+     */
+    void install();
+
+    /**
+     * Queues one message; never blocks on output
+     *
+     * @param level The severity level of the message
+     * @param message The message to log
+     */
+    void write(LogLevel level, const std::string& message);
+
+    /**
+     * Waits until every queued message has been written
+     */
+    void flush();
+
+    /**
+     * Get the number of messages dropped because the ring was full
+     */
+    size_t droppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry {
+        LogLevel level = LogLevel::INFO;
+        std::string message;
+    };
+
+    void run();
+
+    std::vector<Entry> ring;
+    size_t head = 0;    ///< Index of the oldest queued message
+    size_t count = 0;   ///< Number of queued messages
+    size_t writing = 0; ///< Messages taken by the writer but not yet output
+    bool stopping = false;
+    bool installed = false;
+    std::atomic<size_t> dropped{0};
+    std::mutex mutex;
+    std::condition_variable wakeWriter;
+    std::condition_variable drained;
+    std::thread writer;
+};
+
 } // namespace audio
 } // namespace sortify
 
+/**
+ * Logs the concatenation of the arguments at the given level
+ *
+ * Arguments are only evaluated and formatted when the level is enabled.
+ */
+#define SORTIFY_LOG(level, ...)                                                                  \
+    do {                                                                                         \
+        if (static_cast<int>(level) >= SORTIFY_MIN_LOG_LEVEL &&                                  \
+            ::sortify::audio::Logger::isEnabled(level)) {                                        \
+            ::sortify::audio::Logger::write(level, __VA_ARGS__);                                 \
+        }                                                                                        \
+    } while (0)
+
+#define SORTIFY_LOG_DEBUG(...) SORTIFY_LOG(::sortify::audio::LogLevel::DEBUG, __VA_ARGS__)
+#define SORTIFY_LOG_INFO(...) SORTIFY_LOG(::sortify::audio::LogLevel::INFO, __VA_ARGS__)
+#define SORTIFY_LOG_WARNING(...) SORTIFY_LOG(::sortify::audio::LogLevel::WARNING, __VA_ARGS__)
+#define SORTIFY_LOG_ERROR(...) SORTIFY_LOG(::sortify::audio::LogLevel::ERROR, __VA_ARGS__)
+#define SORTIFY_LOG_FATAL(...) SORTIFY_LOG(::sortify::audio::LogLevel::FATAL, __VA_ARGS__)
+
 #endif // LOGGER_HPP
\ No newline at end of file
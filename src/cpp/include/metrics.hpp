@@ -0,0 +1,208 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+/**
+ * @file metrics.hpp
+ * @brief Opt-in counters and stage timings for the fingerprinting pipeline
+ *
+ * Metrics are disabled by default. While disabled every instrumentation
+ * point costs one relaxed atomic load and a branch; defining
+ * SORTIFY_DISABLE_METRICS removes them entirely. Once enabled, stages add
+ * to process-wide atomic counters and log2-bucketed duration histograms,
+ * which snapshot() copies for export as Prometheus text or JSON.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @enum MetricCounter
+ * @brief Quantities counted by the pipeline
+ */
+enum class MetricCounter {
+    SAMPLES_DECODED,    ///< Mono samples produced by the decoders
+    SAMPLES_ANALYZED,   ///< Samples fed to spectrogram generation
+    AUDIO_MICROSECONDS, ///< Duration of the analysed audio
+    WINDOWS_PROCESSED,  ///< FFT windows computed
+    PEAKS_EXTRACTED,    ///< Peaks picked from spectrograms
+    HASHES_EMITTED,     ///< Fingerprint hashes created
+    QUERIES,            ///< Index queries answered
+    BYTES_ALLOCATED,    ///< Bytes of sample, spectrogram and fingerprint buffers allocated
+    COUNT               ///< Number of counters (not a counter)
+};
+
+/**
+ * @enum MetricStage
+ * @brief Timed pipeline stages
+ */
+enum class MetricStage {
+    DECODE,          ///< Loading and decoding audio files
+    SPECTROGRAM,     ///< generateSpectrogram
+    PEAK_EXTRACTION, ///< extractPeaks
+    FINGERPRINT,     ///< Pairing peaks into hashes
+    INDEX_QUERY,     ///< FingerprintIndex::query
+    COUNT            ///< Number of stages (not a stage)
+};
+
+constexpr size_t metricCounterCount = static_cast<size_t>(MetricCounter::COUNT);
+constexpr size_t metricStageCount = static_cast<size_t>(MetricStage::COUNT);
+
+/// Histogram buckets: bucket i counts durations up to 2^i microseconds, the last one everything longer
+constexpr size_t metricBucketCount = 28;
+
+/**
+ * Get the snake_case name of a counter, as used in exports
+ */
+const char* metricCounterName(MetricCounter counter);
+
+/**
+ * Get the snake_case name of a stage, as used in exports
+ */
+const char* metricStageName(MetricStage stage);
+
+/**
+ * @struct StageTiming
+ * @brief Duration histogram of one stage
+ */
+struct StageTiming {
+    uint64_t count = 0;            ///< Number of timed calls
+    uint64_t totalNanoseconds = 0; ///< Sum of all durations
+    std::array<uint64_t, metricBucketCount> buckets{}; ///< Non-cumulative bucket counts
+
+    /**
+     * Get the total time spent in the stage
+     */
+    double totalSeconds() const {
+        return static_cast<double>(totalNanoseconds) * 1e-9;
+    }
+};
+
+/**
+ * @struct MetricsSnapshot
+ * @brief Point-in-time copy of all metrics
+ */
+struct MetricsSnapshot {
+    std::array<uint64_t, metricCounterCount> counters{};
+    std::array<StageTiming, metricStageCount> stages{};
+
+    uint64_t counter(MetricCounter which) const {
+        return counters[static_cast<size_t>(which)];
+    }
+
+    const StageTiming& stage(MetricStage which) const {
+        return stages[static_cast<size_t>(which)];
+    }
+
+    /**
+     * Get the average number of peaks per second of analysed audio
+     */
+    double peaksPerAudioSecond() const;
+
+    /**
+     * Formats the snapshot in the Prometheus text exposition format
+     *
+     * @param prefix Prefix of every metric name
+     */
+    std::string toPrometheus(const std::string& prefix = "sortify") const;
+
+    /**
+     * Formats the snapshot as a JSON object
+     */
+    std::string toJson() const;
+};
+
+/**
+ * @class Metrics
+ * @brief Process-wide metric registry
+ *
+ * Like Logger, all members are static. Updates are lock-free and may come
+ * from any thread.
+ */
+class Metrics {
+public:
+    /**
+     * Turns collection on or off; existing values are kept
+     */
+    static void setEnabled(bool enable);
+
+    /**
+     * Returns whether instrumentation points currently record anything
+     */
+    static bool isEnabled() {
+#ifdef SORTIFY_DISABLE_METRICS
+        return false;
+#else
+        return enabled.load(std::memory_order_relaxed);
+#endif
+    }
+
+    /**
+     * Adds to a counter if metrics are enabled
+     */
+    static void add(MetricCounter counter, uint64_t value) {
+        if (isEnabled()) {
+            addCounter(counter, value);
+        }
+    }
+
+    /**
+     * Records one duration of a stage if metrics are enabled
+     */
+    static void recordDuration(MetricStage stage, std::chrono::nanoseconds duration);
+
+    /**
+     * Copies the current values
+     */
+    static MetricsSnapshot snapshot();
+
+    /**
+     * Sets every counter and histogram back to zero
+     */
+    static void reset();
+
+private:
+    static void addCounter(MetricCounter counter, uint64_t value);
+
+    static inline std::atomic<bool> enabled{false};
+};
+
+/**
+ * @class ScopedTimer
+ * @brief Records the lifetime of a scope as one duration of a stage
+ *
+ * Does not read the clock while metrics are disabled.
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(MetricStage stage) : stage(stage), active(Metrics::isEnabled()) {
+        if (active) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer() {
+        if (active) {
+            Metrics::recordDuration(stage, std::chrono::steady_clock::now() - start);
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    MetricStage stage;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // METRICS_HPP
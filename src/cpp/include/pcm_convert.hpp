@@ -0,0 +1,54 @@
+#ifndef PCM_CONVERT_HPP
+#define PCM_CONVERT_HPP
+
+/**
+ * @file pcm_convert.hpp
+ * @brief Conversion of interleaved PCM frames into mono float samples
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include "cpu_features.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @enum PcmEncoding
+ * @brief Little-endian sample encodings found in WAV files
+ */
+enum class PcmEncoding {
+    UINT8,   ///< Unsigned 8-bit, centred at 128
+    INT16,   ///< Signed 16-bit
+    INT24,   ///< Signed 24-bit packed in 3 bytes
+    INT32,   ///< Signed 32-bit
+    FLOAT32, ///< IEEE 754 single precision
+    FLOAT64  ///< IEEE 754 double precision
+};
+
+/**
+ * Get the size of one sample of one channel
+ */
+unsigned int pcmBytesPerSample(PcmEncoding encoding);
+
+/**
+ * Downmixes interleaved frames to mono and scales them to [-1.0, 1.0]
+ *
+ * Every channel is decoded, the channels of a frame are averaged and the
+ * result is written in a single pass. 16-bit and 32-bit float input with one
+ * or two channels use SIMD kernels; all levels produce identical output.
+ *
+ * @param data First byte of the first frame (no alignment required)
+ * @param numFrames Number of frames to convert
+ * @param numChannels Channels per frame (at least 1)
+ * @param encoding Sample encoding
+ * @param output Destination for numFrames samples
+ * @param level Instruction set to use; unsupported levels fall back to scalar
+ */
+void convertPcmToMono(const uint8_t* data, size_t numFrames, unsigned int numChannels,
+                      PcmEncoding encoding, float* output, SimdLevel level = detectSimdLevel());
+
+} // namespace audio
+} // namespace sortify
+
+#endif // PCM_CONVERT_HPP
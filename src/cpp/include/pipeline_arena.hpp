@@ -0,0 +1,104 @@
+#ifndef PIPELINE_ARENA_HPP
+#define PIPELINE_ARENA_HPP
+
+/**
+ * @file pipeline_arena.hpp
+ * @brief Reusable bump allocator for the per-track pipeline buffers
+ *
+ * The spectrogram, the peak list and the hash scratch space of one track
+ * all die together once its fingerprint exists. An arena hands them out
+ * from a single retained block and frees them all at once on reset(), so
+ * a worker fingerprinting thousands of files stops hitting the global
+ * allocator for them. When a track needs more than the block holds, the
+ * excess comes from the heap and the block grows to fit on the next reset.
+ */
+
+#include <memory_resource>
+#include <optional>
+#include <vector>
+#include <cstddef>
+
+namespace sortify {
+namespace audio {
+
+/// Initial block size of a PipelineArena; a track at the default settings needs
+/// about 3 MiB per minute, so this covers tracks of up to about five minutes
+constexpr size_t defaultArenaBytes = size_t(16) << 20;
+
+/**
+ * @class PipelineArena
+ * @brief Monotonic memory resource over a block that is kept between tracks
+ *
+ * Not thread-safe: each worker thread owns its own arena. Everything
+ * allocated from resource() must be destroyed before reset().
+ */
+class PipelineArena {
+public:
+    /**
+     * @param initialBytes Size of the block allocated up front
+     */
+    explicit PipelineArena(size_t initialBytes = defaultArenaBytes);
+
+    PipelineArena(const PipelineArena&) = delete;
+    PipelineArena& operator=(const PipelineArena&) = delete;
+
+    /**
+     * Get the resource to pass to the pipeline stages
+     */
+    std::pmr::memory_resource* resource() { return &counter; }
+
+    /**
+     * Releases every allocation, growing the block if the last track overflowed it
+     */
+    void reset();
+
+    /**
+     * Get the number of bytes requested since the last reset
+     */
+    size_t bytesInUse() const { return counter.bytes; }
+
+    /**
+     * Get the most bytes requested between two resets
+     */
+    size_t highWaterBytes() const;
+
+    /**
+     * Get the size of the retained block
+     */
+    size_t capacity() const { return block.size(); }
+
+    /**
+     * Get the number of resets that had to grow the block
+     */
+    size_t growthCount() const { return growths; }
+
+private:
+    /**
+     * @class CountingResource
+     * @brief Forwards to another resource and counts the bytes requested
+     */
+    class CountingResource : public std::pmr::memory_resource {
+    public:
+        explicit CountingResource(std::pmr::memory_resource* upstream) : upstream(upstream) {}
+
+        std::pmr::memory_resource* upstream;
+        size_t bytes = 0;
+
+    private:
+        void* do_allocate(size_t size, size_t alignment) override;
+        void do_deallocate(void* pointer, size_t size, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    std::vector<std::byte> block;
+    CountingResource overflow;  ///< Upstream of the monotonic resource: counts heap fallbacks
+    std::optional<std::pmr::monotonic_buffer_resource> monotonic;
+    CountingResource counter;   ///< Front of the arena: counts requested bytes
+    size_t highWater = 0;
+    size_t growths = 0;
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // PIPELINE_ARENA_HPP
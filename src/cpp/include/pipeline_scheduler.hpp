@@ -0,0 +1,224 @@
+#ifndef PIPELINE_SCHEDULER_HPP
+#define PIPELINE_SCHEDULER_HPP
+
+/**
+ * @file pipeline_scheduler.hpp
+ * @brief Staged ingest pipeline with bounded queues between the stages
+ *
+ * BatchFingerprinter runs every stage of a file on one worker, so a worker
+ * waiting on a slow network share holds a core idle. PipelineScheduler
+ * splits ingest into stages, each with its own threads:
+ *
+ *     read -> decode -> spectrogram -> peaks -> fingerprint -> index
+ *
+ * The read stage pulls the file into the page cache ahead of the decoder.
+ * Its threads only wait on I/O, so there can be more of them than cores,
+ * and many slow reads stay in flight while the other stages use the CPUs.
+ * Each stage hands items to the next one through a BoundedQueue. A slow
+ * stage blocks its producers instead of letting decoded audio or
+ * spectrograms pile up, so memory stays bounded by the queue capacities.
+ * The index stage runs on the calling thread, like the sink of
+ * BatchFingerprinter.
+ *
+ * stats() may be called from any thread during a run. It reports, for
+ * every stage, how many items wait in front of it and how busy its threads
+ * are, which shows where the pipeline is starved or backed up.
+ */
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <functional>
+#include <mutex>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "batch_fingerprinter.hpp"
+#include "bounded_queue.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @enum PipelineStage
+ * @brief Stages of a PipelineScheduler, in processing order
+ */
+enum class PipelineStage {
+    READ,        ///< Reading the file into the page cache
+    DECODE,      ///< Decoding to mono samples at config.sampleRate
+    SPECTROGRAM, ///< generateSpectrogram (and quality frames)
+    PEAKS,       ///< extractPeaks
+    FINGERPRINT, ///< createCompactFingerprint
+    INDEX,       ///< The sink, on the calling thread
+    COUNT        ///< Number of stages (not a stage)
+};
+
+constexpr size_t pipelineStageCount = static_cast<size_t>(PipelineStage::COUNT);
+
+/**
+ * Get the snake_case name of a stage
+ */
+const char* pipelineStageName(PipelineStage stage);
+
+/// Reads a file ahead of decoding; returns the number of bytes read
+using FileReader = std::function<Result<uint64_t>(const std::string& filePath)>;
+
+/**
+ * @struct PipelineOptions
+ * @brief Settings of a PipelineScheduler
+ */
+struct PipelineOptions {
+    FingerprintConfig config;            ///< Analysis parameters for every file
+    unsigned int readThreads = 4;        ///< Concurrent file reads; raise it for high-latency storage
+    unsigned int decodeThreads = 0;      ///< 0 = hardware concurrency
+    unsigned int spectrogramThreads = 0; ///< 0 = hardware concurrency
+    unsigned int peakThreads = 0;        ///< 0 = half the hardware concurrency (at least 1)
+    unsigned int fingerprintThreads = 0; ///< 0 = half the hardware concurrency (at least 1)
+    size_t queueCapacity = 0;            ///< Items per inter-stage queue (0 = 2 per consuming thread)
+    FileReader reader;                   ///< Read stage (empty = readFileAhead)
+    AudioDecoder decoder;                ///< Decode stage (empty = WavFile for WAV files, FFmpeg otherwise)
+    DecodeOptions decodeOptions;         ///< FFmpeg settings; the sample rate comes from config
+    bool analyzeQuality = false;         ///< Measure FileResult::quality in the spectrogram stage
+    QualityOptions qualityOptions;       ///< Thresholds of the quality analysis
+};
+
+/**
+ * @struct StageStats
+ * @brief Live counters of one pipeline stage
+ */
+struct StageStats {
+    unsigned int threads = 0;       ///< Threads running the stage
+    size_t queueCapacity = 0;       ///< Capacity of the queue in front of the stage (READ: number of files)
+    size_t queueDepth = 0;          ///< Items waiting in front of the stage
+    size_t maxQueueDepth = 0;       ///< Largest queueDepth seen in the current run
+    uint64_t itemsProcessed = 0;    ///< Items finished by the stage, failures included
+    uint64_t busyMicroseconds = 0;  ///< Time the stage's threads spent processing items
+
+    /**
+     * Get the fraction of the stage's thread time spent processing
+     *
+     * @param elapsedSeconds Wall time of the run so far
+     */
+    double utilization(double elapsedSeconds) const {
+        return threads > 0 && elapsedSeconds > 0.0
+            ? static_cast<double>(busyMicroseconds) * 1e-6 / (elapsedSeconds * threads) : 0.0;
+    }
+};
+
+/**
+ * @struct PipelineStats
+ * @brief Snapshot of every stage of a PipelineScheduler
+ */
+struct PipelineStats {
+    std::array<StageStats, pipelineStageCount> stages{};
+    double elapsedSeconds = 0.0;    ///< Wall time since the run started (or of the whole last run)
+    uint64_t bytesRead = 0;         ///< Bytes read by the read stage
+
+    const StageStats& stage(PipelineStage which) const {
+        return stages[static_cast<size_t>(which)];
+    }
+};
+
+/**
+ * Reads a whole file and discards the data, leaving it in the page cache
+ *
+ * The default read stage: the decoders read by path, so they find the
+ * file cached instead of waiting on the disk or network.
+ *
+ * @param filePath Path to the file
+ * @return Result containing the number of bytes read
+ */
+Result<uint64_t> readFileAhead(const std::string& filePath);
+
+/**
+ * @class PipelineScheduler
+ * @brief Runs the ingest stages concurrently on separate thread groups
+ *
+ * For the same decoded samples every fingerprint equals the result of
+ * fingerprintSamples. A failing read stage is only logged, since the
+ * decoder may not need the file to be cached; later failures skip the
+ * remaining stages and are reported like BatchFingerprinter reports them.
+ */
+class PipelineScheduler {
+public:
+    explicit PipelineScheduler(PipelineOptions options = PipelineOptions());
+
+    PipelineScheduler(const PipelineScheduler&) = delete;
+    PipelineScheduler& operator=(const PipelineScheduler&) = delete;
+
+    /**
+     * Fingerprints every file in paths
+     *
+     * File i is assigned song ID firstSongId + i. The sink is called in
+     * completion order on the calling thread, never concurrently. Only one
+     * run may be active at a time.
+     *
+     * An exception thrown inside a stage fails that file. If the sink
+     * throws, every stage queue is closed, the stage threads are joined and
+     * the exception is rethrown.
+     *
+     * @param paths Files to process
+     * @param firstSongId Song ID of the first file
+     * @param sink Receives each successful fingerprint
+     * @return One report per input file, in input order
+     */
+    std::vector<FileResult> run(const std::vector<std::string>& paths, int firstSongId, const FingerprintSink& sink);
+
+    /**
+     * Fingerprints every file in paths into an index and builds it
+     *
+     * @param paths Files to process
+     * @param index Index the tracks are added to
+     * @param firstSongId Song ID of the first file
+     * @return One report per input file, in input order
+     */
+    std::vector<FileResult> buildIndex(const std::vector<std::string>& paths, FingerprintIndex& index, int firstSongId = 0);
+
+    /**
+     * Get the counters of the current run, or of the last one after it returned
+     *
+     * Safe to call from any thread while run() is active.
+     */
+    PipelineStats stats() const;
+
+    /**
+     * Get the number of threads a stage runs on
+     */
+    unsigned int stageThreads(PipelineStage stage) const {
+        return threads[static_cast<size_t>(stage)];
+    }
+
+private:
+    struct Item;
+
+    /**
+     * @struct StageCounters
+     * @brief Lock-free counters behind StageStats
+     */
+    struct StageCounters {
+        std::atomic<uint64_t> itemsProcessed{0};
+        std::atomic<uint64_t> busyMicroseconds{0};
+    };
+
+    PipelineOptions options;
+    std::array<unsigned int, pipelineStageCount> threads{};
+    std::array<StageCounters, pipelineStageCount> counters;
+    std::atomic<uint64_t> bytesRead{0};
+    std::atomic<size_t> nextFile{0};
+
+    // Queues of the active run, indexed by the stage consuming them; guarded by runMutex
+    mutable std::mutex runMutex;
+    std::array<BoundedQueue<Item>*, pipelineStageCount> queues{};
+    std::array<size_t, pipelineStageCount> capacities{};
+    std::array<size_t, pipelineStageCount> lastMaxDepths{};
+    size_t numFiles = 0;
+    bool running = false;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point endTime;
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // PIPELINE_SCHEDULER_HPP
@@ -0,0 +1,161 @@
+#ifndef RESAMPLER_HPP
+#define RESAMPLER_HPP
+
+/**
+ * @file resampler.hpp
+ * @brief Streaming polyphase sample rate converter for mono audio
+ *
+ * A conversion from rate A to rate B is the rational ratio L/M = B/A in
+ * lowest terms: conceptually the input is upsampled by L, low-pass filtered
+ * and downsampled by M. The polyphase form never computes the discarded
+ * samples: each output sample is one dot product of the input history with
+ * one of L pre-computed phases of a Kaiser-windowed sinc filter.
+ *
+ * The filter cutoff sits at the lower of the two Nyquist frequencies, so
+ * converting 44.1 or 48 kHz audio to 11025 Hz keeps everything up to about
+ * 5 kHz (the default maxFreq) and only folds aliases into the band above it.
+ * Output sample n is centred on input time n * A / B, so the output stays
+ * aligned with the input; the filter delay is compensated internally.
+ */
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "result.hpp"
+#include "audio_fingerprint.hpp"
+#include "cpu_features.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @struct ResamplerOptions
+ * @brief Filter design of a Resampler
+ */
+struct ResamplerOptions {
+    unsigned int zeroCrossings = 32;   ///< Sinc lobes per side at the lower rate; more gives a sharper transition
+    float cutoff = 1.0f;               ///< Cutoff as a fraction of the lower Nyquist frequency (0, 1]
+    float kaiserBeta = 8.0f;           ///< Window shape; 8 gives about 80 dB of stopband attenuation
+    SimdLevel simdLevel = detectSimdLevel(); ///< Dot-product kernel; unsupported levels fall back to scalar
+};
+
+/**
+ * @class Resampler
+ * @brief Converts a mono stream between two sample rates block by block
+ *
+ * Feeding the input in any block sizes produces exactly the same output as
+ * converting it in one call. Equal rates pass the samples through unchanged.
+ */
+class Resampler {
+public:
+    /**
+     * Designs the filter bank for a conversion
+     *
+     * @param inputRate Sample rate of the input (Hz)
+     * @param outputRate Sample rate of the output (Hz)
+     * @param options Filter design
+     */
+    Resampler(unsigned int inputRate, unsigned int outputRate, ResamplerOptions options = ResamplerOptions());
+
+    /**
+     * Check if the conversion is supported
+     */
+    bool isValid() const {
+        return errorMessage.empty();
+    }
+
+    /**
+     * Get the reason the conversion is not supported
+     */
+    const std::string& getError() const {
+        return errorMessage;
+    }
+
+    /**
+     * Converts a block of input
+     *
+     * Output is produced as soon as the filter has seen enough input, so a
+     * block may yield no samples; finish() produces the rest.
+     *
+     * @param input Mono samples at the input rate
+     * @param count Number of samples
+     * @param output Vector the output samples are appended to
+     * @return Number of samples appended
+     */
+    size_t process(const AudioSample* input, size_t count, std::vector<AudioSample>& output);
+
+    /**
+     * Flushes the filter at the end of the input
+     *
+     * After finish() the converter has produced outputLength(inputCount)
+     * samples in total; call reset() before converting another stream.
+     *
+     * @param output Vector the remaining output samples are appended to
+     * @return Number of samples appended
+     */
+    size_t finish(std::vector<AudioSample>& output);
+
+    /**
+     * Starts a new stream with the same filter bank
+     */
+    void reset();
+
+    /**
+     * Get the number of output samples a whole input of a given length converts to
+     */
+    uint64_t outputLength(uint64_t inputLength) const {
+        return (inputLength * upFactor + downFactor - 1) / downFactor;
+    }
+
+    /**
+     * Get the number of filter taps applied per output sample
+     */
+    size_t tapsPerPhase() const {
+        return numTaps;
+    }
+
+    unsigned int inputRate() const { return inRate; }
+    unsigned int outputRate() const { return outRate; }
+
+private:
+    void emitAvailable(std::vector<AudioSample>& output, uint64_t limit);
+
+    unsigned int inRate;
+    unsigned int outRate;
+    uint64_t upFactor = 1;      ///< L
+    uint64_t downFactor = 1;    ///< M
+    size_t numTaps = 0;         ///< Taps per phase
+    std::vector<float> bank;    ///< L phases of numTaps coefficients
+    SimdLevel simdLevel;
+    std::string errorMessage;
+
+    // Stream state; history holds zero-padded input starting at padded index historyStart
+    std::vector<float> history;
+    uint64_t historyStart = 0;
+    uint64_t nextTap = 0;       ///< Padded index of the first tap of the next output
+    uint64_t nextPhase = 0;
+    uint64_t inputCount = 0;
+    uint64_t outputCount = 0;
+};
+
+/**
+ * Converts a whole mono track to another sample rate
+ *
+ * @param samples Mono samples at inputRate
+ * @param inputRate Sample rate of the input (Hz)
+ * @param outputRate Sample rate of the output (Hz)
+ * @param options Filter design
+ * @return Result containing outputLength(samples.size()) samples at outputRate
+ */
+Result<std::vector<AudioSample>> resampleAudio(
+    const std::vector<AudioSample>& samples,
+    unsigned int inputRate,
+    unsigned int outputRate,
+    const ResamplerOptions& options = ResamplerOptions()
+);
+
+} // namespace audio
+} // namespace sortify
+
+#endif // RESAMPLER_HPP
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <optional>
+#include <utility>
 
 namespace sortify {
 namespace audio {
@@ -14,6 +15,9 @@ namespace audio {
  * This class encapsulates the result of an operation that might fail.
  * It contains a success flag, an optional error message, and an optional value.
  * 
+ * Values are moved in and can be moved out with take() or *std::move(result),
+ * so a spectrogram or fingerprint travels through the pipeline without copies.
+ * 
  * @tparam T The type of the value contained in a successful result
  */
 template<typename T>
@@ -60,10 +64,53 @@ public:
      * 
      * @return The operation result value
      */
-    const T& getValue() const {
+    const T& getValue() const& {
         return value.value();
     }
     
+    /**
+     * Get mutable access to the result value
+     * Only valid if isSuccess() returns true
+     * 
+     * @return The operation result value
+     */
+    T& getValue() & {
+        return value.value();
+    }
+    
+    /**
+     * Moves the result value out of an expiring result
+     * Only valid if isSuccess() returns true
+     * 
+     * Returns by value, so binding the result of f().take() to a reference
+     * does not dangle.
+     * 
+     * @return The operation result value
+     */
+    T take() && {
+        return std::move(value.value());
+    }
+    
+    const T& operator*() const& {
+        return value.value();
+    }
+    
+    T& operator*() & {
+        return value.value();
+    }
+    
+    T operator*() && {
+        return std::move(value.value());
+    }
+    
+    const T* operator->() const {
+        return &value.value();
+    }
+    
+    T* operator->() {
+        return &value.value();
+    }
+    
     /**
      * Get the error message
      * Only valid if isSuccess() returns false
@@ -0,0 +1,127 @@
+#ifndef SEGMENT_FINGERPRINT_HPP
+#define SEGMENT_FINGERPRINT_HPP
+
+/**
+ * @file segment_fingerprint.hpp
+ * @brief Fingerprints of selected time ranges of a track
+ *
+ * For duplicate pre-screening a few short segments are enough to reject
+ * most non-matches. Only the requested ranges are read (WAV) or decoded
+ * (FFmpeg input seeking), and every range start is snapped down to a
+ * multiple of the window step, so segment windows coincide with windows of
+ * the full track and anchor frames stay absolute: a segment fingerprint
+ * matches the full fingerprint of the same file at offset 0.
+ */
+
+#include <vector>
+#include <string>
+#include "result.hpp"
+#include "audio_fingerprint.hpp"
+#include "compact_fingerprint.hpp"
+#include "fingerprint_config.hpp"
+#include "audio_decoder.hpp"
+#include "wav_reader.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @struct TimeRange
+ * @brief Part of a track, in seconds
+ */
+struct TimeRange {
+    double startSeconds = 0.0;    ///< Start of the range
+    double durationSeconds = 0.0; ///< Length of the range
+};
+
+/// Relative positions of the default screening segments
+const std::vector<double>& defaultSegmentPositions();
+
+/**
+ * Plans fixed-length segments centred on relative positions of a track
+ *
+ * Segments are clamped to the track. If the track is too short to hold the
+ * segments the whole track is returned as a single range.
+ *
+ * @param trackSeconds Duration of the track
+ * @param segmentSeconds Length of each segment
+ * @param positions Relative centre of each segment (0.0-1.0)
+ * @return Ranges ordered by start time
+ */
+std::vector<TimeRange> planSegments(
+    double trackSeconds,
+    double segmentSeconds = 15.0,
+    const std::vector<double>& positions = defaultSegmentPositions()
+);
+
+/**
+ * Fingerprints ranges of decoded samples
+ *
+ * @param samples Mono samples of the whole track at config.sampleRate
+ * @param ranges Ranges to fingerprint
+ * @param config Analysis parameters
+ * @return Result containing one fingerprint with absolute anchor frames
+ */
+Result<CompactFingerprint> fingerprintSampleRanges(
+    const std::vector<AudioSample>& samples,
+    const std::vector<TimeRange>& ranges,
+    const FingerprintConfig& config
+);
+
+/**
+ * Fingerprints ranges of a WAV file, reading only those ranges
+ *
+ * @param file Mapped WAV file; other sample rates are resampled to config.sampleRate
+ * @param ranges Ranges to fingerprint
+ * @param config Analysis parameters
+ * @return Result containing one fingerprint with absolute anchor frames
+ */
+Result<CompactFingerprint> fingerprintWavRanges(
+    const WavFile& file,
+    const std::vector<TimeRange>& ranges,
+    const FingerprintConfig& config
+);
+
+/**
+ * Fingerprints ranges of any file, decoding only those ranges
+ *
+ * WAV files at the analysis sample rate are read directly; everything
+ * else is decoded with FFmpeg input seeking.
+ *
+ * @param filePath Path to the audio file
+ * @param ranges Ranges to fingerprint
+ * @param config Analysis parameters
+ * @param decodeOptions FFmpeg settings
+ * @return Result containing one fingerprint with absolute anchor frames
+ */
+Result<CompactFingerprint> fingerprintFileRanges(
+    const std::string& filePath,
+    const std::vector<TimeRange>& ranges,
+    const FingerprintConfig& config,
+    const DecodeOptions& decodeOptions = DecodeOptions()
+);
+
+/**
+ * Fingerprints screening segments of a file
+ *
+ * Queries the duration, plans the segments and fingerprints them.
+ *
+ * @param filePath Path to the audio file
+ * @param config Analysis parameters
+ * @param segmentSeconds Length of each segment
+ * @param positions Relative centre of each segment (0.0-1.0)
+ * @param decodeOptions FFmpeg settings
+ * @return Result containing one fingerprint with absolute anchor frames
+ */
+Result<CompactFingerprint> fingerprintFileSegments(
+    const std::string& filePath,
+    const FingerprintConfig& config,
+    double segmentSeconds = 15.0,
+    const std::vector<double>& positions = defaultSegmentPositions(),
+    const DecodeOptions& decodeOptions = DecodeOptions()
+);
+
+} // namespace audio
+} // namespace sortify
+
+#endif // SEGMENT_FINGERPRINT_HPP
@@ -0,0 +1,180 @@
+#ifndef SHARDED_INDEX_HPP
+#define SHARDED_INDEX_HPP
+
+/**
+ * @file sharded_index.hpp
+ * @brief Fingerprint index that accepts new tracks while it is being queried
+ *
+ * The hash space is split into 2^shardBits shards by hash prefix. Each shard
+ * is a list of immutable segments, each an ordinary built FingerprintIndex
+ * or, once compacted, a mapped index file. Writers stage tracks and publish
+ * them as one new segment per shard; the set of segments visible to readers
+ * is an immutable snapshot swapped in with a single atomic store.
+ *
+ * Readers never lock: a query announces the current epoch in a per-thread
+ * slot, loads the snapshot pointer and clears the slot when done. A
+ * replaced snapshot is only freed once no slot still announces an epoch
+ * older than its replacement (epoch-based reclamation), so ingest neither
+ * blocks queries nor frees memory under them.
+ *
+ * A background thread merges segments of similar size (compactionFanIn of
+ * them at a time), so each shard holds a logarithmic number of segments;
+ * with a compaction directory the merged segments are written in the index
+ * file format and mapped instead of kept on the heap.
+ */
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <unordered_set>
+#include <cstdint>
+#include <cstddef>
+#include "result.hpp"
+#include "compact_fingerprint.hpp"
+#include "fingerprint_index.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @struct ShardedIndexOptions
+ * @brief Sharding, publication and compaction settings
+ */
+struct ShardedIndexOptions {
+    unsigned int shardBits = 4;            ///< The index has 2^shardBits shards (at most 16 bits)
+    size_t segmentRecords = 1 << 20;       ///< Staged records that trigger publishing a new segment per shard
+    unsigned int compactionFanIn = 4;      ///< Segments of one size tier merged at a time
+    bool backgroundCompaction = true;      ///< Merge segments on a background thread after each publish
+    std::string compactionDirectory;       ///< Where merged segments are written and mapped (empty = keep on the heap)
+    unsigned int bloomBitsPerKey = defaultBloomBitsPerKey; ///< Bloom filter size of every segment
+};
+
+/**
+ * @struct ShardedIndexStats
+ * @brief Size of the published snapshot
+ */
+struct ShardedIndexStats {
+    size_t trackCount = 0;      ///< Tracks visible to queries
+    size_t pendingTracks = 0;   ///< Tracks added but not yet published
+    size_t segmentCount = 0;    ///< Segments over all shards
+    size_t mappedSegments = 0;  ///< Segments served from mapped index files
+    size_t postingCount = 0;    ///< Postings over all segments
+    size_t memoryBytes = 0;     ///< Heap bytes of the in-memory segments
+    uint64_t version = 0;       ///< Number of snapshots published so far
+};
+
+/**
+ * @class ShardedIndex
+ * @brief Concurrent inverted index with lock-free, snapshot-isolated queries
+ *
+ * addTrack, flush and compact may be called from any thread and serialize
+ * among themselves; query and stats may run concurrently with all of them.
+ * A query sees either all or none of the records of a track.
+ */
+class ShardedIndex {
+public:
+    explicit ShardedIndex(ShardedIndexOptions options = ShardedIndexOptions());
+    ~ShardedIndex();
+
+    ShardedIndex(const ShardedIndex&) = delete;
+    ShardedIndex& operator=(const ShardedIndex&) = delete;
+
+    /**
+     * Stages a track; it becomes visible when the staged records reach
+     * segmentRecords or flush() is called
+     *
+     * @param songId Identifier returned by queries; must be unique in the index
+     * @param fingerprint Compact fingerprint of the track
+     * @return Result containing the number of records staged
+     */
+    Result<size_t> addTrack(int songId, const CompactFingerprint& fingerprint);
+
+    /**
+     * Publishes all staged tracks to queries
+     *
+     * @return Number of tracks published
+     */
+    size_t flush();
+
+    /**
+     * Runs compaction on the calling thread until no size tier is full
+     *
+     * @return Number of merges performed
+     */
+    size_t compact();
+
+    /**
+     * Finds the indexed tracks that best explain the sample
+     *
+     * Scores exactly like FingerprintIndex::query over the published tracks.
+     *
+     * @param sample Compact fingerprint of the query audio
+     * @param maxResults Maximum number of candidates to return
+     * @param minScore Minimum number of hashes agreeing on one time offset
+     * @return Result containing candidates ordered by descending score
+     */
+    Result<std::vector<MatchCandidate>> query(
+        const CompactFingerprint& sample,
+        size_t maxResults = 10,
+        unsigned int minScore = 2
+    ) const;
+
+    /**
+     * Get the size of the current snapshot
+     */
+    ShardedIndexStats stats() const;
+
+    /**
+     * Get the number of shards
+     */
+    size_t shardCount() const {
+        return size_t(1) << options.shardBits;
+    }
+
+private:
+    struct Segment;
+    struct Snapshot;
+    using SegmentList = std::vector<std::shared_ptr<const Segment>>;
+
+    size_t shardOf(uint32_t hash) const {
+        return options.shardBits == 0 ? 0 : hash >> (32 - options.shardBits);
+    }
+
+    size_t publishLocked();
+    void replaceSnapshotLocked(std::unique_ptr<Snapshot> next);
+    void reclaimLocked();
+    bool compactOnce();
+    std::shared_ptr<const Segment> mergeSegments(size_t shard, const SegmentList& parts);
+    void compactionLoop();
+
+    ShardedIndexOptions options;
+
+    std::atomic<const Snapshot*> current{nullptr};
+
+    // Writer side, guarded by writerMutex
+    std::mutex writerMutex;
+    std::vector<FingerprintIndex> staging;  ///< One per shard
+    std::vector<std::pair<uint64_t, const Snapshot*>> retired; ///< Replaced snapshots and their retire epoch
+    std::unordered_set<int> songIds;
+    size_t stagedRecords = 0;
+    std::atomic<size_t> stagedTracks{0};    ///< Also read by stats()
+    size_t publishedTracks = 0;
+    uint64_t version = 0;
+
+    std::mutex compactionRunMutex;          ///< Serializes compaction passes
+    uint64_t nextFileNumber = 0;            ///< Guarded by compactionRunMutex
+    std::mutex compactionMutex;
+    std::condition_variable compactionWake;
+    bool compactionRequested = false;
+    std::atomic<bool> stopping{false};
+    std::thread compactionThread;
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // SHARDED_INDEX_HPP
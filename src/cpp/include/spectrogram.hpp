@@ -0,0 +1,160 @@
+#ifndef SPECTROGRAM_HPP
+#define SPECTROGRAM_HPP
+
+/**
+ * @file spectrogram.hpp
+ * @brief Contiguous time-frequency matrix produced and consumed by the fingerprint pipeline
+ *
+ * The spectrogram is stored time-major: all frequency bins of one window are
+ * adjacent in memory, and every window starts on a 64-byte boundary. This is
+ * the order in which generateSpectrogram writes and extractPeaks reads.
+ */
+
+#include <vector>
+#include <cstddef>
+#include "aligned_allocator.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * The original nested-vector layout (rows=frequencies, cols=time)
+ *
+ * Kept for callers that still build or consume spectrograms in this form;
+ * see Spectrogram::fromLegacy() and Spectrogram::toLegacy().
+ */
+using LegacySpectrogram = std::vector<std::vector<float>>;
+
+/**
+ * @class SpectrogramFrame
+ * @brief Read-only view of the frequency bins of a single time window
+ */
+class SpectrogramFrame {
+public:
+    SpectrogramFrame(const float* bins, unsigned int numBins) : bins(bins), count(numBins) {}
+
+    const float* data() const { return bins; }
+    unsigned int size() const { return count; }
+    const float* begin() const { return bins; }
+    const float* end() const { return bins + count; }
+    float operator[](unsigned int bin) const { return bins[bin]; }
+
+private:
+    const float* bins;
+    unsigned int count;
+};
+
+/**
+ * @class Spectrogram
+ * @brief Flat, cache-aligned magnitude matrix indexed by (frame, bin)
+ *
+ * A single buffer holds numFrames() rows of stride() floats. The first
+ * numBins() values of each row are magnitudes; the remainder is zero padding
+ * that rounds every row up to a whole number of cache lines.
+ *
+ * Spectrograms are move-only: at tens of megabytes per track an implicit
+ * copy is never what a caller wants, so duplicates go through clone().
+ */
+class Spectrogram {
+public:
+    /// Byte alignment of the buffer and of every frame
+    static constexpr std::size_t frameAlignment = 64;
+
+    Spectrogram() = default;
+
+    /**
+     * Creates a zero-filled spectrogram
+     *
+     * @param numFrames Number of time windows
+     * @param numBins Number of frequency bins per window
+     * @param resource Memory resource for the buffer (nullptr = heap); the
+     *        spectrogram must not be used after the resource is released
+     */
+    Spectrogram(unsigned int numFrames, unsigned int numBins, std::pmr::memory_resource* resource = nullptr);
+
+    Spectrogram(const Spectrogram&) = delete;
+    Spectrogram& operator=(const Spectrogram&) = delete;
+    Spectrogram(Spectrogram&&) noexcept = default;
+    Spectrogram& operator=(Spectrogram&&) noexcept = default;
+
+    /**
+     * Creates a heap-allocated copy
+     *
+     * @return A spectrogram with the same shape and magnitudes
+     */
+    Spectrogram clone() const;
+
+    /**
+     * Reshapes the spectrogram and zero-fills it, reusing existing capacity
+     *
+     * @param numFrames Number of time windows
+     * @param numBins Number of frequency bins per window
+     */
+    void resize(unsigned int numFrames, unsigned int numBins);
+
+    unsigned int numFrames() const { return frames; }
+    unsigned int numBins() const { return bins; }
+    bool empty() const { return frames == 0 || bins == 0; }
+
+    /**
+     * Get the distance in floats between the starts of consecutive frames
+     */
+    std::size_t stride() const { return frameStride; }
+
+    /**
+     * Get the number of floats the buffer holds before resize() must reallocate
+     */
+    std::size_t capacity() const { return buffer.capacity(); }
+
+    /**
+     * Get a view of the bins of one time window
+     */
+    SpectrogramFrame frame(unsigned int frameIdx) const {
+        return SpectrogramFrame(buffer.data() + frameIdx * frameStride, bins);
+    }
+
+    /**
+     * Get writable access to the bins of one time window
+     */
+    float* frameData(unsigned int frameIdx) {
+        return buffer.data() + frameIdx * frameStride;
+    }
+
+    float at(unsigned int frameIdx, unsigned int bin) const {
+        return buffer[frameIdx * frameStride + bin];
+    }
+
+    float& at(unsigned int frameIdx, unsigned int bin) {
+        return buffer[frameIdx * frameStride + bin];
+    }
+
+    const float* data() const { return buffer.data(); }
+
+    /**
+     * Converts a nested-vector spectrogram (rows=frequencies, cols=time)
+     *
+     * Rows shorter than the first one are treated as zero-padded.
+     *
+     * @param legacy The spectrogram in the original layout
+     * @return The equivalent flat spectrogram
+     */
+    static Spectrogram fromLegacy(const LegacySpectrogram& legacy);
+
+    /**
+     * Converts to the nested-vector layout (rows=frequencies, cols=time)
+     *
+     * @return A copy of the magnitudes in the original layout
+     */
+    LegacySpectrogram toLegacy() const;
+
+private:
+    unsigned int frames = 0;
+    unsigned int bins = 0;
+    std::size_t frameStride = 0;
+    AlignedVector<float> buffer;
+};
+
+} // namespace audio
+} // namespace sortify
+
+#endif // SPECTROGRAM_HPP
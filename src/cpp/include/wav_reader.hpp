@@ -0,0 +1,140 @@
+#ifndef WAV_READER_HPP
+#define WAV_READER_HPP
+
+/**
+ * @file wav_reader.hpp
+ * @brief Memory-mapped WAV reader
+ *
+ * WavFile maps the file read-only, walks the RIFF chunk list to find the
+ * "fmt " and "data" chunks and then converts any range of frames straight
+ * from the mapping into mono floats. Nothing is copied before conversion, and
+ * reading a range only touches the pages it covers.
+ */
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "result.hpp"
+#include "audio_fingerprint.hpp"
+#include "pcm_convert.hpp"
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @struct WavFormat
+ * @brief Stream parameters from the "fmt " chunk
+ */
+struct WavFormat {
+    unsigned int sampleRate = 0;    ///< Frames per second
+    unsigned int numChannels = 0;   ///< Interleaved channels per frame
+    unsigned int bitsPerSample = 0; ///< Container bits per sample
+    PcmEncoding encoding = PcmEncoding::INT16;
+    size_t numFrames = 0;           ///< Complete frames in the data chunk
+};
+
+/**
+ * @class WavFile
+ * @brief Read-only view of a PCM or IEEE float WAV file
+ *
+ * Supports 8/16/24/32-bit integer and 32/64-bit float samples, including
+ * WAVE_FORMAT_EXTENSIBLE headers.
+ */
+class WavFile {
+public:
+    /**
+     * Maps and parses a WAV file
+     *
+     * @param filePath Path to the WAV file
+     */
+    explicit WavFile(const std::string& filePath);
+    ~WavFile();
+
+    WavFile(const WavFile&) = delete;
+    WavFile& operator=(const WavFile&) = delete;
+
+    /**
+     * Check if the file was mapped and parsed successfully
+     */
+    bool isValid() const {
+        return errorMessage.empty();
+    }
+
+    /**
+     * Get the reason the file could not be used
+     */
+    const std::string& getError() const {
+        return errorMessage;
+    }
+
+    /**
+     * Get the stream parameters
+     */
+    const WavFormat& format() const {
+        return wavFormat;
+    }
+
+    /**
+     * Get the duration of the audio in seconds
+     */
+    double durationSeconds() const {
+        return wavFormat.sampleRate > 0 ? static_cast<double>(wavFormat.numFrames) / wavFormat.sampleRate : 0.0;
+    }
+
+    /**
+     * Converts a range of frames to mono samples in [-1.0, 1.0]
+     *
+     * @param firstFrame First frame to convert
+     * @param numFrames Maximum number of frames to convert
+     * @param output Destination with room for numFrames samples
+     * @return Number of frames converted (fewer at the end of the file)
+     */
+    size_t read(size_t firstFrame, size_t numFrames, AudioSample* output) const;
+
+    /**
+     * Converts the whole file to mono samples
+     *
+     * @param samples Vector resized to format().numFrames and filled
+     */
+    void readAll(std::vector<AudioSample>& samples) const;
+
+    /**
+     * Converts the whole file to mono samples at another sample rate
+     *
+     * Frames are downmixed and resampled block by block, so the track is
+     * never held at the native rate; a 192 kHz file read at 11025 Hz needs
+     * 1/17 of the memory of readAll.
+     *
+     * @param samples Vector replaced with the converted samples
+     * @param sampleRate Output sample rate (Hz); the native rate reads like readAll
+     * @return Result containing the number of samples, or why the rates cannot be converted
+     */
+    Result<size_t> readAllResampled(std::vector<AudioSample>& samples, unsigned int sampleRate) const;
+
+private:
+    std::string parse();
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    const uint8_t* frameData = nullptr;
+    size_t frameBytes = 0;
+    WavFormat wavFormat;
+    std::string errorMessage;
+};
+
+/**
+ * @brief Whether a path ends in ".wav", ignoring case
+ *
+ * Callers use this to decide between mapping the file with WavFile and
+ * handing it to FFmpeg, so other containers are never parsed as RIFF.
+ *
+ * @param filePath Path to check
+ * @return True if the extension is ".wav"
+ */
+bool hasWavExtension(const std::string& filePath);
+
+} // namespace audio
+} // namespace sortify
+
+#endif // WAV_READER_HPP
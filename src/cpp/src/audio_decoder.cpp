@@ -0,0 +1,141 @@
+#include "../include/audio_decoder.hpp"
+#include "../include/logger.hpp"
+#include "../include/metrics.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <sys/wait.h>
+
+namespace sortify {
+namespace audio {
+
+std::string FFmpegDecoder::quoteShellArgument(const std::string& argument) {
+    // Inside single quotes only the quote itself is special: close, escape, reopen
+    std::string quoted = "'";
+    for (char c : argument) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    quoted += "'";
+    return quoted;
+}
+
+std::string FFmpegDecoder::buildCommand(const std::string& filePath, const DecodeOptions& options) {
+    std::ostringstream command;
+    command.precision(17);
+    command << quoteShellArgument(options.ffmpegPath) << " -nostdin -v error";
+    if (options.startSeconds > 0.0) {
+        command << " -ss " << options.startSeconds;
+    }
+    // The file: prefix stops names containing ':' being taken as protocols
+    command << " -i " << quoteShellArgument("file:" + filePath);
+    if (options.durationSeconds > 0.0) {
+        command << " -t " << options.durationSeconds;
+    }
+    command << " -vn -ac 1 -ar " << options.sampleRate << " -f f32le - 2>/dev/null";
+    return command.str();
+}
+
+Result<size_t> FFmpegDecoder::decodeStream(
+    const std::string& filePath,
+    const SampleBlockCallback& callback,
+    const DecodeOptions& options
+) {
+    if (options.sampleRate == 0 || options.blockSize == 0) {
+        return Result<size_t>::createFailure("Invalid decode options: sample rate and block size must be positive");
+    }
+
+    const std::string command = buildCommand(filePath, options);
+    SORTIFY_LOG_DEBUG("Executing: ", command);
+
+    FILE* pipe = ::popen(command.c_str(), "r");
+    if (!pipe) {
+        return Result<size_t>::createFailure("Failed to start FFmpeg for " + filePath);
+    }
+
+    // f32le matches the in-memory float layout on little-endian hosts
+    std::vector<AudioSample> block(options.blockSize);
+    size_t totalSamples = 0;
+    bool stoppedEarly = false;
+
+    // Only time spent waiting on FFmpeg counts as decoding, not the callback
+    const bool timed = Metrics::isEnabled();
+    std::chrono::nanoseconds decodeTime(0);
+
+    while (true) {
+        const auto readStart = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        const size_t count = std::fread(block.data(), sizeof(AudioSample), block.size(), pipe);
+        if (timed) {
+            decodeTime += std::chrono::steady_clock::now() - readStart;
+        }
+        if (count > 0) {
+            totalSamples += count;
+            if (!callback(block.data(), count)) {
+                stoppedEarly = true;
+                break;
+            }
+        }
+        if (count < block.size()) {
+            break;
+        }
+    }
+
+    const int status = ::pclose(pipe);
+    Metrics::recordDuration(MetricStage::DECODE, decodeTime);
+    Metrics::add(MetricCounter::SAMPLES_DECODED, totalSamples);
+
+    // Closing the pipe early makes FFmpeg exit with SIGPIPE, which is expected
+    if (!stoppedEarly && (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+        return Result<size_t>::createFailure("FFmpeg failed to decode " + filePath +
+                                             "; make sure FFmpeg is installed and in your PATH");
+    }
+    if (totalSamples == 0 && !stoppedEarly) {
+        return Result<size_t>::createFailure("No audio decoded from " + filePath);
+    }
+
+    return Result<size_t>::createSuccess(totalSamples);
+}
+
+Result<double> FFmpegDecoder::probeDuration(const std::string& filePath, const DecodeOptions& options) {
+    const std::string command = quoteShellArgument(options.ffprobePath) +
+        " -v error -show_entries format=duration -of default=noprint_wrappers=1:nokey=1 " +
+        quoteShellArgument("file:" + filePath) + " 2>/dev/null";
+    SORTIFY_LOG_DEBUG("Executing: ", command);
+
+    FILE* pipe = ::popen(command.c_str(), "r");
+    if (!pipe) {
+        return Result<double>::createFailure("Failed to start FFprobe for " + filePath);
+    }
+
+    char line[128] = {};
+    const bool gotLine = std::fgets(line, sizeof(line), pipe) != nullptr;
+    const int status = ::pclose(pipe);
+
+    char* end = nullptr;
+    const double duration = gotLine ? std::strtod(line, &end) : 0.0;
+    if (status != 0 || !gotLine || end == line || !(duration > 0.0)) {
+        return Result<double>::createFailure("Could not determine the duration of " + filePath);
+    }
+    return Result<double>::createSuccess(duration);
+}
+
+Result<std::vector<AudioSample>> FFmpegDecoder::decode(const std::string& filePath, const DecodeOptions& options) {
+    std::vector<AudioSample> samples;
+    auto decoded = decodeStream(filePath, [&](const AudioSample* block, size_t count) {
+        samples.insert(samples.end(), block, block + count);
+        return true;
+    }, options);
+
+    if (!decoded.isSuccess()) {
+        return Result<std::vector<AudioSample>>::createFailure(decoded.getError());
+    }
+    Metrics::add(MetricCounter::BYTES_ALLOCATED, samples.capacity() * sizeof(AudioSample));
+    return Result<std::vector<AudioSample>>::createSuccess(std::move(samples));
+}
+
+} // namespace audio
+} // namespace sortify
@@ -0,0 +1,155 @@
+#include "../include/audio_quality.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+/// Bins per block of the cutoff search
+constexpr unsigned int cutoffBlockBins = 8;
+
+float toDecibels(double amplitude) {
+    return amplitude > 0.0 ? static_cast<float>(20.0 * std::log10(amplitude)) : -200.0f;
+}
+
+void accumulateSamples(const AudioSample* samples, size_t count, float clipLevel,
+                       float& peak, double& sumSquares, uint32_t& clipped) {
+    for (size_t i = 0; i < count; ++i) {
+        const float magnitude = std::fabs(samples[i]);
+        peak = std::max(peak, magnitude);
+        sumSquares += static_cast<double>(samples[i]) * samples[i];
+        clipped += magnitude >= clipLevel ? 1 : 0;
+    }
+}
+
+} // namespace
+
+QualityFrame summarizeQualityFrame(
+    const AudioSample* samples1,
+    size_t count1,
+    const AudioSample* samples2,
+    size_t count2,
+    const fftwf_complex* spectrum,
+    unsigned int windowSize,
+    const QualityOptions& options
+) {
+    QualityFrame frame;
+
+    double sumSquares = 0.0;
+    uint32_t clipped = 0;
+    accumulateSamples(samples1, count1, options.clipLevel, frame.peak, sumSquares, clipped);
+    accumulateSamples(samples2, count2, options.clipLevel, frame.peak, sumSquares, clipped);
+    const size_t count = count1 + count2;
+    frame.rms = count > 0 ? static_cast<float>(std::sqrt(sumSquares / count)) : 0.0f;
+    frame.clippedSamples = static_cast<uint16_t>(std::min<uint32_t>(clipped, std::numeric_limits<uint16_t>::max()));
+
+    // The Hamming window's sidelobes only fall off at 6 dB per octave, so a
+    // loud band leaks to about 50 dB below itself across the whole spectrum
+    // and would hide any cutoff. Convolving the spectrum with (-1/2, 1, -1/2)
+    // applies a Hann window on top of it (the effective window is the
+    // product), whose sidelobes fall off at 18 dB per octave. Power is then
+    // compared in blocks of bins so single noisy bins do not count.
+    const unsigned int nyquistBin = windowSize / 2;
+    const unsigned int lastBin = std::min<unsigned int>(nyquistBin, std::numeric_limits<uint16_t>::max());
+    auto taperedPower = [&](unsigned int bin) {
+        // Past the Nyquist bin the spectrum of real input mirrors as the conjugate
+        const float nextRe = bin < nyquistBin ? spectrum[bin + 1][0] : spectrum[bin - 1][0];
+        const float nextIm = bin < nyquistBin ? spectrum[bin + 1][1] : -spectrum[bin - 1][1];
+        const float re = spectrum[bin][0] - 0.5f * (spectrum[bin - 1][0] + nextRe);
+        const float im = spectrum[bin][1] - 0.5f * (spectrum[bin - 1][1] + nextIm);
+        return re * re + im * im;
+    };
+    auto blockPower = [&](unsigned int first) {
+        const unsigned int end = std::min(first + cutoffBlockBins, lastBin + 1);
+        float power = 0.0f;
+        for (unsigned int bin = first; bin < end; ++bin) {
+            power += taperedPower(bin);
+        }
+        return power;
+    };
+
+    // Blocks start at bin 1, skipping DC
+    float strongest = 0.0f;
+    for (unsigned int first = 1; first <= lastBin; first += cutoffBlockBins) {
+        strongest = std::max(strongest, blockPower(first));
+    }
+    if (strongest > 0.0f) {
+        const float threshold = strongest * std::pow(10.0f, -options.cutoffThresholdDb / 10.0f);
+        unsigned int first = 1 + (lastBin - 1) / cutoffBlockBins * cutoffBlockBins;
+        while (first > 1 && blockPower(first) < threshold) {
+            first -= cutoffBlockBins;
+        }
+        frame.cutoffBin = static_cast<uint16_t>(std::min(first + cutoffBlockBins - 1, lastBin));
+    }
+    return frame;
+}
+
+Result<AudioQuality> summarizeQuality(const QualityTrace& trace) {
+    if (trace.frames.empty() || trace.sampleRate == 0 || trace.windowSize == 0) {
+        return Result<AudioQuality>::createFailure("No quality frames collected");
+    }
+    const QualityOptions& options = trace.options;
+
+    AudioQuality quality;
+    quality.nyquistFrequency = trace.sampleRate / 2.0f;
+
+    const float silenceRms = std::pow(10.0f, options.silenceDb / 20.0f);
+    std::vector<uint16_t> cutoffs;
+    std::vector<float> meanSquares;
+    cutoffs.reserve(trace.frames.size());
+    meanSquares.reserve(trace.frames.size());
+    float peak = 0.0f;
+    for (const QualityFrame& frame : trace.frames) {
+        peak = std::max(peak, frame.peak);
+        quality.clippedSamples += frame.clippedSamples;
+        if (frame.rms >= silenceRms) {
+            cutoffs.push_back(frame.cutoffBin);
+            meanSquares.push_back(frame.rms * frame.rms);
+        }
+    }
+    if (cutoffs.empty()) {
+        return Result<AudioQuality>::createFailure("No frames above the silence threshold");
+    }
+    quality.audibleFrames = static_cast<unsigned int>(cutoffs.size());
+
+    const float percentile = std::clamp(options.cutoffPercentile, 0.0f, 1.0f);
+    const size_t cutoffRank = std::min(cutoffs.size() - 1, static_cast<size_t>(percentile * (cutoffs.size() - 1) + 0.5f));
+    std::nth_element(cutoffs.begin(), cutoffs.begin() + cutoffRank, cutoffs.end());
+    quality.cutoffFrequency = static_cast<float>(cutoffs[cutoffRank]) * trace.sampleRate / trace.windowSize;
+
+    const size_t loudFrames = std::max<size_t>(1, static_cast<size_t>(meanSquares.size() * std::clamp(options.loudFraction, 0.0f, 1.0f)));
+    std::nth_element(meanSquares.begin(), meanSquares.begin() + (loudFrames - 1), meanSquares.end(), std::greater<float>());
+    double loudEnergy = 0.0;
+    for (size_t i = 0; i < loudFrames; ++i) {
+        loudEnergy += meanSquares[i];
+    }
+
+    quality.peakDb = toDecibels(peak);
+    quality.loudRmsDb = toDecibels(std::sqrt(loudEnergy / loudFrames));
+    quality.dynamicRangeDb = quality.peakDb - quality.loudRmsDb;
+
+    // Frame 0 covers the whole window, every later frame one hop
+    const uint64_t numSamples = trace.windowSize + static_cast<uint64_t>(trace.frames.size() - 1) * trace.stepSize;
+    quality.clippedFraction = static_cast<double>(quality.clippedSamples) / numSamples;
+    return Result<AudioQuality>::createSuccess(quality);
+}
+
+int compareAudioQuality(const AudioQuality& a, const AudioQuality& b) {
+    if (std::fabs(a.cutoffFrequency - b.cutoffFrequency) >= 500.0f) {
+        return a.cutoffFrequency > b.cutoffFrequency ? 1 : -1;
+    }
+    if (std::fabs(a.clippedFraction - b.clippedFraction) >= 1e-4) {
+        return a.clippedFraction < b.clippedFraction ? 1 : -1;
+    }
+    if (std::fabs(a.dynamicRangeDb - b.dynamicRangeDb) >= 1.0f) {
+        return a.dynamicRangeDb > b.dynamicRangeDb ? 1 : -1;
+    }
+    return 0;
+}
+
+} // namespace audio
+} // namespace sortify
@@ -0,0 +1,408 @@
+#include "../include/batch_fingerprinter.hpp"
+#include "../include/bounded_queue.hpp"
+#include "../include/fingerprint_stream.hpp"
+#include "../include/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <filesystem>
+#include <thread>
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+/**
+ * @struct CompletedFile
+ * @brief A processed file on its way from a worker to the sink
+ */
+struct CompletedFile {
+    size_t position = 0;
+    FileResult result;
+    CompactFingerprint fingerprint;
+};
+
+/**
+ * Streams one file through FingerprintStream, filling in the report fields
+ */
+CompactFingerprint streamFile(const std::string& filePath, const FingerprintConfig& config,
+                              DecodeOptions decodeOptions, FileResult& result, QualityTrace* quality = nullptr) {
+    decodeOptions.sampleRate = config.sampleRate;
+
+    FingerprintStream stream(0, config);
+    if (!stream.isValid()) {
+        result.status = FileStatus::FINGERPRINT_FAILED;
+        result.error = stream.getError();
+        return CompactFingerprint();
+    }
+    stream.setQualityTrace(quality);
+
+    std::vector<FingerprintHash> hashes;
+    std::string streamError;
+    auto decoded = FFmpegDecoder::decodeStream(filePath, [&](const AudioSample* samples, size_t count) {
+        auto pushed = stream.pushSamples(samples, count, hashes);
+        if (!pushed.isSuccess()) {
+            streamError = pushed.getError();
+            return false;
+        }
+        return true;
+    }, decodeOptions);
+
+    if (!streamError.empty()) {
+        result.status = FileStatus::FINGERPRINT_FAILED;
+        result.error = streamError;
+        return CompactFingerprint();
+    }
+    if (!decoded.isSuccess()) {
+        result.status = FileStatus::DECODE_FAILED;
+        result.error = decoded.getError();
+        return CompactFingerprint();
+    }
+    result.numSamples = decoded.getValue();
+
+    auto finished = stream.finish(hashes);
+    if (!finished.isSuccess() || hashes.empty()) {
+        result.status = FileStatus::FINGERPRINT_FAILED;
+        result.error = finished.isSuccess() ? "Failed to create any fingerprint hashes" : finished.getError();
+        return CompactFingerprint();
+    }
+
+    CompactFingerprint fingerprint = CompactFingerprint::fromHashes(hashes);
+    result.status = FileStatus::OK;
+    result.numHashes = fingerprint.size();
+    return fingerprint;
+}
+
+/**
+ * Hashes every option that changes the fingerprint a run produces for a file
+ */
+uint64_t cacheParameterHash(const BatchOptions& options) {
+    uint64_t hash = hashFingerprintConfig(options.config);
+    hash = fnv1aHash(hash, &options.segmentSeconds, sizeof(options.segmentSeconds));
+    if (options.segmentSeconds > 0.0) {
+        hash = fnv1aHash(hash, options.segmentPositions.data(), options.segmentPositions.size() * sizeof(double));
+    }
+    return hash;
+}
+
+} // namespace
+
+Result<CompactFingerprint> fingerprintFile(
+    const std::string& filePath,
+    const FingerprintConfig& config,
+    const DecodeOptions& decodeOptions
+) {
+    FileResult result;
+    CompactFingerprint fingerprint = streamFile(filePath, config, decodeOptions, result);
+    if (result.status != FileStatus::OK) {
+        return Result<CompactFingerprint>::createFailure(result.error);
+    }
+    return Result<CompactFingerprint>::createSuccess(std::move(fingerprint));
+}
+
+Result<CompactFingerprint> fingerprintSamples(
+    const std::vector<AudioSample>& samples,
+    const FingerprintConfig& config,
+    PipelineArena* arena,
+    QualityTrace* quality
+) {
+    std::pmr::memory_resource* resource = arena ? arena->resource() : nullptr;
+
+    // Files are already processed in parallel, so each one uses a single FFT thread
+    auto spectrogram = generateSpectrogram(samples, config.sampleRate, config.windowSize, config.overlap,
+                                           config.minFreq, config.maxFreq, 1, resource, quality);
+    if (!spectrogram.isSuccess()) {
+        return Result<CompactFingerprint>::createFailure("Spectrogram failed: " + spectrogram.getError());
+    }
+
+    auto fingerprint = Result<CompactFingerprint>::createFailure("No peaks");
+    if (resource) {
+        auto peaks = extractPeaks(spectrogram.getValue(), resource, config);
+        if (!peaks.isSuccess()) {
+            return Result<CompactFingerprint>::createFailure("Peak extraction failed: " + peaks.getError());
+        }
+        fingerprint = createCompactFingerprint(peaks.getValue(), resource, config);
+    } else {
+        auto peaks = extractPeaks(spectrogram.getValue(), config);
+        if (!peaks.isSuccess()) {
+            return Result<CompactFingerprint>::createFailure("Peak extraction failed: " + peaks.getError());
+        }
+        fingerprint = createCompactFingerprint(peaks.getValue(), config);
+    }
+    if (!fingerprint.isSuccess()) {
+        return Result<CompactFingerprint>::createFailure("Fingerprint failed: " + fingerprint.getError());
+    }
+    return fingerprint;
+}
+
+std::vector<Result<CompactFingerprint>> fingerprintSampleBatch(
+    const std::vector<std::vector<AudioSample>>& clips,
+    const FingerprintConfig& config,
+    unsigned int batchSize
+) {
+    auto spectrograms = generateSpectrogramBatch(clips, config.sampleRate, config.windowSize, config.overlap,
+                                                 config.minFreq, config.maxFreq, batchSize);
+
+    std::vector<Result<CompactFingerprint>> results;
+    results.reserve(clips.size());
+    std::vector<Peak> peaks;
+    for (auto& spectrogram : spectrograms) {
+        if (!spectrogram.isSuccess()) {
+            results.push_back(Result<CompactFingerprint>::createFailure("Spectrogram failed: " + spectrogram.getError()));
+            continue;
+        }
+
+        // The peak buffer is reused across clips; each spectrogram is freed once its peaks are known
+        auto extracted = extractPeaksInto(spectrogram.getValue(), peaks, config);
+        spectrogram.getValue() = Spectrogram();
+        if (!extracted.isSuccess()) {
+            results.push_back(Result<CompactFingerprint>::createFailure("Peak extraction failed: " + extracted.getError()));
+            continue;
+        }
+
+        auto fingerprint = createCompactFingerprint(peaks, config);
+        if (!fingerprint.isSuccess()) {
+            results.push_back(Result<CompactFingerprint>::createFailure("Fingerprint failed: " + fingerprint.getError()));
+            continue;
+        }
+        results.push_back(std::move(fingerprint));
+    }
+    return results;
+}
+
+BatchFingerprinter::BatchFingerprinter(BatchOptions options) : options(std::move(options)) {
+    numThreads = this->options.numThreads;
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (this->options.maxPendingResults == 0) {
+        this->options.maxPendingResults = 2 * static_cast<size_t>(numThreads);
+    }
+}
+
+std::vector<FileResult> BatchFingerprinter::run(
+    const std::vector<std::string>& paths,
+    int firstSongId,
+    const FingerprintSink& sink
+) const {
+    std::vector<FileResult> results(paths.size());
+    if (paths.empty()) {
+        return results;
+    }
+
+    BoundedQueue<CompletedFile> completed(options.maxPendingResults);
+    std::atomic<size_t> nextFile{0};
+
+    // Fills in file.fingerprint and the report fields for one input
+    auto fingerprintOne = [&](size_t i, CompletedFile& file, PipelineArena& arena, QualityTrace* quality) {
+        if (!options.decoder && options.segmentSeconds > 0.0) {
+            // Only the requested ranges are decoded; failures are reported as decode failures
+            auto fingerprint = fingerprintFileSegments(paths[i], options.config, options.segmentSeconds,
+                                                       options.segmentPositions, options.decodeOptions);
+            if (fingerprint.isSuccess()) {
+                file.fingerprint = std::move(fingerprint).take();
+                file.result.status = FileStatus::OK;
+                file.result.numHashes = file.fingerprint.size();
+            } else {
+                file.result.status = FileStatus::DECODE_FAILED;
+                file.result.error = fingerprint.getError();
+            }
+            return;
+        }
+        if (!options.decoder) {
+            file.fingerprint = streamFile(paths[i], options.config, options.decodeOptions, file.result, quality);
+            return;
+        }
+
+        std::vector<AudioSample> samples;
+        try {
+            samples = options.decoder(paths[i]);
+        } catch (const std::exception& e) {
+            file.result.status = FileStatus::DECODE_FAILED;
+            file.result.error = std::string("Decoder threw: ") + e.what();
+            return;
+        }
+        file.result.numSamples = samples.size();
+        if (samples.empty()) {
+            file.result.status = FileStatus::DECODE_FAILED;
+            file.result.error = "No samples decoded";
+            return;
+        }
+
+        auto fingerprint = options.segmentSeconds > 0.0
+            ? fingerprintSampleRanges(samples, planSegments(
+                  static_cast<double>(samples.size()) / options.config.sampleRate,
+                  options.segmentSeconds, options.segmentPositions), options.config)
+            : fingerprintSamples(samples, options.config, &arena, quality);
+        if (fingerprint.isSuccess()) {
+            file.fingerprint = std::move(fingerprint).take();
+            file.result.status = FileStatus::OK;
+            file.result.numHashes = file.fingerprint.size();
+        } else {
+            file.result.status = FileStatus::FINGERPRINT_FAILED;
+            file.result.error = fingerprint.getError();
+        }
+    };
+
+    const uint64_t paramHash = options.cache ? cacheParameterHash(options) : 0;
+
+    auto worker = [&]() {
+        // Reused for every file of this worker, so steady-state files allocate only their results;
+        // the streaming path keeps its bounded state on the heap and needs no block
+        PipelineArena arena(options.decoder ? defaultArenaBytes : 1);
+        QualityTrace quality;
+        quality.options = options.qualityOptions;
+        const bool measureQuality = options.analyzeQuality && options.segmentSeconds <= 0.0;
+        for (size_t i = nextFile++; i < paths.size(); i = nextFile++) {
+            CompletedFile file;
+            file.position = i;
+            file.result.path = paths[i];
+            file.result.songId = firstSongId + static_cast<int>(i);
+
+            // An unreadable file is left to the decoder to report
+            Result<FileIdentity> identity = options.cache
+                ? computeFileIdentity(paths[i])
+                : Result<FileIdentity>::createFailure("No cache");
+            if (identity.isSuccess() &&
+                options.cache->lookup(paths[i], identity.getValue(), paramHash, file.fingerprint)) {
+                file.result.status = FileStatus::OK;
+                file.result.numHashes = file.fingerprint.size();
+                file.result.fromCache = true;
+                completed.push(std::move(file));
+                continue;
+            }
+
+            quality.frames.clear();
+            try {
+                fingerprintOne(i, file, arena, measureQuality ? &quality : nullptr);
+            } catch (const std::exception& e) {
+                // e.g. bad_alloc in a stage; the file fails, the run goes on
+                file.fingerprint = CompactFingerprint();
+                file.result.status = FileStatus::FINGERPRINT_FAILED;
+                file.result.error = std::string("Fingerprinting threw: ") + e.what();
+            }
+            arena.reset();
+            if (measureQuality && file.result.status == FileStatus::OK) {
+                auto summary = summarizeQuality(quality);
+                file.result.hasQuality = summary.isSuccess();
+                if (file.result.hasQuality) {
+                    file.result.quality = summary.getValue();
+                }
+            }
+            if (identity.isSuccess() && file.result.status == FileStatus::OK) {
+                options.cache->store(paths[i], identity.getValue(), paramHash, file.fingerprint);
+            }
+            completed.push(std::move(file));
+        }
+    };
+
+    const unsigned int numWorkers = static_cast<unsigned int>(std::min<size_t>(numThreads, paths.size()));
+    std::vector<std::thread> workers;
+    workers.reserve(numWorkers);
+    for (unsigned int w = 0; w < numWorkers; ++w) {
+        workers.emplace_back(worker);
+    }
+
+    // Every file produces exactly one queue entry
+    size_t succeeded = 0;
+    size_t fromCache = 0;
+    std::exception_ptr sinkError;
+    for (size_t received = 0; received < paths.size() && !sinkError; ++received) {
+        CompletedFile file;
+        if (!completed.pop(file)) {
+            break;
+        }
+        if (file.result.status == FileStatus::OK) {
+            succeeded++;
+            fromCache += file.result.fromCache ? 1 : 0;
+            if (sink) {
+                try {
+                    sink(file.result, std::move(file.fingerprint));
+                } catch (...) {
+                    sinkError = std::current_exception();
+                }
+            }
+        } else {
+            SORTIFY_LOG_WARNING("Failed to fingerprint ", file.result.path, ": ", file.result.error);
+        }
+        results[file.position] = std::move(file.result);
+    }
+
+    if (sinkError) {
+        // Stop handing out files and release workers blocked on the full queue
+        nextFile = paths.size();
+        completed.close();
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    if (sinkError) {
+        std::rethrow_exception(sinkError);
+    }
+
+    SORTIFY_LOG_INFO("Fingerprinted ", succeeded, " of ", paths.size(), " files with ", numWorkers, " threads (",
+                     fromCache, " from cache)");
+
+    return results;
+}
+
+std::vector<FileResult> BatchFingerprinter::buildIndex(
+    const std::vector<std::string>& paths,
+    FingerprintIndex& index,
+    int firstSongId
+) const {
+    auto results = run(paths, firstSongId, [&](const FileResult& file, CompactFingerprint&& fingerprint) {
+        auto added = index.addTrack(file.songId, fingerprint);
+        if (!added.isSuccess()) {
+            SORTIFY_LOG_WARNING("Failed to index ", file.path, ": ", added.getError());
+        }
+    });
+    index.setConfigId(hashFingerprintConfig(options.config));
+    index.build();
+    return results;
+}
+
+Result<std::vector<std::string>> BatchFingerprinter::collectAudioFiles(
+    const std::string& directory,
+    const std::vector<std::string>& extensions
+) {
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    if (!fs::is_directory(directory, error)) {
+        return Result<std::vector<std::string>>::createFailure("Not a directory: " + directory);
+    }
+
+    std::vector<std::string> files;
+    fs::recursive_directory_iterator it(directory, fs::directory_options::skip_permission_denied, error);
+    if (error) {
+        return Result<std::vector<std::string>>::createFailure("Failed to scan " + directory + ": " + error.message());
+    }
+
+    for (; it != fs::recursive_directory_iterator(); it.increment(error)) {
+        if (error) {
+            SORTIFY_LOG_WARNING("Skipping unreadable entry below ", directory, ": ", error.message());
+            error.clear();
+            continue;
+        }
+        if (!it->is_regular_file(error)) {
+            continue;
+        }
+
+        std::string extension = it->path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (std::find(extensions.begin(), extensions.end(), extension) != extensions.end()) {
+            files.push_back(it->path().string());
+        }
+    }
+
+    // A stable order keeps song IDs reproducible between scans
+    std::sort(files.begin(), files.end());
+    return Result<std::vector<std::string>>::createSuccess(std::move(files));
+}
+
+} // namespace audio
+} // namespace sortify
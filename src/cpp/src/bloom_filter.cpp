@@ -0,0 +1,16 @@
+#include "../include/bloom_filter.hpp"
+
+namespace sortify {
+namespace audio {
+
+BlockedBloomFilter::BlockedBloomFilter(size_t expectedKeys, unsigned int bitsPerKey) {
+    if (expectedKeys == 0 || bitsPerKey == 0) {
+        return;
+    }
+    const size_t bitsPerBlock = sizeof(BloomBlock) * 8;
+    const size_t numBlocks = (expectedKeys * bitsPerKey + bitsPerBlock - 1) / bitsPerBlock;
+    blocks.assign(numBlocks, BloomBlock{});
+}
+
+} // namespace audio
+} // namespace sortify
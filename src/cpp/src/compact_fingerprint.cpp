@@ -0,0 +1,213 @@
+#include "../include/compact_fingerprint.hpp"
+#include "../include/fingerprint_stages.hpp"
+#include "../include/logger.hpp"
+#include "../include/metrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <memory>
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+/**
+ * Converts a peak time (window index stored as float) into a frame index
+ */
+uint32_t toFrameIndex(float time) {
+    return static_cast<uint32_t>(std::lround(std::max(time, 0.0f)));
+}
+
+} // namespace
+
+CompactFingerprint::CompactFingerprint(std::vector<HashRecord> records) : entries(std::move(records)) {
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+    entries.shrink_to_fit();
+}
+
+CompactFingerprint CompactFingerprint::fromSortedRecords(const HashRecord* first, const HashRecord* last) {
+    CompactFingerprint fingerprint;
+    fingerprint.entries.assign(first, last);
+    return fingerprint;
+}
+
+CompactFingerprint CompactFingerprint::fromSortedRecords(std::vector<HashRecord> records) {
+    CompactFingerprint fingerprint;
+    fingerprint.entries = std::move(records);
+    return fingerprint;
+}
+
+std::vector<HashRecord> CompactFingerprint::releaseRecords() {
+    return std::exchange(entries, std::vector<HashRecord>());
+}
+
+CompactFingerprint CompactFingerprint::fromHashMap(
+    const std::unordered_map<uint32_t, std::vector<FingerprintHash>>& fingerprint
+) {
+    size_t total = 0;
+    for (const auto& entry : fingerprint) {
+        total += entry.second.size();
+    }
+
+    std::vector<HashRecord> records;
+    records.reserve(total);
+    for (const auto& [hash, hashes] : fingerprint) {
+        for (const auto& fingerprintHash : hashes) {
+            records.push_back({hash, toFrameIndex(fingerprintHash.time)});
+        }
+    }
+    return CompactFingerprint(std::move(records));
+}
+
+CompactFingerprint CompactFingerprint::fromHashes(const std::vector<FingerprintHash>& hashes) {
+    std::vector<HashRecord> records;
+    records.reserve(hashes.size());
+    for (const auto& fingerprintHash : hashes) {
+        records.push_back({fingerprintHash.hash, toFrameIndex(fingerprintHash.time)});
+    }
+    return CompactFingerprint(std::move(records));
+}
+
+HashRange CompactFingerprint::find(uint32_t hash) const {
+    // Records are sorted by hash, so all matches form one contiguous run
+    const HashRecord* first = std::lower_bound(begin(), end(), hash,
+        [](const HashRecord& record, uint32_t value) { return record.hash < value; });
+    const HashRecord* last = first;
+    while (last != end() && last->hash == hash) {
+        ++last;
+    }
+    return HashRange(first, last);
+}
+
+size_t CompactFingerprint::uniqueHashCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (i == 0 || entries[i].hash != entries[i - 1].hash) {
+            count++;
+        }
+    }
+    return count;
+}
+
+namespace {
+
+/**
+ * Pairs peaks into records, then sorts and de-duplicates them in place
+ *
+ * @param zone TargetZone or RuntimeTargetZone
+ * @param peaks Peaks sorted by time
+ * @param records Empty record buffer; its allocator supplies the scratch memory
+ * @return Number of unique records, or 0 if none were created
+ */
+template <typename Zone, typename PeakVector, typename RecordVector>
+size_t collectSortedRecords(const Zone& zone, const PeakVector& peaks, RecordVector& records) {
+    using IndexVector = std::vector<uint32_t,
+        typename std::allocator_traits<typename RecordVector::allocator_type>::template rebind_alloc<uint32_t>>;
+
+    // Every anchor yields at most maxTargetsPerAnchor hashes, so the buffer never
+    // grows; reserving leaves the worst case untouched instead of zero-filling it
+    records.reserve(peaks.size() * zone.maxTargetsPerAnchor);
+
+    BasicPeakFrames<IndexVector> frames{IndexVector(records.get_allocator())};
+    if (bucketPeakFrames(peaks, frames)) {
+        pairPeaksIndexed(zone, peaks, frames, [&](size_t anchorIndex, uint32_t hash) {
+            records.push_back({hash, toFrameIndex(peaks[anchorIndex].time)});
+        });
+    } else {
+        for (size_t i = 0; i < peaks.size(); ++i) {
+            const uint32_t anchorFrame = toFrameIndex(peaks[i].time);
+            pairAnchorInZone(zone, peaks[i], peaks.begin() + i + 1, peaks.end(), [&](uint32_t hash) {
+                records.push_back({hash, anchorFrame});
+            });
+        }
+    }
+
+    std::sort(records.begin(), records.end());
+    records.erase(std::unique(records.begin(), records.end()), records.end());
+    return records.size();
+}
+
+/**
+ * Builds the sorted records of a fingerprint into records, which must be empty
+ */
+template <typename PeakVector, typename RecordVector>
+Result<size_t> buildSortedRecords(const PeakVector& peaks, RecordVector& records, const FingerprintConfig& config) {
+    ScopedTimer timer(MetricStage::FINGERPRINT);
+
+    if (peaks.empty()) {
+        return Result<size_t>::createFailure("Empty peaks vector provided");
+    }
+
+    SORTIFY_LOG_INFO("Creating compact fingerprint with ", peaks.size(), " peaks");
+
+    // The default zone gets the instantiation with constant bounds
+    const size_t numRecords = matchesPolicyTargetZone<DefaultFingerprintPolicy>(config)
+        ? collectSortedRecords(TargetZone(), peaks, records)
+        : collectSortedRecords(RuntimeTargetZone(config), peaks, records);
+    if (numRecords == 0) {
+        return Result<size_t>::createFailure("Failed to create any fingerprint hashes");
+    }
+
+    SORTIFY_LOG_INFO("Created compact fingerprint with ", records.size(), " hashes");
+
+    Metrics::add(MetricCounter::HASHES_EMITTED, records.size());
+    return Result<size_t>::createSuccess(records.size());
+}
+
+} // namespace
+
+Result<CompactFingerprint> createCompactFingerprint(const std::vector<Peak>& peaks, const FingerprintConfig& config) {
+    std::vector<HashRecord> records;
+    auto built = buildSortedRecords(peaks, records, config);
+    if (!built.isSuccess()) {
+        return Result<CompactFingerprint>::createFailure(built.getError());
+    }
+
+    // The buffer was reserved for the worst case; the fingerprint may live long
+    records.shrink_to_fit();
+    CompactFingerprint fingerprint = CompactFingerprint::fromSortedRecords(std::move(records));
+    Metrics::add(MetricCounter::BYTES_ALLOCATED, fingerprint.memoryBytes());
+    return Result<CompactFingerprint>::createSuccess(std::move(fingerprint));
+}
+
+Result<CompactFingerprint> createCompactFingerprint(
+    const std::pmr::vector<Peak>& peaks,
+    std::pmr::memory_resource* scratch,
+    const FingerprintConfig& config
+) {
+    std::pmr::vector<HashRecord> records(scratch);
+    auto built = buildSortedRecords(peaks, records, config);
+    if (!built.isSuccess()) {
+        return Result<CompactFingerprint>::createFailure(built.getError());
+    }
+
+    CompactFingerprint fingerprint = CompactFingerprint::fromSortedRecords(
+        records.data(), records.data() + records.size());
+    Metrics::add(MetricCounter::BYTES_ALLOCATED, fingerprint.memoryBytes());
+    return Result<CompactFingerprint>::createSuccess(std::move(fingerprint));
+}
+
+Result<size_t> createCompactFingerprintInto(
+    const std::vector<Peak>& peaks,
+    CompactFingerprint& fingerprint,
+    const FingerprintConfig& config
+) {
+    std::vector<HashRecord> records = fingerprint.releaseRecords();
+    const size_t previousCapacity = records.capacity();
+    records.clear();
+
+    auto built = buildSortedRecords(peaks, records, config);
+    if (!built.isSuccess()) {
+        records.clear();
+    }
+    Metrics::add(MetricCounter::BYTES_ALLOCATED, (records.capacity() - previousCapacity) * sizeof(HashRecord));
+
+    // Hand the buffer back even on failure so its capacity survives
+    fingerprint = CompactFingerprint::fromSortedRecords(std::move(records));
+    return built;
+}
+
+} // namespace audio
+} // namespace sortify
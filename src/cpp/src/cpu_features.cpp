@@ -0,0 +1,52 @@
+#include "../include/cpu_features.hpp"
+
+namespace sortify {
+namespace audio {
+
+SimdLevel detectSimdLevel() {
+    static const SimdLevel level = [] {
+#if defined(__x86_64__) && defined(__GNUC__)
+        // SSE2 is part of the x86-64 baseline; AVX2 needs a runtime check
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdLevel::AVX2;
+        }
+        return SimdLevel::SSE2;
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+        return SimdLevel::NEON;
+#else
+        return SimdLevel::SCALAR;
+#endif
+    }();
+    return level;
+}
+
+bool isSimdLevelSupported(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SCALAR:
+            return true;
+#if defined(__x86_64__) && defined(__GNUC__)
+        case SimdLevel::SSE2:
+            return true;
+        case SimdLevel::AVX2:
+            return detectSimdLevel() == SimdLevel::AVX2;
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+        case SimdLevel::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SCALAR: return "scalar";
+        case SimdLevel::SSE2:   return "sse2";
+        case SimdLevel::AVX2:   return "avx2";
+        case SimdLevel::NEON:   return "neon";
+    }
+    return "unknown";
+}
+
+} // namespace audio
+} // namespace sortify
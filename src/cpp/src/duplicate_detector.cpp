@@ -0,0 +1,289 @@
+#include "../include/duplicate_detector.hpp"
+#include "../include/fingerprint_config.hpp"
+#include "../include/fingerprint_compare.hpp"
+#include "../include/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+/**
+ * SplitMix64 finalizer: a fast bijective mix with good avalanche
+ */
+uint64_t mix64(uint64_t value) {
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+/**
+ * @class DisjointSets
+ * @brief Union-find with path halving and union by size
+ */
+class DisjointSets {
+public:
+    explicit DisjointSets(size_t count) : parent(count), sizes(count, 1) {
+        std::iota(parent.begin(), parent.end(), 0);
+    }
+
+    size_t find(size_t element) {
+        while (parent[element] != element) {
+            parent[element] = parent[parent[element]];
+            element = parent[element];
+        }
+        return element;
+    }
+
+    void merge(size_t a, size_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return;
+        }
+        if (sizes[a] < sizes[b]) {
+            std::swap(a, b);
+        }
+        parent[b] = a;
+        sizes[a] += sizes[b];
+    }
+
+private:
+    std::vector<size_t> parent;
+    std::vector<size_t> sizes;
+};
+
+} // namespace
+
+MinHashSketch computeMinHashSketch(const CompactFingerprint& fingerprint, size_t numValues) {
+    if (fingerprint.empty() || numValues == 0) {
+        return {};
+    }
+
+    constexpr uint32_t emptyBin = std::numeric_limits<uint32_t>::max();
+    MinHashSketch sketch(numValues, emptyBin);
+    std::vector<char> filled(numValues, 0);
+
+    // Records with the same hash are adjacent, so each distinct hash is mixed once
+    for (size_t i = 0; i < fingerprint.size(); ++i) {
+        const uint32_t hash = fingerprint.begin()[i].hash;
+        if (i > 0 && hash == fingerprint.begin()[i - 1].hash) {
+            continue;
+        }
+        const uint64_t mixed = mix64(hash);
+        const size_t bin = static_cast<size_t>((mixed & 0xffffffffull) * numValues >> 32);
+        const uint32_t value = static_cast<uint32_t>(mixed >> 32);
+        if (!filled[bin] || value < sketch[bin]) {
+            sketch[bin] = value;
+            filled[bin] = 1;
+        }
+    }
+
+    // Densify: an empty bin copies the bin its own probe sequence hits first,
+    // which keeps the agreement probability equal to the Jaccard similarity
+    for (size_t bin = 0; bin < numValues; ++bin) {
+        if (filled[bin]) {
+            continue;
+        }
+        for (uint64_t attempt = 1;; ++attempt) {
+            const uint64_t probe = mix64(static_cast<uint64_t>(bin) << 32 | attempt);
+            const size_t source = static_cast<size_t>((probe & 0xffffffffull) * numValues >> 32);
+            if (filled[source]) {
+                sketch[bin] = sketch[source];
+                break;
+            }
+        }
+    }
+    return sketch;
+}
+
+float estimateJaccard(const MinHashSketch& a, const MinHashSketch& b) {
+    if (a.size() != b.size() || a.empty()) {
+        return 0.0f;
+    }
+    size_t agree = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        agree += a[i] == b[i] ? 1 : 0;
+    }
+    return static_cast<float>(agree) / static_cast<float>(a.size());
+}
+
+DuplicateDetector::DuplicateDetector(DuplicateOptions options) : options(std::move(options)) {}
+
+Result<size_t> DuplicateDetector::addTrack(int songId, const CompactFingerprint& fingerprint) {
+    if (fingerprint.empty()) {
+        return Result<size_t>::createFailure("Empty fingerprint for song " + std::to_string(songId));
+    }
+    return addSketch(songId, computeMinHashSketch(fingerprint, sketchSize()));
+}
+
+Result<size_t> DuplicateDetector::addSketch(int songId, MinHashSketch sketch) {
+    if (sketchSize() == 0) {
+        return Result<size_t>::createFailure("Duplicate options need at least one band and one row");
+    }
+    if (sketch.size() != sketchSize()) {
+        return Result<size_t>::createFailure("Sketch of song " + std::to_string(songId) + " has " +
+                                             std::to_string(sketch.size()) + " values, expected " +
+                                             std::to_string(sketchSize()));
+    }
+    songIds.push_back(songId);
+    sketches.insert(sketches.end(), sketch.begin(), sketch.end());
+    return Result<size_t>::createSuccess(songIds.size());
+}
+
+std::vector<std::pair<int, int>> DuplicateDetector::findCandidatePairs(size_t* skippedBuckets) const {
+    const size_t numTracks = songIds.size();
+    const size_t stride = sketchSize();
+    std::vector<uint64_t> candidates;
+    size_t skipped = 0;
+
+    // One band at a time keeps memory at one (key, track) entry per track
+    std::vector<std::pair<uint64_t, uint32_t>> buckets(numTracks);
+    for (unsigned int band = 0; band < options.numBands; ++band) {
+        const size_t firstRow = static_cast<size_t>(band) * options.rowsPerBand;
+        for (size_t track = 0; track < numTracks; ++track) {
+            const uint32_t* rows = sketches.data() + track * stride + firstRow;
+            buckets[track] = {fnv1aHash(fnvOffsetBasis, rows, options.rowsPerBand * sizeof(uint32_t)),
+                              static_cast<uint32_t>(track)};
+        }
+        std::sort(buckets.begin(), buckets.end());
+
+        for (size_t i = 0; i < numTracks;) {
+            size_t j = i;
+            while (j < numTracks && buckets[j].first == buckets[i].first) ++j;
+            if (j - i > options.maxBucketSize) {
+                skipped++;
+            } else {
+                for (size_t x = i; x < j; ++x) {
+                    for (size_t y = x + 1; y < j; ++y) {
+                        // Bucket entries are sorted by track, so x < y orders the pair
+                        candidates.push_back(static_cast<uint64_t>(buckets[x].second) << 32 | buckets[y].second);
+                    }
+                }
+            }
+            i = j;
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::vector<std::pair<int, int>> pairs;
+    pairs.reserve(candidates.size());
+    for (uint64_t candidate : candidates) {
+        const int a = songIds[candidate >> 32];
+        const int b = songIds[candidate & 0xffffffffull];
+        pairs.emplace_back(std::min(a, b), std::max(a, b));
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    if (skippedBuckets) {
+        *skippedBuckets = skipped;
+    }
+    return pairs;
+}
+
+Result<DuplicateReport> DuplicateDetector::findDuplicates(const FingerprintLookup& lookup) const {
+    if (!lookup) {
+        return Result<DuplicateReport>::createFailure("No fingerprint lookup provided");
+    }
+
+    DuplicateReport report;
+    const std::vector<std::pair<int, int>> candidates = findCandidatePairs(&report.skippedBuckets);
+    report.candidatePairs = candidates.size();
+
+    unsigned int numWorkers = options.numThreads;
+    if (numWorkers == 0) {
+        numWorkers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    constexpr size_t pairsPerChunk = 256;
+    numWorkers = static_cast<unsigned int>(std::max<size_t>(1,
+        std::min<size_t>(numWorkers, (candidates.size() + pairsPerChunk - 1) / pairsPerChunk)));
+
+    std::atomic<size_t> nextChunk{0};
+    std::vector<std::vector<DuplicatePair>> confirmed(numWorkers);
+    CompareOptions compareOptions;
+    compareOptions.maxOffsetFrames = options.maxOffsetFrames;
+    compareOptions.minScore = options.minScore;
+    compareOptions.minConfidence = options.minConfidence;
+
+    auto verify = [&](unsigned int worker) {
+        // Stops each merge as soon as the pair is confirmed or can no longer be
+        FingerprintComparer comparer(compareOptions);
+        for (size_t first = nextChunk.fetch_add(pairsPerChunk); first < candidates.size();
+             first = nextChunk.fetch_add(pairsPerChunk)) {
+            const size_t last = std::min(candidates.size(), first + pairsPerChunk);
+            for (size_t i = first; i < last; ++i) {
+                const CompactFingerprint* a = lookup(candidates[i].first);
+                const CompactFingerprint* b = lookup(candidates[i].second);
+                if (!a || !b) {
+                    continue;
+                }
+                const FingerprintComparison comparison = comparer.compare(*a, *b);
+                if (comparison.isMatch(compareOptions)) {
+                    confirmed[worker].push_back({candidates[i].first, candidates[i].second, comparison.score,
+                                                 comparison.offsetFrames, comparison.confidence});
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int worker = 1; worker < numWorkers; ++worker) {
+        workers.emplace_back(verify, worker);
+    }
+    verify(0);
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    for (auto& pairs : confirmed) {
+        report.pairs.insert(report.pairs.end(), pairs.begin(), pairs.end());
+    }
+    std::sort(report.pairs.begin(), report.pairs.end(), [](const DuplicatePair& x, const DuplicatePair& y) {
+        return x.firstSongId != y.firstSongId ? x.firstSongId < y.firstSongId : x.secondSongId < y.secondSongId;
+    });
+
+    // Group through the track positions; song IDs may be sparse
+    std::unordered_map<int, size_t> positions;
+    positions.reserve(songIds.size());
+    for (size_t track = 0; track < songIds.size(); ++track) {
+        positions.emplace(songIds[track], track);
+    }
+    DisjointSets sets(songIds.size());
+    for (const DuplicatePair& pair : report.pairs) {
+        sets.merge(positions[pair.firstSongId], positions[pair.secondSongId]);
+    }
+
+    std::unordered_map<size_t, size_t> groupOfRoot;
+    for (const DuplicatePair& pair : report.pairs) {
+        for (int songId : {pair.firstSongId, pair.secondSongId}) {
+            const size_t root = sets.find(positions[songId]);
+            auto inserted = groupOfRoot.emplace(root, report.groups.size());
+            if (inserted.second) {
+                report.groups.emplace_back();
+            }
+            report.groups[inserted.first->second].push_back(songId);
+        }
+    }
+    for (auto& group : report.groups) {
+        std::sort(group.begin(), group.end());
+        group.erase(std::unique(group.begin(), group.end()), group.end());
+    }
+    std::sort(report.groups.begin(), report.groups.end());
+
+    SORTIFY_LOG_INFO("Duplicate detection: ", songIds.size(), " tracks, ", report.candidatePairs,
+                     " candidate pairs, ", report.pairs.size(), " verified, ", report.groups.size(), " groups");
+    return Result<DuplicateReport>::createSuccess(std::move(report));
+}
+
+} // namespace audio
+} // namespace sortify
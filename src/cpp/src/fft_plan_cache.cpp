@@ -0,0 +1,170 @@
+#include "../include/fft_plan_cache.hpp"
+#include "../include/logger.hpp"
+#include <algorithm>
+
+namespace sortify {
+namespace audio {
+
+// Initialize static members of FFTPlanCache
+std::mutex FFTPlanCache::cacheMutex;
+FFTPlanRigor FFTPlanCache::planRigor = FFTPlanRigor::ESTIMATE;
+std::unordered_map<unsigned int, FFTPlanCache::CachedPlan> FFTPlanCache::realPlans;
+std::unordered_map<uint64_t, FFTPlanCache::CachedPlan> FFTPlanCache::batchedRealPlans;
+
+unsigned int FFTPlanCache::plannerFlags() {
+    // FFTW_ESTIMATE quickly creates a reasonable but non-optimal plan
+    // FFTW_MEASURE benchmarks candidate algorithms; imported wisdom makes this instant
+    return planRigor == FFTPlanRigor::MEASURE ? FFTW_MEASURE : FFTW_ESTIMATE;
+}
+
+fftwf_plan FFTPlanCache::getRealPlan(unsigned int size, std::string& errorMessage) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    auto it = realPlans.find(size);
+    if (it != realPlans.end()) {
+        return it->second.plan;
+    }
+
+    // A real transform of N samples produces N/2+1 non-redundant bins
+    float* in = fftwf_alloc_real(size);
+    fftwf_complex* out = fftwf_alloc_complex(size / 2 + 1);
+    if (!in || !out) {
+        if (in) fftwf_free(in);
+        if (out) fftwf_free(out);
+        errorMessage = "Memory allocation failed for FFT plan";
+        return nullptr;
+    }
+
+    fftwf_plan plan = fftwf_plan_dft_r2c_1d(static_cast<int>(size), in, out, plannerFlags());
+    if (!plan) {
+        fftwf_free(in);
+        fftwf_free(out);
+        errorMessage = "Failed to create real FFT plan for size " + std::to_string(size);
+        return nullptr;
+    }
+
+    realPlans[size] = {plan, in, out};
+    SORTIFY_LOG_DEBUG("Created real FFT plan for size ", size);
+    return plan;
+}
+
+fftwf_plan FFTPlanCache::getBatchedRealPlan(unsigned int size, unsigned int batchSize, std::string& errorMessage) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    const uint64_t key = (static_cast<uint64_t>(size) << 32) | batchSize;
+    auto it = batchedRealPlans.find(key);
+    if (it != batchedRealPlans.end()) {
+        return it->second.plan;
+    }
+
+    const unsigned int numBins = size / 2 + 1;
+    float* in = fftwf_alloc_real(static_cast<size_t>(size) * batchSize);
+    fftwf_complex* out = fftwf_alloc_complex(static_cast<size_t>(numBins) * batchSize);
+    if (!in || !out) {
+        if (in) fftwf_free(in);
+        if (out) fftwf_free(out);
+        errorMessage = "Memory allocation failed for FFT plan";
+        return nullptr;
+    }
+
+    // One-dimensional transforms over frames packed back to back
+    const int length = static_cast<int>(size);
+    fftwf_plan plan = fftwf_plan_many_dft_r2c(1, &length, static_cast<int>(batchSize),
+                                              in, nullptr, 1, length,
+                                              out, nullptr, 1, static_cast<int>(numBins),
+                                              plannerFlags());
+    if (!plan) {
+        fftwf_free(in);
+        fftwf_free(out);
+        errorMessage = "Failed to create batched real FFT plan for size " + std::to_string(size) +
+                       " x " + std::to_string(batchSize);
+        return nullptr;
+    }
+
+    batchedRealPlans[key] = {plan, in, out};
+    SORTIFY_LOG_DEBUG("Created batched real FFT plan for size ", size, " x ", batchSize);
+    return plan;
+}
+
+void FFTPlanCache::setPlanRigor(FFTPlanRigor rigor) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    planRigor = rigor;
+}
+
+bool FFTPlanCache::importWisdom(const std::string& filePath) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (fftwf_import_wisdom_from_filename(filePath.c_str()) == 0) {
+        SORTIFY_LOG_WARNING("Could not import FFTW wisdom from ", filePath);
+        return false;
+    }
+    return true;
+}
+
+bool FFTPlanCache::exportWisdom(const std::string& filePath) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (fftwf_export_wisdom_to_filename(filePath.c_str()) == 0) {
+        SORTIFY_LOG_WARNING("Could not export FFTW wisdom to ", filePath);
+        return false;
+    }
+    return true;
+}
+
+void FFTPlanCache::clear() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (auto& entry : realPlans) {
+        fftwf_destroy_plan(entry.second.plan);
+        fftwf_free(entry.second.in);
+        fftwf_free(entry.second.out);
+    }
+    realPlans.clear();
+    for (auto& entry : batchedRealPlans) {
+        fftwf_destroy_plan(entry.second.plan);
+        fftwf_free(entry.second.in);
+        fftwf_free(entry.second.out);
+    }
+    batchedRealPlans.clear();
+}
+
+RealFFTWorkspace::RealFFTWorkspace(unsigned int size) : transformSize(size) {
+    plan = FFTPlanCache::getRealPlan(size, errorMessage);
+    if (!plan) {
+        return;
+    }
+
+    in = fftwf_alloc_real(size);
+    out = fftwf_alloc_complex(size / 2 + 1);
+    if (!in || !out) {
+        errorMessage = "Memory allocation failed for FFT";
+    }
+}
+
+RealFFTWorkspace::~RealFFTWorkspace() {
+    if (in) fftwf_free(in);
+    if (out) fftwf_free(out);
+}
+
+BatchedRealFFTWorkspace::BatchedRealFFTWorkspace(unsigned int size, unsigned int batchSize)
+    : transformSize(size), frames(batchSize) {
+    plan = FFTPlanCache::getBatchedRealPlan(size, batchSize, errorMessage);
+    if (!plan) {
+        return;
+    }
+
+    in = fftwf_alloc_real(static_cast<size_t>(size) * batchSize);
+    out = fftwf_alloc_complex(static_cast<size_t>(numOutputBins()) * batchSize);
+    if (!in || !out) {
+        errorMessage = "Memory allocation failed for FFT";
+        return;
+    }
+
+    // A final partial batch transforms whatever the unused slots hold
+    std::fill(in, in + static_cast<size_t>(size) * batchSize, 0.0f);
+}
+
+BatchedRealFFTWorkspace::~BatchedRealFFTWorkspace() {
+    if (in) fftwf_free(in);
+    if (out) fftwf_free(out);
+}
+
+} // namespace audio
+} // namespace sortify
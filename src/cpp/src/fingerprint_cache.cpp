@@ -0,0 +1,316 @@
+#include "../include/fingerprint_cache.hpp"
+#include "../include/fingerprint_config.hpp"
+#include "../include/logger.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+constexpr char cacheFileMagic[8] = {'S', 'R', 'T', 'F', 'C', 'A', 'C', '\0'};
+constexpr uint32_t cacheFileVersion = 1;
+
+/// Flushes an open file or directory to stable storage
+bool syncDescriptor(int fd) {
+#ifdef __APPLE__
+    // fsync on macOS leaves the data in the drive's cache
+    return ::fcntl(fd, F_FULLFSYNC) == 0 || ::fsync(fd) == 0;
+#else
+    return ::fsync(fd) == 0;
+#endif
+}
+
+/// Writes all of data to fd, retrying short and interrupted writes
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t count = ::write(fd, data, size);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+template <typename T>
+void appendValue(std::vector<char>& out, const T& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+ * @class CacheReader
+ * @brief Bounds-checked cursor over a loaded cache file
+ */
+class CacheReader {
+public:
+    CacheReader(const char* data, size_t size) : data(data), remaining(size) {}
+
+    template <typename T>
+    bool read(T& value) {
+        return readBytes(&value, sizeof(T));
+    }
+
+    bool readBytes(void* output, size_t size) {
+        if (size > remaining) {
+            return false;
+        }
+        std::memcpy(output, data, size);
+        data += size;
+        remaining -= size;
+        return true;
+    }
+
+    size_t bytesLeft() const {
+        return remaining;
+    }
+
+private:
+    const char* data;
+    size_t remaining;
+};
+
+/**
+ * Hashes up to size bytes at offset, returning false on a read error
+ */
+bool hashFileRange(int fd, uint64_t offset, size_t size, std::vector<char>& buffer, uint64_t& hash) {
+    buffer.resize(size);
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t count = ::pread(fd, buffer.data() + done, size - done, static_cast<off_t>(offset + done));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(count);
+    }
+    hash = fnv1aHash(hash, buffer.data(), size);
+    return true;
+}
+
+} // namespace
+
+Result<FileIdentity> computeFileIdentity(const std::string& filePath, size_t sampleBytes) {
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return Result<FileIdentity>::createFailure("Could not open file: " + filePath + " (" + std::strerror(errno) + ")");
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        return Result<FileIdentity>::createFailure("Could not stat file: " + filePath);
+    }
+
+    FileIdentity identity;
+    identity.size = static_cast<uint64_t>(info.st_size);
+#ifdef __APPLE__
+    const struct timespec& mtime = info.st_mtimespec;
+#else
+    const struct timespec& mtime = info.st_mtim;
+#endif
+    identity.mtimeNs = static_cast<int64_t>(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+
+    // Tags are usually rewritten at the start or the end, so hash both ends
+    const size_t head = static_cast<size_t>(std::min<uint64_t>(identity.size, sampleBytes));
+    const size_t tail = static_cast<size_t>(std::min<uint64_t>(identity.size - head, sampleBytes));
+    std::vector<char> buffer;
+    uint64_t hash = fnv1aHash(fnvOffsetBasis, &identity.size, sizeof(identity.size));
+    const bool ok = hashFileRange(fd, 0, head, buffer, hash) &&
+                    hashFileRange(fd, identity.size - tail, tail, buffer, hash);
+    ::close(fd);
+
+    if (!ok) {
+        return Result<FileIdentity>::createFailure("Failed to read file: " + filePath);
+    }
+    identity.contentHash = hash;
+    return Result<FileIdentity>::createSuccess(identity);
+}
+
+FingerprintCache::FingerprintCache(std::string cachePath) : cachePath(std::move(cachePath)) {}
+
+Result<size_t> FingerprintCache::load() {
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file) {
+        return Result<size_t>::createSuccess(0);
+    }
+    std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    CacheReader reader(contents.data(), contents.size());
+    char magic[8];
+    uint32_t version = 0;
+    uint64_t entryCount = 0;
+    if (!reader.readBytes(magic, sizeof(magic)) || std::memcmp(magic, cacheFileMagic, sizeof(magic)) != 0 ||
+        !reader.read(version) || !reader.read(entryCount)) {
+        return Result<size_t>::createFailure("Not a fingerprint cache file: " + cachePath);
+    }
+    if (version != cacheFileVersion) {
+        SORTIFY_LOG_INFO("Ignoring fingerprint cache ", cachePath, " with version ", version);
+        return Result<size_t>::createSuccess(0);
+    }
+
+    std::unordered_map<std::string, Entry> loaded;
+    for (uint64_t e = 0; e < entryCount; ++e) {
+        uint32_t pathLength = 0;
+        uint64_t recordCount = 0;
+        Entry entry;
+        if (!reader.read(pathLength) || pathLength > reader.bytesLeft()) {
+            return Result<size_t>::createFailure("Truncated fingerprint cache file: " + cachePath);
+        }
+        std::string path(pathLength, '\0');
+        if (!reader.readBytes(&path[0], pathLength) ||
+            !reader.read(entry.identity.size) || !reader.read(entry.identity.mtimeNs) ||
+            !reader.read(entry.identity.contentHash) || !reader.read(entry.paramHash) ||
+            !reader.read(recordCount) || recordCount > reader.bytesLeft() / sizeof(HashRecord)) {
+            return Result<size_t>::createFailure("Truncated fingerprint cache file: " + cachePath);
+        }
+        entry.records.resize(static_cast<size_t>(recordCount));
+        reader.readBytes(entry.records.data(), entry.records.size() * sizeof(HashRecord));
+        loaded[std::move(path)] = std::move(entry);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries = std::move(loaded);
+    SORTIFY_LOG_DEBUG("Loaded ", entries.size(), " cached fingerprints from ", cachePath);
+    return Result<size_t>::createSuccess(entries.size());
+}
+
+Result<size_t> FingerprintCache::save() const {
+    if (cachePath.empty()) {
+        return Result<size_t>::createFailure("Fingerprint cache has no file path");
+    }
+
+    std::vector<char> contents;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        contents.insert(contents.end(), cacheFileMagic, cacheFileMagic + sizeof(cacheFileMagic));
+        appendValue(contents, cacheFileVersion);
+        appendValue(contents, static_cast<uint64_t>(entries.size()));
+
+        for (const auto& [path, entry] : entries) {
+            appendValue(contents, static_cast<uint32_t>(path.size()));
+            contents.insert(contents.end(), path.begin(), path.end());
+            appendValue(contents, entry.identity.size);
+            appendValue(contents, entry.identity.mtimeNs);
+            appendValue(contents, entry.identity.contentHash);
+            appendValue(contents, entry.paramHash);
+            appendValue(contents, static_cast<uint64_t>(entry.records.size()));
+            const char* records = reinterpret_cast<const char*>(entry.records.data());
+            contents.insert(contents.end(), records, records + entry.records.size() * sizeof(HashRecord));
+        }
+    }
+
+    // Write a uniquely named file beside the destination, flush it and rename
+    // it over the old cache, so concurrent saves never share a temporary file
+    // and a crash leaves either the old or the new cache
+    std::string tempPath = cachePath + ".XXXXXX";
+    const int fd = ::mkstemp(&tempPath[0]);
+    if (fd < 0) {
+        return Result<size_t>::createFailure("Failed to create cache file: " + tempPath + " (" +
+                                             std::strerror(errno) + ")");
+    }
+    // mkstemp creates the file private to the owner
+    ::fchmod(fd, 0644);
+    const bool written = writeAll(fd, contents.data(), contents.size()) && syncDescriptor(fd);
+    if (::close(fd) != 0 || !written) {
+        std::remove(tempPath.c_str());
+        return Result<size_t>::createFailure("Failed to write cache file: " + tempPath);
+    }
+
+    if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return Result<size_t>::createFailure("Failed to move cache file into place: " + cachePath);
+    }
+
+    // Persist the rename itself
+    const size_t slash = cachePath.find_last_of('/');
+    const std::string directoryPath = slash == std::string::npos ? "." : (slash == 0 ? "/" : cachePath.substr(0, slash));
+    const int directory = ::open(directoryPath.c_str(), O_RDONLY);
+    if (directory < 0 || !syncDescriptor(directory)) {
+        SORTIFY_LOG_WARNING("Could not flush directory ", directoryPath, " after writing ", cachePath);
+    }
+    if (directory >= 0) {
+        ::close(directory);
+    }
+
+    return Result<size_t>::createSuccess(contents.size());
+}
+
+bool FingerprintCache::lookup(
+    const std::string& filePath,
+    const FileIdentity& identity,
+    uint64_t paramHash,
+    CompactFingerprint& fingerprint
+) const {
+    std::vector<HashRecord> records;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(filePath);
+        if (it == entries.end() || !(it->second.identity == identity) || it->second.paramHash != paramHash) {
+            missCount++;
+            return false;
+        }
+        records = it->second.records;
+    }
+
+    hitCount++;
+    // Entries are stored sorted, so the copy needs no re-sort
+    fingerprint = CompactFingerprint::fromSortedRecords(std::move(records));
+    return true;
+}
+
+void FingerprintCache::store(
+    const std::string& filePath,
+    const FileIdentity& identity,
+    uint64_t paramHash,
+    const CompactFingerprint& fingerprint
+) {
+    Entry entry;
+    entry.identity = identity;
+    entry.paramHash = paramHash;
+    entry.records = fingerprint.records();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[filePath] = std::move(entry);
+}
+
+size_t FingerprintCache::retainOnly(const std::vector<std::string>& paths) {
+    const std::unordered_set<std::string> keep(paths.begin(), paths.end());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t removed = 0;
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (keep.count(it->first) == 0) {
+            it = entries.erase(it);
+            removed++;
+        } else {
+            ++it;
+        }
+    }
+    return removed;
+}
+
+size_t FingerprintCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+} // namespace audio
+} // namespace sortify
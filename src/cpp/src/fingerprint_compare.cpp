@@ -0,0 +1,110 @@
+#include "../include/fingerprint_compare.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace sortify {
+namespace audio {
+
+FingerprintComparer::FingerprintComparer(CompareOptions options) {
+    setOptions(options);
+}
+
+void FingerprintComparer::setOptions(const CompareOptions& newOptions) {
+    options = newOptions;
+    const size_t numBins = 2 * static_cast<size_t>(options.maxOffsetFrames) + 1;
+    if (histogram.size() < numBins) {
+        histogram.assign(numBins, 0);
+        touched.reserve(numBins);
+    }
+}
+
+FingerprintComparison FingerprintComparer::compare(const CompactFingerprint& first, const CompactFingerprint& second) {
+    FingerprintComparison result;
+    const size_t smaller = std::min(first.size(), second.size());
+    if (smaller == 0) {
+        return result;
+    }
+
+    // The score the thresholds require; 0 disables early exits
+    const size_t confidenceScore = static_cast<size_t>(std::ceil(options.minConfidence * static_cast<float>(smaller)));
+    const size_t target = std::max<size_t>(options.minScore, confidenceScore);
+
+    const int64_t maxOffset = options.maxOffsetFrames;
+    uint32_t* bins = histogram.data() + maxOffset;  // bins[offset] for offset in [-maxOffset, maxOffset]
+    touched.clear();
+    uint32_t best = 0;
+    int64_t bestOffset = 0;
+
+    const HashRecord* a = first.begin();
+    const HashRecord* b = second.begin();
+    while (a != first.end() && b != second.end()) {
+        if (target > 0) {
+            const size_t remaining = std::min<size_t>(first.end() - a, second.end() - b);
+            if (best >= target || best + remaining < target) {
+                result.complete = false;
+                break;
+            }
+        }
+
+        if (a->hash < b->hash) {
+            ++a;
+            continue;
+        }
+        if (b->hash < a->hash) {
+            ++b;
+            continue;
+        }
+
+        const uint32_t hash = a->hash;
+        const HashRecord* aEnd = a + 1;
+        while (aEnd != first.end() && aEnd->hash == hash) ++aEnd;
+        const HashRecord* bEnd = b + 1;
+        while (bEnd != second.end() && bEnd->hash == hash) ++bEnd;
+
+        if (static_cast<size_t>(aEnd - a) * static_cast<size_t>(bEnd - b) <= options.maxVotesPerHash) {
+            for (const HashRecord* x = a; x != aEnd; ++x) {
+                for (const HashRecord* y = b; y != bEnd; ++y) {
+                    const int64_t offset = static_cast<int64_t>(y->anchorFrame) - static_cast<int64_t>(x->anchorFrame);
+                    if (offset < -maxOffset || offset > maxOffset) {
+                        continue;
+                    }
+                    uint32_t& bin = bins[offset];
+                    if (bin == 0) {
+                        touched.push_back(static_cast<uint32_t>(offset + maxOffset));
+                    }
+                    bin++;
+                    result.matches++;
+                    // Ties go to the smaller offset, independent of merge order
+                    if (bin > best || (bin == best && offset < bestOffset)) {
+                        best = bin;
+                        bestOffset = offset;
+                    }
+                }
+            }
+        }
+        a = aEnd;
+        b = bEnd;
+    }
+
+    for (uint32_t index : touched) {
+        histogram[index] = 0;
+    }
+
+    result.score = best;
+    result.offsetFrames = bestOffset;
+    result.confidence = static_cast<float>(best) / static_cast<float>(smaller);
+    return result;
+}
+
+FingerprintComparison compareFingerprints(
+    const CompactFingerprint& first,
+    const CompactFingerprint& second,
+    const CompareOptions& options
+) {
+    thread_local FingerprintComparer comparer;
+    comparer.setOptions(options);
+    return comparer.compare(first, second);
+}
+
+} // namespace audio
+} // namespace sortify
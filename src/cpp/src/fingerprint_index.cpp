@@ -0,0 +1,214 @@
+#include "../include/fingerprint_index.hpp"
+#include "../include/logger.hpp"
+#include "../include/metrics.hpp"
+#include <algorithm>
+
+namespace sortify {
+namespace audio {
+
+std::vector<MatchCandidate> MatchAccumulator::rank(size_t sampleHashes, size_t maxResults, unsigned int minScore) {
+    std::vector<MatchCandidate> candidates;
+    if (votes.empty() || maxResults == 0) {
+        return candidates;
+    }
+
+    // Equal keys are the same (song, offset) bin of the histogram
+    std::sort(votes.begin(), votes.end());
+
+    size_t i = 0;
+    while (i < votes.size()) {
+        const uint32_t song = static_cast<uint32_t>(votes[i] >> 32);
+        MatchCandidate candidate = {static_cast<int32_t>(song), 0, 0, 0, 0.0f};
+
+        // Walk all offset bins of this song and keep the tallest
+        while (i < votes.size() && static_cast<uint32_t>(votes[i] >> 32) == song) {
+            const uint64_t key = votes[i];
+            size_t binEnd = i;
+            while (binEnd < votes.size() && votes[binEnd] == key) {
+                ++binEnd;
+            }
+
+            const unsigned int count = static_cast<unsigned int>(binEnd - i);
+            if (count > candidate.score) {
+                candidate.score = count;
+                candidate.offsetFrames = static_cast<int64_t>(key & 0xFFFFFFFFu) - offsetBias;
+            }
+            candidate.matches += count;
+            i = binEnd;
+        }
+
+        if (candidate.score >= minScore) {
+            candidate.confidence = sampleHashes > 0
+                ? static_cast<float>(candidate.score) / static_cast<float>(sampleHashes)
+                : 0.0f;
+            candidates.push_back(candidate);
+        }
+    }
+
+    // Highest score first; ties go to the lower song ID so results are deterministic
+    auto better = [](const MatchCandidate& a, const MatchCandidate& b) {
+        return a.score > b.score || (a.score == b.score && a.songId < b.songId);
+    };
+    if (candidates.size() > maxResults) {
+        std::partial_sort(candidates.begin(), candidates.begin() + maxResults, candidates.end(), better);
+        candidates.resize(maxResults);
+    } else {
+        std::sort(candidates.begin(), candidates.end(), better);
+    }
+    return candidates;
+}
+
+Result<size_t> FingerprintIndex::addTrack(int songId, const CompactFingerprint& fingerprint) {
+    if (fingerprint.empty()) {
+        return Result<size_t>::createFailure("Empty fingerprint provided for song " + std::to_string(songId));
+    }
+    if (!songIds.insert(songId).second) {
+        return Result<size_t>::createFailure("Song " + std::to_string(songId) + " is already indexed");
+    }
+
+    pending.reserve(pending.size() + fingerprint.size());
+    for (const HashRecord& record : fingerprint) {
+        pending.push_back({record.hash, {static_cast<int32_t>(songId), record.anchorFrame}});
+    }
+    return Result<size_t>::createSuccess(fingerprint.size());
+}
+
+void FingerprintIndex::addPostings(uint32_t hash, const Posting* list, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        songIds.insert(list[i].songId);
+        pending.push_back({hash, list[i]});
+    }
+}
+
+void FingerprintIndex::build() {
+    if (pending.empty()) {
+        return;
+    }
+
+    auto entryLess = [](const PendingEntry& a, const PendingEntry& b) {
+        if (a.hash != b.hash) return a.hash < b.hash;
+        if (a.posting.songId != b.posting.songId) return a.posting.songId < b.posting.songId;
+        return a.posting.anchorFrame < b.posting.anchorFrame;
+    };
+    std::sort(pending.begin(), pending.end(), entryLess);
+
+    std::vector<uint32_t> mergedHashes;
+    std::vector<uint64_t> mergedOffsets;
+    std::vector<Posting> mergedPostings;
+    mergedPostings.reserve(postings.size() + pending.size());
+    mergedHashes.reserve(hashes.size() + pending.size() / 4);
+    mergedOffsets.reserve(mergedHashes.capacity() + 1);
+
+    auto append = [&](uint32_t hash, const Posting& posting) {
+        if (mergedHashes.empty() || mergedHashes.back() != hash) {
+            mergedHashes.push_back(hash);
+            mergedOffsets.push_back(mergedPostings.size());
+        }
+        mergedPostings.push_back(posting);
+    };
+
+    // Merge the existing rows with the sorted staged entries
+    size_t row = 0;
+    size_t next = 0;
+    while (row < hashes.size() || next < pending.size()) {
+        if (next == pending.size() || (row < hashes.size() && hashes[row] <= pending[next].hash)) {
+            const uint32_t hash = hashes[row];
+            // Interleave existing and staged postings of this hash in (song, frame) order
+            size_t p = offsets[row];
+            const size_t rowEnd = offsets[row + 1];
+            while (p < rowEnd) {
+                if (next < pending.size() && pending[next].hash == hash &&
+                    entryLess(pending[next], PendingEntry{hash, postings[p]})) {
+                    append(hash, pending[next++].posting);
+                } else {
+                    append(hash, postings[p++]);
+                }
+            }
+            while (next < pending.size() && pending[next].hash == hash) {
+                append(hash, pending[next++].posting);
+            }
+            ++row;
+        } else {
+            append(pending[next].hash, pending[next].posting);
+            ++next;
+        }
+    }
+    mergedOffsets.push_back(mergedPostings.size());
+
+    hashes = std::move(mergedHashes);
+    offsets = std::move(mergedOffsets);
+    postings = std::move(mergedPostings);
+    hashes.shrink_to_fit();
+    offsets.shrink_to_fit();
+    pending.clear();
+    pending.shrink_to_fit();
+    // Every registered song had staged postings, so all of them are built now
+    builtTracks = songIds.size();
+
+    bloom = BlockedBloomFilter(hashes.size(), bloomBitsPerKey);
+    if (!bloom.empty()) {
+        for (uint32_t hash : hashes) {
+            bloom.insert(hash);
+        }
+    }
+
+    SORTIFY_LOG_INFO("Built fingerprint index with ", songIds.size(), " tracks, ", hashes.size(), " hashes and ",
+                     postings.size(), " postings");
+}
+
+const Posting* FingerprintIndex::findPostings(uint32_t hash, size_t& count) const {
+    // One cache line settles most absent hashes without touching the hash array
+    if (!bloom.mayContain(hash)) {
+        count = 0;
+        return nullptr;
+    }
+    auto it = std::lower_bound(hashes.begin(), hashes.end(), hash);
+    if (it == hashes.end() || *it != hash) {
+        count = 0;
+        return nullptr;
+    }
+    const size_t row = static_cast<size_t>(it - hashes.begin());
+    count = static_cast<size_t>(offsets[row + 1] - offsets[row]);
+    return postings.data() + offsets[row];
+}
+
+Result<std::vector<MatchCandidate>> FingerprintIndex::query(
+    const CompactFingerprint& sample,
+    size_t maxResults,
+    unsigned int minScore
+) const {
+    ScopedTimer timer(MetricStage::INDEX_QUERY);
+    if (sample.empty()) {
+        return Result<std::vector<MatchCandidate>>::createFailure("Empty sample fingerprint provided");
+    }
+    if (hashes.empty()) {
+        return Result<std::vector<MatchCandidate>>::createFailure("Fingerprint index is empty; call build() after adding tracks");
+    }
+
+    MatchAccumulator accumulator;
+    const HashRecord* record = sample.begin();
+    while (record != sample.end()) {
+        // Sample records are sorted by hash, so each posting list is looked up once
+        const uint32_t hash = record->hash;
+        const HashRecord* runEnd = record;
+        while (runEnd != sample.end() && runEnd->hash == hash) {
+            ++runEnd;
+        }
+
+        size_t count = 0;
+        const Posting* list = findPostings(hash, count);
+        for (const HashRecord* r = record; r != runEnd; ++r) {
+            for (size_t p = 0; p < count; ++p) {
+                accumulator.addVote(list[p].songId, list[p].anchorFrame, r->anchorFrame);
+            }
+        }
+        record = runEnd;
+    }
+
+    Metrics::add(MetricCounter::QUERIES, 1);
+    return Result<std::vector<MatchCandidate>>::createSuccess(
+        accumulator.rank(sample.size(), maxResults, minScore));
+}
+
+} // namespace audio
+} // namespace sortify
@@ -0,0 +1,207 @@
+#include "../include/fingerprint_stream.hpp"
+#include "../include/logger.hpp"
+#include "../include/metrics.hpp"
+#include "../include/audio_quality.hpp"
+#include <algorithm>
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+FingerprintConfig spectrogramConfig(unsigned int sampleRate, unsigned int windowSize, float overlap,
+                                    float minFreq, float maxFreq) {
+    FingerprintConfig config;
+    config.sampleRate = sampleRate;
+    config.windowSize = windowSize;
+    config.overlap = overlap;
+    config.minFreq = minFreq;
+    config.maxFreq = maxFreq;
+    return config;
+}
+
+} // namespace
+
+FingerprintStream::FingerprintStream(
+    int songId,
+    unsigned int sampleRate,
+    unsigned int windowSize,
+    float overlap,
+    float minFreq,
+    float maxFreq
+) : FingerprintStream(songId, spectrogramConfig(sampleRate, windowSize, overlap, minFreq, maxFreq)) {}
+
+FingerprintStream::FingerprintStream(int songId, const FingerprintConfig& config)
+    : songId(songId),
+      sampleRate(config.sampleRate),
+      zone(config),
+      defaultZone(matchesPolicyTargetZone<DefaultFingerprintPolicy>(config)) {
+    const unsigned int windowSize = config.windowSize;
+    if (songId < 0) {
+        errorMessage = "Invalid song ID: " + std::to_string(songId);
+        return;
+    }
+
+    auto layoutResult = computeSpectrogramLayout(sampleRate, windowSize, config.overlap, config.minFreq, config.maxFreq);
+    if (!layoutResult.isSuccess()) {
+        errorMessage = layoutResult.getError();
+        return;
+    }
+    layout = std::move(layoutResult).take();
+
+    auto bandsResult = computeFrequencyBands(layout.numBins, config);
+    if (!bandsResult.isSuccess()) {
+        errorMessage = bandsResult.getError();
+        return;
+    }
+    bands = std::move(bandsResult).take();
+
+    workspace = std::make_unique<RealFFTWorkspace>(windowSize);
+    if (!workspace->isValid()) {
+        errorMessage = "FFT error: " + workspace->getError();
+        return;
+    }
+
+    hammingWindow = createHammingWindow(windowSize);
+    ring.assign(windowSize, 0.0f);
+    frameMagnitudes.assign(layout.numBins, 0.0f);
+    nextFrameEnd = windowSize;
+}
+
+void FingerprintStream::setQualityTrace(QualityTrace* trace) {
+    quality = isValid() ? trace : nullptr;
+    if (quality) {
+        quality->sampleRate = sampleRate;
+        quality->windowSize = layout.windowSize;
+        quality->stepSize = layout.stepSize;
+    }
+}
+
+Result<size_t> FingerprintStream::pushSamples(
+    const AudioSample* samples,
+    size_t count,
+    std::vector<FingerprintHash>& output
+) {
+    if (!isValid()) {
+        return Result<size_t>::createFailure(errorMessage);
+    }
+
+    if (finished) {
+        return Result<size_t>::createFailure("Cannot push samples after finish()");
+    }
+
+    const size_t outputSizeBefore = output.size();
+    const size_t windowSize = layout.windowSize;
+    size_t consumed = 0;
+
+    while (consumed < count) {
+        // Copy samples into the ring until the next window is complete
+        size_t take = std::min(nextFrameEnd - samplesReceived, count - consumed);
+        while (take > 0) {
+            const size_t chunk = std::min(take, windowSize - ringPos);
+            std::copy(samples + consumed, samples + consumed + chunk, ring.begin() + ringPos);
+            ringPos = (ringPos + chunk) % windowSize;
+            samplesReceived += chunk;
+            consumed += chunk;
+            take -= chunk;
+        }
+
+        if (samplesReceived == nextFrameEnd) {
+            processFrame();
+            nextFrameEnd += layout.stepSize;
+        }
+    }
+
+    const size_t emitted = emitCompletedAnchors(output, false);
+    Metrics::add(MetricCounter::HASHES_EMITTED, emitted);
+
+    return Result<size_t>::createSuccess(output.size() - outputSizeBefore);
+}
+
+Result<size_t> FingerprintStream::finish(std::vector<FingerprintHash>& output) {
+    if (!isValid()) {
+        return Result<size_t>::createFailure(errorMessage);
+    }
+
+    if (finished) {
+        return Result<size_t>::createFailure("Stream already finished");
+    }
+
+    finished = true;
+    const size_t emitted = emitCompletedAnchors(output, true);
+
+    SORTIFY_LOG_INFO("Fingerprint stream finished: ", nextFrame, " windows");
+
+    // Stages are interleaved per window here, so only the totals are recorded
+    Metrics::add(MetricCounter::HASHES_EMITTED, emitted);
+    Metrics::add(MetricCounter::SAMPLES_ANALYZED, samplesReceived);
+    Metrics::add(MetricCounter::AUDIO_MICROSECONDS,
+                 static_cast<uint64_t>(samplesReceived) * 1000000 / sampleRate);
+    Metrics::add(MetricCounter::WINDOWS_PROCESSED, nextFrame);
+    Metrics::add(MetricCounter::PEAKS_EXTRACTED, totalPeaks);
+
+    return Result<size_t>::createSuccess(emitted);
+}
+
+void FingerprintStream::processFrame() {
+    // The ring is full whenever a window completes; its oldest sample is at
+    // ringPos, so the window is [ringPos, end) followed by [0, ringPos)
+    const unsigned int windowSize = layout.windowSize;
+    const unsigned int wrapped = windowSize - static_cast<unsigned int>(ringPos);
+    float* fftInput = workspace->input();
+
+    // Apply Hamming window while copying the segment into the FFT input
+    for (unsigned int i = 0; i < wrapped; ++i) {
+        fftInput[i] = ring[ringPos + i] * hammingWindow[i];
+    }
+    for (unsigned int i = wrapped; i < windowSize; ++i) {
+        fftInput[i] = ring[i - wrapped] * hammingWindow[i];
+    }
+
+    workspace->execute();
+    extractMagnitudes(workspace->output(), layout, frameMagnitudes.data());
+    if (quality) {
+        // The samples this window adds end just before ringPos
+        const size_t added = nextFrame == 0 ? windowSize : layout.stepSize;
+        const size_t start = (ringPos + windowSize - added) % windowSize;
+        const size_t first = std::min<size_t>(added, windowSize - start);
+        quality->frames.push_back(summarizeQualityFrame(ring.data() + start, first, ring.data(), added - first,
+                                                        workspace->output(), windowSize, quality->options));
+    }
+
+    framePeaks.clear();
+    pickFramePeaks(SpectrogramFrame(frameMagnitudes.data(), layout.numBins), bands,
+                   static_cast<float>(nextFrame), framePeaks);
+    pendingPeaks.insert(pendingPeaks.end(), framePeaks.begin(), framePeaks.end());
+    totalPeaks += framePeaks.size();
+
+    nextFrame++;
+}
+
+size_t FingerprintStream::emitCompletedAnchors(std::vector<FingerprintHash>& output, bool flushAll) {
+    size_t emitted = 0;
+
+    // Anchors are completed in time order; once an anchor is done it can never
+    // be a target again (targets always follow their anchor), so it is dropped
+    while (!pendingPeaks.empty()) {
+        const Peak anchor = pendingPeaks.front();
+
+        // Every window that could hold a target must have been processed
+        if (!flushAll && anchor.time + zone.timeRange >= static_cast<float>(nextFrame)) {
+            break;
+        }
+
+        auto emit = [&](uint32_t hash) {
+            output.push_back({hash, anchor.time, songId});
+        };
+        emitted += defaultZone
+            ? pairAnchorInZone(TargetZone(), anchor, pendingPeaks.begin() + 1, pendingPeaks.end(), emit)
+            : pairAnchorInZone(zone, anchor, pendingPeaks.begin() + 1, pendingPeaks.end(), emit);
+        pendingPeaks.pop_front();
+    }
+
+    return emitted;
+}
+
+} // namespace audio
+} // namespace sortify
@@ -0,0 +1,386 @@
+#include "../include/index_file.hpp"
+#include "../include/logger.hpp"
+#include "../include/metrics.hpp"
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+constexpr char indexFileMagic[8] = {'S', 'R', 'T', 'F', 'I', 'D', 'X', '\0'};
+constexpr uint32_t byteOrderMark = 0x01020304;
+
+size_t alignTo8(size_t offset) {
+    return (offset + 7) & ~size_t(7);
+}
+
+/// Index files written before the Bloom filter section; readable, without a filter
+constexpr uint32_t indexFileVersionWithoutBloom = 1;
+
+void writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+/**
+ * Reads one varint, refusing to run past end
+ *
+ * @return Pointer past the varint, or nullptr if the data is malformed
+ */
+const uint8_t* readVarint(const uint8_t* data, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (unsigned int shift = 0; data < end && shift < 64; shift += 7) {
+        const uint8_t byte = *data++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return data;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+/// Flushes a file or directory to stable storage
+bool syncToDisk(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+#ifdef __APPLE__
+    // fsync on macOS leaves the data in the drive's cache
+    bool ok = ::fcntl(fd, F_FULLFSYNC) == 0 || ::fsync(fd) == 0;
+#else
+    bool ok = ::fsync(fd) == 0;
+#endif
+    ::close(fd);
+    return ok;
+}
+
+int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+} // namespace
+
+Result<size_t> writeIndexFile(const FingerprintIndex& index, const std::string& path) {
+    if (index.hasPendingTracks()) {
+        SORTIFY_LOG_WARNING("Writing index with tracks pending; call build() to include them");
+    }
+
+    const auto& hashes = index.hashKeys();
+    const auto& offsets = index.postingOffsets();
+    const auto& postings = index.allPostings();
+
+    // Encode posting lists and the directory rows pointing at them
+    std::vector<IndexDirectoryEntry> directory(hashes.size());
+    std::vector<uint8_t> postingBytes;
+    postingBytes.reserve(postings.size() * 3);
+
+    for (size_t row = 0; row < hashes.size(); ++row) {
+        const uint64_t count = offsets[row + 1] - offsets[row];
+        if (count > UINT32_MAX) {
+            return Result<size_t>::createFailure("Posting list too long for hash " + std::to_string(hashes[row]));
+        }
+        directory[row] = {hashes[row], static_cast<uint32_t>(count), postingBytes.size()};
+
+        int64_t previousSong = 0;
+        uint32_t previousFrame = 0;
+        for (uint64_t p = offsets[row]; p < offsets[row + 1]; ++p) {
+            const Posting& posting = postings[p];
+            const int64_t songDelta = static_cast<int64_t>(posting.songId) - previousSong;
+            writeVarint(postingBytes, zigzagEncode(songDelta));
+            writeVarint(postingBytes, songDelta == 0 ? posting.anchorFrame - previousFrame : posting.anchorFrame);
+            previousSong = posting.songId;
+            previousFrame = posting.anchorFrame;
+        }
+    }
+
+    // Radix table: first directory row of every top-16-bit bucket
+    std::vector<uint32_t> radix(indexRadixBuckets + 1);
+    size_t row = 0;
+    for (uint32_t bucket = 0; bucket < indexRadixBuckets; ++bucket) {
+        radix[bucket] = static_cast<uint32_t>(row);
+        while (row < hashes.size() && (hashes[row] >> 16) == bucket) {
+            ++row;
+        }
+    }
+    radix[indexRadixBuckets] = static_cast<uint32_t>(row);
+
+    const BlockedBloomFilter& bloom = index.bloomFilter();
+
+    IndexFileHeader header = {};
+    std::memcpy(header.magic, indexFileMagic, sizeof(indexFileMagic));
+    header.version = indexFileVersion;
+    header.headerSize = sizeof(IndexFileHeader);
+    header.trackCount = index.builtTrackCount();
+    header.hashCount = hashes.size();
+    header.postingCount = postings.size();
+    // The header is 128 bytes, so the filter starts cache-line aligned
+    header.bloomOffset = sizeof(IndexFileHeader);
+    header.bloomBlockCount = bloom.blockCount();
+    header.radixOffset = header.bloomOffset + bloom.sizeBytes();
+    header.directoryOffset = alignTo8(header.radixOffset + radix.size() * sizeof(uint32_t));
+    header.postingsOffset = header.directoryOffset + directory.size() * sizeof(IndexDirectoryEntry);
+    header.postingsSize = postingBytes.size();
+    header.fileSize = header.postingsOffset + header.postingsSize;
+    header.byteOrderMark = byteOrderMark;
+    header.configId = index.configId();
+
+    // Write beside the destination, flush it to disk and rename, so readers
+    // never map a partial file, not even after a crash
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return Result<size_t>::createFailure("Failed to create index file: " + tempPath);
+        }
+
+        const char padding[8] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(bloom.data()), bloom.sizeBytes());
+        file.write(reinterpret_cast<const char*>(radix.data()), radix.size() * sizeof(uint32_t));
+        file.write(padding, header.directoryOffset - (header.radixOffset + radix.size() * sizeof(uint32_t)));
+        file.write(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(IndexDirectoryEntry));
+        file.write(reinterpret_cast<const char*>(postingBytes.data()), postingBytes.size());
+        file.close();
+
+        if (!file) {
+            std::remove(tempPath.c_str());
+            return Result<size_t>::createFailure("Failed to write index file: " + tempPath);
+        }
+    }
+    if (!syncToDisk(tempPath)) {
+        std::remove(tempPath.c_str());
+        return Result<size_t>::createFailure("Failed to flush index file: " + tempPath);
+    }
+
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return Result<size_t>::createFailure("Failed to move index file into place: " + path);
+    }
+
+    // Persist the rename itself
+    const size_t slash = path.find_last_of('/');
+    const std::string directoryPath = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    if (!syncToDisk(directoryPath)) {
+        SORTIFY_LOG_WARNING("Could not flush directory ", directoryPath, " after writing ", path);
+    }
+
+    SORTIFY_LOG_INFO("Wrote fingerprint index ", path, " (", header.fileSize, " bytes, ", header.trackCount, " tracks)");
+
+    return Result<size_t>::createSuccess(static_cast<size_t>(header.fileSize));
+}
+
+MappedIndex::MappedIndex(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        errorMessage = "Failed to open index file: " + path + " (" + std::strerror(errno) + ")";
+        return;
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(IndexFileHeader))) {
+        ::close(fd);
+        errorMessage = "Index file is too small: " + path;
+        return;
+    }
+
+    mappingSize = static_cast<size_t>(info.st_size);
+    void* address = ::mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        mappingSize = 0;
+        errorMessage = "Failed to map index file: " + path + " (" + std::strerror(errno) + ")";
+        return;
+    }
+    mapping = address;
+
+    header = static_cast<const IndexFileHeader*>(mapping);
+    errorMessage = validate();
+    if (!errorMessage.empty()) {
+        errorMessage += ": " + path;
+        header = nullptr;
+        return;
+    }
+
+    const uint8_t* base = static_cast<const uint8_t*>(mapping);
+    radix = reinterpret_cast<const uint32_t*>(base + header->radixOffset);
+    directory = reinterpret_cast<const IndexDirectoryEntry*>(base + header->directoryOffset);
+    postingData = base + header->postingsOffset;
+
+    // Posting lists are visited in hash order, not sequentially
+    ::madvise(mapping, mappingSize, MADV_RANDOM);
+
+    if (header->version != indexFileVersionWithoutBloom && header->bloomBlockCount > 0) {
+        bloomBlocks = reinterpret_cast<const BloomBlock*>(base + header->bloomOffset);
+        // Every query probes the filter at random; fault it in ahead of time
+        const uintptr_t pageMask = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE)) - 1;
+        const uintptr_t first = reinterpret_cast<uintptr_t>(bloomBlocks) & ~pageMask;
+        const uintptr_t last = reinterpret_cast<uintptr_t>(bloomBlocks + header->bloomBlockCount);
+        ::madvise(reinterpret_cast<void*>(first), last - first, MADV_WILLNEED);
+    }
+}
+
+MappedIndex::~MappedIndex() {
+    if (mapping) {
+        ::munmap(mapping, mappingSize);
+    }
+}
+
+std::string MappedIndex::validate() const {
+    if (std::memcmp(header->magic, indexFileMagic, sizeof(indexFileMagic)) != 0) {
+        return "Not a fingerprint index file";
+    }
+    if (header->byteOrderMark != byteOrderMark) {
+        return "Index file was written with a different byte order";
+    }
+    if (header->version != indexFileVersion && header->version != indexFileVersionWithoutBloom) {
+        return "Unsupported index file version " + std::to_string(header->version);
+    }
+    if (header->headerSize != sizeof(IndexFileHeader)) {
+        return "Unexpected index header size";
+    }
+    if (header->fileSize != mappingSize) {
+        return "Index file is truncated";
+    }
+
+    // Version 1 wrote zeros where the filter fields are now
+    const uint64_t bloomCount = header->version == indexFileVersionWithoutBloom ? 0 : header->bloomBlockCount;
+    if (bloomCount > 0 &&
+        (header->bloomOffset < sizeof(IndexFileHeader) || header->bloomOffset > mappingSize ||
+         header->bloomOffset % sizeof(BloomBlock) != 0 ||
+         bloomCount > (mappingSize - header->bloomOffset) / sizeof(BloomBlock) ||
+         header->bloomOffset + bloomCount * sizeof(BloomBlock) > header->radixOffset)) {
+        return "Index Bloom filter section is inconsistent";
+    }
+
+    // Every size is compared with the bytes left after its offset, so a
+    // crafted header cannot wrap the arithmetic and pass
+    const uint64_t radixBytes = (uint64_t(indexRadixBuckets) + 1) * sizeof(uint32_t);
+    if (header->radixOffset < sizeof(IndexFileHeader) || header->radixOffset > mappingSize ||
+        radixBytes > mappingSize - header->radixOffset ||
+        header->directoryOffset < header->radixOffset + radixBytes || header->directoryOffset > mappingSize ||
+        header->directoryOffset % 8 != 0 ||
+        header->hashCount > (mappingSize - header->directoryOffset) / sizeof(IndexDirectoryEntry) ||
+        header->postingsOffset < header->directoryOffset + header->hashCount * sizeof(IndexDirectoryEntry) ||
+        header->postingsOffset > mappingSize || header->postingsSize > mappingSize - header->postingsOffset) {
+        return "Index file sections are inconsistent";
+    }
+
+    const uint32_t* table = reinterpret_cast<const uint32_t*>(
+        static_cast<const uint8_t*>(mapping) + header->radixOffset);
+    if (table[indexRadixBuckets] != header->hashCount) {
+        return "Index radix table is inconsistent";
+    }
+    return "";
+}
+
+const IndexDirectoryEntry* MappedIndex::findEntry(uint32_t hash) const {
+    if (!header) {
+        return nullptr;
+    }
+    // Rejects most absent hashes before the radix and directory pages are touched
+    if (bloomBlocks && !BlockedBloomFilter::mayContain(bloomBlocks, header->bloomBlockCount, hash)) {
+        return nullptr;
+    }
+
+    // The radix table narrows the search to rows sharing the top 16 bits
+    const uint32_t bucket = hash >> 16;
+    const IndexDirectoryEntry* first = directory + std::min<uint64_t>(radix[bucket], header->hashCount);
+    const IndexDirectoryEntry* last = directory + std::min<uint64_t>(radix[bucket + 1], header->hashCount);
+    if (first >= last) {
+        return nullptr;
+    }
+
+    const IndexDirectoryEntry* entry = std::lower_bound(first, last, hash,
+        [](const IndexDirectoryEntry& e, uint32_t value) { return e.hash < value; });
+    return (entry != last && entry->hash == hash) ? entry : nullptr;
+}
+
+size_t MappedIndex::decodePostings(uint32_t hash, std::vector<Posting>& postings) const {
+    const IndexDirectoryEntry* entry = findEntry(hash);
+    if (!entry || entry->dataOffset >= header->postingsSize) {
+        return 0;
+    }
+
+    const uint8_t* data = postingData + entry->dataOffset;
+    const uint8_t* end = postingData + header->postingsSize;
+    int64_t song = 0;
+    uint64_t frame = 0;
+
+    for (uint32_t i = 0; i < entry->postingCount; ++i) {
+        uint64_t songDelta = 0;
+        uint64_t frameValue = 0;
+        data = readVarint(data, end, songDelta);
+        if (data) {
+            data = readVarint(data, end, frameValue);
+        }
+        if (!data) {
+            SORTIFY_LOG_ERROR("Corrupt posting list for hash ", hash);
+            return i;
+        }
+
+        const int64_t delta = zigzagDecode(songDelta);
+        song += delta;
+        frame = delta == 0 ? frame + frameValue : frameValue;
+        postings.push_back({static_cast<int32_t>(song), static_cast<uint32_t>(frame)});
+    }
+    return entry->postingCount;
+}
+
+Result<std::vector<MatchCandidate>> MappedIndex::query(
+    const CompactFingerprint& sample,
+    size_t maxResults,
+    unsigned int minScore
+) const {
+    ScopedTimer timer(MetricStage::INDEX_QUERY);
+    if (!isValid()) {
+        return Result<std::vector<MatchCandidate>>::createFailure(errorMessage);
+    }
+    if (sample.empty()) {
+        return Result<std::vector<MatchCandidate>>::createFailure("Empty sample fingerprint provided");
+    }
+
+    MatchAccumulator accumulator;
+    std::vector<Posting> list;
+    const HashRecord* record = sample.begin();
+    while (record != sample.end()) {
+        // Decode each posting list once for all sample records sharing its hash
+        const uint32_t hash = record->hash;
+        const HashRecord* runEnd = record;
+        while (runEnd != sample.end() && runEnd->hash == hash) {
+            ++runEnd;
+        }
+
+        list.clear();
+        decodePostings(hash, list);
+        for (const HashRecord* r = record; r != runEnd; ++r) {
+            for (const Posting& posting : list) {
+                accumulator.addVote(posting.songId, posting.anchorFrame, r->anchorFrame);
+            }
+        }
+        record = runEnd;
+    }
+
+    Metrics::add(MetricCounter::QUERIES, 1);
+    return Result<std::vector<MatchCandidate>>::createSuccess(
+        accumulator.rank(sample.size(), maxResults, minScore));
+}
+
+} // namespace audio
+} // namespace sortify
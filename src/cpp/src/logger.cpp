@@ -1,19 +1,34 @@
 #include "../include/logger.hpp"
 #include <iostream>
+#include <algorithm>
 
 namespace sortify {
 namespace audio {
 
 // Initialize static members of Logger
-LogLevel Logger::currentLogLevel = LogLevel::ERROR;
+std::shared_mutex Logger::logFunctionMutex;
 std::function<void(LogLevel, const std::string&)> Logger::logFunction = nullptr;
 
+const char* logLevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::DEBUG:   return "DEBUG";
+        case LogLevel::INFO:    return "INFO";
+        case LogLevel::WARNING: return "WARNING";
+        case LogLevel::ERROR:   return "ERROR";
+        case LogLevel::FATAL:   return "FATAL";
+    }
+    return "UNKNOWN";
+}
+
 void Logger::setLogLevel(LogLevel level) {
-    currentLogLevel = level;
+    currentLogLevel.store(level, std::memory_order_relaxed);
 }
 
 void Logger::setLogFunction(std::function<void(LogLevel, const std::string&)> logFunc) {
-    logFunction = std::move(logFunc);
+    std::unique_lock<std::shared_mutex> lock(logFunctionMutex);
+    logFunction.swap(logFunc);
+    lock.unlock();
+    // The previous function is destroyed here, after every call into it returned
 }
 
 void Logger::debug(const std::string& message) {
@@ -38,32 +53,104 @@ void Logger::fatal(const std::string& message) {
 
 void Logger::log(LogLevel level, const std::string& message) {
     // Skip messages with level lower than the current log level
-    if (level < currentLogLevel) {
+    if (!isEnabled(level)) {
         return;
     }
     
-    // If a custom log function is set, use it
-    if (logFunction) {
-        logFunction(level, message);
-        return;
+    // If a custom log function is set, use it; the shared lock keeps it
+    // from being replaced or destroyed during the call
+    {
+        std::shared_lock<std::shared_mutex> lock(logFunctionMutex);
+        if (logFunction) {
+            logFunction(level, message);
+            return;
+        }
     }
     
-    // Default implementation: log to standard output/error
-    std::string levelStr;
-    switch (level) {
-        case LogLevel::DEBUG:   levelStr = "DEBUG"; break;
-        case LogLevel::INFO:    levelStr = "INFO"; break;
-        case LogLevel::WARNING: levelStr = "WARNING"; break;
-        case LogLevel::ERROR:   levelStr = "ERROR"; break;
-        case LogLevel::FATAL:   levelStr = "FATAL"; break;
+    // Default implementation: log to standard output/error without flushing each line
+    std::ostream& stream = level >= LogLevel::ERROR ? std::cerr : std::cout;
+    stream << "[" << logLevelName(level) << "] " << message << '\n';
+}
+
+AsyncLogSink::AsyncLogSink(size_t capacity) : ring(std::max<size_t>(1, capacity)) {
+    writer = std::thread(&AsyncLogSink::run, this);
+}
+
+AsyncLogSink::~AsyncLogSink() {
+    if (installed) {
+        Logger::setLogFunction(nullptr);
     }
-    
-    if (level >= LogLevel::ERROR) {
-        std::cerr << "[" << levelStr << "] " << message << std::endl;
-    } else {
-        std::cout << "[" << levelStr << "] " << message << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWriter.notify_one();
+    writer.join();
+}
+
+void AsyncLogSink::install() {
+    installed = true;
+    Logger::setLogFunction([this](LogLevel level, const std::string& message) {
+        write(level, message);
+    });
+}
+
+void AsyncLogSink::write(LogLevel level, const std::string& message) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count == ring.size()) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Entry& entry = ring[(head + count) % ring.size()];
+        entry.level = level;
+        entry.message = message;
+        count++;
+    }
+    wakeWriter.notify_one();
+}
+
+void AsyncLogSink::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    drained.wait(lock, [this] { return count == 0 && writing == 0; });
+}
+
+void AsyncLogSink::run() {
+    std::vector<Entry> batch;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wakeWriter.wait(lock, [this] { return stopping || count > 0; });
+        if (count == 0 && stopping) {
+            break;
+        }
+
+        // Take everything queued so far and write it without holding the lock
+        batch.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            std::swap(batch[i], ring[(head + i) % ring.size()]);
+        }
+        head = (head + count) % ring.size();
+        writing = count;
+        count = 0;
+        lock.unlock();
+
+        bool wroteError = false;
+        for (const Entry& entry : batch) {
+            std::ostream& stream = entry.level >= LogLevel::ERROR ? std::cerr : std::cout;
+            stream << "[" << logLevelName(entry.level) << "] " << entry.message << '\n';
+            wroteError = wroteError || entry.level >= LogLevel::ERROR;
+        }
+        std::cout.flush();
+        if (wroteError) {
+            std::cerr.flush();
+        }
+
+        lock.lock();
+        writing = 0;
+        drained.notify_all();
     }
+    drained.notify_all();
 }
 
 } // namespace audio
-} // namespace sortify
\ No newline at end of file
+} // namespace sortify
@@ -0,0 +1,170 @@
+#include "../include/metrics.hpp"
+#include <algorithm>
+#include <sstream>
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+/**
+ * @struct AtomicStageTiming
+ * @brief Lock-free storage behind a StageTiming
+ */
+struct AtomicStageTiming {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalNanoseconds{0};
+    std::array<std::atomic<uint64_t>, metricBucketCount> buckets{};
+};
+
+std::array<std::atomic<uint64_t>, metricCounterCount> counterValues{};
+std::array<AtomicStageTiming, metricStageCount> stageTimings;
+
+size_t bucketFor(std::chrono::nanoseconds duration) {
+    // Bucket i holds durations of at most 2^i microseconds
+    uint64_t micros = static_cast<uint64_t>(std::max<int64_t>(0, (duration.count() + 999) / 1000));
+    size_t bucket = 0;
+    while (bucket + 1 < metricBucketCount && (uint64_t(1) << bucket) < micros) {
+        bucket++;
+    }
+    return bucket;
+}
+
+std::string bucketBound(size_t bucket) {
+    if (bucket + 1 == metricBucketCount) {
+        return "+Inf";
+    }
+    std::ostringstream bound;
+    bound << static_cast<double>(uint64_t(1) << bucket) * 1e-6;
+    return bound.str();
+}
+
+} // namespace
+
+const char* metricCounterName(MetricCounter counter) {
+    switch (counter) {
+        case MetricCounter::SAMPLES_DECODED: return "samples_decoded";
+        case MetricCounter::SAMPLES_ANALYZED: return "samples_analyzed";
+        case MetricCounter::AUDIO_MICROSECONDS: return "audio_microseconds";
+        case MetricCounter::WINDOWS_PROCESSED: return "windows_processed";
+        case MetricCounter::PEAKS_EXTRACTED: return "peaks_extracted";
+        case MetricCounter::HASHES_EMITTED: return "hashes_emitted";
+        case MetricCounter::QUERIES: return "queries";
+        case MetricCounter::BYTES_ALLOCATED: return "bytes_allocated";
+        default: return "unknown";
+    }
+}
+
+const char* metricStageName(MetricStage stage) {
+    switch (stage) {
+        case MetricStage::DECODE: return "decode";
+        case MetricStage::SPECTROGRAM: return "spectrogram";
+        case MetricStage::PEAK_EXTRACTION: return "peak_extraction";
+        case MetricStage::FINGERPRINT: return "fingerprint";
+        case MetricStage::INDEX_QUERY: return "index_query";
+        default: return "unknown";
+    }
+}
+
+void Metrics::setEnabled(bool enable) {
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+void Metrics::addCounter(MetricCounter counter, uint64_t value) {
+    counterValues[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+}
+
+void Metrics::recordDuration(MetricStage stage, std::chrono::nanoseconds duration) {
+    if (!isEnabled()) {
+        return;
+    }
+    AtomicStageTiming& timing = stageTimings[static_cast<size_t>(stage)];
+    timing.count.fetch_add(1, std::memory_order_relaxed);
+    timing.totalNanoseconds.fetch_add(static_cast<uint64_t>(std::max<int64_t>(0, duration.count())),
+                                      std::memory_order_relaxed);
+    timing.buckets[bucketFor(duration)].fetch_add(1, std::memory_order_relaxed);
+}
+
+MetricsSnapshot Metrics::snapshot() {
+    MetricsSnapshot snapshot;
+    for (size_t c = 0; c < metricCounterCount; ++c) {
+        snapshot.counters[c] = counterValues[c].load(std::memory_order_relaxed);
+    }
+    for (size_t s = 0; s < metricStageCount; ++s) {
+        const AtomicStageTiming& timing = stageTimings[s];
+        snapshot.stages[s].count = timing.count.load(std::memory_order_relaxed);
+        snapshot.stages[s].totalNanoseconds = timing.totalNanoseconds.load(std::memory_order_relaxed);
+        for (size_t b = 0; b < metricBucketCount; ++b) {
+            snapshot.stages[s].buckets[b] = timing.buckets[b].load(std::memory_order_relaxed);
+        }
+    }
+    return snapshot;
+}
+
+void Metrics::reset() {
+    for (auto& value : counterValues) {
+        value.store(0, std::memory_order_relaxed);
+    }
+    for (auto& timing : stageTimings) {
+        timing.count.store(0, std::memory_order_relaxed);
+        timing.totalNanoseconds.store(0, std::memory_order_relaxed);
+        for (auto& bucket : timing.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+double MetricsSnapshot::peaksPerAudioSecond() const {
+    const uint64_t micros = counter(MetricCounter::AUDIO_MICROSECONDS);
+    if (micros == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(counter(MetricCounter::PEAKS_EXTRACTED)) * 1e6 / static_cast<double>(micros);
+}
+
+std::string MetricsSnapshot::toPrometheus(const std::string& prefix) const {
+    std::ostringstream out;
+    for (size_t c = 0; c < metricCounterCount; ++c) {
+        const std::string name = prefix + "_" + metricCounterName(static_cast<MetricCounter>(c)) + "_total";
+        out << "# TYPE " << name << " counter\n";
+        out << name << " " << counters[c] << "\n";
+    }
+
+    const std::string histogram = prefix + "_stage_duration_seconds";
+    out << "# TYPE " << histogram << " histogram\n";
+    for (size_t s = 0; s < metricStageCount; ++s) {
+        const std::string label = std::string("stage=\"") + metricStageName(static_cast<MetricStage>(s)) + "\"";
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < metricBucketCount; ++b) {
+            cumulative += stages[s].buckets[b];
+            out << histogram << "_bucket{" << label << ",le=\"" << bucketBound(b) << "\"} " << cumulative << "\n";
+        }
+        out << histogram << "_sum{" << label << "} " << stages[s].totalSeconds() << "\n";
+        out << histogram << "_count{" << label << "} " << stages[s].count << "\n";
+    }
+    return out.str();
+}
+
+std::string MetricsSnapshot::toJson() const {
+    std::ostringstream out;
+    out << "{\"counters\":{";
+    for (size_t c = 0; c < metricCounterCount; ++c) {
+        out << (c ? "," : "") << "\"" << metricCounterName(static_cast<MetricCounter>(c)) << "\":" << counters[c];
+    }
+    out << "},\"peaks_per_audio_second\":" << peaksPerAudioSecond() << ",\"stages\":{";
+    for (size_t s = 0; s < metricStageCount; ++s) {
+        out << (s ? "," : "") << "\"" << metricStageName(static_cast<MetricStage>(s)) << "\":{"
+            << "\"count\":" << stages[s].count
+            << ",\"total_seconds\":" << stages[s].totalSeconds()
+            << ",\"buckets\":[";
+        for (size_t b = 0; b < metricBucketCount; ++b) {
+            out << (b ? "," : "") << stages[s].buckets[b];
+        }
+        out << "]}";
+    }
+    out << "}}";
+    return out.str();
+}
+
+} // namespace audio
+} // namespace sortify
@@ -0,0 +1,303 @@
+#include "../include/pcm_convert.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define SORTIFY_HAS_X86_KERNELS 1
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SORTIFY_HAS_NEON_KERNELS 1
+#endif
+
+// PCM downmix kernels
+//
+// Each output sample is (sum of the frame's raw channel values) * scale,
+// where scale folds the full-scale normalisation and the 1/numChannels
+// average into one multiply. Integer sums are exact in float, so the vector
+// kernels (which add in the integer domain) match the scalar loop bit for bit.
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+inline float decodeUint8(const uint8_t* p) {
+    return static_cast<float>(static_cast<int>(p[0]) - 128);
+}
+
+inline float decodeInt16(const uint8_t* p) {
+    int16_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return static_cast<float>(value);
+}
+
+inline float decodeInt24(const uint8_t* p) {
+    // Place the 24 bits at the top of an int32 and shift back to sign-extend
+    const uint32_t bits = static_cast<uint32_t>(p[0]) << 8 |
+                          static_cast<uint32_t>(p[1]) << 16 |
+                          static_cast<uint32_t>(p[2]) << 24;
+    return static_cast<float>(static_cast<int32_t>(bits) >> 8);
+}
+
+inline float decodeInt32(const uint8_t* p) {
+    int32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return static_cast<float>(value);
+}
+
+inline float decodeFloat32(const uint8_t* p) {
+    float value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline float decodeFloat64(const uint8_t* p) {
+    double value;
+    std::memcpy(&value, p, sizeof(value));
+    return static_cast<float>(value);
+}
+
+/**
+ * Scalar downmix for one encoding; mono and stereo get their own loops so
+ * the compiler can vectorise them
+ */
+template<typename Decode>
+void downmixScalar(const uint8_t* data, size_t numFrames, unsigned int numChannels, unsigned int bytesPerSample,
+                   float scale, float* output, Decode decode) {
+    const size_t frameBytes = static_cast<size_t>(numChannels) * bytesPerSample;
+    if (numChannels == 1) {
+        for (size_t i = 0; i < numFrames; ++i) {
+            output[i] = decode(data + i * frameBytes) * scale;
+        }
+    } else if (numChannels == 2) {
+        for (size_t i = 0; i < numFrames; ++i) {
+            const uint8_t* frame = data + i * frameBytes;
+            output[i] = (decode(frame) + decode(frame + bytesPerSample)) * scale;
+        }
+    } else {
+        for (size_t i = 0; i < numFrames; ++i) {
+            const uint8_t* frame = data + i * frameBytes;
+            float sum = 0.0f;
+            for (unsigned int ch = 0; ch < numChannels; ++ch) {
+                sum += decode(frame + ch * bytesPerSample);
+            }
+            output[i] = sum * scale;
+        }
+    }
+}
+
+/**
+ * Full-scale value of one integer channel (1.0 for float encodings)
+ */
+float fullScale(PcmEncoding encoding) {
+    switch (encoding) {
+        case PcmEncoding::UINT8:   return 128.0f;
+        case PcmEncoding::INT16:   return 32768.0f;
+        case PcmEncoding::INT24:   return 8388608.0f;
+        case PcmEncoding::INT32:   return 2147483648.0f;
+        case PcmEncoding::FLOAT32:
+        case PcmEncoding::FLOAT64: return 1.0f;
+    }
+    return 1.0f;
+}
+
+#if defined(SORTIFY_HAS_X86_KERNELS)
+
+size_t downmixInt16Sse2(const uint8_t* data, size_t numFrames, unsigned int numChannels, float scale, float* output) {
+    const __m128 factor = _mm_set1_ps(scale);
+    size_t i = 0;
+    if (numChannels == 1) {
+        for (; i + 8 <= numFrames; i += 8) {
+            __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 2));
+            // Sign-extend by placing each int16 in the top half of an int32
+            __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+            __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+            _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(low), factor));
+            _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), factor));
+        }
+    } else if (numChannels == 2) {
+        const __m128i ones = _mm_set1_epi16(1);
+        for (; i + 4 <= numFrames; i += 4) {
+            // madd adds each left/right pair into one int32
+            __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 4));
+            __m128i sums = _mm_madd_epi16(values, ones);
+            _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(sums), factor));
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t downmixInt16Avx2(const uint8_t* data, size_t numFrames, unsigned int numChannels, float scale, float* output) {
+    const __m256 factor = _mm256_set1_ps(scale);
+    size_t i = 0;
+    if (numChannels == 1) {
+        for (; i + 8 <= numFrames; i += 8) {
+            __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 2));
+            __m256i widened = _mm256_cvtepi16_epi32(values);
+            _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(widened), factor));
+        }
+    } else if (numChannels == 2) {
+        const __m256i ones = _mm256_set1_epi16(1);
+        for (; i + 8 <= numFrames; i += 8) {
+            __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i * 4));
+            __m256i sums = _mm256_madd_epi16(values, ones);
+            _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(sums), factor));
+        }
+    }
+    return i;
+}
+
+size_t downmixFloat32Sse2(const uint8_t* data, size_t numFrames, unsigned int numChannels, float scale, float* output) {
+    const __m128 factor = _mm_set1_ps(scale);
+    const float* samples = reinterpret_cast<const float*>(data);
+    size_t i = 0;
+    if (numChannels == 1) {
+        for (; i + 4 <= numFrames; i += 4) {
+            _mm_storeu_ps(output + i, _mm_mul_ps(_mm_loadu_ps(samples + i), factor));
+        }
+    } else if (numChannels == 2) {
+        for (; i + 4 <= numFrames; i += 4) {
+            __m128 a = _mm_loadu_ps(samples + i * 2);
+            __m128 b = _mm_loadu_ps(samples + i * 2 + 4);
+            // Deinterleave left and right, then add them
+            __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(output + i, _mm_mul_ps(_mm_add_ps(left, right), factor));
+        }
+    }
+    return i;
+}
+
+#endif // SORTIFY_HAS_X86_KERNELS
+
+#if defined(SORTIFY_HAS_NEON_KERNELS)
+
+size_t downmixInt16Neon(const uint8_t* data, size_t numFrames, unsigned int numChannels, float scale, float* output) {
+    const float32x4_t factor = vdupq_n_f32(scale);
+    const int16_t* samples = reinterpret_cast<const int16_t*>(data);
+    size_t i = 0;
+    if (numChannels == 1) {
+        for (; i + 8 <= numFrames; i += 8) {
+            int16x8_t values = vld1q_s16(samples + i);
+            vst1q_f32(output + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(values))), factor));
+            vst1q_f32(output + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(values))), factor));
+        }
+    } else if (numChannels == 2) {
+        for (; i + 4 <= numFrames; i += 4) {
+            // Pairwise widening add sums each left/right pair into one int32
+            int32x4_t sums = vpaddlq_s16(vld1q_s16(samples + i * 2));
+            vst1q_f32(output + i, vmulq_f32(vcvtq_f32_s32(sums), factor));
+        }
+    }
+    return i;
+}
+
+size_t downmixFloat32Neon(const uint8_t* data, size_t numFrames, unsigned int numChannels, float scale, float* output) {
+    const float32x4_t factor = vdupq_n_f32(scale);
+    const float* samples = reinterpret_cast<const float*>(data);
+    size_t i = 0;
+    if (numChannels == 1) {
+        for (; i + 4 <= numFrames; i += 4) {
+            vst1q_f32(output + i, vmulq_f32(vld1q_f32(samples + i), factor));
+        }
+    } else if (numChannels == 2) {
+        for (; i + 4 <= numFrames; i += 4) {
+            float32x4x2_t channels = vld2q_f32(samples + i * 2);
+            vst1q_f32(output + i, vmulq_f32(vaddq_f32(channels.val[0], channels.val[1]), factor));
+        }
+    }
+    return i;
+}
+
+#endif // SORTIFY_HAS_NEON_KERNELS
+
+/**
+ * Runs the widest vector kernel for the encoding
+ *
+ * @return Number of frames converted; the caller finishes the rest
+ */
+size_t downmixVector(const uint8_t* data, size_t numFrames, unsigned int numChannels, PcmEncoding encoding,
+                     float scale, float* output, SimdLevel level) {
+    if (numChannels > 2) {
+        return 0;
+    }
+#if defined(SORTIFY_HAS_X86_KERNELS)
+    if (encoding == PcmEncoding::INT16) {
+        if (level == SimdLevel::AVX2) return downmixInt16Avx2(data, numFrames, numChannels, scale, output);
+        if (level == SimdLevel::SSE2) return downmixInt16Sse2(data, numFrames, numChannels, scale, output);
+    }
+    if (encoding == PcmEncoding::FLOAT32 && (level == SimdLevel::AVX2 || level == SimdLevel::SSE2)) {
+        return downmixFloat32Sse2(data, numFrames, numChannels, scale, output);
+    }
+#elif defined(SORTIFY_HAS_NEON_KERNELS)
+    if (level == SimdLevel::NEON) {
+        if (encoding == PcmEncoding::INT16) return downmixInt16Neon(data, numFrames, numChannels, scale, output);
+        if (encoding == PcmEncoding::FLOAT32) return downmixFloat32Neon(data, numFrames, numChannels, scale, output);
+    }
+#else
+    (void)data; (void)numFrames; (void)encoding; (void)scale; (void)output; (void)level;
+#endif
+    return 0;
+}
+
+} // namespace
+
+unsigned int pcmBytesPerSample(PcmEncoding encoding) {
+    switch (encoding) {
+        case PcmEncoding::UINT8:   return 1;
+        case PcmEncoding::INT16:   return 2;
+        case PcmEncoding::INT24:   return 3;
+        case PcmEncoding::INT32:   return 4;
+        case PcmEncoding::FLOAT32: return 4;
+        case PcmEncoding::FLOAT64: return 8;
+    }
+    return 0;
+}
+
+void convertPcmToMono(const uint8_t* data, size_t numFrames, unsigned int numChannels,
+                      PcmEncoding encoding, float* output, SimdLevel level) {
+    if (numFrames == 0 || numChannels == 0) {
+        return;
+    }
+    if (!isSimdLevelSupported(level)) {
+        level = SimdLevel::SCALAR;
+    }
+
+    const float scale = 1.0f / (fullScale(encoding) * static_cast<float>(numChannels));
+    const unsigned int bytesPerSample = pcmBytesPerSample(encoding);
+
+    size_t done = 0;
+    if (level != SimdLevel::SCALAR) {
+        done = downmixVector(data, numFrames, numChannels, encoding, scale, output, level);
+    }
+
+    // Convert whatever the vector kernel left over (or everything)
+    const uint8_t* rest = data + done * numChannels * bytesPerSample;
+    const size_t remaining = numFrames - done;
+    float* restOutput = output + done;
+
+    switch (encoding) {
+        case PcmEncoding::UINT8:
+            downmixScalar(rest, remaining, numChannels, bytesPerSample, scale, restOutput, decodeUint8);
+            break;
+        case PcmEncoding::INT16:
+            downmixScalar(rest, remaining, numChannels, bytesPerSample, scale, restOutput, decodeInt16);
+            break;
+        case PcmEncoding::INT24:
+            downmixScalar(rest, remaining, numChannels, bytesPerSample, scale, restOutput, decodeInt24);
+            break;
+        case PcmEncoding::INT32:
+            downmixScalar(rest, remaining, numChannels, bytesPerSample, scale, restOutput, decodeInt32);
+            break;
+        case PcmEncoding::FLOAT32:
+            downmixScalar(rest, remaining, numChannels, bytesPerSample, scale, restOutput, decodeFloat32);
+            break;
+        case PcmEncoding::FLOAT64:
+            downmixScalar(rest, remaining, numChannels, bytesPerSample, scale, restOutput, decodeFloat64);
+            break;
+    }
+}
+
+} // namespace audio
+} // namespace sortify
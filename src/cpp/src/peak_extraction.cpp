@@ -1,5 +1,7 @@
 #include "../include/audio_fingerprint.hpp"
 #include "../include/logger.hpp"
+#include "../include/fingerprint_stages.hpp"
+#include "../include/metrics.hpp"
 #include <vector>
 #include <algorithm> // Used for std::max and other algorithms
 
@@ -17,105 +19,195 @@ namespace {
 namespace sortify {
 namespace audio {
 
-Result<std::vector<Peak>> extractPeaks(const Spectrogram& spectrogram) {
-    if (spectrogram.empty() || spectrogram[0].empty()) {
-        return Result<std::vector<Peak>>::createFailure("Empty spectrogram provided");
+Result<FrequencyBands> computeFrequencyBands(unsigned int numFreqBins) {
+    return computeFrequencyBands(numFreqBins, FingerprintConfig());
+}
+
+Result<FrequencyBands> computeFrequencyBands(unsigned int numFreqBins, const FingerprintConfig& config) {
+    // The default bands are logarithmic (see DefaultFingerprintPolicy): they
+    // mimic human ear sensitivity, which is more sensitive to changes in
+    // lower frequencies than higher ones
+    if (config.numBands == 0 || config.numBands > maxFrequencyBands) {
+        return Result<FrequencyBands>::createFailure("Invalid number of frequency bands: " +
+                                                std::to_string(config.numBands));
     }
     
-    const unsigned int numFreqBins = spectrogram.size();
-    const unsigned int numTimeWindows = spectrogram[0].size();
-    
-    Logger::info("Extracting peaks from spectrogram: " + 
-                std::to_string(numFreqBins) + "x" + 
-                std::to_string(numTimeWindows));
-    
-    // Define logarithmic frequency bands (Hz)
-    // These bands mimic human ear sensitivity which is more sensitive to
-    // changes in lower frequencies than higher ones
-    // The bands are distributed logarithmically across the spectrum
-    const std::vector<std::pair<unsigned int, unsigned int>> freqBands = {
-        {0, static_cast<unsigned int>(numFreqBins * 0.1)},         // ~0-500 Hz
-        {static_cast<unsigned int>(numFreqBins * 0.1), 
-         static_cast<unsigned int>(numFreqBins * 0.25)},           // ~500-2000 Hz
-        {static_cast<unsigned int>(numFreqBins * 0.25), 
-         static_cast<unsigned int>(numFreqBins * 0.4)},            // ~2000-3000 Hz
-        {static_cast<unsigned int>(numFreqBins * 0.4), 
-         static_cast<unsigned int>(numFreqBins * 0.6)},            // ~3000-4000 Hz
-        {static_cast<unsigned int>(numFreqBins * 0.6), 
-         static_cast<unsigned int>(numFreqBins * 0.8)},            // ~4000-4500 Hz
-        {static_cast<unsigned int>(numFreqBins * 0.8), numFreqBins} // ~4500-5000 Hz
-    };
+    FrequencyBands freqBands;
+    freqBands.reserve(config.numBands);
+    for (unsigned int b = 0; b < config.numBands; ++b) {
+        freqBands.emplace_back(static_cast<unsigned int>(numFreqBins * config.bandEdges[b]),
+                               static_cast<unsigned int>(numFreqBins * config.bandEdges[b + 1]));
+    }
     
     // Validate frequency bands
     for (const auto& band : freqBands) {
         if (band.first >= band.second) {
-            return Result<std::vector<Peak>>::createFailure("Invalid frequency band: [" + 
+            return Result<FrequencyBands>::createFailure("Invalid frequency band: [" + 
                                                     std::to_string(band.first) + ", " + 
                                                     std::to_string(band.second) + "]");
         }
         
         if (band.second > numFreqBins) {
-            return Result<std::vector<Peak>>::createFailure("Frequency band exceeds spectrogram size: " + 
+            return Result<FrequencyBands>::createFailure("Frequency band exceeds spectrogram size: " + 
                                                     std::to_string(band.second) + " > " + 
                                                     std::to_string(numFreqBins));
         }
     }
     
-    std::vector<Peak> peaks;
+    return Result<FrequencyBands>::createSuccess(std::move(freqBands));
+}
+
+namespace {
+
+/**
+ * Picks the peaks of one frame
+ *
+ * FixedBands is the band count when known at compile time (bands.size()
+ * must then equal it), which unrolls the band loop; 0 reads it from bands.
+ */
+template <unsigned int FixedBands, typename PeakVector>
+void appendFramePeaks(const SpectrogramFrame& frame, const FrequencyBands& bands, float time, PeakVector& peaks) {
+    static_assert(FixedBands <= maxFrequencyBands, "Too many fixed frequency bands");
+    static const SimdLevel simdLevel = detectSimdLevel();
     
-    // Process each time window
-    for (unsigned int t = 0; t < numTimeWindows; ++t) {
-        std::vector<Peak> bandPeaks;
-        
-        // Find the maximum peak in each frequency band
-        for (const auto& band : freqBands) {
-            Peak maxPeak = {0.0f, static_cast<float>(t), 0.0f};
-            bool foundPeak = false;
-            
-            // Find the maximum magnitude within this band
-            for (unsigned int f = band.first; f < band.second && f < numFreqBins; ++f) {
-                if (spectrogram[f][t] > maxPeak.magnitude) {
-                    maxPeak.magnitude = spectrogram[f][t];
-                    maxPeak.frequency = static_cast<float>(f);
-                    foundPeak = true;
-                }
-            }
-            
-            if (foundPeak) {
-                bandPeaks.push_back(maxPeak);
-            }
+    const unsigned int numFreqBins = frame.size();
+    const size_t numBands = FixedBands ? FixedBands : bands.size();
+    const std::pair<unsigned int, unsigned int>* bandRanges = bands.data();
+    Peak bandPeaks[maxFrequencyBands];
+    unsigned int numBandPeaks = 0;
+    float totalMagnitude = 0.0f;
+    
+    // Find the maximum peak in each frequency band
+    for (size_t b = 0; b < numBands; ++b) {
+        const auto& band = bandRanges[b];
+        const unsigned int last = std::min(band.second, numFreqBins);
+        if (band.first >= last || numBandPeaks == maxFrequencyBands) {
+            continue;
         }
         
-        if (bandPeaks.empty()) {
-            continue;  // No peaks found in this time window
+        BandMaximum maximum = findBandMaximum(frame.data(), band.first, last, simdLevel);
+        if (maximum.magnitude > 0.0f) {
+            bandPeaks[numBandPeaks++] = {static_cast<float>(maximum.bin), time, maximum.magnitude};
+            totalMagnitude += maximum.magnitude;
         }
-        
-        // Calculate dynamic threshold as average of the band peaks
-        // Dynamic thresholding adapts to the audio's overall volume and
-        // spectral characteristics, improving fingerprint robustness across
-        // different recording conditions
-        float avgMagnitude = 0.0f;
-        for (const auto& peak : bandPeaks) {
-            avgMagnitude += peak.magnitude;
+    }
+    
+    if (numBandPeaks == 0) {
+        return;  // No peaks found in this time window
+    }
+    
+    // Calculate dynamic threshold as average of the band peaks
+    // Dynamic thresholding adapts to the audio's overall volume and
+    // spectral characteristics, improving fingerprint robustness across
+    // different recording conditions
+    const float avgMagnitude = totalMagnitude / numBandPeaks;
+    
+    // Keep only peaks above the threshold
+    for (unsigned int i = 0; i < numBandPeaks; ++i) {
+        if (bandPeaks[i].magnitude > avgMagnitude) {
+            peaks.push_back(bandPeaks[i]);
         }
-        avgMagnitude /= bandPeaks.size();
-        
-        // Keep only peaks above the threshold
-        for (const auto& peak : bandPeaks) {
-            if (peak.magnitude > avgMagnitude) {
-                peaks.push_back(peak);
-            }
+    }
+}
+
+/**
+ * Picks the peaks of one frame with the kernel specialized for the band count
+ */
+template <typename PeakVector>
+void appendFramePeaksDispatch(const SpectrogramFrame& frame, const FrequencyBands& bands, float time, PeakVector& peaks) {
+    if (bands.size() == DefaultFingerprintPolicy::numBands) {
+        appendFramePeaks<DefaultFingerprintPolicy::numBands>(frame, bands, time, peaks);
+    } else {
+        appendFramePeaks<0>(frame, bands, time, peaks);
+    }
+}
+
+/**
+ * Appends the peaks of every frame to peaks, which must be empty
+ */
+template <typename PeakVector>
+Result<size_t> collectPeaks(const Spectrogram& spectrogram, PeakVector& peaks, const FingerprintConfig& config) {
+    ScopedTimer timer(MetricStage::PEAK_EXTRACTION);
+    
+    if (spectrogram.empty()) {
+        return Result<size_t>::createFailure("Empty spectrogram provided");
+    }
+    
+    const unsigned int numFreqBins = spectrogram.numBins();
+    const unsigned int numTimeWindows = spectrogram.numFrames();
+    
+    SORTIFY_LOG_INFO("Extracting peaks from spectrogram: ", numFreqBins, "x", numTimeWindows);
+    
+    auto bandsResult = computeFrequencyBands(numFreqBins, config);
+    if (!bandsResult.isSuccess()) {
+        return Result<size_t>::createFailure(bandsResult.getError());
+    }
+    const FrequencyBands& freqBands = bandsResult.getValue();
+    
+    const size_t previousCapacity = peaks.capacity();
+    
+    // Process each time window; the band count is decided once per spectrogram
+    if (freqBands.size() == DefaultFingerprintPolicy::numBands) {
+        for (unsigned int t = 0; t < numTimeWindows; ++t) {
+            appendFramePeaks<DefaultFingerprintPolicy::numBands>(spectrogram.frame(t), freqBands,
+                                                                 static_cast<float>(t), peaks);
+        }
+    } else {
+        for (unsigned int t = 0; t < numTimeWindows; ++t) {
+            appendFramePeaks<0>(spectrogram.frame(t), freqBands, static_cast<float>(t), peaks);
         }
     }
     
     if (peaks.empty()) {
-        return Result<std::vector<Peak>>::createFailure("No significant peaks found in spectrogram");
+        return Result<size_t>::createFailure("No significant peaks found in spectrogram");
     }
     
-    Logger::info("Extracted " + std::to_string(peaks.size()) + " peaks");
+    SORTIFY_LOG_INFO("Extracted ", peaks.size(), " peaks");
+    
+    Metrics::add(MetricCounter::PEAKS_EXTRACTED, peaks.size());
+    Metrics::add(MetricCounter::BYTES_ALLOCATED, (peaks.capacity() - previousCapacity) * sizeof(Peak));
     
+    return Result<size_t>::createSuccess(peaks.size());
+}
+
+} // namespace
+
+void pickFramePeaks(const SpectrogramFrame& frame, const FrequencyBands& bands, float time, std::vector<Peak>& peaks) {
+    appendFramePeaksDispatch(frame, bands, time, peaks);
+}
+
+Result<std::vector<Peak>> extractPeaks(const Spectrogram& spectrogram, const FingerprintConfig& config) {
+    std::vector<Peak> peaks;
+    auto extracted = collectPeaks(spectrogram, peaks, config);
+    if (!extracted.isSuccess()) {
+        return Result<std::vector<Peak>>::createFailure(extracted.getError());
+    }
     return Result<std::vector<Peak>>::createSuccess(std::move(peaks));
 }
 
+Result<size_t> extractPeaksInto(const Spectrogram& spectrogram, std::vector<Peak>& peaks, const FingerprintConfig& config) {
+    peaks.clear();
+    return collectPeaks(spectrogram, peaks, config);
+}
+
+Result<std::pmr::vector<Peak>> extractPeaks(
+    const Spectrogram& spectrogram,
+    std::pmr::memory_resource* resource,
+    const FingerprintConfig& config
+) {
+    // Reserve the worst case up front: a monotonic resource never reuses the blocks left behind by growth
+    std::pmr::vector<Peak> peaks(resource);
+    peaks.reserve(static_cast<size_t>(spectrogram.numFrames()) * maxFrequencyBands);
+    auto extracted = collectPeaks(spectrogram, peaks, config);
+    if (!extracted.isSuccess()) {
+        return Result<std::pmr::vector<Peak>>::createFailure(extracted.getError());
+    }
+    return Result<std::pmr::vector<Peak>>::createSuccess(std::move(peaks));
+}
+
+Result<std::vector<Peak>> extractPeaks(const LegacySpectrogram& spectrogram) {
+    return extractPeaks(Spectrogram::fromLegacy(spectrogram));
+}
+
 } // namespace audio
 } // namespace sortify
\ No newline at end of file
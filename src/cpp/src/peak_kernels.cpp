@@ -0,0 +1,162 @@
+#include "../include/fingerprint_stages.hpp"
+#include <cstdint>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define SORTIFY_HAS_X86_KERNELS 1
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SORTIFY_HAS_NEON_KERNELS 1
+#endif
+
+// Band maximum kernels
+//
+// Every kernel returns the same result as the scalar loop: the first bin
+// holding the largest magnitude, or magnitude 0 if no bin is above zero.
+// Vector kernels track a running maximum and its bin per lane (strictly
+// greater keeps the earliest bin within a lane), then combine lanes by
+// taking the largest value and, on ties, the smallest bin.
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+BandMaximum findBandMaximumScalar(const float* bins, unsigned int first, unsigned int last) {
+    BandMaximum best = {0.0f, first};
+    for (unsigned int f = first; f < last; ++f) {
+        if (bins[f] > best.magnitude) {
+            best.magnitude = bins[f];
+            best.bin = f;
+        }
+    }
+    return best;
+}
+
+/**
+ * Combines per-lane maxima and finishes the tail with the scalar loop
+ */
+BandMaximum reduceLanes(const float* laneValues, const uint32_t* laneBins, unsigned int numLanes,
+                        const float* bins, unsigned int tailFirst, unsigned int last, unsigned int first) {
+    BandMaximum best = {0.0f, first};
+    for (unsigned int lane = 0; lane < numLanes; ++lane) {
+        if (laneValues[lane] > best.magnitude ||
+            (laneValues[lane] > 0.0f && laneValues[lane] == best.magnitude && laneBins[lane] < best.bin)) {
+            best.magnitude = laneValues[lane];
+            best.bin = laneBins[lane];
+        }
+    }
+
+    // Tail bins come after every lane bin, so strictly greater keeps the earliest
+    for (unsigned int f = tailFirst; f < last; ++f) {
+        if (bins[f] > best.magnitude) {
+            best.magnitude = bins[f];
+            best.bin = f;
+        }
+    }
+    return best;
+}
+
+#if defined(SORTIFY_HAS_X86_KERNELS)
+
+BandMaximum findBandMaximumSse2(const float* bins, unsigned int first, unsigned int last) {
+    unsigned int f = first;
+    __m128 maxValues = _mm_setzero_ps();
+    __m128i maxBins = _mm_set1_epi32(static_cast<int>(first));
+    __m128i laneBins = _mm_setr_epi32(f, f + 1, f + 2, f + 3);
+    const __m128i step = _mm_set1_epi32(4);
+
+    for (; f + 4 <= last; f += 4) {
+        __m128 values = _mm_loadu_ps(bins + f);
+        __m128 greater = _mm_cmpgt_ps(values, maxValues);
+        __m128i greaterBits = _mm_castps_si128(greater);
+        // SSE2 has no blend; select with and/andnot/or
+        maxValues = _mm_or_ps(_mm_and_ps(greater, values), _mm_andnot_ps(greater, maxValues));
+        maxBins = _mm_or_si128(_mm_and_si128(greaterBits, laneBins), _mm_andnot_si128(greaterBits, maxBins));
+        laneBins = _mm_add_epi32(laneBins, step);
+    }
+
+    alignas(16) float laneValues[4];
+    alignas(16) uint32_t laneMaxBins[4];
+    _mm_store_ps(laneValues, maxValues);
+    _mm_store_si128(reinterpret_cast<__m128i*>(laneMaxBins), maxBins);
+    return reduceLanes(laneValues, laneMaxBins, 4, bins, f, last, first);
+}
+
+__attribute__((target("avx2")))
+BandMaximum findBandMaximumAvx2(const float* bins, unsigned int first, unsigned int last) {
+    unsigned int f = first;
+    __m256 maxValues = _mm256_setzero_ps();
+    __m256i maxBins = _mm256_set1_epi32(static_cast<int>(first));
+    __m256i laneBins = _mm256_setr_epi32(f, f + 1, f + 2, f + 3, f + 4, f + 5, f + 6, f + 7);
+    const __m256i step = _mm256_set1_epi32(8);
+
+    for (; f + 8 <= last; f += 8) {
+        __m256 values = _mm256_loadu_ps(bins + f);
+        __m256 greater = _mm256_cmp_ps(values, maxValues, _CMP_GT_OQ);
+        maxValues = _mm256_blendv_ps(maxValues, values, greater);
+        maxBins = _mm256_blendv_epi8(maxBins, laneBins, _mm256_castps_si256(greater));
+        laneBins = _mm256_add_epi32(laneBins, step);
+    }
+
+    alignas(32) float laneValues[8];
+    alignas(32) uint32_t laneMaxBins[8];
+    _mm256_store_ps(laneValues, maxValues);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(laneMaxBins), maxBins);
+    return reduceLanes(laneValues, laneMaxBins, 8, bins, f, last, first);
+}
+
+#endif // SORTIFY_HAS_X86_KERNELS
+
+#if defined(SORTIFY_HAS_NEON_KERNELS)
+
+BandMaximum findBandMaximumNeon(const float* bins, unsigned int first, unsigned int last) {
+    unsigned int f = first;
+    float32x4_t maxValues = vdupq_n_f32(0.0f);
+    uint32x4_t maxBins = vdupq_n_u32(first);
+    const uint32_t initialBins[4] = {f, f + 1, f + 2, f + 3};
+    uint32x4_t laneBins = vld1q_u32(initialBins);
+    const uint32x4_t step = vdupq_n_u32(4);
+
+    for (; f + 4 <= last; f += 4) {
+        float32x4_t values = vld1q_f32(bins + f);
+        uint32x4_t greater = vcgtq_f32(values, maxValues);
+        maxValues = vbslq_f32(greater, values, maxValues);
+        maxBins = vbslq_u32(greater, laneBins, maxBins);
+        laneBins = vaddq_u32(laneBins, step);
+    }
+
+    float laneValues[4];
+    uint32_t laneMaxBins[4];
+    vst1q_f32(laneValues, maxValues);
+    vst1q_u32(laneMaxBins, maxBins);
+    return reduceLanes(laneValues, laneMaxBins, 4, bins, f, last, first);
+}
+
+#endif // SORTIFY_HAS_NEON_KERNELS
+
+} // namespace
+
+BandMaximum findBandMaximum(const float* bins, unsigned int first, unsigned int last, SimdLevel level) {
+    if (!isSimdLevelSupported(level)) {
+        level = SimdLevel::SCALAR;
+    }
+    
+    switch (level) {
+#if defined(SORTIFY_HAS_X86_KERNELS)
+        case SimdLevel::AVX2:
+            return findBandMaximumAvx2(bins, first, last);
+        case SimdLevel::SSE2:
+            return findBandMaximumSse2(bins, first, last);
+#endif
+#if defined(SORTIFY_HAS_NEON_KERNELS)
+        case SimdLevel::NEON:
+            return findBandMaximumNeon(bins, first, last);
+#endif
+        default:
+            return findBandMaximumScalar(bins, first, last);
+    }
+}
+
+} // namespace audio
+} // namespace sortify
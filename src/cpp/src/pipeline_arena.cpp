@@ -0,0 +1,50 @@
+#include "../include/pipeline_arena.hpp"
+#include <algorithm>
+
+namespace sortify {
+namespace audio {
+
+PipelineArena::PipelineArena(size_t initialBytes)
+    : block(std::max<size_t>(initialBytes, 1)),
+      overflow(std::pmr::new_delete_resource()),
+      counter(nullptr) {
+    monotonic.emplace(block.data(), block.size(), &overflow);
+    counter.upstream = &*monotonic;
+}
+
+void PipelineArena::reset() {
+    highWater = std::max(highWater, counter.bytes);
+
+    // Drop the overflow chunks before the block is resized underneath the resource
+    monotonic.reset();
+    if (overflow.bytes > 0) {
+        // Alignment padding is not counted, so leave some headroom
+        block.resize(block.size() + overflow.bytes + overflow.bytes / 8);
+        growths++;
+    }
+    overflow.bytes = 0;
+    counter.bytes = 0;
+    monotonic.emplace(block.data(), block.size(), &overflow);
+    counter.upstream = &*monotonic;
+}
+
+size_t PipelineArena::highWaterBytes() const {
+    return std::max(highWater, counter.bytes);
+}
+
+void* PipelineArena::CountingResource::do_allocate(size_t size, size_t alignment) {
+    void* pointer = upstream->allocate(size, alignment);
+    bytes += size;
+    return pointer;
+}
+
+void PipelineArena::CountingResource::do_deallocate(void* pointer, size_t size, size_t alignment) {
+    upstream->deallocate(pointer, size, alignment);
+}
+
+bool PipelineArena::CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+} // namespace audio
+} // namespace sortify
@@ -0,0 +1,405 @@
+#include "../include/pipeline_scheduler.hpp"
+#include "../include/wav_reader.hpp"
+#include "../include/logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sortify {
+namespace audio {
+
+/**
+ * @struct PipelineScheduler::Item
+ * @brief One file on its way through the stages
+ *
+ * Each stage releases the buffers it consumed, so an item only holds the
+ * data of the stage it is queued for.
+ */
+struct PipelineScheduler::Item {
+    size_t position = 0;
+    FileResult result;
+    std::vector<AudioSample> samples;
+    Spectrogram spectrogram;
+    std::vector<Peak> peaks;
+    CompactFingerprint fingerprint;
+};
+
+namespace {
+
+/// Bytes requested per read() call of readFileAhead
+constexpr size_t readAheadChunk = size_t(1) << 20;
+
+unsigned int resolveThreads(unsigned int requested, unsigned int fallback) {
+    return requested > 0 ? requested : std::max(1u, fallback);
+}
+
+/**
+ * Decodes .wav files with the WAV reader when it can parse them and
+ * everything else with FFmpeg
+ */
+std::vector<AudioSample> decodeFile(const std::string& filePath, const FingerprintConfig& config,
+                                    DecodeOptions decodeOptions, std::string& error) {
+    std::vector<AudioSample> samples;
+    if (hasWavExtension(filePath)) {
+        WavFile wav(filePath);
+        if (wav.isValid()) {
+            auto read = wav.readAllResampled(samples, config.sampleRate);
+            if (!read.isSuccess()) {
+                error = read.getError();
+                samples.clear();
+            }
+            return samples;
+        }
+    }
+
+    decodeOptions.sampleRate = config.sampleRate;
+    auto decoded = FFmpegDecoder::decode(filePath, decodeOptions);
+    if (!decoded.isSuccess()) {
+        error = decoded.getError();
+        return samples;
+    }
+    return std::move(decoded).take();
+}
+
+} // namespace
+
+const char* pipelineStageName(PipelineStage stage) {
+    switch (stage) {
+        case PipelineStage::READ: return "read";
+        case PipelineStage::DECODE: return "decode";
+        case PipelineStage::SPECTROGRAM: return "spectrogram";
+        case PipelineStage::PEAKS: return "peaks";
+        case PipelineStage::FINGERPRINT: return "fingerprint";
+        case PipelineStage::INDEX: return "index";
+        default: return "unknown";
+    }
+}
+
+Result<uint64_t> readFileAhead(const std::string& filePath) {
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return Result<uint64_t>::createFailure("Could not open file: " + filePath + " (" + std::strerror(errno) + ")");
+    }
+#if defined(POSIX_FADV_SEQUENTIAL)
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // One buffer per read thread, reused for every file it reads
+    thread_local std::vector<char> buffer(readAheadChunk);
+    uint64_t total = 0;
+    for (;;) {
+        const ssize_t count = ::read(fd, buffer.data(), buffer.size());
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            const std::string reason = std::strerror(errno);
+            ::close(fd);
+            return Result<uint64_t>::createFailure("Could not read file: " + filePath + " (" + reason + ")");
+        }
+        if (count == 0) {
+            break;
+        }
+        total += static_cast<uint64_t>(count);
+    }
+    ::close(fd);
+    return Result<uint64_t>::createSuccess(total);
+}
+
+PipelineScheduler::PipelineScheduler(PipelineOptions options) : options(std::move(options)) {
+    const unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+    const PipelineOptions& o = this->options;
+    threads[static_cast<size_t>(PipelineStage::READ)] = resolveThreads(o.readThreads, 4);
+    threads[static_cast<size_t>(PipelineStage::DECODE)] = resolveThreads(o.decodeThreads, hardware);
+    threads[static_cast<size_t>(PipelineStage::SPECTROGRAM)] = resolveThreads(o.spectrogramThreads, hardware);
+    threads[static_cast<size_t>(PipelineStage::PEAKS)] = resolveThreads(o.peakThreads, hardware / 2);
+    threads[static_cast<size_t>(PipelineStage::FINGERPRINT)] = resolveThreads(o.fingerprintThreads, hardware / 2);
+    threads[static_cast<size_t>(PipelineStage::INDEX)] = 1;
+
+    for (size_t stage = 1; stage < pipelineStageCount; ++stage) {
+        capacities[stage] = o.queueCapacity > 0 ? o.queueCapacity : 2 * static_cast<size_t>(threads[stage]);
+    }
+}
+
+std::vector<FileResult> PipelineScheduler::run(
+    const std::vector<std::string>& paths,
+    int firstSongId,
+    const FingerprintSink& sink
+) {
+    std::vector<FileResult> results(paths.size());
+    if (paths.empty()) {
+        return results;
+    }
+
+    // queue[s] feeds stage s; the read stage takes its input from nextFile
+    std::array<std::unique_ptr<BoundedQueue<Item>>, pipelineStageCount> queue;
+    for (size_t stage = 1; stage < pipelineStageCount; ++stage) {
+        queue[stage] = std::make_unique<BoundedQueue<Item>>(capacities[stage]);
+    }
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        for (size_t stage = 0; stage < pipelineStageCount; ++stage) {
+            queues[stage] = queue[stage].get();
+            counters[stage].itemsProcessed = 0;
+            counters[stage].busyMicroseconds = 0;
+        }
+        bytesRead = 0;
+        nextFile = 0;
+        numFiles = paths.size();
+        running = true;
+        startTime = std::chrono::steady_clock::now();
+    }
+
+    const FingerprintConfig& config = options.config;
+
+    auto fail = [](Item& item, FileStatus status, std::string error) {
+        item.result.status = status;
+        item.result.error = std::move(error);
+        return false;
+    };
+
+    // Runs one item through a stage; failed items skip straight to the index stage
+    auto process = [&](PipelineStage stage, Item& item, auto&& body) {
+        const auto start = std::chrono::steady_clock::now();
+        // An exception must not escape a worker thread, so it fails the file instead
+        const FileStatus failure = stage <= PipelineStage::DECODE ? FileStatus::DECODE_FAILED
+                                                                  : FileStatus::FINGERPRINT_FAILED;
+        bool ok = false;
+        try {
+            ok = body(item);
+        } catch (const std::exception& e) {
+            ok = fail(item, failure, std::string(pipelineStageName(stage)) + " stage threw: " + e.what());
+        } catch (...) {
+            ok = fail(item, failure, std::string(pipelineStageName(stage)) + " stage threw an unknown exception");
+        }
+        StageCounters& counter = counters[static_cast<size_t>(stage)];
+        counter.busyMicroseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        counter.itemsProcessed++;
+        const size_t next = ok ? static_cast<size_t>(stage) + 1 : static_cast<size_t>(PipelineStage::INDEX);
+        queue[next]->push(std::move(item));
+    };
+
+    // The last worker to leave a stage closes the queue of the next one; by
+    // then every earlier stage has finished too, so no failure can still be
+    // on its way to the index queue when the fingerprint stage closes it
+    std::array<std::atomic<unsigned int>, pipelineStageCount> activeWorkers;
+    for (size_t stage = 0; stage < pipelineStageCount; ++stage) {
+        activeWorkers[stage] = threads[stage];
+    }
+    auto leaveStage = [&](PipelineStage stage) {
+        const size_t index = static_cast<size_t>(stage);
+        if (--activeWorkers[index] == 0) {
+            queue[index + 1]->close();
+        }
+    };
+
+    auto readWorker = [&]() {
+        for (size_t i = nextFile++; i < paths.size(); i = nextFile++) {
+            Item item;
+            item.position = i;
+            item.result.path = paths[i];
+            item.result.songId = firstSongId + static_cast<int>(i);
+            process(PipelineStage::READ, item, [&](Item& current) {
+                auto read = options.reader ? options.reader(current.result.path) : readFileAhead(current.result.path);
+                if (read.isSuccess()) {
+                    bytesRead += read.getValue();
+                } else {
+                    SORTIFY_LOG_DEBUG("Read-ahead failed, leaving it to the decoder: ", read.getError());
+                }
+                return true;
+            });
+        }
+        leaveStage(PipelineStage::READ);
+    };
+
+    auto decodeWorker = [&]() {
+        Item item;
+        while (queue[static_cast<size_t>(PipelineStage::DECODE)]->pop(item)) {
+            process(PipelineStage::DECODE, item, [&](Item& current) {
+                std::string error = "No samples decoded";
+                current.samples = options.decoder ? options.decoder(current.result.path)
+                                                  : decodeFile(current.result.path, config, options.decodeOptions, error);
+                current.result.numSamples = current.samples.size();
+                return !current.samples.empty() || fail(current, FileStatus::DECODE_FAILED, error);
+            });
+        }
+        leaveStage(PipelineStage::DECODE);
+    };
+
+    auto spectrogramWorker = [&]() {
+        QualityTrace quality;
+        quality.options = options.qualityOptions;
+        Item item;
+        while (queue[static_cast<size_t>(PipelineStage::SPECTROGRAM)]->pop(item)) {
+            process(PipelineStage::SPECTROGRAM, item, [&](Item& current) {
+                // Files are already processed in parallel, so each one uses a single FFT thread
+                auto generated = generateSpectrogramInto(current.samples, current.spectrogram, config.sampleRate,
+                                                         config.windowSize, config.overlap, config.minFreq,
+                                                         config.maxFreq, 1,
+                                                         options.analyzeQuality ? &quality : nullptr);
+                current.samples = std::vector<AudioSample>();
+                if (!generated.isSuccess()) {
+                    return fail(current, FileStatus::FINGERPRINT_FAILED, "Spectrogram failed: " + generated.getError());
+                }
+                if (options.analyzeQuality) {
+                    auto summary = summarizeQuality(quality);
+                    current.result.hasQuality = summary.isSuccess();
+                    if (current.result.hasQuality) {
+                        current.result.quality = summary.getValue();
+                    }
+                }
+                return true;
+            });
+        }
+        leaveStage(PipelineStage::SPECTROGRAM);
+    };
+
+    auto peakWorker = [&]() {
+        Item item;
+        while (queue[static_cast<size_t>(PipelineStage::PEAKS)]->pop(item)) {
+            process(PipelineStage::PEAKS, item, [&](Item& current) {
+                auto extracted = extractPeaksInto(current.spectrogram, current.peaks, config);
+                current.spectrogram = Spectrogram();
+                return extracted.isSuccess() ||
+                       fail(current, FileStatus::FINGERPRINT_FAILED, "Peak extraction failed: " + extracted.getError());
+            });
+        }
+        leaveStage(PipelineStage::PEAKS);
+    };
+
+    auto fingerprintWorker = [&]() {
+        Item item;
+        while (queue[static_cast<size_t>(PipelineStage::FINGERPRINT)]->pop(item)) {
+            process(PipelineStage::FINGERPRINT, item, [&](Item& current) {
+                auto fingerprint = createCompactFingerprint(current.peaks, config);
+                current.peaks = std::vector<Peak>();
+                if (!fingerprint.isSuccess()) {
+                    return fail(current, FileStatus::FINGERPRINT_FAILED, "Fingerprint failed: " + fingerprint.getError());
+                }
+                current.fingerprint = std::move(fingerprint).take();
+                current.result.status = FileStatus::OK;
+                current.result.numHashes = current.fingerprint.size();
+                return true;
+            });
+        }
+        leaveStage(PipelineStage::FINGERPRINT);
+    };
+
+    std::vector<std::thread> workers;
+    auto start = [&](PipelineStage stage, const std::function<void()>& worker) {
+        for (unsigned int t = 0; t < threads[static_cast<size_t>(stage)]; ++t) {
+            workers.emplace_back(worker);
+        }
+    };
+    start(PipelineStage::READ, readWorker);
+    start(PipelineStage::DECODE, decodeWorker);
+    start(PipelineStage::SPECTROGRAM, spectrogramWorker);
+    start(PipelineStage::PEAKS, peakWorker);
+    start(PipelineStage::FINGERPRINT, fingerprintWorker);
+
+    // Index stage: every file arrives here exactly once, successful or not
+    size_t succeeded = 0;
+    Item item;
+    StageCounters& indexCounter = counters[static_cast<size_t>(PipelineStage::INDEX)];
+    std::exception_ptr sinkError;
+    while (!sinkError && queue[static_cast<size_t>(PipelineStage::INDEX)]->pop(item)) {
+        const auto sinkStart = std::chrono::steady_clock::now();
+        if (item.result.status == FileStatus::OK) {
+            succeeded++;
+            if (sink) {
+                try {
+                    sink(item.result, std::move(item.fingerprint));
+                } catch (...) {
+                    sinkError = std::current_exception();
+                }
+            }
+        } else {
+            SORTIFY_LOG_WARNING("Failed to fingerprint ", item.result.path, ": ", item.result.error);
+        }
+        results[item.position] = std::move(item.result);
+        indexCounter.busyMicroseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - sinkStart).count());
+        indexCounter.itemsProcessed++;
+        item = Item();
+    }
+
+    if (sinkError) {
+        // Stop handing out files and unblock every stage: pushes into a closed
+        // queue fail and pops only drain what is already queued
+        nextFile = paths.size();
+        for (size_t stage = 1; stage < pipelineStageCount; ++stage) {
+            queue[stage]->close();
+        }
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        for (size_t stage = 1; stage < pipelineStageCount; ++stage) {
+            lastMaxDepths[stage] = queue[stage]->highWaterMark();
+        }
+        lastMaxDepths[0] = paths.size();
+        queues.fill(nullptr);
+        running = false;
+        endTime = std::chrono::steady_clock::now();
+    }
+    if (sinkError) {
+        std::rethrow_exception(sinkError);
+    }
+
+    SORTIFY_LOG_INFO("Pipeline fingerprinted ", succeeded, " of ", paths.size(), " files in ",
+                     stats().elapsedSeconds, " s");
+    return results;
+}
+
+std::vector<FileResult> PipelineScheduler::buildIndex(
+    const std::vector<std::string>& paths,
+    FingerprintIndex& index,
+    int firstSongId
+) {
+    auto results = run(paths, firstSongId, [&](const FileResult& file, CompactFingerprint&& fingerprint) {
+        auto added = index.addTrack(file.songId, fingerprint);
+        if (!added.isSuccess()) {
+            SORTIFY_LOG_WARNING("Failed to index ", file.path, ": ", added.getError());
+        }
+    });
+    index.setConfigId(hashFingerprintConfig(options.config));
+    index.build();
+    return results;
+}
+
+PipelineStats PipelineScheduler::stats() const {
+    PipelineStats snapshot;
+    std::lock_guard<std::mutex> lock(runMutex);
+    for (size_t stage = 0; stage < pipelineStageCount; ++stage) {
+        StageStats& out = snapshot.stages[stage];
+        out.threads = threads[stage];
+        out.queueCapacity = stage == 0 ? numFiles : capacities[stage];
+        out.itemsProcessed = counters[stage].itemsProcessed;
+        out.busyMicroseconds = counters[stage].busyMicroseconds;
+        if (running && stage == 0) {
+            out.queueDepth = numFiles - std::min(numFiles, nextFile.load());
+            out.maxQueueDepth = numFiles;
+        } else if (running) {
+            out.queueDepth = queues[stage]->size();
+            out.maxQueueDepth = queues[stage]->highWaterMark();
+        } else {
+            out.maxQueueDepth = lastMaxDepths[stage];
+        }
+    }
+    const auto end = running ? std::chrono::steady_clock::now() : endTime;
+    snapshot.elapsedSeconds = numFiles > 0 ? std::chrono::duration<double>(end - startTime).count() : 0.0;
+    snapshot.bytesRead = bytesRead;
+    return snapshot;
+}
+
+} // namespace audio
+} // namespace sortify
@@ -0,0 +1,272 @@
+#include "../include/resampler.hpp"
+#include "../include/logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define SORTIFY_HAS_X86_KERNELS 1
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SORTIFY_HAS_NEON_KERNELS 1
+#endif
+
+// Filter dot-product kernels
+//
+// Every kernel accumulates tap j into lane j % 8 and reduces the lanes in
+// the same order, and the tap count is a multiple of 8, so all levels
+// produce bit-identical output. That also needs every multiply-add to be
+// rounded twice: the build compiles this file with -ffp-contract=off, and
+// the pragma keeps Clang from fusing them into FMAs otherwise.
+
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+/// Coefficients per phase are padded to this many taps
+constexpr size_t tapBlock = 8;
+
+/// Largest filter bank built (L phases x taps); rate pairs with a larger L are rejected
+constexpr size_t maxBankCoefficients = size_t(1) << 21;
+
+inline float reduceLanes(const float* lanes) {
+    // lanes[k] already holds accumulator k plus accumulator k + 4
+    return (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+}
+
+float dotScalar(const float* x, const float* c, size_t n) {
+    float acc[tapBlock] = {};
+    for (size_t j = 0; j < n; j += tapBlock) {
+        for (size_t lane = 0; lane < tapBlock; ++lane) {
+            acc[lane] += x[j + lane] * c[j + lane];
+        }
+    }
+    const float lanes[4] = {acc[0] + acc[4], acc[1] + acc[5], acc[2] + acc[6], acc[3] + acc[7]};
+    return reduceLanes(lanes);
+}
+
+#if defined(SORTIFY_HAS_X86_KERNELS)
+
+float dotSse2(const float* x, const float* c, size_t n) {
+    __m128 low = _mm_setzero_ps();
+    __m128 high = _mm_setzero_ps();
+    for (size_t j = 0; j < n; j += tapBlock) {
+        low = _mm_add_ps(low, _mm_mul_ps(_mm_loadu_ps(x + j), _mm_loadu_ps(c + j)));
+        high = _mm_add_ps(high, _mm_mul_ps(_mm_loadu_ps(x + j + 4), _mm_loadu_ps(c + j + 4)));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, _mm_add_ps(low, high));
+    return reduceLanes(lanes);
+}
+
+__attribute__((target("avx2")))
+float dotAvx2(const float* x, const float* c, size_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    for (size_t j = 0; j < n; j += tapBlock) {
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(x + j), _mm256_loadu_ps(c + j)));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)));
+    return reduceLanes(lanes);
+}
+
+#endif // SORTIFY_HAS_X86_KERNELS
+
+#if defined(SORTIFY_HAS_NEON_KERNELS)
+
+float dotNeon(const float* x, const float* c, size_t n) {
+    float32x4_t low = vdupq_n_f32(0.0f);
+    float32x4_t high = vdupq_n_f32(0.0f);
+    for (size_t j = 0; j < n; j += tapBlock) {
+        // Separate multiply and add; vmlaq may be fused and round differently
+        low = vaddq_f32(low, vmulq_f32(vld1q_f32(x + j), vld1q_f32(c + j)));
+        high = vaddq_f32(high, vmulq_f32(vld1q_f32(x + j + 4), vld1q_f32(c + j + 4)));
+    }
+    float lanes[4];
+    vst1q_f32(lanes, vaddq_f32(low, high));
+    return reduceLanes(lanes);
+}
+
+#endif // SORTIFY_HAS_NEON_KERNELS
+
+float dot(const float* x, const float* c, size_t n, SimdLevel level) {
+    switch (level) {
+#if defined(SORTIFY_HAS_X86_KERNELS)
+        case SimdLevel::AVX2:
+            return dotAvx2(x, c, n);
+        case SimdLevel::SSE2:
+            return dotSse2(x, c, n);
+#endif
+#if defined(SORTIFY_HAS_NEON_KERNELS)
+        case SimdLevel::NEON:
+            return dotNeon(x, c, n);
+#endif
+        default:
+            return dotScalar(x, c, n);
+    }
+}
+
+/**
+ * Zeroth-order modified Bessel function of the first kind, by its power series
+ */
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    const double quarterSquare = x * x / 4.0;
+    for (int k = 1; k < 64 && term > sum * 1e-17; ++k) {
+        term *= quarterSquare / (static_cast<double>(k) * k);
+        sum += term;
+    }
+    return sum;
+}
+
+} // namespace
+
+Resampler::Resampler(unsigned int inputRate, unsigned int outputRate, ResamplerOptions options)
+    : inRate(inputRate), outRate(outputRate), simdLevel(options.simdLevel) {
+    if (inputRate == 0 || outputRate == 0) {
+        errorMessage = "Sample rates must be positive";
+        return;
+    }
+    if (!(options.cutoff > 0.0f && options.cutoff <= 1.0f) || options.zeroCrossings == 0) {
+        errorMessage = "Invalid resampler filter options";
+        return;
+    }
+    if (!isSimdLevelSupported(simdLevel)) {
+        simdLevel = SimdLevel::SCALAR;
+    }
+
+    const uint64_t divisor = std::gcd(inputRate, outputRate);
+    upFactor = outputRate / divisor;
+    downFactor = inputRate / divisor;
+    if (upFactor == downFactor) {
+        reset();
+        return;
+    }
+
+    // Cutoff in cycles per input sample, at the lower of the two Nyquist frequencies
+    const double ratio = std::min(1.0, static_cast<double>(upFactor) / static_cast<double>(downFactor));
+    const double cutoff = 0.5 * options.cutoff * ratio;
+    const double halfWidth = options.zeroCrossings / (2.0 * cutoff);
+    numTaps = static_cast<size_t>(2.0 * std::ceil(halfWidth));
+    numTaps = (numTaps + tapBlock - 1) / tapBlock * tapBlock;
+
+    if (upFactor * numTaps > maxBankCoefficients) {
+        errorMessage = "Unsupported sample rate ratio " + std::to_string(inputRate) + " -> " +
+                       std::to_string(outputRate) + " Hz";
+        return;
+    }
+
+    // Phase p serves outputs that fall p/L of an input sample after their first
+    // centre tap; tap j is applied to input (floor(x) - numTaps/2 + 1 + j)
+    const double windowNorm = besselI0(options.kaiserBeta);
+    const double center = static_cast<double>(numTaps / 2 - 1);
+    bank.resize(upFactor * numTaps);
+    std::vector<double> taps(numTaps);
+    for (uint64_t phase = 0; phase < upFactor; ++phase) {
+        const double fraction = static_cast<double>(phase) / static_cast<double>(upFactor);
+        double sum = 0.0;
+        for (size_t j = 0; j < numTaps; ++j) {
+            const double distance = fraction + center - static_cast<double>(j);
+            const double position = distance / halfWidth;
+            double value = 0.0;
+            if (std::abs(position) < 1.0) {
+                const double argument = 2.0 * cutoff * distance;
+                const double sinc = argument == 0.0 ? 1.0 : std::sin(M_PI * argument) / (M_PI * argument);
+                value = sinc * besselI0(options.kaiserBeta * std::sqrt(1.0 - position * position)) / windowNorm;
+            }
+            taps[j] = value;
+            sum += value;
+        }
+        // Unit gain at DC for every phase
+        for (size_t j = 0; j < numTaps; ++j) {
+            bank[phase * numTaps + j] = static_cast<float>(taps[j] / sum);
+        }
+    }
+
+    SORTIFY_LOG_DEBUG("Resampler ", inputRate, " -> ", outputRate, " Hz: ", upFactor, " phases of ",
+                      numTaps, " taps");
+    reset();
+}
+
+void Resampler::reset() {
+    history.assign(numTaps > 0 ? numTaps / 2 - 1 : 0, 0.0f);
+    historyStart = 0;
+    nextTap = 0;
+    nextPhase = 0;
+    inputCount = 0;
+    outputCount = 0;
+}
+
+void Resampler::emitAvailable(std::vector<AudioSample>& output, uint64_t limit) {
+    const uint64_t historyEnd = historyStart + history.size();
+    while (outputCount < limit && nextTap + numTaps <= historyEnd) {
+        output.push_back(dot(history.data() + (nextTap - historyStart), bank.data() + nextPhase * numTaps,
+                             numTaps, simdLevel));
+        ++outputCount;
+        nextPhase += downFactor;
+        nextTap += nextPhase / upFactor;
+        nextPhase %= upFactor;
+    }
+
+    // Keep only the input that later outputs still need
+    const uint64_t consumed = std::min<uint64_t>(nextTap - historyStart, history.size());
+    history.erase(history.begin(), history.begin() + consumed);
+    historyStart += consumed;
+}
+
+size_t Resampler::process(const AudioSample* input, size_t count, std::vector<AudioSample>& output) {
+    if (!isValid() || count == 0) {
+        return 0;
+    }
+    const size_t before = output.size();
+    inputCount += count;
+    if (numTaps == 0) {
+        output.insert(output.end(), input, input + count);
+        outputCount += count;
+        return count;
+    }
+
+    output.reserve(before + outputLength(count) + 1);
+    history.insert(history.end(), input, input + count);
+    emitAvailable(output, UINT64_MAX);
+    return output.size() - before;
+}
+
+size_t Resampler::finish(std::vector<AudioSample>& output) {
+    if (!isValid() || numTaps == 0) {
+        return 0;
+    }
+    const size_t before = output.size();
+    // Zeros past the end let the last outputs see a full filter
+    history.resize(history.size() + numTaps, 0.0f);
+    emitAvailable(output, outputLength(inputCount));
+    return output.size() - before;
+}
+
+Result<std::vector<AudioSample>> resampleAudio(
+    const std::vector<AudioSample>& samples,
+    unsigned int inputRate,
+    unsigned int outputRate,
+    const ResamplerOptions& options
+) {
+    Resampler resampler(inputRate, outputRate, options);
+    if (!resampler.isValid()) {
+        return Result<std::vector<AudioSample>>::createFailure(resampler.getError());
+    }
+
+    std::vector<AudioSample> output;
+    output.reserve(resampler.outputLength(samples.size()));
+    resampler.process(samples.data(), samples.size(), output);
+    resampler.finish(output);
+    return Result<std::vector<AudioSample>>::createSuccess(std::move(output));
+}
+
+} // namespace audio
+} // namespace sortify
@@ -0,0 +1,321 @@
+#include "../include/segment_fingerprint.hpp"
+#include "../include/fingerprint_stream.hpp"
+#include "../include/logger.hpp"
+#include "../include/resampler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+/**
+ * @struct SampleRange
+ * @brief A TimeRange snapped to the window grid of the full track
+ */
+struct SampleRange {
+    size_t firstSample;  ///< Always a multiple of the step size
+    size_t numSamples;
+    uint32_t firstFrame; ///< Window index of firstSample in the full track
+};
+
+/// Delivers the samples of one range to a block callback
+using SampleSource = std::function<Result<size_t>(const SampleBlockCallback& callback)>;
+
+std::vector<SampleRange> toSampleRanges(const std::vector<TimeRange>& ranges, const SpectrogramLayout& layout,
+                                        unsigned int sampleRate, size_t totalSamples) {
+    std::vector<SampleRange> result;
+    for (const TimeRange& range : ranges) {
+        const double start = std::max(0.0, range.startSeconds);
+        const double end = start + std::max(0.0, range.durationSeconds);
+
+        // Snap down to a window start so frame k of the range is frame firstFrame + k of the track
+        const size_t firstFrame = static_cast<size_t>(std::floor(start * sampleRate / layout.stepSize));
+        const size_t firstSample = firstFrame * layout.stepSize;
+        const size_t endSample = std::min(totalSamples, static_cast<size_t>(std::ceil(end * sampleRate)));
+        if (endSample <= firstSample || firstFrame > UINT32_MAX) {
+            continue;
+        }
+        result.push_back({firstSample, endSample - firstSample, static_cast<uint32_t>(firstFrame)});
+    }
+    return result;
+}
+
+/**
+ * Streams one range through a FingerprintStream and appends its hashes with absolute frames
+ *
+ * @return Empty string on success, otherwise the error
+ */
+std::string appendRangeHashes(const SampleSource& source, uint32_t firstFrame,
+                              const FingerprintConfig& config, std::vector<HashRecord>& records) {
+    FingerprintStream stream(0, config);
+    if (!stream.isValid()) {
+        return stream.getError();
+    }
+
+    std::vector<FingerprintHash> hashes;
+    std::string streamError;
+    auto delivered = source([&](const AudioSample* samples, size_t count) {
+        auto pushed = stream.pushSamples(samples, count, hashes);
+        if (!pushed.isSuccess()) {
+            streamError = pushed.getError();
+            return false;
+        }
+        return true;
+    });
+    if (!streamError.empty()) {
+        return streamError;
+    }
+    if (!delivered.isSuccess()) {
+        return delivered.getError();
+    }
+
+    auto finished = stream.finish(hashes);
+    if (!finished.isSuccess()) {
+        return finished.getError();
+    }
+
+    for (const FingerprintHash& hash : hashes) {
+        records.push_back({hash.hash, firstFrame + static_cast<uint32_t>(std::lround(hash.time))});
+    }
+    return "";
+}
+
+/**
+ * Fingerprints every range from its source and merges the results
+ */
+Result<CompactFingerprint> fingerprintRanges(
+    const std::vector<SampleRange>& ranges,
+    const FingerprintConfig& config,
+    const std::function<SampleSource(const SampleRange&)>& makeSource
+) {
+    if (ranges.empty()) {
+        return Result<CompactFingerprint>::createFailure("No requested range lies within the track");
+    }
+
+    std::vector<HashRecord> records;
+    for (const SampleRange& range : ranges) {
+        std::string error = appendRangeHashes(makeSource(range), range.firstFrame, config, records);
+        if (!error.empty()) {
+            return Result<CompactFingerprint>::createFailure(error);
+        }
+    }
+
+    if (records.empty()) {
+        return Result<CompactFingerprint>::createFailure("Failed to create any fingerprint hashes");
+    }
+
+    // Overlapping ranges produce some records twice; the constructor removes them
+    return Result<CompactFingerprint>::createSuccess(CompactFingerprint(std::move(records)));
+}
+
+Result<SpectrogramLayout> layoutFor(const FingerprintConfig& config) {
+    return computeSpectrogramLayout(config.sampleRate, config.windowSize, config.overlap,
+                                    config.minFreq, config.maxFreq);
+}
+
+/**
+ * Fingerprints ranges of a WAV file whose native rate differs from the analysis rate
+ *
+ * Each range reads the native frames it covers, downmixes them and passes
+ * them through a freshly reset resampler, so ranges stay independent.
+ */
+Result<CompactFingerprint> fingerprintResampledWavRanges(
+    const WavFile& file,
+    const std::vector<TimeRange>& ranges,
+    const FingerprintConfig& config,
+    const SpectrogramLayout& layout
+) {
+    const uint64_t nativeRate = file.format().sampleRate;
+    const uint64_t rate = config.sampleRate;
+    Resampler resampler(file.format().sampleRate, config.sampleRate);
+    if (!resampler.isValid()) {
+        return Result<CompactFingerprint>::createFailure(resampler.getError());
+    }
+
+    std::vector<AudioSample> block(16384);
+    std::vector<AudioSample> converted;
+    auto sampleRanges = toSampleRanges(ranges, layout, config.sampleRate,
+                                       resampler.outputLength(file.format().numFrames));
+    return fingerprintRanges(sampleRanges, config, [&](const SampleRange& range) -> SampleSource {
+        return [&, range](const SampleBlockCallback& callback) {
+            resampler.reset();
+            converted.clear();
+            const uint64_t firstFrame = range.firstSample * nativeRate / rate;
+            const uint64_t lastFrame = ((range.firstSample + range.numSamples) * nativeRate + rate - 1) / rate;
+
+            size_t delivered = 0;
+            bool stopped = false;
+            auto deliver = [&]() {
+                const size_t count = std::min(converted.size(), range.numSamples - delivered);
+                delivered += count;
+                if (count > 0 && !callback(converted.data(), count)) {
+                    stopped = true;
+                }
+                converted.clear();
+            };
+
+            for (uint64_t frame = firstFrame; frame < lastFrame && !stopped && delivered < range.numSamples;) {
+                const size_t count = file.read(frame, std::min<uint64_t>(block.size(), lastFrame - frame), block.data());
+                if (count == 0) {
+                    break;
+                }
+                frame += count;
+                resampler.process(block.data(), count, converted);
+                deliver();
+            }
+            if (!stopped && delivered < range.numSamples) {
+                resampler.finish(converted);
+                deliver();
+            }
+            return Result<size_t>::createSuccess(delivered);
+        };
+    });
+}
+
+} // namespace
+
+const std::vector<double>& defaultSegmentPositions() {
+    static const std::vector<double> positions = {0.2, 0.5, 0.8};
+    return positions;
+}
+
+std::vector<TimeRange> planSegments(double trackSeconds, double segmentSeconds, const std::vector<double>& positions) {
+    if (trackSeconds <= 0.0 || segmentSeconds <= 0.0 || positions.empty()) {
+        return {};
+    }
+    if (trackSeconds <= segmentSeconds * static_cast<double>(positions.size())) {
+        return {{0.0, trackSeconds}};
+    }
+
+    std::vector<TimeRange> ranges;
+    for (double position : positions) {
+        const double centre = std::clamp(position, 0.0, 1.0) * trackSeconds;
+        const double start = std::clamp(centre - segmentSeconds / 2.0, 0.0, trackSeconds - segmentSeconds);
+        ranges.push_back({start, segmentSeconds});
+    }
+    std::sort(ranges.begin(), ranges.end(),
+              [](const TimeRange& a, const TimeRange& b) { return a.startSeconds < b.startSeconds; });
+    return ranges;
+}
+
+Result<CompactFingerprint> fingerprintSampleRanges(
+    const std::vector<AudioSample>& samples,
+    const std::vector<TimeRange>& ranges,
+    const FingerprintConfig& config
+) {
+    auto layout = layoutFor(config);
+    if (!layout.isSuccess()) {
+        return Result<CompactFingerprint>::createFailure(layout.getError());
+    }
+
+    auto sampleRanges = toSampleRanges(ranges, layout.getValue(), config.sampleRate, samples.size());
+    return fingerprintRanges(sampleRanges, config, [&](const SampleRange& range) -> SampleSource {
+        return [&samples, range](const SampleBlockCallback& callback) {
+            callback(samples.data() + range.firstSample, range.numSamples);
+            return Result<size_t>::createSuccess(range.numSamples);
+        };
+    });
+}
+
+Result<CompactFingerprint> fingerprintWavRanges(
+    const WavFile& file,
+    const std::vector<TimeRange>& ranges,
+    const FingerprintConfig& config
+) {
+    if (!file.isValid()) {
+        return Result<CompactFingerprint>::createFailure(file.getError());
+    }
+    auto layout = layoutFor(config);
+    if (!layout.isSuccess()) {
+        return Result<CompactFingerprint>::createFailure(layout.getError());
+    }
+
+    if (file.format().sampleRate != config.sampleRate) {
+        return fingerprintResampledWavRanges(file, ranges, config, layout.getValue());
+    }
+
+    // Convert each range in blocks straight from the mapping
+    std::vector<AudioSample> block(16384);
+    auto sampleRanges = toSampleRanges(ranges, layout.getValue(), config.sampleRate, file.format().numFrames);
+    return fingerprintRanges(sampleRanges, config, [&](const SampleRange& range) -> SampleSource {
+        return [&file, &block, range](const SampleBlockCallback& callback) {
+            size_t delivered = 0;
+            while (delivered < range.numSamples) {
+                const size_t count = file.read(range.firstSample + delivered,
+                                               std::min(block.size(), range.numSamples - delivered), block.data());
+                if (count == 0) {
+                    break;
+                }
+                delivered += count;
+                if (!callback(block.data(), count)) {
+                    break;
+                }
+            }
+            return Result<size_t>::createSuccess(delivered);
+        };
+    });
+}
+
+Result<CompactFingerprint> fingerprintFileRanges(
+    const std::string& filePath,
+    const std::vector<TimeRange>& ranges,
+    const FingerprintConfig& config,
+    const DecodeOptions& decodeOptions
+) {
+    if (hasWavExtension(filePath)) {
+        WavFile file(filePath);
+        if (file.isValid()) {
+            return fingerprintWavRanges(file, ranges, config);
+        }
+    }
+
+    auto layout = layoutFor(config);
+    if (!layout.isSuccess()) {
+        return Result<CompactFingerprint>::createFailure(layout.getError());
+    }
+
+    // The decoder clips ranges to the end of the file, so no limit is needed here
+    auto sampleRanges = toSampleRanges(ranges, layout.getValue(), config.sampleRate, SIZE_MAX);
+    return fingerprintRanges(sampleRanges, config, [&](const SampleRange& range) -> SampleSource {
+        DecodeOptions options = decodeOptions;
+        options.sampleRate = config.sampleRate;
+        options.startSeconds = static_cast<double>(range.firstSample) / config.sampleRate;
+        options.durationSeconds = static_cast<double>(range.numSamples) / config.sampleRate;
+        return [&filePath, options](const SampleBlockCallback& callback) {
+            return FFmpegDecoder::decodeStream(filePath, callback, options);
+        };
+    });
+}
+
+Result<CompactFingerprint> fingerprintFileSegments(
+    const std::string& filePath,
+    const FingerprintConfig& config,
+    double segmentSeconds,
+    const std::vector<double>& positions,
+    const DecodeOptions& decodeOptions
+) {
+    double duration = 0.0;
+    if (hasWavExtension(filePath)) {
+        WavFile file(filePath);
+        if (file.isValid()) {
+            duration = file.durationSeconds();
+        }
+    }
+    if (duration <= 0.0) {
+        auto probed = FFmpegDecoder::probeDuration(filePath, decodeOptions);
+        if (!probed.isSuccess()) {
+            return Result<CompactFingerprint>::createFailure(probed.getError());
+        }
+        duration = probed.getValue();
+    }
+
+    auto ranges = planSegments(duration, segmentSeconds, positions);
+    SORTIFY_LOG_DEBUG("Fingerprinting ", ranges.size(), " segments of ", filePath);
+    return fingerprintFileRanges(filePath, ranges, config, decodeOptions);
+}
+
+} // namespace audio
+} // namespace sortify
@@ -0,0 +1,500 @@
+#include "../include/sharded_index.hpp"
+#include "../include/index_file.hpp"
+#include "../include/logger.hpp"
+#include "../include/metrics.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <unistd.h>
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+/// Reader threads that get a slot of their own; further threads share an overflow counter
+constexpr size_t maxReaderSlots = 128;
+
+/**
+ * @struct ReaderSlot
+ * @brief Epoch announced by one reader thread (0 = not reading)
+ */
+struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> claimed{false};
+};
+
+// Shared by all indexes; a reader of one index only delays reclamation in the others
+ReaderSlot readerSlots[maxReaderSlots];
+std::atomic<uint64_t> globalEpoch{1};
+std::atomic<size_t> overflowReaders{0};
+
+/**
+ * @struct ReaderRegistration
+ * @brief Claims a reader slot for the lifetime of a thread
+ */
+struct ReaderRegistration {
+    ReaderSlot* slot = nullptr;
+    unsigned int depth = 0;
+
+    ReaderRegistration() {
+        for (ReaderSlot& candidate : readerSlots) {
+            bool expected = false;
+            if (candidate.claimed.compare_exchange_strong(expected, true)) {
+                slot = &candidate;
+                break;
+            }
+        }
+    }
+
+    ~ReaderRegistration() {
+        if (slot) {
+            slot->epoch.store(0);
+            slot->claimed.store(false);
+        }
+    }
+};
+
+/**
+ * @class EpochGuard
+ * @brief Keeps every snapshot loaded while it lives from being freed
+ *
+ * The slot store and the later snapshot load are sequentially consistent,
+ * so a writer that no longer sees the announcement has already published
+ * the snapshot this reader will load.
+ */
+class EpochGuard {
+public:
+    EpochGuard() : registration(threadRegistration()) {
+        if (!registration.slot) {
+            overflowReaders.fetch_add(1);
+        } else if (registration.depth++ == 0) {
+            registration.slot->epoch.store(globalEpoch.load());
+        }
+    }
+
+    ~EpochGuard() {
+        if (!registration.slot) {
+            overflowReaders.fetch_sub(1);
+        } else if (--registration.depth == 0) {
+            registration.slot->epoch.store(0);
+        }
+    }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+private:
+    static ReaderRegistration& threadRegistration() {
+        thread_local ReaderRegistration registration;
+        return registration;
+    }
+
+    ReaderRegistration& registration;
+};
+
+/**
+ * Size tier of a segment: segments in one tier differ by less than a factor of fanIn
+ */
+unsigned int sizeTier(size_t postings, unsigned int fanIn) {
+    unsigned int tier = 0;
+    while (postings >= fanIn) {
+        postings /= fanIn;
+        tier++;
+    }
+    return tier;
+}
+
+} // namespace
+
+/**
+ * @struct ShardedIndex::Segment
+ * @brief Immutable part of one shard, held in memory or mapped from a file
+ */
+struct ShardedIndex::Segment {
+    std::unique_ptr<FingerprintIndex> memory;
+    std::unique_ptr<MappedIndex> mapped;
+    std::string path;   ///< Index file owned by the segment, removed with it
+    size_t postings = 0;
+
+    ~Segment() {
+        mapped.reset();
+        if (!path.empty()) {
+            std::remove(path.c_str());
+        }
+    }
+
+    /**
+     * Get the postings of one hash; mapped lists are decoded into scratch
+     */
+    const Posting* find(uint32_t hash, size_t& count, std::vector<Posting>& scratch) const {
+        if (memory) {
+            return memory->findPostings(hash, count);
+        }
+        scratch.clear();
+        mapped->decodePostings(hash, scratch);
+        count = scratch.size();
+        return scratch.data();
+    }
+
+    /**
+     * Stages every posting of the segment into another index
+     */
+    void appendTo(FingerprintIndex& target) const {
+        if (memory) {
+            const auto& hashes = memory->hashKeys();
+            const auto& offsets = memory->postingOffsets();
+            const Posting* all = memory->allPostings().data();
+            for (size_t row = 0; row < hashes.size(); ++row) {
+                target.addPostings(hashes[row], all + offsets[row], static_cast<size_t>(offsets[row + 1] - offsets[row]));
+            }
+            return;
+        }
+        std::vector<Posting> list;
+        for (size_t row = 0; row < mapped->hashCount(); ++row) {
+            const uint32_t hash = mapped->hashAt(row);
+            list.clear();
+            mapped->decodePostings(hash, list);
+            target.addPostings(hash, list.data(), list.size());
+        }
+    }
+};
+
+/**
+ * @struct ShardedIndex::Snapshot
+ * @brief Segments visible to queries; never modified once published
+ */
+struct ShardedIndex::Snapshot {
+    std::vector<SegmentList> shards;
+    size_t trackCount = 0;
+    uint64_t version = 0;
+};
+
+ShardedIndex::ShardedIndex(ShardedIndexOptions options) : options(std::move(options)) {
+    if (this->options.shardBits > 16) {
+        SORTIFY_LOG_WARNING("Limiting sharded index to 16 shard bits (", this->options.shardBits, " requested)");
+        this->options.shardBits = 16;
+    }
+    staging.resize(shardCount());
+    for (FingerprintIndex& shard : staging) {
+        shard.setBloomBitsPerKey(this->options.bloomBitsPerKey);
+    }
+    if (this->options.backgroundCompaction) {
+        compactionThread = std::thread(&ShardedIndex::compactionLoop, this);
+    }
+}
+
+ShardedIndex::~ShardedIndex() {
+    {
+        std::lock_guard<std::mutex> lock(compactionMutex);
+        stopping = true;
+    }
+    compactionWake.notify_all();
+    if (compactionThread.joinable()) {
+        compactionThread.join();
+    }
+
+    // No query may still run while the index is destroyed
+    delete current.load();
+    for (auto& entry : retired) {
+        delete entry.second;
+    }
+}
+
+Result<size_t> ShardedIndex::addTrack(int songId, const CompactFingerprint& fingerprint) {
+    if (fingerprint.empty()) {
+        return Result<size_t>::createFailure("Empty fingerprint provided for song " + std::to_string(songId));
+    }
+
+    std::lock_guard<std::mutex> lock(writerMutex);
+    if (!songIds.insert(songId).second) {
+        return Result<size_t>::createFailure("Song " + std::to_string(songId) + " is already indexed");
+    }
+
+    // Records are sorted by hash, so each shard's records are one contiguous run
+    const HashRecord* first = fingerprint.begin();
+    while (first != fingerprint.end()) {
+        const size_t shard = shardOf(first->hash);
+        const HashRecord* last = first;
+        while (last != fingerprint.end() && shardOf(last->hash) == shard) {
+            ++last;
+        }
+        staging[shard].addTrack(songId, CompactFingerprint::fromSortedRecords(first, last));
+        first = last;
+    }
+
+    stagedRecords += fingerprint.size();
+    stagedTracks++;
+    if (stagedRecords >= options.segmentRecords) {
+        publishLocked();
+    }
+    return Result<size_t>::createSuccess(fingerprint.size());
+}
+
+size_t ShardedIndex::flush() {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    const size_t published = publishLocked();
+    // Also frees snapshots that readers still held at the last publish
+    reclaimLocked();
+    return published;
+}
+
+size_t ShardedIndex::publishLocked() {
+    const size_t tracks = stagedTracks.load();
+    if (tracks == 0) {
+        return 0;
+    }
+
+    const Snapshot* previous = current.load();
+    auto next = std::make_unique<Snapshot>();
+    next->shards = previous ? previous->shards : std::vector<SegmentList>(shardCount());
+
+    // Every shard gets its part of the staged tracks in the same snapshot
+    for (size_t shard = 0; shard < staging.size(); ++shard) {
+        if (!staging[shard].hasPendingTracks()) {
+            continue;
+        }
+        staging[shard].build();
+        auto segment = std::make_shared<Segment>();
+        segment->postings = staging[shard].postingCount();
+        segment->memory = std::make_unique<FingerprintIndex>(std::move(staging[shard]));
+        next->shards[shard].push_back(std::move(segment));
+
+        staging[shard] = FingerprintIndex();
+        staging[shard].setBloomBitsPerKey(options.bloomBitsPerKey);
+    }
+
+    publishedTracks += tracks;
+    next->trackCount = publishedTracks;
+    replaceSnapshotLocked(std::move(next));
+    stagedRecords = 0;
+    stagedTracks = 0;
+
+    if (options.backgroundCompaction) {
+        {
+            std::lock_guard<std::mutex> lock(compactionMutex);
+            compactionRequested = true;
+        }
+        compactionWake.notify_one();
+    }
+    return tracks;
+}
+
+void ShardedIndex::replaceSnapshotLocked(std::unique_ptr<Snapshot> next) {
+    next->version = ++version;
+    const Snapshot* previous = current.exchange(next.release());
+    if (previous) {
+        // Readers announcing an epoch below this one may still hold the previous snapshot
+        retired.emplace_back(globalEpoch.fetch_add(1) + 1, previous);
+    }
+    reclaimLocked();
+}
+
+void ShardedIndex::reclaimLocked() {
+    if (retired.empty() || overflowReaders.load() > 0) {
+        return;
+    }
+
+    uint64_t oldestActive = std::numeric_limits<uint64_t>::max();
+    for (const ReaderSlot& slot : readerSlots) {
+        const uint64_t epoch = slot.epoch.load();
+        if (epoch != 0) {
+            oldestActive = std::min(oldestActive, epoch);
+        }
+    }
+
+    auto freeable = [oldestActive](const std::pair<uint64_t, const Snapshot*>& entry) {
+        return entry.first <= oldestActive;
+    };
+    for (auto& entry : retired) {
+        if (freeable(entry)) {
+            delete entry.second;
+        }
+    }
+    retired.erase(std::remove_if(retired.begin(), retired.end(), freeable), retired.end());
+}
+
+size_t ShardedIndex::compact() {
+    std::lock_guard<std::mutex> lock(compactionRunMutex);
+    size_t merges = 0;
+    while (!stopping && compactOnce()) {
+        merges++;
+    }
+    return merges;
+}
+
+bool ShardedIndex::compactOnce() {
+    if (options.compactionFanIn < 2) {
+        return false;
+    }
+
+    // Pick the smallest full tier of the first shard that has one
+    size_t shard = 0;
+    SegmentList parts;
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        const Snapshot* snapshot = current.load();
+        if (!snapshot) {
+            return false;
+        }
+        for (size_t candidate = 0; candidate < snapshot->shards.size() && parts.empty(); ++candidate) {
+            const SegmentList& segments = snapshot->shards[candidate];
+            if (segments.size() < options.compactionFanIn) {
+                continue;
+            }
+            std::vector<std::pair<unsigned int, size_t>> tiers;
+            for (size_t i = 0; i < segments.size(); ++i) {
+                tiers.emplace_back(sizeTier(segments[i]->postings, options.compactionFanIn), i);
+            }
+            std::sort(tiers.begin(), tiers.end());
+            for (size_t i = 0; i + options.compactionFanIn <= tiers.size(); ++i) {
+                if (tiers[i].first == tiers[i + options.compactionFanIn - 1].first) {
+                    for (size_t j = i; j < i + options.compactionFanIn; ++j) {
+                        parts.push_back(segments[tiers[j].second]);
+                    }
+                    shard = candidate;
+                    break;
+                }
+            }
+        }
+        if (parts.empty()) {
+            return false;
+        }
+    }
+
+    // Merge without holding the writer lock; only compaction removes segments
+    std::shared_ptr<const Segment> merged = mergeSegments(shard, parts);
+
+    std::lock_guard<std::mutex> lock(writerMutex);
+    auto next = std::make_unique<Snapshot>(*current.load());
+    SegmentList& segments = next->shards[shard];
+    segments.erase(std::remove_if(segments.begin(), segments.end(), [&parts](const std::shared_ptr<const Segment>& s) {
+        return std::find(parts.begin(), parts.end(), s) != parts.end();
+    }), segments.end());
+    segments.push_back(std::move(merged));
+    replaceSnapshotLocked(std::move(next));
+    return true;
+}
+
+std::shared_ptr<const ShardedIndex::Segment> ShardedIndex::mergeSegments(size_t shard, const SegmentList& parts) {
+    FingerprintIndex merged;
+    merged.setBloomBitsPerKey(options.bloomBitsPerKey);
+    for (const auto& part : parts) {
+        part->appendTo(merged);
+    }
+    merged.build();
+
+    auto segment = std::make_shared<Segment>();
+    segment->postings = merged.postingCount();
+
+    if (!options.compactionDirectory.empty()) {
+        const std::string path = options.compactionDirectory + "/sortify-" + std::to_string(::getpid()) +
+                                 "-" + std::to_string(reinterpret_cast<uintptr_t>(this)) + "-s" +
+                                 std::to_string(shard) + "-" + std::to_string(nextFileNumber++) + ".idx";
+        auto written = writeIndexFile(merged, path);
+        if (written.isSuccess()) {
+            auto mapped = std::make_unique<MappedIndex>(path);
+            if (mapped->isValid()) {
+                segment->mapped = std::move(mapped);
+                segment->path = path;
+                return segment;
+            }
+            SORTIFY_LOG_WARNING("Keeping compacted segment in memory: ", mapped->getError());
+            std::remove(path.c_str());
+        } else {
+            SORTIFY_LOG_WARNING("Keeping compacted segment in memory: ", written.getError());
+        }
+    }
+
+    segment->memory = std::make_unique<FingerprintIndex>(std::move(merged));
+    return segment;
+}
+
+void ShardedIndex::compactionLoop() {
+    std::unique_lock<std::mutex> lock(compactionMutex);
+    while (true) {
+        compactionWake.wait(lock, [this] { return compactionRequested || stopping; });
+        if (stopping) {
+            return;
+        }
+        compactionRequested = false;
+        lock.unlock();
+        const size_t merges = compact();
+        if (merges > 0) {
+            SORTIFY_LOG_DEBUG("Sharded index compaction merged ", merges, " segment groups");
+        }
+        lock.lock();
+    }
+}
+
+Result<std::vector<MatchCandidate>> ShardedIndex::query(
+    const CompactFingerprint& sample,
+    size_t maxResults,
+    unsigned int minScore
+) const {
+    ScopedTimer timer(MetricStage::INDEX_QUERY);
+    if (sample.empty()) {
+        return Result<std::vector<MatchCandidate>>::createFailure("Empty sample fingerprint provided");
+    }
+
+    EpochGuard guard;
+    const Snapshot* snapshot = current.load();
+    if (!snapshot || snapshot->trackCount == 0) {
+        return Result<std::vector<MatchCandidate>>::createFailure("Fingerprint index is empty; call flush() after adding tracks");
+    }
+
+    MatchAccumulator accumulator;
+    std::vector<Posting> scratch;
+    const HashRecord* record = sample.begin();
+    while (record != sample.end()) {
+        const uint32_t hash = record->hash;
+        const HashRecord* runEnd = record;
+        while (runEnd != sample.end() && runEnd->hash == hash) {
+            ++runEnd;
+        }
+
+        // Segments of a shard hold disjoint songs, so their votes simply add up
+        for (const auto& segment : snapshot->shards[shardOf(hash)]) {
+            size_t count = 0;
+            const Posting* list = segment->find(hash, count, scratch);
+            for (const HashRecord* r = record; r != runEnd; ++r) {
+                for (size_t p = 0; p < count; ++p) {
+                    accumulator.addVote(list[p].songId, list[p].anchorFrame, r->anchorFrame);
+                }
+            }
+        }
+        record = runEnd;
+    }
+
+    Metrics::add(MetricCounter::QUERIES, 1);
+    return Result<std::vector<MatchCandidate>>::createSuccess(
+        accumulator.rank(sample.size(), maxResults, minScore));
+}
+
+ShardedIndexStats ShardedIndex::stats() const {
+    ShardedIndexStats result;
+    result.pendingTracks = stagedTracks.load();
+
+    EpochGuard guard;
+    const Snapshot* snapshot = current.load();
+    if (!snapshot) {
+        return result;
+    }
+    result.trackCount = snapshot->trackCount;
+    result.version = snapshot->version;
+    for (const SegmentList& segments : snapshot->shards) {
+        for (const auto& segment : segments) {
+            result.segmentCount++;
+            result.postingCount += segment->postings;
+            if (segment->mapped) {
+                result.mappedSegments++;
+            } else {
+                result.memoryBytes += segment->memory->memoryBytes();
+            }
+        }
+    }
+    return result;
+}
+
+} // namespace audio
+} // namespace sortify
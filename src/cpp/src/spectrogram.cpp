@@ -1,15 +1,74 @@
 #include "../include/audio_fingerprint.hpp"
 #include "../include/logger.hpp"
+#include "../include/fft_plan_cache.hpp"
+#include "../include/fingerprint_stages.hpp"
+#include "../include/metrics.hpp"
+#include "../include/audio_quality.hpp"
 #include <vector>
 #include <complex>
 #include <cmath>
 #include <algorithm>
-// Use explicit path for M1/M2 Mac with Homebrew
-#include </opt/homebrew/include/fftw3.h>
+#include <string>
+#include <thread>
 
 namespace sortify {
 namespace audio {
 
+Spectrogram::Spectrogram(unsigned int numFrames, unsigned int numBins, std::pmr::memory_resource* resource)
+    : buffer(AlignedAllocator<float, frameAlignment>(resource)) {
+    resize(numFrames, numBins);
+}
+
+void Spectrogram::resize(unsigned int numFrames, unsigned int numBins) {
+    // Round each frame up to a whole number of cache lines so every frame
+    // starts aligned and vector loads never split a line
+    const std::size_t floatsPerLine = frameAlignment / sizeof(float);
+    frames = numFrames;
+    bins = numBins;
+    frameStride = (numBins + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+    buffer.assign(static_cast<std::size_t>(numFrames) * frameStride, 0.0f);
+}
+
+Spectrogram Spectrogram::clone() const {
+    Spectrogram copy;
+    copy.frames = frames;
+    copy.bins = bins;
+    copy.frameStride = frameStride;
+    copy.buffer.assign(buffer.begin(), buffer.end());
+    return copy;
+}
+
+Spectrogram Spectrogram::fromLegacy(const LegacySpectrogram& legacy) {
+    if (legacy.empty() || legacy[0].empty()) {
+        return Spectrogram();
+    }
+    
+    const unsigned int numBins = legacy.size();
+    const unsigned int numFrames = legacy[0].size();
+    Spectrogram spectrogram(numFrames, numBins);
+    
+    for (unsigned int bin = 0; bin < numBins; ++bin) {
+        const std::vector<float>& row = legacy[bin];
+        const unsigned int rowFrames = std::min<std::size_t>(row.size(), numFrames);
+        for (unsigned int t = 0; t < rowFrames; ++t) {
+            spectrogram.at(t, bin) = row[t];
+        }
+    }
+    
+    return spectrogram;
+}
+
+LegacySpectrogram Spectrogram::toLegacy() const {
+    LegacySpectrogram legacy(bins, std::vector<float>(frames, 0.0f));
+    for (unsigned int t = 0; t < frames; ++t) {
+        const float* bin = buffer.data() + t * frameStride;
+        for (unsigned int f = 0; f < bins; ++f) {
+            legacy[f][t] = bin[f];
+        }
+    }
+    return legacy;
+}
+
 /**
  * Helper function to create a Hamming window
  * 
@@ -28,194 +87,358 @@ std::vector<float> createHammingWindow(unsigned int size) {
     return window;
 }
 
+Result<SpectrogramLayout> computeSpectrogramLayout(
+    unsigned int sampleRate,
+    unsigned int windowSize,
+    float overlap,
+    float minFreq,
+    float maxFreq
+) {
+    // Validate parameters
+    if (sampleRate == 0) {
+        return Result<SpectrogramLayout>::createFailure("Sample rate cannot be zero");
+    }
+    
+    if (windowSize == 0) {
+        return Result<SpectrogramLayout>::createFailure("Window size cannot be zero");
+    }
+    
+    if (overlap < 0.0f || overlap >= 1.0f) {
+        return Result<SpectrogramLayout>::createFailure("Overlap must be between 0.0 and 1.0 (exclusive)");
+    }
+    
+    if (minFreq < 0.0f) {
+        return Result<SpectrogramLayout>::createFailure("Minimum frequency cannot be negative");
+    }
+    
+    if (maxFreq <= minFreq) {
+        return Result<SpectrogramLayout>::createFailure("Maximum frequency must be greater than minimum frequency");
+    }
+    
+    // Calculate step size between windows based on overlap
+    unsigned int stepSize = static_cast<unsigned int>(windowSize * (1.0f - overlap));
+    if (stepSize == 0) stepSize = 1; // Prevent division by zero
+    
+    // Calculate frequency range to keep
+    // Each FFT bin represents a frequency range of (sample_rate / window_size) Hz
+    // We convert our min/max frequency thresholds to corresponding FFT bin indices
+    unsigned int binSize = sampleRate / windowSize;  // Hz per bin
+    unsigned int minBin = static_cast<unsigned int>(std::ceil(minFreq / binSize));
+    unsigned int maxBin = static_cast<unsigned int>(std::floor(maxFreq / binSize));
+    
+    // Ensure valid bin range
+    minBin = std::max(minBin, 0u);
+    maxBin = std::min(maxBin, windowSize / 2u);
+    
+    if (maxBin <= minBin) {
+        return Result<SpectrogramLayout>::createFailure("Invalid frequency range for given window size and sample rate");
+    }
+    
+    SpectrogramLayout layout;
+    layout.windowSize = windowSize;
+    layout.stepSize = stepSize;
+    layout.minBin = minBin;
+    layout.maxBin = maxBin;
+    layout.lastBin = std::min(maxBin, windowSize / 2 - 1); // The Nyquist bin is never stored
+    layout.numBins = maxBin - minBin + 1;
+    return Result<SpectrogramLayout>::createSuccess(layout);
+}
+
+namespace {
+
 /**
- * Compute Fast Fourier Transform using FFTW library
+ * Computes the spectrogram frames for windows [firstWindow, endWindow)
  * 
- * This wrapper translates between C++ std::complex vectors and FFTW's C-style arrays.
- * FFTW is used because it's one of the fastest FFT implementations available.
+ * Each call owns its FFT workspace, so ranges can be processed concurrently;
+ * they only share the read-only samples and window and write disjoint frames.
  * 
- * @param x Input/output vector of complex values, modified in-place with FFT result
  * @return True if successful, false if an error occurred
  */
-bool fft(std::vector<std::complex<float>>& x, std::string& errorMessage) {
-    const size_t N = x.size();
-    if (N <= 1) return true;  // Nothing to do for tiny arrays
-    
-    // Allocate input/output arrays for FFTW
-    // Using FFTW's allocation functions ensures proper memory alignment for SIMD operations
-    fftwf_complex* in = fftwf_alloc_complex(N);
-    fftwf_complex* out = fftwf_alloc_complex(N);
-    
-    // Check for allocation failure
-    if (!in || !out) {
-        // Clean up and return error
-        if (in) fftwf_free(in);
-        if (out) fftwf_free(out);
-        errorMessage = "Memory allocation failed for FFT";
-        return false;
-    }
-    
-    // Copy input data
-    for (size_t i = 0; i < N; i++) {
-        in[i][0] = x[i].real();
-        in[i][1] = x[i].imag();
-    }
-    
-    // Create plan and execute FFT
-    // FFTW_ESTIMATE flag quickly creates a reasonable but non-optimal plan
-    // FFTW_FORWARD indicates we're transforming from time domain to frequency domain
-    fftwf_plan plan = fftwf_plan_dft_1d(N, in, out, FFTW_FORWARD, FFTW_ESTIMATE);
+bool computeFrames(
+    const std::vector<AudioSample>& samples,
+    const std::vector<float>& hammingWindow,
+    const SpectrogramLayout& layout,
+    unsigned int firstWindow,
+    unsigned int endWindow,
+    Spectrogram& spectrogram,
+    QualityTrace* quality,
+    std::string& errorMessage
+) {
+    const unsigned int windowSize = layout.windowSize;
     
-    if (!plan) {
-        fftwf_free(in);
-        fftwf_free(out);
-        errorMessage = "Failed to create FFT plan";
+    RealFFTWorkspace workspace(windowSize);
+    if (!workspace.isValid()) {
+        errorMessage = workspace.getError();
         return false;
     }
     
-    fftwf_execute(plan);
+    float* fftInput = workspace.input();
     
-    // Copy result back to input vector
-    for (size_t i = 0; i < N; i++) {
-        x[i] = std::complex<float>(out[i][0], out[i][1]);
+    for (unsigned int windowIdx = firstWindow; windowIdx < endWindow; ++windowIdx) {
+        // Apply Hamming window while copying the segment into the FFT input
+        // numWindows guarantees every window lies fully inside the samples
+        const AudioSample* segment = samples.data() + static_cast<size_t>(windowIdx) * layout.stepSize;
+        for (unsigned int i = 0; i < windowSize; ++i) {
+            fftInput[i] = segment[i] * hammingWindow[i];
+        }
+        
+        workspace.execute();
+        
+        // Extract magnitude for the frequency bins we care about
+        extractMagnitudes(workspace.output(), layout, spectrogram.frameData(windowIdx));
+        
+        // The quality summary sees the full band of the same transform
+        if (quality) {
+            const unsigned int overlapped = windowIdx == 0 ? 0 : windowSize - layout.stepSize;
+            quality->frames[windowIdx] = summarizeQualityFrame(segment + overlapped, windowSize - overlapped,
+                                                               nullptr, 0, workspace.output(), windowSize,
+                                                               quality->options);
+        }
     }
     
-    // Clean up
-    fftwf_destroy_plan(plan);
-    fftwf_free(in);
-    fftwf_free(out);
-    
     return true;
 }
 
+} // namespace
+
 /**
  * Converts raw audio samples to a time-frequency representation (spectrogram)
  * 
  * Algorithm steps:
  * 1. Divide audio into overlapping segments
  * 2. Apply window function to each segment to reduce spectral leakage
- * 3. Transform each windowed segment using FFT
+ * 3. Transform each windowed segment using a real-input FFT
  * 4. Extract magnitude information for each frequency bin
  * 5. Focus only on the desired frequency range (20Hz-5kHz)
  * 
- * @return A Result containing a 2D matrix with frequencies as rows and time windows as columns
+ * Steps 1-2 are a single pass that writes windowed samples straight into the
+ * FFT input buffer, and step 4 only visits the bins kept in step 5.
+ * 
+ * Windows are independent, so with numThreads > 1 they are split into
+ * contiguous chunks, each transformed by its own worker and FFT workspace.
+ * 
+ * With a quality trace, each FFT output is also reduced to a QualityFrame
+ * before the next window overwrites it.
+ * 
+ * @return A Result containing a time-major spectrogram (one contiguous frame per window)
  */
-Result<Spectrogram> generateSpectrogram(
+Result<size_t> generateSpectrogramInto(
     const std::vector<AudioSample>& samples,
+    Spectrogram& spectrogram,
     unsigned int sampleRate,
     unsigned int windowSize,
     float overlap,
     float minFreq,
-    float maxFreq
+    float maxFreq,
+    unsigned int numThreads,
+    QualityTrace* quality
 ) {
+    ScopedTimer timer(MetricStage::SPECTROGRAM);
+    
     if (samples.empty()) {
-        return Result<Spectrogram>::createFailure("Empty audio samples provided");
+        return Result<size_t>::createFailure("Empty audio samples provided");
     }
     
-    // Validate parameters
-    if (sampleRate == 0) {
-        return Result<Spectrogram>::createFailure("Sample rate cannot be zero");
+    auto layoutResult = computeSpectrogramLayout(sampleRate, windowSize, overlap, minFreq, maxFreq);
+    if (!layoutResult.isSuccess()) {
+        return Result<size_t>::createFailure(layoutResult.getError());
     }
+    const SpectrogramLayout& layout = layoutResult.getValue();
     
-    if (windowSize == 0) {
-        return Result<Spectrogram>::createFailure("Window size cannot be zero");
+    if (samples.size() < windowSize) {
+        return Result<size_t>::createFailure("Sample size too small for given window size");
     }
     
-    if (overlap < 0.0f || overlap >= 1.0f) {
-        return Result<Spectrogram>::createFailure("Overlap must be between 0.0 and 1.0 (exclusive)");
+    // Calculate number of windows
+    unsigned int numWindows = (samples.size() - windowSize) / layout.stepSize + 1;
+    if (numWindows == 0) {
+        return Result<size_t>::createFailure("Sample size too small for given window size");
     }
     
-    if (minFreq < 0.0f) {
-        return Result<Spectrogram>::createFailure("Minimum frequency cannot be negative");
+    // Create Hamming window
+    std::vector<float> hammingWindow = createHammingWindow(windowSize);
+    
+    // Reshape the output, keeping its buffer when it is already large enough
+    const std::size_t previousCapacity = spectrogram.capacity();
+    spectrogram.resize(numWindows, layout.numBins);
+    if (quality) {
+        quality->sampleRate = sampleRate;
+        quality->windowSize = windowSize;
+        quality->stepSize = layout.stepSize;
+        quality->frames.assign(numWindows, QualityFrame());
     }
+    // Log progress
+    SORTIFY_LOG_INFO("Generating spectrogram: ", numWindows, " windows, ", layout.numBins, " frequency bins");
     
-    if (maxFreq <= minFreq) {
-        return Result<Spectrogram>::createFailure("Maximum frequency must be greater than minimum frequency");
+    // Decide how many workers to use
+    // Keep chunks large enough that thread start-up stays negligible
+    const unsigned int minWindowsPerThread = 32;
+    unsigned int numWorkers = numThreads;
+    if (numWorkers == 0) {
+        numWorkers = std::max(1u, std::thread::hardware_concurrency());
     }
+    numWorkers = std::min(numWorkers, std::max(1u, numWindows / minWindowsPerThread));
     
-    // Calculate step size between windows based on overlap
-    unsigned int stepSize = static_cast<unsigned int>(windowSize * (1.0f - overlap));
-    if (stepSize == 0) stepSize = 1; // Prevent division by zero
+    // Process each chunk of windows; the calling thread takes the first chunk
+    // The FFT plan itself is shared across workers and across calls
+    std::vector<std::string> workerErrors(numWorkers);
+    std::vector<char> workerSucceeded(numWorkers, 0);
+    std::vector<std::thread> workers;
+    workers.reserve(numWorkers - 1);
     
-    // Calculate number of windows
-    unsigned int numWindows = (samples.size() - windowSize) / stepSize + 1;
-    if (numWindows == 0) {
-        return Result<Spectrogram>::createFailure("Sample size too small for given window size");
+    auto runChunk = [&](unsigned int worker) {
+        const unsigned int firstWindow = static_cast<unsigned int>(
+            static_cast<uint64_t>(numWindows) * worker / numWorkers);
+        const unsigned int endWindow = static_cast<unsigned int>(
+            static_cast<uint64_t>(numWindows) * (worker + 1) / numWorkers);
+        workerSucceeded[worker] = computeFrames(samples, hammingWindow, layout,
+                                                firstWindow, endWindow, spectrogram,
+                                                quality, workerErrors[worker]);
+    };
+    
+    for (unsigned int worker = 1; worker < numWorkers; ++worker) {
+        workers.emplace_back(runChunk, worker);
+    }
+    runChunk(0);
+    for (auto& thread : workers) {
+        thread.join();
     }
     
-    // Create Hamming window
-    std::vector<float> hammingWindow = createHammingWindow(windowSize);
+    for (unsigned int worker = 0; worker < numWorkers; ++worker) {
+        if (!workerSucceeded[worker]) {
+            return Result<size_t>::createFailure("FFT error: " + workerErrors[worker]);
+        }
+    }
     
-    // Calculate frequency range to keep
-    // Each FFT bin represents a frequency range of (sample_rate / window_size) Hz
-    // We convert our min/max frequency thresholds to corresponding FFT bin indices
-    unsigned int binSize = sampleRate / windowSize;  // Hz per bin
-    unsigned int minBin = static_cast<unsigned int>(std::ceil(minFreq / binSize));
-    unsigned int maxBin = static_cast<unsigned int>(std::floor(maxFreq / binSize));
+    if (spectrogram.empty()) {
+        return Result<size_t>::createFailure("Failed to generate spectrogram data");
+    }
     
-    // Ensure valid bin range
-    minBin = std::max(minBin, 0u);
-    maxBin = std::min(maxBin, windowSize / 2u);
+    SORTIFY_LOG_INFO("Spectrogram generation complete: ", spectrogram.numBins(), "x", spectrogram.numFrames());
     
-    if (maxBin <= minBin) {
-        return Result<Spectrogram>::createFailure("Invalid frequency range for given window size and sample rate");
+    Metrics::add(MetricCounter::SAMPLES_ANALYZED, samples.size());
+    Metrics::add(MetricCounter::AUDIO_MICROSECONDS, static_cast<uint64_t>(samples.size()) * 1000000 / sampleRate);
+    Metrics::add(MetricCounter::WINDOWS_PROCESSED, numWindows);
+    Metrics::add(MetricCounter::BYTES_ALLOCATED,
+                 (std::max(spectrogram.capacity(), previousCapacity) - previousCapacity) * sizeof(float));
+    
+    return Result<size_t>::createSuccess(numWindows);
+}
+
+Result<Spectrogram> generateSpectrogram(
+    const std::vector<AudioSample>& samples,
+    unsigned int sampleRate,
+    unsigned int windowSize,
+    float overlap,
+    float minFreq,
+    float maxFreq,
+    unsigned int numThreads,
+    std::pmr::memory_resource* resource,
+    QualityTrace* quality
+) {
+    Spectrogram spectrogram(0, 0, resource);
+    auto generated = generateSpectrogramInto(samples, spectrogram, sampleRate, windowSize, overlap,
+                                             minFreq, maxFreq, numThreads, quality);
+    if (!generated.isSuccess()) {
+        return Result<Spectrogram>::createFailure(generated.getError());
     }
+    return Result<Spectrogram>::createSuccess(std::move(spectrogram));
+}
+
+std::vector<Result<Spectrogram>> generateSpectrogramBatch(
+    const std::vector<std::vector<AudioSample>>& tracks,
+    unsigned int sampleRate,
+    unsigned int windowSize,
+    float overlap,
+    float minFreq,
+    float maxFreq,
+    unsigned int batchSize
+) {
+    ScopedTimer timer(MetricStage::SPECTROGRAM);
     
-    unsigned int numBins = maxBin - minBin + 1;
+    std::vector<Result<Spectrogram>> results;
+    results.reserve(tracks.size());
     
-    // Initialize spectrogram
-    Spectrogram spectrogram(numBins, std::vector<float>(numWindows, 0.0f));
+    auto layoutResult = computeSpectrogramLayout(sampleRate, windowSize, overlap, minFreq, maxFreq);
+    if (!layoutResult.isSuccess()) {
+        for (size_t track = 0; track < tracks.size(); ++track) {
+            results.push_back(Result<Spectrogram>::createFailure(layoutResult.getError()));
+        }
+        return results;
+    }
+    const SpectrogramLayout& layout = layoutResult.getValue();
     
-    // Log progress
-    Logger::info("Generating spectrogram: " + std::to_string(numWindows) + " windows, " +
-                 std::to_string(numBins) + " frequency bins");
+    // Allocate every output first; tracks that cannot be analysed get no windows
+    std::vector<Spectrogram> spectrograms(tracks.size());
+    uint64_t totalWindows = 0;
+    for (size_t track = 0; track < tracks.size(); ++track) {
+        if (tracks[track].size() >= windowSize) {
+            const unsigned int numWindows = (tracks[track].size() - windowSize) / layout.stepSize + 1;
+            spectrograms[track].resize(numWindows, layout.numBins);
+            totalWindows += numWindows;
+        }
+    }
     
-    std::string fftError;
+    SORTIFY_LOG_INFO("Generating ", tracks.size(), " spectrograms in batches of ", batchSize,
+                     ": ", totalWindows, " windows, ", layout.numBins, " frequency bins");
     
-    // Process each window
-    for (unsigned int windowIdx = 0; windowIdx < numWindows; ++windowIdx) {
-        // Extract window from audio samples
-        std::vector<std::complex<float>> windowSamples(windowSize);
-        for (unsigned int i = 0; i < windowSize; ++i) {
-            unsigned int sampleIdx = windowIdx * stepSize + i;
-            if (sampleIdx < samples.size()) {
-                // Apply Hamming window
-                windowSamples[i] = std::complex<float>(samples[sampleIdx] * hammingWindow[i], 0.0f);
-            } else {
-                windowSamples[i] = std::complex<float>(0.0f, 0.0f); // Zero-padding
+    std::string fftError;
+    if (totalWindows > 0) {
+        BatchedRealFFTWorkspace workspace(windowSize, std::max(1u, batchSize));
+        if (!workspace.isValid()) {
+            fftError = workspace.getError();
+        } else {
+            const std::vector<float> hammingWindow = createHammingWindow(windowSize);
+            
+            // Destination of each filled slot, so a batch may span track boundaries
+            std::vector<std::pair<Spectrogram*, unsigned int>> slots;
+            slots.reserve(workspace.batchSize());
+            auto flush = [&]() {
+                workspace.execute();
+                for (unsigned int slot = 0; slot < slots.size(); ++slot) {
+                    extractMagnitudes(workspace.output(slot), layout, slots[slot].first->frameData(slots[slot].second));
+                }
+                slots.clear();
+            };
+            
+            for (size_t track = 0; track < tracks.size(); ++track) {
+                const AudioSample* samples = tracks[track].data();
+                for (unsigned int windowIdx = 0; windowIdx < spectrograms[track].numFrames(); ++windowIdx) {
+                    float* fftInput = workspace.input(static_cast<unsigned int>(slots.size()));
+                    const AudioSample* segment = samples + static_cast<size_t>(windowIdx) * layout.stepSize;
+                    for (unsigned int i = 0; i < windowSize; ++i) {
+                        fftInput[i] = segment[i] * hammingWindow[i];
+                    }
+                    slots.emplace_back(&spectrograms[track], windowIdx);
+                    if (slots.size() == workspace.batchSize()) {
+                        flush();
+                    }
+                }
             }
-        }
-        
-        // Apply FFT
-        if (!fft(windowSamples, fftError)) {
-            return Result<Spectrogram>::createFailure("FFT error: " + fftError);
-        }
-        
-        // Extract magnitude for the frequency bins we care about
-        for (unsigned int binIdx = 0; binIdx < numBins; ++binIdx) {
-            unsigned int sourceBinIdx = minBin + binIdx;
-            if (sourceBinIdx < windowSamples.size() / 2) {
-                // Calculate magnitude (absolute value) of complex FFT result
-                // This converts complex value to a single real value representing amplitude
-                // We ignore phase information as it's less important for fingerprinting
-                float magnitude = std::abs(windowSamples[sourceBinIdx]);
-                
-                // Store in spectrogram
-                spectrogram[binIdx][windowIdx] = magnitude;
+            if (!slots.empty()) {
+                flush();
             }
         }
     }
     
-    if (spectrogram.empty() || spectrogram[0].empty()) {
-        return Result<Spectrogram>::createFailure("Failed to generate spectrogram data");
+    for (size_t track = 0; track < tracks.size(); ++track) {
+        if (tracks[track].empty()) {
+            results.push_back(Result<Spectrogram>::createFailure("Empty audio samples provided"));
+        } else if (spectrograms[track].empty()) {
+            results.push_back(Result<Spectrogram>::createFailure("Sample size too small for given window size"));
+        } else if (!fftError.empty()) {
+            results.push_back(Result<Spectrogram>::createFailure("FFT error: " + fftError));
+        } else {
+            Metrics::add(MetricCounter::SAMPLES_ANALYZED, tracks[track].size());
+            Metrics::add(MetricCounter::AUDIO_MICROSECONDS,
+                         static_cast<uint64_t>(tracks[track].size()) * 1000000 / sampleRate);
+            Metrics::add(MetricCounter::WINDOWS_PROCESSED, spectrograms[track].numFrames());
+            Metrics::add(MetricCounter::BYTES_ALLOCATED, spectrograms[track].capacity() * sizeof(float));
+            results.push_back(Result<Spectrogram>::createSuccess(std::move(spectrograms[track])));
+        }
     }
-    
-    Logger::info("Spectrogram generation complete: " + 
-                std::to_string(spectrogram.size()) + "x" + 
-                std::to_string(spectrogram[0].size()));
-    
-    return Result<Spectrogram>::createSuccess(std::move(spectrogram));
+    return results;
 }
 
 } // namespace audio
-} // namespace sortify
\ No newline at end of file
+} // namespace sortify
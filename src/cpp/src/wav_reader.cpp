@@ -0,0 +1,221 @@
+#include "../include/wav_reader.hpp"
+#include "../include/metrics.hpp"
+#include "../include/resampler.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sortify {
+namespace audio {
+
+namespace {
+
+constexpr uint16_t formatPcm = 0x0001;
+constexpr uint16_t formatIeeeFloat = 0x0003;
+constexpr uint16_t formatExtensible = 0xFFFE;
+
+uint16_t readUint16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readUint32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) |
+           static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 |
+           static_cast<uint32_t>(p[3]) << 24;
+}
+
+bool isChunk(const uint8_t* p, const char* id) {
+    return std::memcmp(p, id, 4) == 0;
+}
+
+} // namespace
+
+WavFile::WavFile(const std::string& filePath) {
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        errorMessage = "Could not open file: " + filePath + " (" + std::strerror(errno) + ")";
+        return;
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size < 12) {
+        ::close(fd);
+        errorMessage = "File too small to be a valid WAV: " + filePath;
+        return;
+    }
+
+    mappingSize = static_cast<size_t>(info.st_size);
+    void* address = ::mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        mappingSize = 0;
+        errorMessage = "Could not map file: " + filePath + " (" + std::strerror(errno) + ")";
+        return;
+    }
+    mapping = address;
+
+    errorMessage = parse();
+    if (!errorMessage.empty()) {
+        errorMessage += ": " + filePath;
+        return;
+    }
+
+    // Conversion walks the data chunk front to back
+    ::madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+}
+
+WavFile::~WavFile() {
+    if (mapping) {
+        ::munmap(mapping, mappingSize);
+    }
+}
+
+std::string WavFile::parse() {
+    const uint8_t* file = static_cast<const uint8_t*>(mapping);
+    if (!isChunk(file, "RIFF")) {
+        return "Not a valid WAV file (RIFF header missing)";
+    }
+    if (!isChunk(file + 8, "WAVE")) {
+        return "Not a valid WAV file (WAVE format missing)";
+    }
+
+    const uint8_t* fmt = nullptr;
+    uint32_t fmtSize = 0;
+    const uint8_t* data = nullptr;
+    size_t dataSize = 0;
+
+    // Walk the chunk list; chunk bodies are padded to an even size
+    size_t pos = 12;
+    while (pos + 8 <= mappingSize && (!fmt || !data)) {
+        const uint32_t chunkSize = readUint32(file + pos + 4);
+        const size_t body = pos + 8;
+        const size_t available = mappingSize - body;
+
+        if (isChunk(file + pos, "fmt ")) {
+            if (chunkSize < 16 || chunkSize > available) {
+                return "Invalid fmt chunk in WAV file";
+            }
+            fmt = file + body;
+            fmtSize = chunkSize;
+        } else if (isChunk(file + pos, "data")) {
+            // Streamed or truncated files may declare more data than they hold
+            data = file + body;
+            dataSize = std::min<size_t>(chunkSize, available);
+        }
+
+        if (chunkSize > available) {
+            break;
+        }
+        pos = body + chunkSize + (chunkSize & 1);
+    }
+
+    if (!fmt) {
+        return "Could not find fmt chunk in WAV file";
+    }
+    if (!data) {
+        return "Could not find data chunk in WAV file";
+    }
+
+    uint16_t formatTag = readUint16(fmt);
+    wavFormat.numChannels = readUint16(fmt + 2);
+    wavFormat.sampleRate = readUint32(fmt + 4);
+    wavFormat.bitsPerSample = readUint16(fmt + 14);
+
+    // WAVE_FORMAT_EXTENSIBLE carries the real format in the first two bytes of its sub-format GUID
+    if (formatTag == formatExtensible) {
+        if (fmtSize < 40) {
+            return "Invalid extensible fmt chunk in WAV file";
+        }
+        formatTag = readUint16(fmt + 24);
+    }
+
+    if (wavFormat.numChannels == 0 || wavFormat.sampleRate == 0) {
+        return "WAV file declares no channels or a zero sample rate";
+    }
+
+    if (formatTag == formatPcm && wavFormat.bitsPerSample == 8) {
+        wavFormat.encoding = PcmEncoding::UINT8;
+    } else if (formatTag == formatPcm && wavFormat.bitsPerSample == 16) {
+        wavFormat.encoding = PcmEncoding::INT16;
+    } else if (formatTag == formatPcm && wavFormat.bitsPerSample == 24) {
+        wavFormat.encoding = PcmEncoding::INT24;
+    } else if (formatTag == formatPcm && wavFormat.bitsPerSample == 32) {
+        wavFormat.encoding = PcmEncoding::INT32;
+    } else if (formatTag == formatIeeeFloat && wavFormat.bitsPerSample == 32) {
+        wavFormat.encoding = PcmEncoding::FLOAT32;
+    } else if (formatTag == formatIeeeFloat && wavFormat.bitsPerSample == 64) {
+        wavFormat.encoding = PcmEncoding::FLOAT64;
+    } else {
+        return "Unsupported WAV format tag " + std::to_string(formatTag) + " with " +
+               std::to_string(wavFormat.bitsPerSample) + " bits per sample";
+    }
+
+    frameBytes = static_cast<size_t>(wavFormat.numChannels) * pcmBytesPerSample(wavFormat.encoding);
+    frameData = data;
+    wavFormat.numFrames = dataSize / frameBytes;
+    return "";
+}
+
+size_t WavFile::read(size_t firstFrame, size_t numFrames, AudioSample* output) const {
+    if (!isValid() || firstFrame >= wavFormat.numFrames) {
+        return 0;
+    }
+
+    const size_t count = std::min(numFrames, wavFormat.numFrames - firstFrame);
+    convertPcmToMono(frameData + firstFrame * frameBytes, count, wavFormat.numChannels,
+                     wavFormat.encoding, output);
+    Metrics::add(MetricCounter::SAMPLES_DECODED, count);
+    return count;
+}
+
+void WavFile::readAll(std::vector<AudioSample>& samples) const {
+    samples.resize(wavFormat.numFrames);
+    if (!samples.empty()) {
+        read(0, samples.size(), samples.data());
+    }
+}
+
+Result<size_t> WavFile::readAllResampled(std::vector<AudioSample>& samples, unsigned int sampleRate) const {
+    if (!isValid()) {
+        return Result<size_t>::createFailure(errorMessage);
+    }
+    if (sampleRate == wavFormat.sampleRate) {
+        readAll(samples);
+        return Result<size_t>::createSuccess(samples.size());
+    }
+
+    Resampler resampler(wavFormat.sampleRate, sampleRate);
+    if (!resampler.isValid()) {
+        return Result<size_t>::createFailure(resampler.getError());
+    }
+
+    samples.clear();
+    samples.reserve(resampler.outputLength(wavFormat.numFrames));
+    std::vector<AudioSample> block(16384);
+    for (size_t frame = 0; frame < wavFormat.numFrames; frame += block.size()) {
+        const size_t count = read(frame, block.size(), block.data());
+        resampler.process(block.data(), count, samples);
+    }
+    resampler.finish(samples);
+    return Result<size_t>::createSuccess(samples.size());
+}
+
+bool hasWavExtension(const std::string& filePath) {
+    const size_t dot = filePath.find_last_of('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+    std::string extension = filePath.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".wav";
+}
+
+} // namespace audio
+} // namespace sortify
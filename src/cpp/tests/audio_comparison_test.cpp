@@ -4,6 +4,7 @@
 #include <chrono>
 #include <stdexcept>
 #include "audio_fingerprint.hpp"
+#include "logger.hpp"
 
 // Include our audio file reader
 #include "audio_reader.hpp"
@@ -76,7 +77,7 @@ TEST(AudioComparisonTest, SameTrackDifferentFormats) {
             std::cerr << "Error generating MP3 spectrogram: " << result.errorMessage << std::endl;
             throw std::runtime_error(result.errorMessage);
         }
-        mp3Spectrogram = result.value.value();
+        mp3Spectrogram = std::move(result).take();
     });
     
     sortify::audio::Spectrogram m4aSpectrogram;
@@ -86,16 +87,16 @@ TEST(AudioComparisonTest, SameTrackDifferentFormats) {
             std::cerr << "Error generating M4A spectrogram: " << result.errorMessage << std::endl;
             throw std::runtime_error(result.errorMessage);
         }
-        m4aSpectrogram = result.value.value();
+        m4aSpectrogram = std::move(result).take();
     });
     
     // Check if spectrograms were generated successfully
     ASSERT_FALSE(mp3Spectrogram.empty()) << "Failed to generate MP3 spectrogram";
     ASSERT_FALSE(m4aSpectrogram.empty()) << "Failed to generate M4A spectrogram";
     
-    std::cout << "MP3 spectrogram: " << mp3Spectrogram.size() << "x" << mp3Spectrogram[0].size() 
+    std::cout << "MP3 spectrogram: " << mp3Spectrogram.numBins() << "x" << mp3Spectrogram.numFrames() 
               << " (generated in " << mp3SpectrogramTime << "s)" << std::endl;
-    std::cout << "M4A spectrogram: " << m4aSpectrogram.size() << "x" << m4aSpectrogram[0].size() 
+    std::cout << "M4A spectrogram: " << m4aSpectrogram.numBins() << "x" << m4aSpectrogram.numFrames() 
               << " (generated in " << m4aSpectrogramTime << "s)" << std::endl;
     
     // Extract peaks
@@ -107,7 +108,7 @@ TEST(AudioComparisonTest, SameTrackDifferentFormats) {
             std::cerr << "Error extracting MP3 peaks: " << result.errorMessage << std::endl;
             throw std::runtime_error(result.errorMessage);
         }
-        mp3Peaks = result.value.value();
+        mp3Peaks = std::move(result).take();
     });
     
     std::vector<sortify::audio::Peak> m4aPeaks;
@@ -117,7 +118,7 @@ TEST(AudioComparisonTest, SameTrackDifferentFormats) {
             std::cerr << "Error extracting M4A peaks: " << result.errorMessage << std::endl;
             throw std::runtime_error(result.errorMessage);
         }
-        m4aPeaks = result.value.value();
+        m4aPeaks = std::move(result).take();
     });
     
     // Check if peaks were extracted successfully
@@ -136,7 +137,7 @@ TEST(AudioComparisonTest, SameTrackDifferentFormats) {
             std::cerr << "Error creating MP3 fingerprint: " << result.errorMessage << std::endl;
             throw std::runtime_error(result.errorMessage);
         }
-        mp3Fingerprint = result.value.value();
+        mp3Fingerprint = std::move(result).take();
     });
     
     std::unordered_map<uint32_t, std::vector<sortify::audio::FingerprintHash>> m4aFingerprint;
@@ -146,7 +147,7 @@ TEST(AudioComparisonTest, SameTrackDifferentFormats) {
             std::cerr << "Error creating M4A fingerprint: " << result.errorMessage << std::endl;
             throw std::runtime_error(result.errorMessage);
         }
-        m4aFingerprint = result.value.value();
+        m4aFingerprint = std::move(result).take();
     });
     
     // Check if fingerprints were created successfully
@@ -239,21 +240,21 @@ TEST(AudioComparisonTest, SameFileSanityCheck) {
     std::cout << "Generating spectrograms..." << std::endl;
     auto firstHalfResult = sortify::audio::generateSpectrogram(firstHalf, 44100);
     ASSERT_TRUE(firstHalfResult.success) << "Failed to generate first half spectrogram: " << firstHalfResult.errorMessage;
-    sortify::audio::Spectrogram firstHalfSpectrogram = firstHalfResult.value.value();
+    sortify::audio::Spectrogram firstHalfSpectrogram = std::move(firstHalfResult).take();
     
     auto fullFileResult = sortify::audio::generateSpectrogram(fullFile, 44100);
     ASSERT_TRUE(fullFileResult.success) << "Failed to generate full file spectrogram: " << fullFileResult.errorMessage;
-    sortify::audio::Spectrogram fullFileSpectrogram = fullFileResult.value.value();
+    sortify::audio::Spectrogram fullFileSpectrogram = std::move(fullFileResult).take();
     
     // Extract peaks
     std::cout << "Extracting peaks..." << std::endl;
     auto firstHalfPeaksResult = sortify::audio::extractPeaks(firstHalfSpectrogram);
     ASSERT_TRUE(firstHalfPeaksResult.success) << "Failed to extract first half peaks: " << firstHalfPeaksResult.errorMessage;
-    std::vector<sortify::audio::Peak> firstHalfPeaks = firstHalfPeaksResult.value.value();
+    std::vector<sortify::audio::Peak> firstHalfPeaks = std::move(firstHalfPeaksResult).take();
     
     auto fullFilePeaksResult = sortify::audio::extractPeaks(fullFileSpectrogram);
     ASSERT_TRUE(fullFilePeaksResult.success) << "Failed to extract full file peaks: " << fullFilePeaksResult.errorMessage;
-    std::vector<sortify::audio::Peak> fullFilePeaks = fullFilePeaksResult.value.value();
+    std::vector<sortify::audio::Peak> fullFilePeaks = std::move(fullFilePeaksResult).take();
     
     std::cout << "First half peaks: " << firstHalfPeaks.size() << std::endl;
     std::cout << "Full file peaks: " << fullFilePeaks.size() << std::endl;
@@ -262,11 +263,11 @@ TEST(AudioComparisonTest, SameFileSanityCheck) {
     std::cout << "Creating fingerprints..." << std::endl;
     auto firstHalfFingerprintResult = sortify::audio::createFingerprint(firstHalfPeaks, 1);
     ASSERT_TRUE(firstHalfFingerprintResult.success) << "Failed to create first half fingerprint: " << firstHalfFingerprintResult.errorMessage;
-    auto firstHalfFingerprint = firstHalfFingerprintResult.value.value();
+    auto firstHalfFingerprint = std::move(firstHalfFingerprintResult).take();
     
     auto fullFileFingerprintResult = sortify::audio::createFingerprint(fullFilePeaks, 2);
     ASSERT_TRUE(fullFileFingerprintResult.success) << "Failed to create full file fingerprint: " << fullFileFingerprintResult.errorMessage;
-    auto fullFileFingerprint = fullFileFingerprintResult.value.value();
+    auto fullFileFingerprint = std::move(fullFileFingerprintResult).take();
     
     std::cout << "First half fingerprint hash count: " << firstHalfFingerprint.size() << std::endl;
     std::cout << "Full file fingerprint hash count: " << fullFileFingerprint.size() << std::endl;
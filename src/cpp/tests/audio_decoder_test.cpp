@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "audio_decoder.hpp"
+#include "audio_reader.hpp"
+#include "batch_fingerprinter.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::DecodeOptions;
+using sortify::audio::FFmpegDecoder;
+
+namespace {
+
+/**
+ * Stand-in for FFmpeg: records its arguments and prints a prepared f32le file
+ */
+class FakeFFmpeg {
+public:
+    FakeFFmpeg() {
+        const std::string prefix = "/tmp/sortify_fake_ffmpeg_" + std::to_string(::getpid());
+        scriptPath = prefix + ".sh";
+        argsPath = prefix + ".args";
+        rawPath = prefix + ".raw";
+
+        std::ofstream script(scriptPath);
+        script << "#!/bin/sh\n"
+               << "printf '%s\\n' \"$@\" > '" << argsPath << "'\n"
+               << "[ -n \"$SORTIFY_FAKE_FFMPEG_FAIL\" ] && exit 1\n"
+               << "cat '" << rawPath << "'\n";
+        script.close();
+        ::chmod(scriptPath.c_str(), 0755);
+    }
+
+    ~FakeFFmpeg() {
+        std::remove(scriptPath.c_str());
+        std::remove(argsPath.c_str());
+        std::remove(rawPath.c_str());
+    }
+
+    void setOutput(const std::vector<float>& samples) {
+        std::ofstream raw(rawPath, std::ios::binary | std::ios::trunc);
+        raw.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(float));
+    }
+
+    std::vector<std::string> arguments() const {
+        std::ifstream args(argsPath);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(args, line);) {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    DecodeOptions options() const {
+        DecodeOptions options;
+        options.ffmpegPath = scriptPath;
+        options.blockSize = 1000;
+        return options;
+    }
+
+private:
+    std::string scriptPath;
+    std::string argsPath;
+    std::string rawPath;
+};
+
+} // namespace
+
+// Shell metacharacters in the path reach FFmpeg as one verbatim argument
+TEST(AudioDecoderTest, PassesPathVerbatim) {
+    FakeFFmpeg ffmpeg;
+    ffmpeg.setOutput(std::vector<float>(10, 0.5f));
+
+    const std::string path = "/music/it's \"$(rm -rf ~)\" `x` ; a:b.mp3";
+    auto decoded = FFmpegDecoder::decode(path, ffmpeg.options());
+    ASSERT_TRUE(decoded.isSuccess()) << decoded.getError();
+    EXPECT_EQ(decoded.getValue().size(), 10u);
+
+    auto args = ffmpeg.arguments();
+    auto input = std::find(args.begin(), args.end(), "-i");
+    ASSERT_NE(input, args.end());
+    ASSERT_NE(input + 1, args.end());
+    EXPECT_EQ(*(input + 1), "file:" + path);
+    EXPECT_NE(std::find(args.begin(), args.end(), "f32le"), args.end());
+}
+
+// Samples arrive in blocks of the requested size and decoding can stop early
+TEST(AudioDecoderTest, StreamsBlocksAndStopsEarly) {
+    FakeFFmpeg ffmpeg;
+    std::vector<float> samples(4500);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = static_cast<float>(i);
+    }
+    ffmpeg.setOutput(samples);
+
+    std::vector<size_t> blocks;
+    std::vector<float> received;
+    auto decoded = FFmpegDecoder::decodeStream("track.flac", [&](const float* block, size_t count) {
+        blocks.push_back(count);
+        received.insert(received.end(), block, block + count);
+        return true;
+    }, ffmpeg.options());
+    ASSERT_TRUE(decoded.isSuccess()) << decoded.getError();
+    EXPECT_EQ(decoded.getValue(), samples.size());
+    EXPECT_EQ(blocks, (std::vector<size_t>{1000, 1000, 1000, 1000, 500}));
+    EXPECT_EQ(received, samples);
+
+    size_t calls = 0;
+    auto stopped = FFmpegDecoder::decodeStream("track.flac", [&](const float*, size_t) {
+        return ++calls < 2;
+    }, ffmpeg.options());
+    EXPECT_TRUE(stopped.isSuccess()) << stopped.getError();
+    EXPECT_EQ(calls, 2u);
+}
+
+// A failing FFmpeg is reported instead of producing an empty track
+TEST(AudioDecoderTest, ReportsFFmpegFailure) {
+    FakeFFmpeg ffmpeg;
+    ffmpeg.setOutput({});
+    ::setenv("SORTIFY_FAKE_FFMPEG_FAIL", "1", 1);
+    auto decoded = FFmpegDecoder::decode("broken.mp3", ffmpeg.options());
+    ::unsetenv("SORTIFY_FAKE_FFMPEG_FAIL");
+    EXPECT_FALSE(decoded.isSuccess());
+
+    DecodeOptions missing;
+    missing.ffmpegPath = "/nonexistent/ffmpeg";
+    EXPECT_FALSE(FFmpegDecoder::decode("broken.mp3", missing).isSuccess());
+}
+
+// Streaming a file through the pipe gives the same fingerprint as the in-memory pipeline
+TEST(AudioDecoderTest, StreamedFingerprintMatchesBatch) {
+    FakeFFmpeg ffmpeg;
+    auto samples = sortify::testing::generateMelody(6.0f, 44100, 9);
+    ffmpeg.setOutput(samples);
+
+    sortify::audio::FingerprintConfig config;
+    auto streamed = sortify::audio::fingerprintFile("melody.m4a", config, ffmpeg.options());
+    auto batch = sortify::audio::fingerprintSamples(samples, config);
+    ASSERT_TRUE(streamed.isSuccess()) << streamed.getError();
+    ASSERT_TRUE(batch.isSuccess()) << batch.getError();
+    EXPECT_EQ(streamed.getValue().records(), batch.getValue().records());
+}
+
+// loadAudioFile peak-normalizes like loadWavFile unless asked not to
+TEST(AudioDecoderTest, LoadAudioFileNormalizes) {
+    FakeFFmpeg ffmpeg;
+    ffmpeg.setOutput({0.1f, -0.25f, 0.2f});
+
+    // loadAudioFile runs the default "ffmpeg", so put the fake first on the PATH
+    const std::string binDir = "/tmp/sortify_fake_bin_" + std::to_string(::getpid());
+    ASSERT_EQ(::mkdir(binDir.c_str(), 0755), 0);
+    ASSERT_EQ(::symlink(ffmpeg.options().ffmpegPath.c_str(), (binDir + "/ffmpeg").c_str()), 0);
+    const std::string oldPath = std::getenv("PATH") ? std::getenv("PATH") : "";
+    ::setenv("PATH", (binDir + ":" + oldPath).c_str(), 1);
+
+    const auto normalized = sortify::audio::AudioReader::loadAudioFile("song.mp3");
+    const auto raw = sortify::audio::AudioReader::loadAudioFile("song.mp3", false);
+
+    ::setenv("PATH", oldPath.c_str(), 1);
+    std::remove((binDir + "/ffmpeg").c_str());
+    ::rmdir(binDir.c_str());
+
+    EXPECT_EQ(normalized, (std::vector<float>{0.4f, -1.0f, 0.8f}));
+    EXPECT_EQ(raw, (std::vector<float>{0.1f, -0.25f, 0.2f}));
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include "audio_quality.hpp"
+#include "fingerprint_stream.hpp"
+#include "batch_fingerprinter.hpp"
+#include "resampler.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::AudioSample;
+using sortify::audio::QualityTrace;
+
+namespace {
+
+std::vector<AudioSample> makeNoise(size_t count, float amplitude, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> value(-amplitude, amplitude);
+    std::vector<AudioSample> samples(count);
+    for (auto& sample : samples) {
+        sample = value(rng);
+    }
+    return samples;
+}
+
+std::vector<AudioSample> makeSine(float amplitude, size_t count) {
+    std::vector<AudioSample> samples(count);
+    for (size_t i = 0; i < count; ++i) {
+        samples[i] = amplitude * static_cast<float>(std::sin(2.0 * M_PI * 440.0 * i / 44100.0));
+    }
+    return samples;
+}
+
+sortify::audio::AudioQuality measure(const std::vector<AudioSample>& samples) {
+    QualityTrace trace;
+    EXPECT_TRUE(sortify::audio::generateSpectrogram(samples, 44100, 2048, 0.5f, 20.0f, 5000.0f, 1, nullptr,
+                                                    &trace).isSuccess());
+    auto quality = sortify::audio::summarizeQuality(trace);
+    EXPECT_TRUE(quality.isSuccess()) << quality.getError();
+    return quality.isSuccess() ? quality.getValue() : sortify::audio::AudioQuality();
+}
+
+} // namespace
+
+// A band limit like a lossy encoder's low-pass shows up as a lower cutoff
+TEST(AudioQualityTest, DetectsLowPassCutoff) {
+    const auto fullBand = makeNoise(44100 * 5, 0.3f, 3);
+
+    // Through 32 kHz and back: nothing above 16 kHz survives
+    auto down = sortify::audio::resampleAudio(fullBand, 44100, 32000);
+    ASSERT_TRUE(down.isSuccess()) << down.getError();
+    auto lowPassed = sortify::audio::resampleAudio(down.getValue(), 32000, 44100);
+    ASSERT_TRUE(lowPassed.isSuccess()) << lowPassed.getError();
+
+    const auto original = measure(fullBand);
+    const auto transcode = measure(lowPassed.getValue());
+    EXPECT_GT(original.cutoffFrequency, 21000.0f);
+    EXPECT_GT(transcode.cutoffFrequency, 15000.0f);
+    EXPECT_LT(transcode.cutoffFrequency, 17500.0f);
+    EXPECT_FLOAT_EQ(original.nyquistFrequency, 22050.0f);
+
+    EXPECT_GT(sortify::audio::compareAudioQuality(original, transcode), 0);
+    EXPECT_LT(sortify::audio::compareAudioQuality(transcode, original), 0);
+}
+
+// Level and dynamic range of a sine; clipping of noise driven past full scale
+TEST(AudioQualityTest, MeasuresLevelsAndClipping) {
+    const auto sine = measure(makeSine(0.5f, 44100 * 3));
+    EXPECT_NEAR(sine.peakDb, -6.02f, 0.05f);
+    EXPECT_NEAR(sine.dynamicRangeDb, 3.01f, 0.1f);
+    EXPECT_EQ(sine.clippedSamples, 0u);
+
+    // Uniform noise over +-2 spends half of the time beyond full scale
+    const auto clean = makeNoise(44100 * 3, 0.9f, 5);
+    auto clipped = makeNoise(44100 * 3, 2.0f, 5);
+    for (auto& sample : clipped) {
+        sample = std::clamp(sample, -1.0f, 1.0f);
+    }
+    const auto cleanQuality = measure(clean);
+    const auto clippedQuality = measure(clipped);
+    EXPECT_EQ(cleanQuality.clippedSamples, 0u);
+    EXPECT_NEAR(clippedQuality.clippedFraction, 0.5, 0.01);
+    EXPECT_LT(clippedQuality.dynamicRangeDb, cleanQuality.dynamicRangeDb);
+    EXPECT_GT(sortify::audio::compareAudioQuality(cleanQuality, clippedQuality), 0);
+    EXPECT_EQ(sortify::audio::compareAudioQuality(cleanQuality, cleanQuality), 0);
+
+    QualityTrace silence;
+    ASSERT_TRUE(sortify::audio::generateSpectrogram(std::vector<AudioSample>(44100, 0.0f), 44100, 2048, 0.5f,
+                                                    20.0f, 5000.0f, 1, nullptr, &silence).isSuccess());
+    EXPECT_FALSE(sortify::audio::summarizeQuality(silence).isSuccess());
+}
+
+// The streaming pipeline and threaded spectrograms produce the same frames,
+// and collecting them leaves the spectrogram unchanged
+TEST(AudioQualityTest, StreamAndSpectrogramAgree) {
+    const auto samples = sortify::testing::generateMelody(6.0f, 44100, 4);
+
+    QualityTrace spectrogramTrace;
+    auto traced = sortify::audio::generateSpectrogram(samples, 44100, 2048, 0.5f, 20.0f, 5000.0f, 3, nullptr,
+                                                      &spectrogramTrace);
+    auto plain = sortify::audio::generateSpectrogram(samples, 44100);
+    ASSERT_TRUE(traced.isSuccess());
+    ASSERT_TRUE(plain.isSuccess());
+    ASSERT_EQ(traced.getValue().numFrames(), plain.getValue().numFrames());
+    for (unsigned int t = 0; t < plain.getValue().numFrames(); ++t) {
+        for (unsigned int bin = 0; bin < plain.getValue().numBins(); ++bin) {
+            ASSERT_EQ(traced.getValue().at(t, bin), plain.getValue().at(t, bin));
+        }
+    }
+    ASSERT_EQ(spectrogramTrace.frames.size(), plain.getValue().numFrames());
+
+    QualityTrace streamTrace;
+    sortify::audio::FingerprintStream stream(0);
+    stream.setQualityTrace(&streamTrace);
+    std::vector<sortify::audio::FingerprintHash> hashes;
+    for (size_t offset = 0; offset < samples.size(); offset += 1000) {
+        ASSERT_TRUE(stream.pushSamples(samples.data() + offset, std::min<size_t>(1000, samples.size() - offset),
+                                       hashes).isSuccess());
+    }
+    ASSERT_TRUE(stream.finish(hashes).isSuccess());
+
+    ASSERT_EQ(streamTrace.frames.size(), spectrogramTrace.frames.size());
+    EXPECT_EQ(streamTrace.stepSize, spectrogramTrace.stepSize);
+    for (size_t i = 0; i < streamTrace.frames.size(); ++i) {
+        EXPECT_EQ(streamTrace.frames[i].peak, spectrogramTrace.frames[i].peak) << "frame " << i;
+        EXPECT_EQ(streamTrace.frames[i].rms, spectrogramTrace.frames[i].rms) << "frame " << i;
+        EXPECT_EQ(streamTrace.frames[i].cutoffBin, spectrogramTrace.frames[i].cutoffBin) << "frame " << i;
+        EXPECT_EQ(streamTrace.frames[i].clippedSamples, spectrogramTrace.frames[i].clippedSamples) << "frame " << i;
+    }
+}
+
+// Batch runs attach the measurements to each file report when asked
+TEST(AudioQualityTest, BatchReportsQuality) {
+    sortify::audio::BatchOptions options;
+    options.numThreads = 2;
+    options.analyzeQuality = true;
+    options.decoder = [](const std::string& path) {
+        return path == "clean" ? makeSine(0.5f, 44100 * 3) : makeSine(1.0f, 44100 * 3);
+    };
+    sortify::audio::BatchFingerprinter fingerprinter(options);
+    auto results = fingerprinter.run({"clean", "loud"}, 0, nullptr);
+
+    ASSERT_EQ(results.size(), 2u);
+    ASSERT_TRUE(results[0].hasQuality);
+    ASSERT_TRUE(results[1].hasQuality);
+    EXPECT_NEAR(results[0].quality.peakDb, -6.02f, 0.05f);
+    EXPECT_GT(results[1].quality.clippedSamples, 0u);
+
+    options.analyzeQuality = false;
+    auto unmeasured = sortify::audio::BatchFingerprinter(options).run({"clean"}, 0, nullptr);
+    EXPECT_FALSE(unmeasured[0].hasQuality);
+}
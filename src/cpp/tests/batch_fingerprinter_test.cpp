@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <new>
+#include <unistd.h>
+#include "batch_fingerprinter.hpp"
+#include "bounded_queue.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::BatchFingerprinter;
+using sortify::audio::BatchOptions;
+using sortify::audio::FileStatus;
+
+namespace {
+
+// Decoder that synthesises a track per "path" instead of reading files
+std::vector<float> decodeSynthetic(const std::string& path) {
+    if (path == "missing") return {};
+    if (path == "short") return std::vector<float>(100, 0.1f);
+    return sortify::testing::generateMelody(8.0f, 44100, static_cast<unsigned int>(std::stoul(path)));
+}
+
+} // namespace
+
+// Every file gets a report in input order, and good files end up in the index
+TEST(BatchFingerprinterTest, BuildsIndexAndReportsFailures) {
+    BatchOptions options;
+    options.numThreads = 3;
+    options.maxPendingResults = 1;
+    options.decoder = decodeSynthetic;
+    BatchFingerprinter batch(options);
+
+    const std::vector<std::string> paths = {"1", "2", "missing", "3", "short", "4", "5", "6"};
+    sortify::audio::FingerprintIndex index;
+    auto results = batch.buildIndex(paths, index, 100);
+
+    ASSERT_EQ(results.size(), paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        EXPECT_EQ(results[i].path, paths[i]);
+        EXPECT_EQ(results[i].songId, 100 + static_cast<int>(i));
+    }
+    EXPECT_EQ(results[2].status, FileStatus::DECODE_FAILED);
+    EXPECT_EQ(results[4].status, FileStatus::FINGERPRINT_FAILED);
+    EXPECT_FALSE(results[4].error.empty());
+    EXPECT_EQ(index.trackCount(), 6u);
+
+    // A batch result must be identical to fingerprinting the file directly
+    auto direct = sortify::audio::fingerprintSamples(decodeSynthetic("3"), options.config);
+    ASSERT_TRUE(direct.isSuccess()) << direct.getError();
+    EXPECT_EQ(results[3].status, FileStatus::OK);
+    EXPECT_EQ(results[3].numHashes, direct.getValue().size());
+
+    auto match = index.query(direct.getValue(), 1);
+    ASSERT_TRUE(match.isSuccess()) << match.getError();
+    ASSERT_EQ(match.getValue().size(), 1u);
+    EXPECT_EQ(match.getValue()[0].songId, 103);
+    EXPECT_EQ(match.getValue()[0].offsetFrames, 0);
+}
+
+// Producers block on a full queue until the consumer catches up
+TEST(BatchFingerprinterTest, BoundedQueueAppliesBackpressure) {
+    sortify::audio::BoundedQueue<int> queue(2);
+    std::atomic<int> pushed{0};
+    std::thread producer([&] {
+        for (int i = 0; i < 5; ++i) {
+            queue.push(i);
+            pushed++;
+        }
+        queue.close();
+    });
+
+    while (queue.size() < 2) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(pushed.load(), 2);
+
+    std::vector<int> received;
+    int value = 0;
+    while (queue.pop(value)) {
+        received.push_back(value);
+    }
+    producer.join();
+    EXPECT_EQ(received, (std::vector<int>{0, 1, 2, 3, 4}));
+    EXPECT_FALSE(queue.push(5));
+}
+
+// A throwing decoder fails its file; a throwing sink stops the run and propagates
+TEST(BatchFingerprinterTest, HandlesExceptions) {
+    BatchOptions options;
+    options.numThreads = 3;
+    options.maxPendingResults = 1;
+    options.decoder = [](const std::string& path) {
+        if (path == "throw") {
+            throw std::runtime_error("corrupt frame");
+        }
+        return decodeSynthetic(path);
+    };
+    BatchFingerprinter batch(options);
+
+    auto results = batch.run({"1", "throw", "2"}, 0, nullptr);
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0].status, FileStatus::OK);
+    EXPECT_EQ(results[1].status, FileStatus::DECODE_FAILED);
+    EXPECT_NE(results[1].error.find("corrupt frame"), std::string::npos);
+    EXPECT_EQ(results[2].status, FileStatus::OK);
+
+    // Workers are blocked on the full queue when the sink gives up
+    std::vector<std::string> paths;
+    for (int i = 1; i <= 12; ++i) {
+        paths.push_back(std::to_string(i));
+    }
+    std::atomic<int> sunk{0};
+    EXPECT_THROW(batch.run(paths, 0, [&](const sortify::audio::FileResult&, sortify::audio::CompactFingerprint&&) {
+        if (++sunk == 2) {
+            throw std::bad_alloc();
+        }
+    }), std::bad_alloc);
+    EXPECT_EQ(sunk.load(), 2);
+}
+
+// Directory scans recurse, match extensions case-insensitively and sort the result
+TEST(BatchFingerprinterTest, CollectsAudioFilesRecursively) {
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / ("sortify_scan_" + std::to_string(::getpid()));
+    fs::create_directories(root / "album");
+    for (const char* name : {"b.mp3", "album/a.FLAC", "album/cover.jpg", "notes.txt"}) {
+        std::ofstream(root / name) << "x";
+    }
+
+    auto files = BatchFingerprinter::collectAudioFiles(root.string());
+    ASSERT_TRUE(files.isSuccess()) << files.getError();
+    EXPECT_EQ(files.getValue(), (std::vector<std::string>{
+        (root / "album/a.FLAC").string(), (root / "b.mp3").string()}));
+
+    EXPECT_FALSE(BatchFingerprinter::collectAudioFiles((root / "nope").string()).isSuccess());
+    fs::remove_all(root);
+}
+
+// Clips fingerprinted together with batched FFTs match one-by-one fingerprints
+TEST(BatchFingerprinterTest, SampleBatchMatchesPerClip) {
+    const std::vector<std::vector<float>> clips = {
+        sortify::testing::generateMelody(2.0f, 44100, 11),
+        std::vector<float>(100, 0.1f),
+        sortify::testing::generateMelody(1.5f, 44100, 12),
+    };
+    const sortify::audio::FingerprintConfig config;
+
+    auto batch = sortify::audio::fingerprintSampleBatch(clips, config, 5);
+    ASSERT_EQ(batch.size(), clips.size());
+    EXPECT_FALSE(batch[1].isSuccess());
+    for (size_t clip : {size_t(0), size_t(2)}) {
+        auto single = sortify::audio::fingerprintSamples(clips[clip], config);
+        ASSERT_TRUE(single.isSuccess()) << single.getError();
+        ASSERT_TRUE(batch[clip].isSuccess()) << batch[clip].getError();
+        // FFTW may round a batched transform differently, which can flip a borderline peak
+        const auto& expected = single.getValue().records();
+        const auto& actual = batch[clip].getValue().records();
+        std::vector<sortify::audio::HashRecord> shared;
+        std::set_intersection(actual.begin(), actual.end(), expected.begin(), expected.end(),
+                              std::back_inserter(shared));
+        EXPECT_GE(shared.size(), expected.size() * 98 / 100);
+        EXPECT_GE(shared.size(), actual.size() * 98 / 100);
+    }
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include "bloom_filter.hpp"
+
+using sortify::audio::BlockedBloomFilter;
+
+namespace {
+
+// Spreads consecutive integers like fingerprint hashes would be
+uint32_t keyOf(uint32_t i) {
+    return i * 2654435761u + 12345u;
+}
+
+} // namespace
+
+// Inserted keys are always reported and most other keys are rejected
+TEST(BloomFilterTest, NoFalseNegativesAndFewFalsePositives) {
+    constexpr uint32_t numKeys = 100000;
+    BlockedBloomFilter filter(numKeys);
+    ASSERT_FALSE(filter.empty());
+    EXPECT_EQ(filter.sizeBytes(), filter.blockCount() * 64);
+    EXPECT_GE(filter.sizeBytes() * 8, size_t(numKeys) * sortify::audio::defaultBloomBitsPerKey);
+
+    for (uint32_t i = 0; i < numKeys; ++i) {
+        filter.insert(keyOf(i));
+    }
+    for (uint32_t i = 0; i < numKeys; ++i) {
+        ASSERT_TRUE(filter.mayContain(keyOf(i))) << i;
+    }
+
+    size_t falsePositives = 0;
+    for (uint32_t i = numKeys; i < 2 * numKeys; ++i) {
+        falsePositives += filter.mayContain(keyOf(i)) ? 1 : 0;
+    }
+    EXPECT_LT(falsePositives, numKeys / 50);
+
+    // Probing the raw blocks gives the same answers
+    for (uint32_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ(BlockedBloomFilter::mayContain(filter.data(), filter.blockCount(), keyOf(i + numKeys / 2 * 3)),
+                  filter.mayContain(keyOf(i + numKeys / 2 * 3)));
+    }
+}
+
+// A filter without blocks never rejects, so disabling it cannot lose matches
+TEST(BloomFilterTest, EmptyFilterAcceptsEverything) {
+    BlockedBloomFilter disabled(1000, 0);
+    EXPECT_TRUE(disabled.empty());
+    disabled.insert(7);
+    EXPECT_TRUE(disabled.mayContain(7));
+    EXPECT_TRUE(disabled.mayContain(8));
+    EXPECT_TRUE(BlockedBloomFilter().mayContain(123));
+}
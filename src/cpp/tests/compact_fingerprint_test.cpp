@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <utility>
+#include "audio_fingerprint.hpp"
+#include "compact_fingerprint.hpp"
+#include "fingerprint_stages.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::CompactFingerprint;
+using sortify::audio::HashRecord;
+using sortify::testing::makePeaks;
+
+// The compact form holds exactly the (hash, anchor time) pairs of the hashmap
+TEST(CompactFingerprintTest, MatchesHashMapFingerprint) {
+    auto peaks = makePeaks(200, 3);
+
+    auto map = sortify::audio::createFingerprint(peaks, 7);
+    ASSERT_TRUE(map.isSuccess()) << map.getError();
+    auto compact = sortify::audio::createCompactFingerprint(peaks);
+    ASSERT_TRUE(compact.isSuccess()) << compact.getError();
+
+    const CompactFingerprint& fingerprint = compact.getValue();
+    EXPECT_TRUE(std::is_sorted(fingerprint.begin(), fingerprint.end()));
+    EXPECT_EQ(fingerprint.uniqueHashCount(), map.getValue().size());
+
+    size_t total = 0;
+    for (const auto& [hash, entries] : map.getValue()) {
+        auto range = fingerprint.find(hash);
+        ASSERT_EQ(range.size(), entries.size());
+        for (const auto& entry : entries) {
+            HashRecord expected = {hash, static_cast<uint32_t>(entry.time)};
+            EXPECT_TRUE(std::find(range.begin(), range.end(), expected) != range.end());
+        }
+        total += entries.size();
+    }
+    EXPECT_EQ(fingerprint.size(), total);
+
+    CompactFingerprint converted = CompactFingerprint::fromHashMap(map.getValue());
+    EXPECT_EQ(converted.records(), fingerprint.records());
+}
+
+// Records are sorted and duplicates removed; missing hashes give an empty range
+TEST(CompactFingerprintTest, SortsAndDeduplicates) {
+    CompactFingerprint fingerprint({{9, 4}, {3, 2}, {9, 1}, {3, 2}, {5, 0}});
+
+    ASSERT_EQ(fingerprint.size(), 4u);
+    EXPECT_EQ(fingerprint.uniqueHashCount(), 3u);
+
+    auto range = fingerprint.find(9);
+    ASSERT_EQ(range.size(), 2u);
+    EXPECT_EQ(range.begin()[0].anchorFrame, 1u);
+    EXPECT_EQ(range.begin()[1].anchorFrame, 4u);
+
+    EXPECT_TRUE(fingerprint.find(4).empty());
+    EXPECT_FALSE(fingerprint.contains(10));
+    EXPECT_TRUE(fingerprint.contains(5));
+}
+
+// Building in place keeps the storage of the previous fingerprint
+TEST(CompactFingerprintTest, IntoReusesStorage) {
+    auto longPeaks = makePeaks(400, 5);
+    auto shortPeaks = makePeaks(100, 9);
+
+    CompactFingerprint reused;
+    ASSERT_TRUE(sortify::audio::createCompactFingerprintInto(longPeaks, reused).isSuccess());
+    const HashRecord* storage = reused.begin();
+
+    auto built = sortify::audio::createCompactFingerprintInto(shortPeaks, reused);
+    ASSERT_TRUE(built.isSuccess()) << built.getError();
+    EXPECT_EQ(built.getValue(), reused.size());
+    EXPECT_EQ(reused.begin(), storage);
+
+    auto expected = sortify::audio::createCompactFingerprint(shortPeaks);
+    ASSERT_TRUE(expected.isSuccess());
+    EXPECT_EQ(reused.records(), std::move(expected).take().records());
+
+    EXPECT_FALSE(sortify::audio::createCompactFingerprintInto({}, reused).isSuccess());
+    EXPECT_EQ(reused.size(), 0u);
+}
+
+namespace {
+
+using IndexedPairs = std::vector<std::pair<size_t, uint32_t>>;
+
+// Dense frames with duplicate times, shuffled bins and fractional frequencies
+std::vector<sortify::audio::Peak> makeDensePeaks(unsigned int numFrames, bool sortBins) {
+    std::mt19937 rng(21);
+    std::uniform_real_distribution<float> bin(0.0f, 120.0f);
+    std::vector<sortify::audio::Peak> peaks;
+    for (unsigned int t = 0; t < numFrames; ++t) {
+        std::vector<float> bins(20);
+        for (float& value : bins) {
+            value = bin(rng);
+        }
+        if (sortBins) {
+            std::sort(bins.begin(), bins.end());
+        }
+        for (float f : bins) {
+            peaks.push_back({f, static_cast<float>(t), 1.0f});
+        }
+    }
+    return peaks;
+}
+
+template <typename Zone>
+IndexedPairs linearPairs(const Zone& zone, const std::vector<sortify::audio::Peak>& peaks) {
+    IndexedPairs pairs;
+    for (size_t i = 0; i < peaks.size(); ++i) {
+        sortify::audio::pairAnchorInZone(zone, peaks[i], peaks.begin() + i + 1, peaks.end(),
+                                         [&](uint32_t hash) { pairs.emplace_back(i, hash); });
+    }
+    return pairs;
+}
+
+template <typename Zone>
+IndexedPairs indexedPairs(const Zone& zone, const std::vector<sortify::audio::Peak>& peaks) {
+    sortify::audio::PeakFrames frames;
+    EXPECT_TRUE(sortify::audio::bucketPeakFrames(peaks, frames));
+    IndexedPairs pairs;
+    size_t emitted = sortify::audio::pairPeaksIndexed(zone, peaks, frames, [&](size_t anchor, uint32_t hash) {
+        pairs.emplace_back(anchor, hash);
+    });
+    EXPECT_EQ(emitted, pairs.size());
+    return pairs;
+}
+
+} // namespace
+
+// Indexed pairing emits the exact hashes, in the exact order, of the linear scan
+TEST(CompactFingerprintTest, IndexedPairingMatchesLinearScan) {
+    for (bool sortBins : {true, false}) {
+        auto peaks = makeDensePeaks(60, sortBins);
+        EXPECT_EQ(indexedPairs(sortify::audio::TargetZone(), peaks),
+                  linearPairs(sortify::audio::TargetZone(), peaks)) << "sorted bins: " << sortBins;
+
+        // Zones that include the anchor's own frame or exclude several frames
+        for (float minDelta : {-1.0f, 0.0f, 2.0f}) {
+            sortify::audio::FingerprintConfig config;
+            config.minTargetTimeDelta = minDelta;
+            config.targetTimeRange = 4.5f;
+            config.maxFreqDelta = 7.5f;
+            config.maxTargetsPerAnchor = 12;
+            sortify::audio::RuntimeTargetZone zone(config);
+            EXPECT_EQ(indexedPairs(zone, peaks), linearPairs(zone, peaks))
+                << "sorted bins: " << sortBins << ", min delta: " << minDelta;
+        }
+    }
+
+    // Peaks out of time order cannot be bucketed
+    std::vector<sortify::audio::Peak> unsorted = {{10.0f, 2.0f, 1.0f}, {12.0f, 1.0f, 1.0f}};
+    sortify::audio::PeakFrames frames;
+    EXPECT_FALSE(sortify::audio::bucketPeakFrames(unsorted, frames));
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <map>
+#include "duplicate_detector.hpp"
+#include "batch_fingerprinter.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::CompactFingerprint;
+using sortify::audio::DuplicateDetector;
+using sortify::audio::HashRecord;
+
+// Sketch agreement tracks the Jaccard similarity of the hash sets
+TEST(DuplicateDetectorTest, SketchEstimatesJaccard) {
+    std::vector<HashRecord> shared, onlyA, onlyB;
+    for (uint32_t i = 0; i < 3000; ++i) {
+        shared.push_back({i * 7919u, i});
+        onlyA.push_back({i * 7919u + 1, i});
+        onlyB.push_back({i * 7919u + 2, i});
+    }
+    // Both sets hold 3000 shared and 3000 own hashes: J = 3000 / 9000
+    std::vector<HashRecord> a = shared, b = shared;
+    a.insert(a.end(), onlyA.begin(), onlyA.end());
+    b.insert(b.end(), onlyB.begin(), onlyB.end());
+
+    auto sketchA = sortify::audio::computeMinHashSketch(CompactFingerprint(a), 512);
+    auto sketchB = sortify::audio::computeMinHashSketch(CompactFingerprint(b), 512);
+    ASSERT_EQ(sketchA.size(), 512u);
+    EXPECT_NEAR(sortify::audio::estimateJaccard(sketchA, sketchB), 1.0f / 3.0f, 0.07f);
+    EXPECT_FLOAT_EQ(sortify::audio::estimateJaccard(sketchA, sketchA), 1.0f);
+    EXPECT_TRUE(sortify::audio::computeMinHashSketch(CompactFingerprint(), 512).empty());
+}
+
+// Shifted and attenuated copies of one track form a group; distinct tracks stay out
+TEST(DuplicateDetectorTest, GroupsCopiesOfTheSameTrack) {
+    const sortify::audio::FingerprintConfig config;
+    std::map<int, std::vector<float>> tracks;
+    for (int seed = 1; seed <= 5; ++seed) {
+        tracks[seed] = sortify::testing::generateMelody(8.0f, config.sampleRate, static_cast<unsigned int>(seed));
+    }
+    // Delayed by a whole number of window steps, and a quieter copy
+    std::vector<float> delayed(10 * 1024, 0.0f);
+    delayed.insert(delayed.end(), tracks[2].begin(), tracks[2].end());
+    tracks[12] = delayed;
+    tracks[22] = tracks[2];
+    for (float& sample : tracks[22]) {
+        sample *= 0.5f;
+    }
+
+    std::map<int, CompactFingerprint> fingerprints;
+    sortify::audio::DuplicateOptions options;
+    options.numThreads = 2;
+    DuplicateDetector detector(options);
+    for (const auto& [songId, samples] : tracks) {
+        auto fingerprint = sortify::audio::fingerprintSamples(samples, config);
+        ASSERT_TRUE(fingerprint.isSuccess()) << fingerprint.getError();
+        fingerprints[songId] = std::move(fingerprint).take();
+        ASSERT_TRUE(detector.addTrack(songId, fingerprints[songId]).isSuccess());
+    }
+    EXPECT_FALSE(detector.addSketch(99, {1, 2, 3}).isSuccess());
+
+    auto report = detector.findDuplicates([&](int songId) -> const CompactFingerprint* {
+        auto it = fingerprints.find(songId);
+        return it == fingerprints.end() ? nullptr : &it->second;
+    });
+    ASSERT_TRUE(report.isSuccess()) << report.getError();
+
+    const auto& value = report.getValue();
+    ASSERT_EQ(value.groups.size(), 1u);
+    EXPECT_EQ(value.groups[0], (std::vector<int>{2, 12, 22}));
+    EXPECT_GE(value.candidatePairs, value.pairs.size());
+    ASSERT_EQ(value.pairs.size(), 3u);
+    EXPECT_EQ(value.pairs[0].firstSongId, 2);
+    EXPECT_EQ(value.pairs[0].secondSongId, 12);
+    EXPECT_EQ(value.pairs[0].offsetFrames, 10);
+}
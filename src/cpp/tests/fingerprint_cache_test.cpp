@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <dirent.h>
+#include <unistd.h>
+#include "fingerprint_cache.hpp"
+#include "batch_fingerprinter.hpp"
+#include "wav_reader.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::FingerprintCache;
+using sortify::audio::FileIdentity;
+using sortify::audio::computeFileIdentity;
+
+namespace {
+
+std::string tempPath(const std::string& name) {
+    return "/tmp/sortify_cache_" + std::to_string(::getpid()) + "_" + name;
+}
+
+} // namespace
+
+// Entries survive a save/load round trip and go stale when the file or the parameters change
+TEST(FingerprintCacheTest, PersistsAndInvalidates) {
+    const std::string audioPath = tempPath("track.wav");
+    const std::string cachePath = tempPath("cache.bin");
+    ASSERT_TRUE(sortify::testing::writeWav16(audioPath, sortify::testing::generateMelody(2.0f, 44100, 3), 44100));
+
+    auto identity = computeFileIdentity(audioPath);
+    ASSERT_TRUE(identity.isSuccess()) << identity.getError();
+    EXPECT_GT(identity.getValue().size, 0u);
+
+    auto peaks = sortify::testing::makePeaks(200, 11);
+    auto fingerprint = sortify::testing::compactFingerprintOf(peaks);
+    {
+        FingerprintCache cache(cachePath);
+        cache.store(audioPath, identity.getValue(), 42, fingerprint);
+        ASSERT_TRUE(cache.save().isSuccess());
+    }
+
+    FingerprintCache cache(cachePath);
+    auto loaded = cache.load();
+    ASSERT_TRUE(loaded.isSuccess()) << loaded.getError();
+    EXPECT_EQ(loaded.getValue(), 1u);
+
+    sortify::audio::CompactFingerprint cached;
+    ASSERT_TRUE(cache.lookup(audioPath, identity.getValue(), 42, cached));
+    EXPECT_EQ(cached.records(), fingerprint.records());
+    EXPECT_FALSE(cache.lookup(audioPath, identity.getValue(), 43, cached));
+    EXPECT_FALSE(cache.lookup("other.wav", identity.getValue(), 42, cached));
+
+    // Rewriting the file with different audio changes its identity
+    ASSERT_TRUE(sortify::testing::writeWav16(audioPath, sortify::testing::generateMelody(2.0f, 44100, 4), 44100));
+    auto changed = computeFileIdentity(audioPath);
+    ASSERT_TRUE(changed.isSuccess());
+    EXPECT_FALSE(changed.getValue() == identity.getValue());
+    EXPECT_FALSE(cache.lookup(audioPath, changed.getValue(), 42, cached));
+    EXPECT_EQ(cache.hits(), 1u);
+    EXPECT_EQ(cache.misses(), 3u);
+
+    EXPECT_EQ(cache.retainOnly({}), 1u);
+    EXPECT_EQ(cache.size(), 0u);
+
+    std::remove(audioPath.c_str());
+    std::remove(cachePath.c_str());
+}
+
+// Processes saving one cache at once never share a temporary file, and a
+// failed save leaves nothing behind
+TEST(FingerprintCacheTest, ConcurrentSavesStayLoadable) {
+    char directoryTemplate[] = "/tmp/sortify_cache_dir_XXXXXX";
+    ASSERT_NE(::mkdtemp(directoryTemplate), nullptr);
+    const std::string directory = directoryTemplate;
+    const std::string cachePath = directory + "/cache.bin";
+
+    const FileIdentity identity{1000, 1, 7};
+    const auto fingerprint = sortify::testing::compactFingerprintOf(sortify::testing::makePeaks(200, 11));
+    FingerprintCache small(cachePath);
+    FingerprintCache big(cachePath);
+    small.store("a.wav", identity, 42, fingerprint);
+    big.store("a.wav", identity, 42, fingerprint);
+    big.store("b.wav", identity, 42, fingerprint);
+
+    std::atomic<int> failures{0};
+    auto saveRepeatedly = [&](const FingerprintCache& cache) {
+        for (int i = 0; i < 20; ++i) {
+            if (!cache.save().isSuccess()) failures++;
+        }
+    };
+    std::thread first(saveRepeatedly, std::cref(small));
+    std::thread second(saveRepeatedly, std::cref(big));
+    first.join();
+    second.join();
+    EXPECT_EQ(failures, 0);
+
+    FingerprintCache loaded(cachePath);
+    auto count = loaded.load();
+    ASSERT_TRUE(count.isSuccess()) << count.getError();
+    EXPECT_TRUE(count.getValue() == 1u || count.getValue() == 2u) << count.getValue();
+
+    FingerprintCache unwritable(directory + "/missing/cache.bin");
+    EXPECT_FALSE(unwritable.save().isSuccess());
+
+    std::vector<std::string> names;
+    if (DIR* listing = ::opendir(directory.c_str())) {
+        while (const dirent* entry = ::readdir(listing)) {
+            if (entry->d_name[0] != '.') names.push_back(entry->d_name);
+        }
+        ::closedir(listing);
+    }
+    EXPECT_EQ(names, std::vector<std::string>{"cache.bin"});
+
+    std::remove(cachePath.c_str());
+    ::rmdir(directory.c_str());
+}
+
+// A second batch run over unchanged files never calls the decoder
+TEST(FingerprintCacheTest, BatchRescanSkipsUnchangedFiles) {
+    std::vector<std::string> paths;
+    for (unsigned int i = 0; i < 3; ++i) {
+        paths.push_back(tempPath("batch" + std::to_string(i) + ".wav"));
+        ASSERT_TRUE(sortify::testing::writeWav16(paths.back(), sortify::testing::generateMelody(3.0f, 44100, i + 1), 44100));
+    }
+
+    std::atomic<int> decodes{0};
+    FingerprintCache cache;
+    sortify::audio::BatchOptions options;
+    options.numThreads = 2;
+    options.cache = &cache;
+    options.decoder = [&](const std::string& path) {
+        decodes++;
+        std::vector<float> samples;
+        sortify::audio::WavFile(path).readAll(samples);
+        return samples;
+    };
+
+    sortify::audio::BatchFingerprinter batch(options);
+    auto first = batch.run(paths, 0, nullptr);
+    EXPECT_EQ(decodes.load(), 3);
+    EXPECT_EQ(cache.size(), 3u);
+
+    auto second = batch.run(paths, 0, nullptr);
+    EXPECT_EQ(decodes.load(), 3);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        EXPECT_EQ(second[i].status, sortify::audio::FileStatus::OK);
+        EXPECT_TRUE(second[i].fromCache);
+        EXPECT_FALSE(first[i].fromCache);
+        EXPECT_EQ(second[i].numHashes, first[i].numHashes);
+    }
+
+    // Different analysis parameters must not reuse the cached fingerprints
+    options.config.windowSize = 1024;
+    sortify::audio::BatchFingerprinter changed(options);
+    changed.run(paths, 0, nullptr);
+    EXPECT_EQ(decodes.load(), 6);
+
+    for (const auto& path : paths) {
+        std::remove(path.c_str());
+    }
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <map>
+#include "fingerprint_compare.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::CompactFingerprint;
+using sortify::audio::CompareOptions;
+using sortify::audio::FingerprintComparer;
+using sortify::testing::compactFingerprintOf;
+using sortify::testing::excerptPeaks;
+using sortify::testing::makePeaks;
+
+namespace {
+
+// Straightforward offset histogram over every pair of equal hashes
+std::map<int64_t, unsigned int> referenceHistogram(const CompactFingerprint& a, const CompactFingerprint& b) {
+    std::map<int64_t, unsigned int> histogram;
+    for (const auto& x : a.records()) {
+        for (const auto& y : b.records()) {
+            if (x.hash == y.hash) {
+                histogram[static_cast<int64_t>(y.anchorFrame) - static_cast<int64_t>(x.anchorFrame)]++;
+            }
+        }
+    }
+    return histogram;
+}
+
+} // namespace
+
+// Without thresholds the merge join reproduces the full histogram peak
+TEST(FingerprintCompareTest, MatchesReferenceHistogram) {
+    const auto peaks = makePeaks(600, 21);
+    const CompactFingerprint track = compactFingerprintOf(peaks);
+    const CompactFingerprint excerpt = compactFingerprintOf(excerptPeaks(peaks, 150, 400));
+
+    auto comparison = sortify::audio::compareFingerprints(excerpt, track);
+    EXPECT_TRUE(comparison.complete);
+    EXPECT_EQ(comparison.offsetFrames, 150);
+
+    const auto histogram = referenceHistogram(excerpt, track);
+    unsigned int best = 0;
+    for (const auto& [offset, count] : histogram) {
+        best = std::max(best, count);
+    }
+    EXPECT_EQ(comparison.score, best);
+    EXPECT_FLOAT_EQ(comparison.confidence, static_cast<float>(best) / excerpt.size());
+
+    // Offsets outside the configured range get no votes
+    CompareOptions narrow;
+    narrow.maxOffsetFrames = 100;
+    auto limited = sortify::audio::compareFingerprints(excerpt, track, narrow);
+    EXPECT_LT(limited.score, comparison.score);
+    EXPECT_LE(std::abs(limited.offsetFrames), 100);
+}
+
+// Thresholds stop the merge once the outcome is certain
+TEST(FingerprintCompareTest, ExitsEarlyWhenDecided) {
+    const auto peaks = makePeaks(600, 21);
+    const CompactFingerprint track = compactFingerprintOf(peaks);
+    const CompactFingerprint copy = compactFingerprintOf(excerptPeaks(peaks, 0, 600));
+    const CompactFingerprint unrelated = compactFingerprintOf(makePeaks(600, 22));
+
+    CompareOptions options;
+    options.minConfidence = 0.3f;
+    FingerprintComparer comparer(options);
+
+    auto match = comparer.compare(copy, track);
+    EXPECT_TRUE(match.isMatch(options));
+    EXPECT_FALSE(match.complete);
+    EXPECT_EQ(match.offsetFrames, 0);
+    EXPECT_LT(match.score, copy.size());
+
+    auto mismatch = comparer.compare(unrelated, track);
+    EXPECT_FALSE(mismatch.isMatch(options));
+    EXPECT_FALSE(mismatch.complete);
+
+    // The comparer leaves its histogram clean for the next pair
+    options.minConfidence = 0.0f;
+    comparer.setOptions(options);
+    auto full = comparer.compare(copy, track);
+    EXPECT_TRUE(full.complete);
+    EXPECT_EQ(full.score, copy.size());
+}
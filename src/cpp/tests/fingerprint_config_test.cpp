@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+#include "audio_fingerprint.hpp"
+#include "compact_fingerprint.hpp"
+#include "fingerprint_config.hpp"
+#include "fingerprint_stages.hpp"
+#include "fingerprint_stream.hpp"
+#include "fingerprint_index.hpp"
+#include "index_file.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::CompactFingerprint;
+using sortify::audio::DefaultFingerprintPolicy;
+using sortify::audio::FingerprintConfig;
+using sortify::testing::makePeaks;
+
+// The default configuration is the compile-time policy, so it selects the specialized kernels
+static_assert(sortify::audio::matchesPolicy<DefaultFingerprintPolicy>(FingerprintConfig()),
+              "FingerprintConfig defaults must equal DefaultFingerprintPolicy");
+static_assert(sortify::audio::matchesPolicy<DefaultFingerprintPolicy>(
+                  sortify::audio::makeFingerprintConfig<DefaultFingerprintPolicy>()),
+              "makeFingerprintConfig must reproduce the policy");
+
+namespace {
+
+// Five bands and three targets per anchor, which only the runtime kernels handle
+FingerprintConfig fiveBandConfig() {
+    FingerprintConfig config;
+    config.numBands = 5;
+    config.bandEdges = {0.0, 0.1, 0.25, 0.5, 0.75, 1.0};
+    config.maxTargetsPerAnchor = 3;
+    return config;
+}
+
+} // namespace
+
+// The runtime band and zone code reproduces the constant-folded defaults exactly
+TEST(FingerprintConfigTest, RuntimeKernelsMatchSpecializedDefaults) {
+    for (unsigned int numBins : {64u, 232u, 1024u}) {
+        auto fixed = sortify::audio::computeFrequencyBands(numBins);
+        auto runtime = sortify::audio::computeFrequencyBands(numBins, FingerprintConfig());
+        ASSERT_TRUE(fixed.isSuccess()) << fixed.getError();
+        ASSERT_TRUE(runtime.isSuccess()) << runtime.getError();
+        EXPECT_EQ(fixed.getValue(), runtime.getValue()) << numBins << " bins";
+    }
+
+    auto peaks = makePeaks(200, 11);
+    sortify::audio::RuntimeTargetZone zone{FingerprintConfig()};
+    for (size_t i = 0; i < peaks.size(); ++i) {
+        std::vector<uint32_t> fixedHashes;
+        std::vector<uint32_t> runtimeHashes;
+        sortify::audio::pairAnchor(peaks[i], peaks.begin() + i + 1, peaks.end(),
+                                   [&](uint32_t hash) { fixedHashes.push_back(hash); });
+        sortify::audio::pairAnchorInZone(zone, peaks[i], peaks.begin() + i + 1, peaks.end(),
+                                         [&](uint32_t hash) { runtimeHashes.push_back(hash); });
+        ASSERT_EQ(fixedHashes, runtimeHashes) << "anchor " << i;
+    }
+}
+
+// A non-default configuration changes the fingerprint and its configuration ID
+TEST(FingerprintConfigTest, CustomConfigurationChangesFingerprint) {
+    const FingerprintConfig config = fiveBandConfig();
+    EXPECT_NE(sortify::audio::hashFingerprintConfig(config), sortify::audio::hashFingerprintConfig(FingerprintConfig()));
+
+    auto samples = sortify::testing::generateMelody(4.0f, 44100, 5);
+    auto spectrogram = sortify::audio::generateSpectrogram(samples, 44100);
+    ASSERT_TRUE(spectrogram.isSuccess()) << spectrogram.getError();
+
+    auto defaultPeaks = sortify::audio::extractPeaks(spectrogram.getValue());
+    auto customPeaks = sortify::audio::extractPeaks(spectrogram.getValue(), config);
+    ASSERT_TRUE(defaultPeaks.isSuccess()) << defaultPeaks.getError();
+    ASSERT_TRUE(customPeaks.isSuccess()) << customPeaks.getError();
+    EXPECT_LT(customPeaks.getValue().size(), defaultPeaks.getValue().size());
+
+    auto fingerprint = sortify::audio::createCompactFingerprint(customPeaks.getValue(), config);
+    ASSERT_TRUE(fingerprint.isSuccess()) << fingerprint.getError();
+    EXPECT_FALSE(fingerprint.getValue().empty());
+
+    // Streaming with the same configuration yields the same records
+    sortify::audio::FingerprintStream stream(0, config);
+    ASSERT_TRUE(stream.isValid()) << stream.getError();
+    std::vector<sortify::audio::FingerprintHash> emitted;
+    ASSERT_TRUE(stream.pushSamples(samples.data(), samples.size(), emitted).isSuccess());
+    ASSERT_TRUE(stream.finish(emitted).isSuccess());
+
+    std::vector<sortify::audio::HashRecord> records;
+    for (const auto& entry : emitted) {
+        records.push_back({entry.hash, static_cast<uint32_t>(entry.time)});
+    }
+    std::sort(records.begin(), records.end());
+    records.erase(std::unique(records.begin(), records.end()), records.end());
+    CompactFingerprint streamed = CompactFingerprint::fromSortedRecords(std::move(records));
+    EXPECT_TRUE(std::equal(streamed.begin(), streamed.end(),
+                           fingerprint.getValue().begin(), fingerprint.getValue().end()));
+}
+
+// Band layouts the peak picker cannot represent are rejected instead of misread
+TEST(FingerprintConfigTest, RejectsInvalidBands) {
+    FingerprintConfig config;
+    config.numBands = 0;
+    EXPECT_FALSE(sortify::audio::computeFrequencyBands(232, config).isSuccess());
+
+    config.numBands = sortify::audio::maxFrequencyBands + 1;
+    EXPECT_FALSE(sortify::audio::computeFrequencyBands(232, config).isSuccess());
+
+    config = FingerprintConfig();
+    config.bandEdges[3] = 0.2;  // Not ascending
+    EXPECT_FALSE(sortify::audio::computeFrequencyBands(232, config).isSuccess());
+}
+
+// Index files record the configuration their hashes were produced with
+TEST(FingerprintConfigTest, IndexFileStoresConfigId) {
+    const uint64_t configId = sortify::audio::hashFingerprintConfig(fiveBandConfig());
+
+    sortify::audio::FingerprintIndex index;
+    index.setConfigId(configId);
+    index.addTrack(1, sortify::testing::compactFingerprintOf(makePeaks(100, 2)));
+    index.build();
+
+    const std::string path = "/tmp/sortify_config_id_" + std::to_string(::getpid()) + ".idx";
+    ASSERT_TRUE(sortify::audio::writeIndexFile(index, path).isSuccess());
+    {
+        sortify::audio::MappedIndex mapped(path);
+        ASSERT_TRUE(mapped.isValid()) << mapped.getError();
+        EXPECT_EQ(mapped.configId(), configId);
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <algorithm>
+#include "audio_fingerprint.hpp"
+#include "compact_fingerprint.hpp"
+#include "fingerprint_index.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::CompactFingerprint;
+using sortify::audio::FingerprintIndex;
+using sortify::testing::makePeaks;
+using sortify::testing::excerptPeaks;
+
+// An excerpt of an indexed track is found at the right offset
+TEST(FingerprintIndexTest, FindsTrackFromExcerpt) {
+    FingerprintIndex index;
+    std::vector<std::vector<sortify::audio::Peak>> tracks;
+    for (int song = 0; song < 20; ++song) {
+        tracks.push_back(makePeaks(400, 100 + song));
+        ASSERT_TRUE(index.addTrack(song, sortify::testing::compactFingerprintOf(tracks.back())).isSuccess());
+    }
+    index.build();
+    EXPECT_EQ(index.trackCount(), 20u);
+    EXPECT_FALSE(index.hasPendingTracks());
+
+    auto result = index.query(sortify::testing::compactFingerprintOf(excerptPeaks(tracks[13], 150, 250)), 3);
+    ASSERT_TRUE(result.isSuccess()) << result.getError();
+    const auto& candidates = result.getValue();
+    ASSERT_FALSE(candidates.empty());
+    EXPECT_EQ(candidates[0].songId, 13);
+    EXPECT_EQ(candidates[0].offsetFrames, 150);
+    EXPECT_GT(candidates[0].confidence, 0.9f);
+    if (candidates.size() > 1) {
+        EXPECT_LT(candidates[1].score * 10, candidates[0].score);
+    }
+}
+
+// Building twice gives the same layout as building once
+TEST(FingerprintIndexTest, IncrementalBuildMatchesSingleBuild) {
+    FingerprintIndex once;
+    FingerprintIndex incremental;
+    for (int song = 0; song < 6; ++song) {
+        CompactFingerprint fingerprint = sortify::testing::compactFingerprintOf(makePeaks(120, 7 * song + 1));
+        ASSERT_TRUE(once.addTrack(song, fingerprint).isSuccess());
+        ASSERT_TRUE(incremental.addTrack(song, fingerprint).isSuccess());
+        if (song == 2) {
+            incremental.build();
+        }
+    }
+    once.build();
+    incremental.build();
+
+    EXPECT_EQ(once.hashKeys(), incremental.hashKeys());
+    EXPECT_EQ(once.postingOffsets(), incremental.postingOffsets());
+    ASSERT_EQ(once.postingCount(), incremental.postingCount());
+    for (size_t i = 0; i < once.postingCount(); ++i) {
+        EXPECT_EQ(once.allPostings()[i].songId, incremental.allPostings()[i].songId);
+        EXPECT_EQ(once.allPostings()[i].anchorFrame, incremental.allPostings()[i].anchorFrame);
+    }
+}
+
+// Duplicate song IDs and queries against an empty index are rejected
+TEST(FingerprintIndexTest, RejectsInvalidUse) {
+    FingerprintIndex index;
+    CompactFingerprint fingerprint = sortify::testing::compactFingerprintOf(makePeaks(50, 5));
+
+    EXPECT_FALSE(index.query(fingerprint).isSuccess());
+    EXPECT_TRUE(index.addTrack(1, fingerprint).isSuccess());
+    EXPECT_FALSE(index.addTrack(1, fingerprint).isSuccess());
+    EXPECT_FALSE(index.addTrack(2, CompactFingerprint()).isSuccess());
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <map>
+#include <algorithm>
+#include "audio_fingerprint.hpp"
+#include "fingerprint_stream.hpp"
+
+// Helper function to generate a deterministic melody with noise
+std::vector<float> generateMelody(float duration, unsigned int sampleRate) {
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+    std::vector<float> samples(static_cast<size_t>(duration * sampleRate));
+    for (size_t i = 0; i < samples.size(); ++i) {
+        double t = static_cast<double>(i) / sampleRate;
+        int note = static_cast<int>(t * 4) % 7;
+        double f = 220.0 * std::pow(2.0, note / 6.0);
+        samples[i] = static_cast<float>(0.5 * std::sin(2 * M_PI * f * t) +
+                                        0.2 * std::sin(2 * M_PI * (1000 + 150 * note) * t)) + noise(rng);
+    }
+    return samples;
+}
+
+// Collect (hash, time) pairs so both representations can be compared directly
+using HashList = std::vector<std::pair<uint32_t, float>>;
+
+HashList fromBatch(const std::vector<float>& samples) {
+    auto spectrogram = sortify::audio::generateSpectrogram(samples, 44100);
+    auto peaks = sortify::audio::extractPeaks(spectrogram.getValue());
+    auto fingerprint = sortify::audio::createFingerprint(peaks.getValue(), 3);
+
+    HashList hashes;
+    for (const auto& [hash, entries] : fingerprint.getValue()) {
+        for (const auto& entry : entries) {
+            hashes.emplace_back(hash, entry.time);
+        }
+    }
+    std::sort(hashes.begin(), hashes.end());
+    return hashes;
+}
+
+HashList fromStream(const std::vector<float>& samples, size_t blockSize) {
+    sortify::audio::FingerprintStream stream(3);
+    EXPECT_TRUE(stream.isValid()) << stream.getError();
+
+    std::vector<sortify::audio::FingerprintHash> emitted;
+    for (size_t offset = 0; offset < samples.size(); offset += blockSize) {
+        size_t count = std::min(blockSize, samples.size() - offset);
+        auto result = stream.pushSamples(samples.data() + offset, count, emitted);
+        EXPECT_TRUE(result.isSuccess()) << result.getError();
+    }
+    auto result = stream.finish(emitted);
+    EXPECT_TRUE(result.isSuccess()) << result.getError();
+
+    HashList hashes;
+    for (const auto& entry : emitted) {
+        EXPECT_EQ(entry.songId, 3);
+        hashes.emplace_back(entry.hash, entry.time);
+    }
+    std::sort(hashes.begin(), hashes.end());
+    return hashes;
+}
+
+// The stream must emit exactly the hashes of the batch pipeline, for any block size
+TEST(FingerprintStreamTest, MatchesBatchPipeline) {
+    auto samples = generateMelody(4.0f, 44100);
+    HashList expected = fromBatch(samples);
+    ASSERT_FALSE(expected.empty());
+
+    for (size_t blockSize : {1u, 333u, 1024u, 4096u, 100000u}) {
+        EXPECT_EQ(fromStream(samples, blockSize), expected) << "Block size " << blockSize;
+    }
+}
+
+// Hashes must start flowing before the input ends
+TEST(FingerprintStreamTest, EmitsIncrementally) {
+    auto samples = generateMelody(4.0f, 44100);
+    sortify::audio::FingerprintStream stream(1);
+    ASSERT_TRUE(stream.isValid()) << stream.getError();
+
+    std::vector<sortify::audio::FingerprintHash> emitted;
+    auto result = stream.pushSamples(samples.data(), samples.size() / 2, emitted);
+    ASSERT_TRUE(result.isSuccess()) << result.getError();
+    EXPECT_GT(emitted.size(), 0u);
+    EXPECT_GT(stream.framesProcessed(), 0u);
+}
+
+// Invalid parameters are reported through isValid/getError and every call
+TEST(FingerprintStreamTest, RejectsInvalidParameters) {
+    sortify::audio::FingerprintStream stream(1, 44100, 2048, 1.5f);
+    EXPECT_FALSE(stream.isValid());
+
+    std::vector<sortify::audio::FingerprintHash> emitted;
+    float sample = 0.0f;
+    EXPECT_FALSE(stream.pushSamples(&sample, 1, emitted).isSuccess());
+    EXPECT_FALSE(stream.finish(emitted).isSuccess());
+}
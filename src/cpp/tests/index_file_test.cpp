@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
+#include "compact_fingerprint.hpp"
+#include "fingerprint_index.hpp"
+#include "index_file.hpp"
+#include "metrics.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::CompactFingerprint;
+using sortify::audio::FingerprintIndex;
+using sortify::audio::MappedIndex;
+using sortify::audio::Posting;
+using sortify::testing::makePeaks;
+
+namespace {
+
+std::string tempIndexPath(const char* name) {
+    return "/tmp/sortify_" + std::string(name) + "_" + std::to_string(::getpid()) + ".idx";
+}
+
+FingerprintIndex buildIndex(std::vector<CompactFingerprint>& fingerprints) {
+    FingerprintIndex index;
+    // Negative and sparse song IDs exercise the zigzag song deltas
+    const int songIds[] = {-5, 0, 3, 1000, 70000, 2000000};
+    for (int i = 0; i < 6; ++i) {
+        fingerprints.push_back(sortify::testing::compactFingerprintOf(makePeaks(300, 40 + i)));
+        index.addTrack(songIds[i], fingerprints.back());
+    }
+    index.build();
+    return index;
+}
+
+} // namespace
+
+// Every posting list and every query result survives the round trip
+TEST(IndexFileTest, RoundTripMatchesInMemoryIndex) {
+    std::vector<CompactFingerprint> fingerprints;
+    FingerprintIndex index = buildIndex(fingerprints);
+    const std::string path = tempIndexPath("roundtrip");
+
+    auto written = sortify::audio::writeIndexFile(index, path);
+    ASSERT_TRUE(written.isSuccess()) << written.getError();
+
+    MappedIndex mapped(path);
+    ASSERT_TRUE(mapped.isValid()) << mapped.getError();
+    EXPECT_EQ(mapped.trackCount(), index.trackCount());
+    EXPECT_EQ(mapped.hashCount(), index.hashCount());
+    EXPECT_EQ(mapped.postingCount(), index.postingCount());
+
+    std::vector<Posting> decoded;
+    for (uint32_t hash : index.hashKeys()) {
+        size_t count = 0;
+        const Posting* expected = index.findPostings(hash, count);
+        decoded.clear();
+        ASSERT_EQ(mapped.decodePostings(hash, decoded), count);
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_EQ(decoded[i].songId, expected[i].songId);
+            ASSERT_EQ(decoded[i].anchorFrame, expected[i].anchorFrame);
+        }
+    }
+    decoded.clear();
+    EXPECT_EQ(mapped.decodePostings(0xFFFFFFFFu, decoded), 0u);
+
+    for (const auto& fingerprint : fingerprints) {
+        auto expected = index.query(fingerprint, 3);
+        auto actual = mapped.query(fingerprint, 3);
+        ASSERT_TRUE(actual.isSuccess()) << actual.getError();
+        ASSERT_EQ(actual.getValue().size(), expected.getValue().size());
+        for (size_t i = 0; i < expected.getValue().size(); ++i) {
+            EXPECT_EQ(actual.getValue()[i].songId, expected.getValue()[i].songId);
+            EXPECT_EQ(actual.getValue()[i].score, expected.getValue()[i].score);
+            EXPECT_EQ(actual.getValue()[i].offsetFrames, expected.getValue()[i].offsetFrames);
+        }
+    }
+
+    // Queries of the mapped index show up in the metrics like in-memory ones
+    sortify::audio::Metrics::reset();
+    sortify::audio::Metrics::setEnabled(true);
+    ASSERT_TRUE(mapped.query(fingerprints[0], 3).isSuccess());
+    sortify::audio::Metrics::setEnabled(false);
+    const auto snapshot = sortify::audio::Metrics::snapshot();
+    EXPECT_EQ(snapshot.counter(sortify::audio::MetricCounter::QUERIES), 1u);
+    EXPECT_EQ(snapshot.stage(sortify::audio::MetricStage::INDEX_QUERY).count, 1u);
+    sortify::audio::Metrics::reset();
+
+    // A track staged after build() is neither written nor counted
+    ASSERT_TRUE(index.addTrack(42, fingerprints[0]).isSuccess());
+    ASSERT_TRUE(sortify::audio::writeIndexFile(index, path).isSuccess());
+    MappedIndex staged(path);
+    ASSERT_TRUE(staged.isValid()) << staged.getError();
+    EXPECT_EQ(index.trackCount(), 7u);
+    EXPECT_EQ(staged.trackCount(), 6u);
+    EXPECT_EQ(staged.postingCount(), mapped.postingCount());
+
+    std::remove(path.c_str());
+}
+
+// Truncated or foreign files are rejected instead of being read out of bounds
+TEST(IndexFileTest, RejectsDamagedFiles) {
+    std::vector<CompactFingerprint> fingerprints;
+    FingerprintIndex index = buildIndex(fingerprints);
+    const std::string path = tempIndexPath("damaged");
+    ASSERT_TRUE(sortify::audio::writeIndexFile(index, path).isSuccess());
+
+    ASSERT_EQ(::truncate(path.c_str(), 4096), 0);
+    MappedIndex truncated(path);
+    EXPECT_FALSE(truncated.isValid());
+    EXPECT_FALSE(truncated.query(fingerprints[0]).isSuccess());
+
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << std::string(256, 'x');
+    }
+    MappedIndex foreign(path);
+    EXPECT_FALSE(foreign.isValid());
+
+    // A posting size that wraps around 64 bits when added to its offset
+    ASSERT_TRUE(sortify::audio::writeIndexFile(index, path).isSuccess());
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        sortify::audio::IndexFileHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        header.postingsSize = ~uint64_t(0) - header.postingsOffset + 2;
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    MappedIndex crafted(path);
+    EXPECT_FALSE(crafted.isValid());
+
+    // A file from a machine of the other byte order
+    ASSERT_TRUE(sortify::audio::writeIndexFile(index, path).isSuccess());
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        sortify::audio::IndexFileHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        header.byteOrderMark = 0x04030201;
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    MappedIndex swapped(path);
+    EXPECT_FALSE(swapped.isValid());
+    EXPECT_NE(swapped.getError().find("byte order"), std::string::npos) << swapped.getError();
+
+    MappedIndex missing(path + ".missing");
+    EXPECT_FALSE(missing.isValid());
+
+    std::remove(path.c_str());
+}
+
+// The filter written into the file rejects absent hashes without changing results,
+// and files without a filter (disabled, or written by version 1) stay readable
+TEST(IndexFileTest, BloomFilterIsOptionalAndLossless) {
+    std::vector<CompactFingerprint> fingerprints;
+    FingerprintIndex index = buildIndex(fingerprints);
+    ASSERT_FALSE(index.bloomFilter().empty());
+
+    const std::string path = tempIndexPath("bloom");
+    ASSERT_TRUE(sortify::audio::writeIndexFile(index, path).isSuccess());
+    MappedIndex mapped(path);
+    ASSERT_TRUE(mapped.isValid()) << mapped.getError();
+    EXPECT_TRUE(mapped.hasBloomFilter());
+
+    // Every indexed hash passes; hashes of unrelated audio are almost all rejected
+    std::vector<Posting> decoded;
+    for (uint32_t hash : index.hashKeys()) {
+        ASSERT_TRUE(index.bloomFilter().mayContain(hash));
+    }
+    const CompactFingerprint unrelated = sortify::testing::compactFingerprintOf(makePeaks(300, 999));
+    size_t passed = 0;
+    size_t absent = 0;
+    for (const auto& record : unrelated) {
+        size_t count = 0;
+        if (index.findPostings(record.hash, count) == nullptr) {
+            absent++;
+            passed += index.bloomFilter().mayContain(record.hash) ? 1 : 0;
+            decoded.clear();
+            EXPECT_EQ(mapped.decodePostings(record.hash, decoded), 0u);
+        }
+    }
+    ASSERT_GT(absent, 100u);
+    EXPECT_LT(passed, absent / 20);
+
+    FingerprintIndex unfiltered;
+    unfiltered.setBloomBitsPerKey(0);
+    const int songIds[] = {-5, 0, 3, 1000, 70000, 2000000};
+    for (size_t i = 0; i < fingerprints.size(); ++i) {
+        unfiltered.addTrack(songIds[i], fingerprints[i]);
+    }
+    unfiltered.build();
+    EXPECT_TRUE(unfiltered.bloomFilter().empty());
+
+    const std::string plainPath = tempIndexPath("plain");
+    ASSERT_TRUE(sortify::audio::writeIndexFile(unfiltered, plainPath).isSuccess());
+    {
+        // Rewrite the version field as a version 1 writer would have produced it
+        std::fstream file(plainPath, std::ios::binary | std::ios::in | std::ios::out);
+        const uint32_t version = 1;
+        file.seekp(8);
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+    MappedIndex plain(plainPath);
+    ASSERT_TRUE(plain.isValid()) << plain.getError();
+    EXPECT_FALSE(plain.hasBloomFilter());
+
+    for (const auto& fingerprint : fingerprints) {
+        auto expected = mapped.query(fingerprint, 3);
+        auto actual = plain.query(fingerprint, 3);
+        ASSERT_TRUE(actual.isSuccess()) << actual.getError();
+        ASSERT_EQ(actual.getValue().size(), expected.getValue().size());
+        for (size_t i = 0; i < expected.getValue().size(); ++i) {
+            EXPECT_EQ(actual.getValue()[i].songId, expected.getValue()[i].songId);
+            EXPECT_EQ(actual.getValue()[i].score, expected.getValue()[i].score);
+        }
+    }
+
+    std::remove(path.c_str());
+    std::remove(plainPath.c_str());
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "logger.hpp"
+
+using sortify::audio::Logger;
+using sortify::audio::LogLevel;
+using sortify::audio::AsyncLogSink;
+
+namespace {
+
+std::vector<std::string> captured;
+
+void captureLog(LogLevel level, const std::string& message) {
+    captured.push_back(std::string(sortify::audio::logLevelName(level)) + " " + message);
+}
+
+int countedValue(int& evaluations) {
+    evaluations++;
+    return 42;
+}
+
+} // namespace
+
+// Macro arguments are neither evaluated nor formatted below the current level
+TEST(LoggerTest, MacrosFormatLazily) {
+    captured.clear();
+    Logger::setLogFunction(captureLog);
+    Logger::setLogLevel(LogLevel::WARNING);
+
+    int evaluations = 0;
+    SORTIFY_LOG_INFO("value ", countedValue(evaluations));
+    EXPECT_EQ(evaluations, 0);
+    EXPECT_TRUE(captured.empty());
+
+    SORTIFY_LOG_WARNING("value ", countedValue(evaluations), " of ", 2.5f, " ", std::string("units"));
+    EXPECT_EQ(evaluations, 1);
+    ASSERT_EQ(captured.size(), 1u);
+    EXPECT_EQ(captured[0], "WARNING value 42 of 2.5 units");
+
+    Logger::setLogFunction(nullptr);
+    Logger::setLogLevel(LogLevel::ERROR);
+}
+
+// Messages from several threads all reach the output, in order per thread
+TEST(LoggerTest, AsyncSinkWritesEveryMessage) {
+    Logger::setLogLevel(LogLevel::INFO);
+    testing::internal::CaptureStdout();
+    {
+        AsyncLogSink sink(1024);
+        sink.install();
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([t] {
+                for (int i = 0; i < 50; ++i) {
+                    SORTIFY_LOG_INFO("thread ", t, " message ", i);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        sink.flush();
+        EXPECT_EQ(sink.droppedCount(), 0u);
+    }
+    const std::string output = testing::internal::GetCapturedStdout();
+    Logger::setLogLevel(LogLevel::ERROR);
+
+    size_t lines = 0;
+    for (char c : output) {
+        lines += c == '\n';
+    }
+    EXPECT_EQ(lines, 200u);
+    EXPECT_LT(output.find("[INFO] thread 2 message 3\n"), output.find("[INFO] thread 2 message 4\n"));
+    EXPECT_NE(output.find("[INFO] thread 3 message 49\n"), std::string::npos);
+}
+
+// A sink can be destroyed while other threads keep logging
+TEST(LoggerTest, AsyncSinkUninstallsWhileThreadsLog) {
+    Logger::setLogLevel(LogLevel::INFO);
+    testing::internal::CaptureStdout();
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t) {
+        threads.emplace_back([&done, t] {
+            while (!done) {
+                SORTIFY_LOG_INFO("thread ", t);
+            }
+        });
+    }
+    for (int round = 0; round < 20; ++round) {
+        AsyncLogSink sink(64);
+        sink.install();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    done = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const std::string output = testing::internal::GetCapturedStdout();
+    Logger::setLogLevel(LogLevel::ERROR);
+    EXPECT_NE(output.find("[INFO] thread "), std::string::npos);
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include "metrics.hpp"
+#include "audio_fingerprint.hpp"
+#include "compact_fingerprint.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::Metrics;
+using sortify::audio::MetricCounter;
+using sortify::audio::MetricStage;
+
+// Stages report what they processed while enabled and nothing while disabled
+TEST(MetricsTest, CountsPipelineStages) {
+    const auto samples = sortify::testing::generateMelody(3.0f, 44100, 2);
+    Metrics::reset();
+
+    Metrics::setEnabled(false);
+    ASSERT_TRUE(sortify::audio::generateSpectrogram(samples).isSuccess());
+    EXPECT_EQ(Metrics::snapshot().counter(MetricCounter::WINDOWS_PROCESSED), 0u);
+    EXPECT_EQ(Metrics::snapshot().stage(MetricStage::SPECTROGRAM).count, 0u);
+
+    Metrics::setEnabled(true);
+    auto spectrogram = sortify::audio::generateSpectrogram(samples);
+    ASSERT_TRUE(spectrogram.isSuccess());
+    auto peaks = sortify::audio::extractPeaks(spectrogram.getValue());
+    ASSERT_TRUE(peaks.isSuccess());
+    auto fingerprint = sortify::audio::createCompactFingerprint(peaks.getValue());
+    ASSERT_TRUE(fingerprint.isSuccess());
+    Metrics::setEnabled(false);
+
+    const auto snapshot = Metrics::snapshot();
+    EXPECT_EQ(snapshot.counter(MetricCounter::SAMPLES_ANALYZED), samples.size());
+    EXPECT_EQ(snapshot.counter(MetricCounter::WINDOWS_PROCESSED), spectrogram.getValue().numFrames());
+    EXPECT_EQ(snapshot.counter(MetricCounter::PEAKS_EXTRACTED), peaks.getValue().size());
+    EXPECT_EQ(snapshot.counter(MetricCounter::HASHES_EMITTED), fingerprint.getValue().size());
+    EXPECT_GT(snapshot.counter(MetricCounter::BYTES_ALLOCATED), 0u);
+    EXPECT_NEAR(snapshot.peaksPerAudioSecond(), peaks.getValue().size() / 3.0, 1.0);
+
+    for (MetricStage stage : {MetricStage::SPECTROGRAM, MetricStage::PEAK_EXTRACTION, MetricStage::FINGERPRINT}) {
+        const auto& timing = snapshot.stage(stage);
+        EXPECT_EQ(timing.count, 1u) << sortify::audio::metricStageName(stage);
+        uint64_t bucketTotal = 0;
+        for (uint64_t bucket : timing.buckets) {
+            bucketTotal += bucket;
+        }
+        EXPECT_EQ(bucketTotal, 1u);
+    }
+    Metrics::reset();
+}
+
+// Both exports name every counter and stage
+TEST(MetricsTest, ExportsPrometheusAndJson) {
+    Metrics::reset();
+    Metrics::setEnabled(true);
+    Metrics::add(MetricCounter::SAMPLES_DECODED, 1234);
+    Metrics::recordDuration(MetricStage::DECODE, std::chrono::microseconds(3));
+    Metrics::setEnabled(false);
+
+    const auto snapshot = Metrics::snapshot();
+    const std::string text = snapshot.toPrometheus();
+    EXPECT_NE(text.find("sortify_samples_decoded_total 1234\n"), std::string::npos);
+    EXPECT_NE(text.find("sortify_stage_duration_seconds_bucket{stage=\"decode\",le=\"2e-06\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("sortify_stage_duration_seconds_bucket{stage=\"decode\",le=\"4e-06\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("sortify_stage_duration_seconds_bucket{stage=\"decode\",le=\"+Inf\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("sortify_stage_duration_seconds_count{stage=\"index_query\"} 0\n"), std::string::npos);
+
+    const std::string json = snapshot.toJson();
+    EXPECT_EQ(json.front(), '{');
+    EXPECT_EQ(json.back(), '}');
+    EXPECT_NE(json.find("\"samples_decoded\":1234"), std::string::npos);
+    EXPECT_NE(json.find("\"decode\":{\"count\":1"), std::string::npos);
+    Metrics::reset();
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <random>
+#include "audio_fingerprint.hpp"
+#include "fingerprint_stages.hpp"
+
+using sortify::audio::SimdLevel;
+
+// Every SIMD kernel must pick the same bin as the scalar loop, including ties
+TEST(PeakExtractionTest, SimdKernelsMatchScalar) {
+    std::mt19937 rng(11);
+    // Few distinct values so that ties between lanes are common
+    std::uniform_int_distribution<int> value(0, 6);
+    std::uniform_int_distribution<unsigned int> bound(0, 240);
+
+    std::vector<float> bins(240);
+    for (int trial = 0; trial < 2000; ++trial) {
+        for (auto& bin : bins) {
+            bin = static_cast<float>(value(rng)) * 0.5f;
+        }
+        unsigned int first = bound(rng);
+        unsigned int last = bound(rng);
+        if (first > last) std::swap(first, last);
+
+        auto expected = sortify::audio::findBandMaximum(bins.data(), first, last, SimdLevel::SCALAR);
+        for (SimdLevel level : {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON}) {
+            if (!sortify::audio::isSimdLevelSupported(level)) continue;
+            auto actual = sortify::audio::findBandMaximum(bins.data(), first, last, level);
+            ASSERT_EQ(actual.magnitude, expected.magnitude) << sortify::audio::simdLevelName(level);
+            if (expected.magnitude > 0.0f) {
+                ASSERT_EQ(actual.bin, expected.bin) << sortify::audio::simdLevelName(level)
+                                                    << " [" << first << ", " << last << ")";
+            }
+        }
+    }
+}
+
+// A band with no positive magnitude yields no peak
+TEST(PeakExtractionTest, SilentBandHasNoMaximum) {
+    std::vector<float> bins(64, 0.0f);
+    auto maximum = sortify::audio::findBandMaximum(bins.data(), 0, 64);
+    EXPECT_EQ(maximum.magnitude, 0.0f);
+}
+
+// Only band maxima above the average of all band maxima survive
+TEST(PeakExtractionTest, DynamicThresholdKeepsStrongBands) {
+    const unsigned int numBins = 100;
+    auto bands = sortify::audio::computeFrequencyBands(numBins);
+    ASSERT_TRUE(bands.isSuccess()) << bands.getError();
+
+    std::vector<float> magnitudes(numBins, 0.1f);
+    magnitudes[5] = 10.0f;   // band 0
+    magnitudes[30] = 8.0f;   // band 2
+    magnitudes[90] = 1.0f;   // band 5
+
+    std::vector<sortify::audio::Peak> peaks;
+    sortify::audio::pickFramePeaks(sortify::audio::SpectrogramFrame(magnitudes.data(), numBins),
+                                   bands.getValue(), 4.0f, peaks);
+
+    ASSERT_EQ(peaks.size(), 2u);
+    EXPECT_EQ(peaks[0].frequency, 5.0f);
+    EXPECT_EQ(peaks[1].frequency, 30.0f);
+    EXPECT_EQ(peaks[0].time, 4.0f);
+}
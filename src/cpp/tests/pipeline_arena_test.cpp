@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "pipeline_arena.hpp"
+#include "batch_fingerprinter.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::PipelineArena;
+using sortify::audio::FingerprintConfig;
+
+// Fingerprints built from arena memory equal the heap-allocated ones
+TEST(PipelineArenaTest, MatchesHeapPipeline) {
+    const auto samples = sortify::testing::generateMelody(4.0f, 44100, 3);
+    const FingerprintConfig config;
+
+    auto heap = sortify::audio::fingerprintSamples(samples, config);
+    ASSERT_TRUE(heap.isSuccess());
+
+    PipelineArena arena(1 << 16);
+    for (int round = 0; round < 2; ++round) {
+        auto pooled = sortify::audio::fingerprintSamples(samples, config, &arena);
+        ASSERT_TRUE(pooled.isSuccess());
+        EXPECT_EQ(pooled.getValue().records(), heap.getValue().records());
+        EXPECT_GT(arena.bytesInUse(), 0u);
+        arena.reset();
+    }
+}
+
+// A reset grows an overflowed block once and then reuses it
+TEST(PipelineArenaTest, ResetReusesBlock) {
+    PipelineArena arena(1024);
+    for (int round = 0; round < 3; ++round) {
+        std::pmr::vector<float> values(16384, 1.0f, arena.resource());
+        EXPECT_EQ(arena.bytesInUse(), 16384 * sizeof(float));
+        values = {};
+        arena.reset();
+        EXPECT_EQ(arena.bytesInUse(), 0u);
+    }
+    EXPECT_EQ(arena.growthCount(), 1u);
+    EXPECT_GE(arena.capacity(), 16384 * sizeof(float));
+    EXPECT_EQ(arena.highWaterBytes(), 16384 * sizeof(float));
+}
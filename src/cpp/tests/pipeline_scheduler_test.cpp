@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <cstdio>
+#include <unistd.h>
+#include "pipeline_scheduler.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::FileStatus;
+using sortify::audio::PipelineOptions;
+using sortify::audio::PipelineScheduler;
+using sortify::audio::PipelineStage;
+
+namespace {
+
+// Decoder that synthesises a track per "path" instead of reading files
+std::vector<float> decodeSynthetic(const std::string& path) {
+    if (path == "missing") return {};
+    if (path == "short") return std::vector<float>(100, 0.1f);
+    return sortify::testing::generateMelody(6.0f, 44100, static_cast<unsigned int>(std::stoul(path)));
+}
+
+PipelineOptions syntheticOptions() {
+    PipelineOptions options;
+    options.readThreads = 3;
+    options.decodeThreads = 2;
+    options.spectrogramThreads = 2;
+    options.peakThreads = 1;
+    options.fingerprintThreads = 2;
+    options.queueCapacity = 1;
+    options.reader = [](const std::string&) { return sortify::audio::Result<uint64_t>::createSuccess(10); };
+    options.decoder = decodeSynthetic;
+    return options;
+}
+
+} // namespace
+
+// Every file gets a report in input order, failures skip the later stages,
+// and fingerprints equal those of the single-call pipeline
+TEST(PipelineSchedulerTest, MatchesFingerprintSamplesAndReportsFailures) {
+    PipelineScheduler pipeline(syntheticOptions());
+    const std::vector<std::string> paths = {"1", "2", "missing", "3", "short", "4", "5"};
+
+    std::vector<sortify::audio::CompactFingerprint> received(paths.size());
+    auto results = pipeline.run(paths, 100, [&](const sortify::audio::FileResult& file,
+                                                sortify::audio::CompactFingerprint&& fingerprint) {
+        received[file.songId - 100] = std::move(fingerprint);
+    });
+
+    ASSERT_EQ(results.size(), paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        EXPECT_EQ(results[i].path, paths[i]);
+        EXPECT_EQ(results[i].songId, 100 + static_cast<int>(i));
+        if (paths[i] == "missing" || paths[i] == "short") {
+            continue;
+        }
+        ASSERT_EQ(results[i].status, FileStatus::OK) << results[i].error;
+        auto direct = sortify::audio::fingerprintSamples(decodeSynthetic(paths[i]), sortify::audio::FingerprintConfig());
+        ASSERT_TRUE(direct.isSuccess());
+        EXPECT_EQ(received[i].records(), direct.getValue().records()) << paths[i];
+    }
+    EXPECT_EQ(results[2].status, FileStatus::DECODE_FAILED);
+    EXPECT_EQ(results[4].status, FileStatus::FINGERPRINT_FAILED);
+    EXPECT_FALSE(results[4].error.empty());
+
+    // Failed files leave the pipeline early, but all reach the index stage
+    auto stats = pipeline.stats();
+    EXPECT_EQ(stats.stage(PipelineStage::READ).itemsProcessed, paths.size());
+    EXPECT_EQ(stats.stage(PipelineStage::DECODE).itemsProcessed, paths.size());
+    EXPECT_EQ(stats.stage(PipelineStage::SPECTROGRAM).itemsProcessed, paths.size() - 1);
+    EXPECT_EQ(stats.stage(PipelineStage::FINGERPRINT).itemsProcessed, paths.size() - 2);
+    EXPECT_EQ(stats.stage(PipelineStage::INDEX).itemsProcessed, paths.size());
+    EXPECT_EQ(stats.bytesRead, 10u * paths.size());
+    for (size_t stage = 1; stage < sortify::audio::pipelineStageCount; ++stage) {
+        EXPECT_LE(stats.stages[stage].maxQueueDepth, 1u) << sortify::audio::pipelineStageName(PipelineStage(stage));
+        EXPECT_EQ(stats.stages[stage].queueDepth, 0u);
+    }
+}
+
+// A slow index stage backs the queues up instead of letting work pile up,
+// and the live stats show where the pipeline is waiting
+TEST(PipelineSchedulerTest, SlowSinkBacksUpBoundedQueues) {
+    PipelineScheduler pipeline(syntheticOptions());
+    std::vector<std::string> paths;
+    for (int i = 1; i <= 12; ++i) {
+        paths.push_back(std::to_string(i));
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> maxIndexDepth{0};
+    std::thread monitor([&] {
+        while (!done) {
+            auto stats = pipeline.stats();
+            for (const auto& stage : stats.stages) {
+                EXPECT_LE(stage.queueDepth, stage.queueCapacity);
+            }
+            maxIndexDepth = std::max<size_t>(maxIndexDepth, stats.stage(PipelineStage::INDEX).queueDepth);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    sortify::audio::FingerprintIndex index;
+    auto results = pipeline.run(paths, 0, [&](const sortify::audio::FileResult& file,
+                                              sortify::audio::CompactFingerprint&& fingerprint) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        ASSERT_TRUE(index.addTrack(file.songId, fingerprint).isSuccess());
+    });
+    done = true;
+    monitor.join();
+
+    for (const auto& result : results) {
+        EXPECT_EQ(result.status, FileStatus::OK) << result.error;
+    }
+    EXPECT_EQ(index.trackCount(), paths.size());
+    EXPECT_EQ(maxIndexDepth, 1u);
+
+    auto stats = pipeline.stats();
+    EXPECT_EQ(stats.stage(PipelineStage::INDEX).maxQueueDepth, 1u);
+    EXPECT_GE(stats.stage(PipelineStage::INDEX).busyMicroseconds, 12u * 30000u);
+    EXPECT_GT(stats.elapsedSeconds, 0.3);
+}
+
+// A throwing stage fails its file; a throwing sink stops the run and is rethrown
+TEST(PipelineSchedulerTest, HandlesExceptions) {
+    PipelineOptions options = syntheticOptions();
+    options.decoder = [](const std::string& path) -> std::vector<float> {
+        if (path == "throw") throw std::runtime_error("corrupt stream");
+        return decodeSynthetic(path);
+    };
+    PipelineScheduler pipeline(options);
+
+    auto results = pipeline.run({"1", "throw", "2"}, 0, nullptr);
+    EXPECT_EQ(results[0].status, FileStatus::OK) << results[0].error;
+    EXPECT_EQ(results[1].status, FileStatus::DECODE_FAILED);
+    EXPECT_NE(results[1].error.find("corrupt stream"), std::string::npos) << results[1].error;
+    EXPECT_EQ(results[2].status, FileStatus::OK) << results[2].error;
+
+    std::vector<std::string> paths;
+    for (int i = 1; i <= 12; ++i) {
+        paths.push_back(std::to_string(i));
+    }
+    size_t calls = 0;
+    EXPECT_THROW(pipeline.run(paths, 0, [&](const sortify::audio::FileResult&, sortify::audio::CompactFingerprint&&) {
+        if (++calls == 2) throw std::runtime_error("index full");
+    }), std::runtime_error);
+    EXPECT_EQ(calls, 2u);
+
+    // The scheduler is usable again after the failed run
+    results = pipeline.run({"3"}, 0, nullptr);
+    EXPECT_EQ(results[0].status, FileStatus::OK) << results[0].error;
+}
+
+// WAV files at another rate go through the default read and decode stages
+TEST(PipelineSchedulerTest, ReadsAndResamplesWavFiles) {
+    std::vector<std::string> paths;
+    for (unsigned int seed = 1; seed <= 3; ++seed) {
+        paths.push_back("/tmp/sortify_pipeline_" + std::to_string(::getpid()) + "_" + std::to_string(seed) + ".wav");
+        ASSERT_TRUE(sortify::testing::writeWav16(paths.back(), sortify::testing::generateMelody(6.0f, 48000, seed),
+                                                 48000));
+    }
+    paths.push_back("/tmp/sortify_pipeline_does_not_exist.mp3");
+    // Only .wav paths are mapped as WAV, so this one goes to the missing FFmpeg
+    paths.push_back("/tmp/sortify_pipeline_" + std::to_string(::getpid()) + "_riff.mp3");
+    ASSERT_TRUE(sortify::testing::writeWav16(paths.back(), sortify::testing::generateMelody(6.0f, 44100, 4), 44100));
+
+    PipelineOptions options;
+    options.decodeOptions.ffmpegPath = "/nonexistent/ffmpeg";
+    options.analyzeQuality = true;
+    PipelineScheduler pipeline(options);
+    sortify::audio::FingerprintIndex index;
+    auto results = pipeline.buildIndex(paths, index, 1);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        std::remove(paths[i].c_str());
+    }
+
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(results[i].status, FileStatus::OK) << results[i].error;
+        EXPECT_EQ(results[i].numSamples, 6u * 44100u);
+        EXPECT_TRUE(results[i].hasQuality);
+    }
+    EXPECT_EQ(results[3].status, FileStatus::DECODE_FAILED);
+    EXPECT_EQ(results[4].status, FileStatus::DECODE_FAILED);
+    EXPECT_EQ(index.trackCount(), 3u);
+    EXPECT_EQ(index.configId(), sortify::audio::hashFingerprintConfig(options.config));
+
+    // Three 6 s 16-bit mono files plus their headers
+    EXPECT_GE(pipeline.stats().bytesRead, 3u * 6u * 48000u * 2u);
+}
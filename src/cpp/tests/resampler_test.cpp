@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <random>
+#include <cstdio>
+#include <unistd.h>
+#include "resampler.hpp"
+#include "wav_reader.hpp"
+#include "compact_fingerprint.hpp"
+#include "fingerprint_compare.hpp"
+#include "batch_fingerprinter.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::AudioSample;
+using sortify::audio::Resampler;
+using sortify::audio::SimdLevel;
+
+namespace {
+
+std::vector<AudioSample> makeNoise(size_t count, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    std::vector<AudioSample> samples(count);
+    for (auto& sample : samples) {
+        sample = value(rng);
+    }
+    return samples;
+}
+
+std::vector<AudioSample> makeSine(double frequency, unsigned int sampleRate, size_t count) {
+    std::vector<AudioSample> samples(count);
+    for (size_t i = 0; i < count; ++i) {
+        samples[i] = static_cast<float>(std::sin(2.0 * M_PI * frequency * i / sampleRate));
+    }
+    return samples;
+}
+
+} // namespace
+
+// Any block split and any SIMD level give the same output as one scalar call
+TEST(ResamplerTest, BlockSizeAndSimdLevelDoNotChangeOutput) {
+    const auto input = makeNoise(30011, 5);
+    const std::pair<unsigned int, unsigned int> conversions[] = {
+        {44100, 11025}, {48000, 11025}, {192000, 11025}, {44100, 48000}, {22050, 44100}};
+
+    for (const auto& [inputRate, outputRate] : conversions) {
+        sortify::audio::ResamplerOptions scalarOptions;
+        scalarOptions.simdLevel = SimdLevel::SCALAR;
+        auto expected = sortify::audio::resampleAudio(input, inputRate, outputRate, scalarOptions);
+        ASSERT_TRUE(expected.isSuccess()) << expected.getError();
+
+        Resampler reference(inputRate, outputRate);
+        ASSERT_EQ(expected.getValue().size(), reference.outputLength(input.size()));
+
+        for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON}) {
+            if (!sortify::audio::isSimdLevelSupported(level)) continue;
+            for (size_t blockSize : {size_t(1), size_t(37), size_t(4096)}) {
+                sortify::audio::ResamplerOptions options;
+                options.simdLevel = level;
+                Resampler resampler(inputRate, outputRate, options);
+                std::vector<AudioSample> output;
+                for (size_t offset = 0; offset < input.size(); offset += blockSize) {
+                    resampler.process(input.data() + offset, std::min(blockSize, input.size() - offset), output);
+                }
+                resampler.finish(output);
+                ASSERT_EQ(output, expected.getValue())
+                    << inputRate << " -> " << outputRate << ", " << sortify::audio::simdLevelName(level)
+                    << ", blocks of " << blockSize;
+            }
+        }
+    }
+}
+
+// Tones below the lower Nyquist frequency survive in place; tones above it are removed
+TEST(ResamplerTest, KeepsPassbandAndRejectsAliases) {
+    const size_t inputLength = 48000;
+    auto passband = sortify::audio::resampleAudio(makeSine(1000.0, 48000, inputLength), 48000, 11025);
+    ASSERT_TRUE(passband.isSuccess()) << passband.getError();
+    const auto expected = makeSine(1000.0, 11025, passband.getValue().size());
+
+    // Skip the edges, where the filter sees the zero padding
+    double maxError = 0.0;
+    for (size_t i = 300; i + 300 < expected.size(); ++i) {
+        maxError = std::max(maxError, static_cast<double>(std::fabs(passband.getValue()[i] - expected[i])));
+    }
+    EXPECT_LT(maxError, 1e-3);
+
+    // 8 kHz would fold onto 3025 Hz without the anti-aliasing filter
+    auto alias = sortify::audio::resampleAudio(makeSine(8000.0, 48000, inputLength), 48000, 11025);
+    ASSERT_TRUE(alias.isSuccess()) << alias.getError();
+    double energy = 0.0;
+    for (size_t i = 300; i + 300 < alias.getValue().size(); ++i) {
+        energy += alias.getValue()[i] * alias.getValue()[i];
+    }
+    EXPECT_LT(std::sqrt(energy / (alias.getValue().size() - 600)), 1e-3);
+}
+
+// Equal rates pass through; unusable rate pairs are rejected
+TEST(ResamplerTest, PassThroughAndInvalidRates) {
+    const auto input = makeNoise(1000, 9);
+    auto same = sortify::audio::resampleAudio(input, 44100, 44100);
+    ASSERT_TRUE(same.isSuccess()) << same.getError();
+    EXPECT_EQ(same.getValue(), input);
+
+    EXPECT_FALSE(Resampler(0, 44100).isValid());
+    EXPECT_FALSE(Resampler(44100, 0).isValid());
+    // 44100 -> 44101 needs 44101 phases
+    EXPECT_FALSE(Resampler(44100, 44101).isValid());
+}
+
+// A 48 kHz file read at 11025 Hz and fingerprinted with the decimated policy
+// matches the default fingerprint of the same audio at 44.1 kHz
+TEST(ResamplerTest, DecimatedAnalysisMatchesDefault) {
+    const std::string path = "/tmp/sortify_resample_" + std::to_string(::getpid()) + ".wav";
+    ASSERT_TRUE(sortify::testing::writeWav16(path, sortify::testing::generateMelody(20.0f, 48000, 8), 48000));
+
+    std::vector<AudioSample> native;
+    std::vector<AudioSample> decimated;
+    {
+        sortify::audio::WavFile file(path);
+        ASSERT_TRUE(file.isValid()) << file.getError();
+        ASSERT_TRUE(file.readAllResampled(native, 44100).isSuccess());
+        auto read = file.readAllResampled(decimated, 11025);
+        ASSERT_TRUE(read.isSuccess()) << read.getError();
+        EXPECT_EQ(read.getValue(), Resampler(48000, 11025).outputLength(file.format().numFrames));
+    }
+    std::remove(path.c_str());
+
+    const auto decimatedConfig =
+        sortify::audio::makeFingerprintConfig<sortify::audio::DecimatedFingerprintPolicy>();
+    auto reference = sortify::audio::fingerprintSamples(native, sortify::audio::FingerprintConfig());
+    auto fingerprint = sortify::audio::fingerprintSamples(decimated, decimatedConfig);
+    ASSERT_TRUE(reference.isSuccess()) << reference.getError();
+    ASSERT_TRUE(fingerprint.isSuccess()) << fingerprint.getError();
+
+    // The repetitive melody caps even the self-match score, so compare against that
+    auto self = sortify::audio::compareFingerprints(reference.getValue(), reference.getValue());
+    auto comparison = sortify::audio::compareFingerprints(reference.getValue(), fingerprint.getValue());
+    EXPECT_EQ(comparison.offsetFrames, 0);
+    EXPECT_GE(comparison.score * 10, self.score * 9);
+}
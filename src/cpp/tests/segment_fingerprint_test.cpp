@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+#include "segment_fingerprint.hpp"
+#include "batch_fingerprinter.hpp"
+#include "fingerprint_index.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::CompactFingerprint;
+using sortify::audio::FingerprintConfig;
+using sortify::audio::TimeRange;
+
+// Segments are centred on their positions and clamped to the track
+TEST(SegmentFingerprintTest, PlansSegments) {
+    auto ranges = sortify::audio::planSegments(100.0, 15.0);
+    ASSERT_EQ(ranges.size(), 3u);
+    EXPECT_DOUBLE_EQ(ranges[0].startSeconds, 12.5);
+    EXPECT_DOUBLE_EQ(ranges[1].startSeconds, 42.5);
+    EXPECT_DOUBLE_EQ(ranges[2].startSeconds, 72.5);
+    EXPECT_DOUBLE_EQ(ranges[2].durationSeconds, 15.0);
+
+    auto edge = sortify::audio::planSegments(60.0, 15.0, {0.0, 1.0});
+    ASSERT_EQ(edge.size(), 2u);
+    EXPECT_DOUBLE_EQ(edge[0].startSeconds, 0.0);
+    EXPECT_DOUBLE_EQ(edge[1].startSeconds, 45.0);
+
+    auto whole = sortify::audio::planSegments(30.0, 15.0);
+    ASSERT_EQ(whole.size(), 1u);
+    EXPECT_DOUBLE_EQ(whole[0].durationSeconds, 30.0);
+}
+
+// Segment hashes are a subset of the full fingerprint, at the same absolute frames
+TEST(SegmentFingerprintTest, SegmentsUseAbsoluteFrames) {
+    FingerprintConfig config;
+    auto samples = sortify::testing::generateMelody(40.0f, config.sampleRate, 4);
+
+    auto full = sortify::audio::fingerprintSamples(samples, config);
+    ASSERT_TRUE(full.isSuccess()) << full.getError();
+    auto segments = sortify::audio::fingerprintSampleRanges(samples, sortify::audio::planSegments(40.0, 5.0), config);
+    ASSERT_TRUE(segments.isSuccess()) << segments.getError();
+
+    const auto& fullRecords = full.getValue().records();
+    const auto& segmentRecords = segments.getValue().records();
+    EXPECT_LT(segmentRecords.size(), fullRecords.size() / 2);
+    EXPECT_TRUE(std::includes(fullRecords.begin(), fullRecords.end(), segmentRecords.begin(), segmentRecords.end()));
+
+    sortify::audio::FingerprintIndex index;
+    ASSERT_TRUE(index.addTrack(1, full.getValue()).isSuccess());
+    index.build();
+    auto match = index.query(segments.getValue(), 1);
+    ASSERT_TRUE(match.isSuccess()) << match.getError();
+    ASSERT_EQ(match.getValue().size(), 1u);
+    EXPECT_EQ(match.getValue()[0].offsetFrames, 0);
+    EXPECT_EQ(match.getValue()[0].score, segmentRecords.size());
+}
+
+// WAV ranges are read from the mapping and give the same result as in-memory samples
+TEST(SegmentFingerprintTest, WavRangesMatchSampleRanges) {
+    FingerprintConfig config;
+    const std::string path = "/tmp/sortify_segments_" + std::to_string(::getpid()) + ".wav";
+    ASSERT_TRUE(sortify::testing::writeWav16(path, sortify::testing::generateMelody(20.0f, config.sampleRate, 6),
+                                             config.sampleRate));
+
+    sortify::audio::WavFile file(path);
+    ASSERT_TRUE(file.isValid()) << file.getError();
+    std::vector<float> samples;
+    file.readAll(samples);
+
+    const std::vector<TimeRange> ranges = {{1.3, 4.0}, {11.0, 3.0}, {18.5, 10.0}};
+    auto expected = sortify::audio::fingerprintSampleRanges(samples, ranges, config);
+    auto actual = sortify::audio::fingerprintFileRanges(path, ranges, config);
+    ASSERT_TRUE(expected.isSuccess()) << expected.getError();
+    ASSERT_TRUE(actual.isSuccess()) << actual.getError();
+    EXPECT_EQ(actual.getValue().records(), expected.getValue().records());
+
+    auto segments = sortify::audio::fingerprintFileSegments(path, config, 4.0);
+    ASSERT_TRUE(segments.isSuccess()) << segments.getError();
+    auto planned = sortify::audio::fingerprintSampleRanges(samples, sortify::audio::planSegments(20.0, 4.0), config);
+    EXPECT_EQ(segments.getValue().records(), planned.getValue().records());
+
+    std::remove(path.c_str());
+}
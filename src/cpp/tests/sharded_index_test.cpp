@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include "compact_fingerprint.hpp"
+#include "fingerprint_index.hpp"
+#include "sharded_index.hpp"
+#include "synthetic_signals.hpp"
+
+using sortify::audio::CompactFingerprint;
+using sortify::audio::FingerprintIndex;
+using sortify::audio::MatchCandidate;
+using sortify::audio::ShardedIndex;
+using sortify::audio::ShardedIndexOptions;
+using sortify::testing::makePeaks;
+using sortify::testing::excerptPeaks;
+
+namespace {
+
+void expectSameCandidates(const std::vector<MatchCandidate>& actual, const std::vector<MatchCandidate>& expected) {
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(actual[i].songId, expected[i].songId);
+        EXPECT_EQ(actual[i].score, expected[i].score);
+        EXPECT_EQ(actual[i].offsetFrames, expected[i].offsetFrames);
+        EXPECT_EQ(actual[i].matches, expected[i].matches);
+    }
+}
+
+} // namespace
+
+// Many small segments, merged in memory or into mapped files, score like one index
+TEST(ShardedIndexTest, MatchesSingleIndexAcrossSegmentsAndCompaction) {
+    std::vector<std::vector<sortify::audio::Peak>> tracks;
+    FingerprintIndex reference;
+    for (int song = 0; song < 24; ++song) {
+        tracks.push_back(makePeaks(300, 200 + song));
+        reference.addTrack(song, sortify::testing::compactFingerprintOf(tracks.back()));
+    }
+    reference.build();
+
+    for (const char* directory : {"", "/tmp"}) {
+        ShardedIndexOptions options;
+        options.shardBits = 3;
+        options.segmentRecords = 2000;  // A few tracks per segment
+        options.backgroundCompaction = false;
+        options.compactionFanIn = 2;
+        options.compactionDirectory = directory;
+        ShardedIndex index(options);
+        EXPECT_EQ(index.shardCount(), 8u);
+        EXPECT_FALSE(index.query(sortify::testing::compactFingerprintOf(tracks[0])).isSuccess());
+
+        for (int song = 0; song < 24; ++song) {
+            ASSERT_TRUE(index.addTrack(song, sortify::testing::compactFingerprintOf(tracks[song])).isSuccess());
+        }
+        EXPECT_FALSE(index.addTrack(3, sortify::testing::compactFingerprintOf(tracks[3])).isSuccess());
+        index.flush();
+
+        const auto before = index.stats();
+        EXPECT_EQ(before.trackCount, 24u);
+        EXPECT_EQ(before.pendingTracks, 0u);
+        EXPECT_EQ(before.postingCount, reference.postingCount());
+        EXPECT_GT(before.segmentCount, index.shardCount());
+
+        auto check = [&] {
+            for (int song : {0, 7, 23}) {
+                const CompactFingerprint sample =
+                    sortify::testing::compactFingerprintOf(excerptPeaks(tracks[song], 50, 150));
+                auto expected = reference.query(sample, 5);
+                auto actual = index.query(sample, 5);
+                ASSERT_TRUE(actual.isSuccess()) << actual.getError();
+                expectSameCandidates(actual.getValue(), expected.getValue());
+                EXPECT_EQ(actual.getValue()[0].songId, song);
+            }
+        };
+        check();
+
+        EXPECT_GT(index.compact(), 0u);
+        const auto after = index.stats();
+        EXPECT_LT(after.segmentCount, before.segmentCount);
+        EXPECT_EQ(after.postingCount, reference.postingCount());
+        EXPECT_EQ(after.mappedSegments > 0, std::string(directory) == "/tmp") << directory;
+        check();
+    }
+}
+
+// Queries run without interruption while tracks are ingested and compacted in the background
+TEST(ShardedIndexTest, QueriesDuringIngestSeePublishedTracks) {
+    ShardedIndexOptions options;
+    options.shardBits = 2;
+    options.segmentRecords = 1500;
+    options.compactionFanIn = 3;
+    ShardedIndex index(options);
+
+    std::vector<std::vector<sortify::audio::Peak>> tracks;
+    for (int song = 0; song < 40; ++song) {
+        tracks.push_back(makePeaks(200, 500 + song));
+    }
+    ASSERT_TRUE(index.addTrack(0, sortify::testing::compactFingerprintOf(tracks[0])).isSuccess());
+    index.flush();
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> failures{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            const CompactFingerprint sample = sortify::testing::compactFingerprintOf(excerptPeaks(tracks[0], 20, 120));
+            size_t lastTracks = 0;
+            while (!done) {
+                auto result = index.query(sample, 3);
+                const size_t visible = index.stats().trackCount;
+                if (!result.isSuccess() || result.getValue().empty() || result.getValue()[0].songId != 0 ||
+                    visible < lastTracks) {
+                    failures++;
+                }
+                lastTracks = visible;
+            }
+        });
+    }
+
+    for (int song = 1; song < 40; ++song) {
+        ASSERT_TRUE(index.addTrack(song, sortify::testing::compactFingerprintOf(tracks[song])).isSuccess());
+    }
+    index.flush();
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(failures.load(), 0u);
+
+    EXPECT_EQ(index.stats().trackCount, 40u);
+    auto result = index.query(sortify::testing::compactFingerprintOf(excerptPeaks(tracks[31], 30, 130)), 1);
+    ASSERT_TRUE(result.isSuccess()) << result.getError();
+    EXPECT_EQ(result.getValue()[0].songId, 31);
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include "audio_fingerprint.hpp"
+
+// Helper function to generate a sine tone
+std::vector<float> generateTone(float frequency, float duration, unsigned int sampleRate) {
+    std::vector<float> samples(static_cast<size_t>(duration * sampleRate));
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = std::sin(2.0f * static_cast<float>(M_PI) * frequency * i / sampleRate);
+    }
+    return samples;
+}
+
+// Every frame must start on a cache line
+TEST(SpectrogramTest, FramesAreAligned) {
+    sortify::audio::Spectrogram spectrogram(10, 238);
+
+    EXPECT_EQ(spectrogram.numFrames(), 10u);
+    EXPECT_EQ(spectrogram.numBins(), 238u);
+    EXPECT_EQ(spectrogram.stride() % 16, 0u);
+    EXPECT_GE(spectrogram.stride(), 238u);
+
+    for (unsigned int t = 0; t < spectrogram.numFrames(); ++t) {
+        auto address = reinterpret_cast<std::uintptr_t>(spectrogram.frame(t).data());
+        EXPECT_EQ(address % sortify::audio::Spectrogram::frameAlignment, 0u) << "Frame " << t;
+    }
+}
+
+// Converting to the nested-vector layout and back must be lossless
+TEST(SpectrogramTest, LegacyRoundTrip) {
+    sortify::audio::LegacySpectrogram legacy(5, std::vector<float>(7));
+    for (size_t f = 0; f < legacy.size(); ++f) {
+        for (size_t t = 0; t < legacy[f].size(); ++t) {
+            legacy[f][t] = static_cast<float>(f * 100 + t);
+        }
+    }
+
+    auto spectrogram = sortify::audio::Spectrogram::fromLegacy(legacy);
+    ASSERT_EQ(spectrogram.numBins(), 5u);
+    ASSERT_EQ(spectrogram.numFrames(), 7u);
+    EXPECT_FLOAT_EQ(spectrogram.at(3, 2), 203.0f);
+
+    EXPECT_EQ(spectrogram.toLegacy(), legacy);
+}
+
+// A pure tone must produce its strongest bin at the tone's frequency in every frame
+TEST(SpectrogramTest, ToneLandsInExpectedBin) {
+    const unsigned int sampleRate = 44100;
+    const unsigned int windowSize = 2048;
+    auto samples = generateTone(1000.0f, 1.0f, sampleRate);
+
+    auto result = sortify::audio::generateSpectrogram(samples, sampleRate, windowSize);
+    ASSERT_TRUE(result.isSuccess()) << result.getError();
+    const auto& spectrogram = result.getValue();
+
+    // Bin 0 of the spectrogram is the first bin at or above minFreq
+    const unsigned int binSize = sampleRate / windowSize;
+    const unsigned int minBin = static_cast<unsigned int>(std::ceil(20.0f / binSize));
+    const float expectedBin = 1000.0f * windowSize / sampleRate - minBin;
+
+    for (unsigned int t = 0; t < spectrogram.numFrames(); ++t) {
+        auto frame = spectrogram.frame(t);
+        unsigned int strongest = 0;
+        for (unsigned int f = 0; f < frame.size(); ++f) {
+            if (frame[f] > frame[strongest]) strongest = f;
+        }
+        EXPECT_NEAR(static_cast<float>(strongest), expectedBin, 1.0f) << "Frame " << t;
+    }
+}
+
+// Too few samples for a single window is an error, not an underflow
+TEST(SpectrogramTest, RejectsInputShorterThanWindow) {
+    std::vector<float> samples(1000, 0.5f);
+    auto result = sortify::audio::generateSpectrogram(samples, 44100, 2048);
+    EXPECT_FALSE(result.isSuccess());
+}
+
+// The legacy overload of extractPeaks must agree with the native one
+TEST(SpectrogramTest, LegacyPeakExtractionMatches) {
+    auto samples = generateTone(440.0f, 1.0f, 44100);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] += 0.5f * std::sin(2.0f * static_cast<float>(M_PI) * 3000.0f * i / 44100);
+    }
+
+    auto spectrogram = sortify::audio::generateSpectrogram(samples, 44100);
+    ASSERT_TRUE(spectrogram.isSuccess()) << spectrogram.getError();
+
+    auto nativePeaks = sortify::audio::extractPeaks(spectrogram.getValue());
+    auto legacyPeaks = sortify::audio::extractPeaks(spectrogram.getValue().toLegacy());
+    ASSERT_TRUE(nativePeaks.isSuccess()) << nativePeaks.getError();
+    ASSERT_TRUE(legacyPeaks.isSuccess()) << legacyPeaks.getError();
+
+    ASSERT_EQ(nativePeaks.getValue().size(), legacyPeaks.getValue().size());
+    for (size_t i = 0; i < nativePeaks.getValue().size(); ++i) {
+        EXPECT_EQ(nativePeaks.getValue()[i].frequency, legacyPeaks.getValue()[i].frequency);
+        EXPECT_EQ(nativePeaks.getValue()[i].time, legacyPeaks.getValue()[i].time);
+    }
+}
+
+// Splitting windows across threads must not change a single magnitude
+TEST(SpectrogramTest, MultiThreadedMatchesSingleThreaded) {
+    auto samples = generateTone(440.0f, 3.0f, 44100);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] += 0.3f * std::sin(2.0f * static_cast<float>(M_PI) * 1234.0f * i / 44100);
+    }
+
+    auto single = sortify::audio::generateSpectrogram(samples, 44100, 2048, 0.5f, 20.0f, 5000.0f, 1);
+    auto multi = sortify::audio::generateSpectrogram(samples, 44100, 2048, 0.5f, 20.0f, 5000.0f, 4);
+    ASSERT_TRUE(single.isSuccess()) << single.getError();
+    ASSERT_TRUE(multi.isSuccess()) << multi.getError();
+
+    ASSERT_EQ(single.getValue().numFrames(), multi.getValue().numFrames());
+    ASSERT_EQ(single.getValue().numBins(), multi.getValue().numBins());
+    EXPECT_EQ(single.getValue().toLegacy(), multi.getValue().toLegacy());
+}
+
+// Generating into an existing spectrogram reuses its buffer and matches a fresh one
+TEST(SpectrogramTest, IntoReusesBuffer) {
+    const auto longTone = generateTone(440.0f, 2.0f, 44100);
+    const auto shortTone = generateTone(880.0f, 1.0f, 44100);
+
+    sortify::audio::Spectrogram reused;
+    auto first = sortify::audio::generateSpectrogramInto(longTone, reused);
+    ASSERT_TRUE(first.isSuccess()) << first.getError();
+    EXPECT_EQ(first.getValue(), reused.numFrames());
+    const float* buffer = reused.data();
+
+    auto second = sortify::audio::generateSpectrogramInto(shortTone, reused);
+    ASSERT_TRUE(second.isSuccess()) << second.getError();
+    EXPECT_EQ(reused.data(), buffer);
+
+    auto fresh = sortify::audio::generateSpectrogram(shortTone);
+    ASSERT_TRUE(fresh.isSuccess());
+    const sortify::audio::Spectrogram expected = std::move(fresh).take();
+    ASSERT_EQ(reused.numFrames(), expected.numFrames());
+    ASSERT_EQ(reused.numBins(), expected.numBins());
+    for (unsigned int t = 0; t < expected.numFrames(); ++t) {
+        for (unsigned int bin = 0; bin < expected.numBins(); ++bin) {
+            ASSERT_EQ(reused.at(t, bin), expected.at(t, bin));
+        }
+    }
+}
+
+// Batched FFTs over several tracks give each track its own spectrogram
+TEST(SpectrogramTest, BatchMatchesPerTrack) {
+    const std::vector<std::vector<float>> tracks = {
+        generateTone(440.0f, 0.5f, 44100),
+        generateTone(1000.0f, 0.02f, 44100),  // shorter than one window
+        generateTone(2500.0f, 0.3f, 44100),
+    };
+
+    // A batch size that does not divide the window count exercises the partial last batch
+    auto batch = sortify::audio::generateSpectrogramBatch(tracks, 44100, 2048, 0.5f, 20.0f, 5000.0f, 7);
+    ASSERT_EQ(batch.size(), tracks.size());
+    EXPECT_FALSE(batch[1].isSuccess());
+
+    for (size_t track : {size_t(0), size_t(2)}) {
+        ASSERT_TRUE(batch[track].isSuccess()) << batch[track].getError();
+        auto single = sortify::audio::generateSpectrogram(tracks[track], 44100, 2048, 0.5f, 20.0f, 5000.0f);
+        ASSERT_TRUE(single.isSuccess());
+        const auto& expected = single.getValue();
+        const auto& actual = batch[track].getValue();
+        ASSERT_EQ(actual.numFrames(), expected.numFrames());
+        ASSERT_EQ(actual.numBins(), expected.numBins());
+        for (unsigned int t = 0; t < expected.numFrames(); ++t) {
+            for (unsigned int bin = 0; bin < expected.numBins(); ++bin) {
+                ASSERT_NEAR(actual.at(t, bin), expected.at(t, bin), 1e-3f + 1e-5f * expected.at(t, bin));
+            }
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef SYNTHETIC_SIGNALS_HPP
+#define SYNTHETIC_SIGNALS_HPP
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include "audio_fingerprint.hpp"
+#include "compact_fingerprint.hpp"
+
+namespace sortify {
+namespace testing {
+
+/**
+ * Generates a deterministic melody with noise
+ *
+ * @param duration Length in seconds
+ * @param sampleRate Sample rate (Hz)
+ * @param seed Varies the notes and the noise, so different seeds give different tracks
+ * @return Mono samples
+ */
+inline std::vector<float> generateMelody(float duration, unsigned int sampleRate, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+    std::uniform_int_distribution<int> noteOffset(0, 11);
+    const int shift = noteOffset(rng);
+
+    std::vector<float> samples(static_cast<size_t>(duration * sampleRate));
+    for (size_t i = 0; i < samples.size(); ++i) {
+        double t = static_cast<double>(i) / sampleRate;
+        int note = (static_cast<int>(t * 4) * (seed % 5 + 1) + shift) % 13;
+        double f = 220.0 * std::pow(2.0, note / 6.0);
+        samples[i] = static_cast<float>(0.5 * std::sin(2 * M_PI * f * t) +
+                                        0.2 * std::sin(2 * M_PI * (1000 + 150 * note) * t)) + noise(rng);
+    }
+    return samples;
+}
+
+/**
+ * Builds a synthetic constellation with up to three distinct peaks per frame
+ *
+ * @param numFrames Number of frames
+ * @param seed Seed for the pseudo-random bins
+ * @return Peaks sorted by time, then frequency
+ */
+inline std::vector<audio::Peak> makePeaks(unsigned int numFrames, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> bin(0, 200);
+    std::vector<audio::Peak> peaks;
+    for (unsigned int t = 0; t < numFrames; ++t) {
+        std::vector<int> bins = {bin(rng), bin(rng), bin(rng)};
+        std::sort(bins.begin(), bins.end());
+        bins.erase(std::unique(bins.begin(), bins.end()), bins.end());
+        for (int f : bins) {
+            peaks.push_back({static_cast<float>(f), static_cast<float>(t), 1.0f});
+        }
+    }
+    return peaks;
+}
+
+/**
+ * Peaks of frames [first, last), re-timed to start at frame 0
+ */
+inline std::vector<audio::Peak> excerptPeaks(const std::vector<audio::Peak>& peaks,
+                                             unsigned int first, unsigned int last) {
+    std::vector<audio::Peak> result;
+    for (const auto& peak : peaks) {
+        if (peak.time >= first && peak.time < last) {
+            result.push_back({peak.frequency, peak.time - first, peak.magnitude});
+        }
+    }
+    return result;
+}
+
+/**
+ * Compact fingerprint of a synthetic constellation (empty on failure)
+ */
+inline audio::CompactFingerprint compactFingerprintOf(const std::vector<audio::Peak>& peaks) {
+    auto result = audio::createCompactFingerprint(peaks);
+    return result.isSuccess() ? result.getValue() : audio::CompactFingerprint();
+}
+
+/**
+ * Writes mono samples as a 16-bit PCM WAV file
+ *
+ * @return true if the file was written
+ */
+inline bool writeWav16(const std::string& path, const std::vector<float>& samples, unsigned int sampleRate) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    auto put32 = [&](uint32_t v) { file.write(reinterpret_cast<const char*>(&v), 4); };
+    auto put16 = [&](uint16_t v) { file.write(reinterpret_cast<const char*>(&v), 2); };
+
+    const uint32_t dataSize = static_cast<uint32_t>(samples.size() * 2);
+    file.write("RIFF", 4);
+    put32(36 + dataSize);
+    file.write("WAVEfmt ", 8);
+    put32(16);
+    put16(1);
+    put16(1);
+    put32(sampleRate);
+    put32(sampleRate * 2);
+    put16(2);
+    put16(16);
+    file.write("data", 4);
+    put32(dataSize);
+    for (float sample : samples) {
+        const float clipped = std::max(-1.0f, std::min(1.0f, sample));
+        put16(static_cast<uint16_t>(static_cast<int16_t>(std::lround(clipped * 32767.0f))));
+    }
+    return static_cast<bool>(file);
+}
+
+} // namespace testing
+} // namespace sortify
+
+#endif // SYNTHETIC_SIGNALS_HPP
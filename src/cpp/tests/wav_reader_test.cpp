@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <random>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+#include "wav_reader.hpp"
+#include "pcm_convert.hpp"
+#include "audio_reader.hpp"
+
+using sortify::audio::PcmEncoding;
+using sortify::audio::SimdLevel;
+using sortify::audio::WavFile;
+
+namespace {
+
+void appendUint16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
+
+void appendUint32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back((value >> (8 * i)) & 0xFF);
+}
+
+void appendChunk(std::vector<uint8_t>& out, const char* id, const std::vector<uint8_t>& body) {
+    out.insert(out.end(), id, id + 4);
+    appendUint32(out, static_cast<uint32_t>(body.size()));
+    out.insert(out.end(), body.begin(), body.end());
+    if (body.size() & 1) out.push_back(0);
+}
+
+/**
+ * Builds a WAV file with an odd-sized chunk before "fmt " to exercise padding
+ */
+std::vector<uint8_t> buildWav(uint16_t formatTag, uint16_t channels, uint16_t bits,
+                              const std::vector<uint8_t>& data, bool extensible) {
+    std::vector<uint8_t> fmt;
+    appendUint16(fmt, extensible ? 0xFFFE : formatTag);
+    appendUint16(fmt, channels);
+    appendUint32(fmt, 44100);
+    appendUint32(fmt, 44100u * channels * bits / 8);
+    appendUint16(fmt, channels * bits / 8);
+    appendUint16(fmt, bits);
+    if (extensible) {
+        appendUint16(fmt, 22);
+        appendUint16(fmt, bits);
+        appendUint32(fmt, 0);
+        appendUint16(fmt, formatTag);
+        const uint8_t guidTail[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00,
+                                      0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+        fmt.insert(fmt.end(), guidTail, guidTail + 14);
+    }
+
+    std::vector<uint8_t> chunks;
+    appendChunk(chunks, "LIST", {'I', 'N', 'F', 'O', 'x'});
+    appendChunk(chunks, "fmt ", fmt);
+    appendChunk(chunks, "data", data);
+
+    std::vector<uint8_t> file = {'R', 'I', 'F', 'F'};
+    appendUint32(file, static_cast<uint32_t>(chunks.size() + 4));
+    file.insert(file.end(), {'W', 'A', 'V', 'E'});
+    file.insert(file.end(), chunks.begin(), chunks.end());
+    return file;
+}
+
+std::string writeTempFile(const std::vector<uint8_t>& bytes, const char* name) {
+    const std::string path = "/tmp/sortify_" + std::string(name) + "_" + std::to_string(::getpid()) + ".wav";
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return path;
+}
+
+template<typename T>
+std::vector<uint8_t> toBytes(const std::vector<T>& values) {
+    std::vector<uint8_t> bytes(values.size() * sizeof(T));
+    std::memcpy(bytes.data(), values.data(), bytes.size());
+    return bytes;
+}
+
+} // namespace
+
+// Stereo frames of every encoding are decoded and averaged to the same values
+TEST(WavReaderTest, ReadsAllEncodings) {
+    // Left = +0.5, right = -0.25 of full scale, so the mono mix is 0.125
+    struct Case { const char* name; uint16_t tag; uint16_t bits; std::vector<uint8_t> frame; };
+    const std::vector<Case> cases = {
+        {"u8", 1, 8, {192, 96}},
+        {"i16", 1, 16, toBytes(std::vector<int16_t>{16384, -8192})},
+        {"i24", 1, 24, {0x00, 0x00, 0x40, 0x00, 0x00, 0xE0}},
+        {"i32", 1, 32, toBytes(std::vector<int32_t>{1 << 30, -(1 << 29)})},
+        {"f32", 3, 32, toBytes(std::vector<float>{0.5f, -0.25f})},
+        {"f64", 3, 64, toBytes(std::vector<double>{0.5, -0.25})},
+    };
+
+    for (const auto& c : cases) {
+        for (bool extensible : {false, true}) {
+            std::vector<uint8_t> data;
+            for (int i = 0; i < 37; ++i) data.insert(data.end(), c.frame.begin(), c.frame.end());
+            const std::string path = writeTempFile(buildWav(c.tag, 2, c.bits, data, extensible), c.name);
+
+            WavFile file(path);
+            ASSERT_TRUE(file.isValid()) << c.name << ": " << file.getError();
+            EXPECT_EQ(file.format().numChannels, 2u);
+            EXPECT_EQ(file.format().sampleRate, 44100u);
+            ASSERT_EQ(file.format().numFrames, 37u) << c.name;
+
+            std::vector<float> samples;
+            file.readAll(samples);
+            for (float sample : samples) {
+                ASSERT_FLOAT_EQ(sample, 0.125f) << c.name << (extensible ? " (extensible)" : "");
+            }
+
+            // Reads past the end are clipped to the available frames
+            std::vector<float> tail(10);
+            EXPECT_EQ(file.read(30, 10, tail.data()), 7u);
+            EXPECT_EQ(file.read(37, 10, tail.data()), 0u);
+            std::remove(path.c_str());
+        }
+    }
+}
+
+// Every SIMD level converts exactly like the scalar loop, for any length
+TEST(WavReaderTest, SimdConversionMatchesScalar) {
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> value(-32768, 32767);
+    std::uniform_real_distribution<float> real(-1.0f, 1.0f);
+
+    std::vector<int16_t> ints(2 * 1031);
+    std::vector<float> floats(2 * 1031);
+    for (auto& v : ints) v = static_cast<int16_t>(value(rng));
+    for (auto& v : floats) v = real(rng);
+
+    for (unsigned int channels : {1u, 2u}) {
+        for (size_t frames : {0ul, 3ul, 8ul, 17ul, 1031ul}) {
+            for (PcmEncoding encoding : {PcmEncoding::INT16, PcmEncoding::FLOAT32}) {
+                const uint8_t* data = encoding == PcmEncoding::INT16
+                    ? reinterpret_cast<const uint8_t*>(ints.data())
+                    : reinterpret_cast<const uint8_t*>(floats.data());
+
+                std::vector<float> expected(frames + 1, -7.0f);
+                sortify::audio::convertPcmToMono(data, frames, channels, encoding, expected.data(), SimdLevel::SCALAR);
+                EXPECT_EQ(expected[frames], -7.0f) << "wrote past the output";
+
+                for (SimdLevel level : {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON}) {
+                    if (!sortify::audio::isSimdLevelSupported(level)) continue;
+                    std::vector<float> actual(frames + 1, -7.0f);
+                    sortify::audio::convertPcmToMono(data, frames, channels, encoding, actual.data(), level);
+                    EXPECT_EQ(actual, expected) << sortify::audio::simdLevelName(level)
+                                                << " channels=" << channels << " frames=" << frames;
+                }
+            }
+        }
+    }
+}
+
+// Truncated data chunks are clipped; unsupported or broken files are rejected
+TEST(WavReaderTest, HandlesDamagedFiles) {
+    std::vector<uint8_t> data = toBytes(std::vector<int16_t>(100, 1000));
+    std::vector<uint8_t> wav = buildWav(1, 1, 16, data, false);
+    wav.resize(wav.size() - 51);  // cut into the data chunk, leaving a partial frame
+    std::string path = writeTempFile(wav, "truncated");
+    {
+        WavFile file(path);
+        ASSERT_TRUE(file.isValid()) << file.getError();
+        EXPECT_EQ(file.format().numFrames, 74u);
+        EXPECT_EQ(sortify::audio::AudioReader::loadWavFile(path, false).size(), 74u);
+    }
+    std::remove(path.c_str());
+
+    path = writeTempFile(buildWav(2, 1, 16, data, false), "adpcm");
+    EXPECT_FALSE(WavFile(path).isValid());
+    std::remove(path.c_str());
+
+    path = writeTempFile({'R', 'I', 'F', 'F', 0, 0, 0, 0, 'A', 'V', 'I', ' '}, "avi");
+    EXPECT_FALSE(WavFile(path).isValid());
+    EXPECT_TRUE(sortify::audio::AudioReader::loadWavFile(path).empty());
+    std::remove(path.c_str());
+
+    EXPECT_FALSE(WavFile("/nonexistent/file.wav").isValid());
+}